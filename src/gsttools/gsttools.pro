@@ -35,7 +35,9 @@ INCLUDEPATH += ../multimedia/gsttools_headers/
 VPATH += ../multimedia/gsttools_headers/
 
 PRIVATE_HEADERS += \
+    qgstaudiobuffer_p.h \
     qgstbufferpoolinterface_p.h \
+    qgstsharedmemorybufferpool_p.h \
     qgstreamerbushelper_p.h \
     qgstreamermessage_p.h \
     qgstutils_p.h \
@@ -52,7 +54,9 @@ PRIVATE_HEADERS += \
     qgstreamervideowindow_p.h
 
 SOURCES += \
+    qgstaudiobuffer.cpp \
     qgstbufferpoolinterface.cpp \
+    qgstsharedmemorybufferpool.cpp \
     qgstreamerbushelper.cpp \
     qgstreamermessage.cpp \
     qgstutils.cpp \
@@ -40,10 +40,150 @@
 ****************************************************************************/
 
 #include <QDebug>
+#include <QtCore/qbuffer.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qlist.h>
 
 #include "qgstappsrc_p.h"
 #include <QtNetwork>
 
+#include <sys/mman.h>
+
+// Blocks handed out to GstBuffers on the generic (copying) path are
+// returned here when GStreamer releases the buffer, so steady state
+// streaming doesn't allocate.
+class QGstAppSrcBufferPool
+{
+public:
+    struct Block
+    {
+        QGstAppSrcBufferPool *pool;
+        int capacity;
+    };
+
+    QGstAppSrcBufferPool() : m_ref(1), m_blockSize(0) {}
+
+    void ref() { m_ref.ref(); }
+    void deref()
+    {
+        if (!m_ref.deref())
+            delete this;
+    }
+
+    static char *data(Block *block) { return reinterpret_cast<char *>(block + 1); }
+
+    Block *take(int size, bool *allocated)
+    {
+        {
+            QMutexLocker locker(&m_mutex);
+            if (size > m_blockSize) {
+                // Requests only grow in practice, drop the smaller blocks
+                foreach (Block *block, m_freeBlocks)
+                    g_free(block);
+                m_freeBlocks.clear();
+                m_blockSize = size;
+            }
+
+            if (!m_freeBlocks.isEmpty()) {
+                *allocated = false;
+                ref();
+                return m_freeBlocks.takeLast();
+            }
+            size = m_blockSize;
+        }
+
+        Block *block = static_cast<Block *>(g_malloc(sizeof(Block) + size));
+        block->pool = this;
+        block->capacity = size;
+        *allocated = true;
+        ref();
+        return block;
+    }
+
+    static void recycle(gpointer data)
+    {
+        Block *block = static_cast<Block *>(data);
+        QGstAppSrcBufferPool *pool = block->pool;
+
+        {
+            QMutexLocker locker(&pool->m_mutex);
+            if (block->capacity == pool->m_blockSize && pool->m_freeBlocks.size() < MaxFreeBlocks) {
+                pool->m_freeBlocks.append(block);
+                block = 0;
+            }
+        }
+
+        if (block)
+            g_free(block);
+        pool->deref();
+    }
+
+private:
+    enum { MaxFreeBlocks = 16 };
+
+    ~QGstAppSrcBufferPool()
+    {
+        foreach (Block *block, m_freeBlocks)
+            g_free(block);
+    }
+
+    QAtomicInt m_ref;
+    QMutex m_mutex;
+    QList<Block *> m_freeBlocks;
+    int m_blockSize;
+};
+
+// Memory a zero-copy stream is read from, shared by every GstBuffer
+// wrapping part of it.
+class QGstAppSrcMemory
+{
+public:
+    QGstAppSrcMemory(const QByteArray &bytes)
+        : m_ref(1)
+        , m_bytes(bytes)
+        , m_mapped(0)
+        , m_data(m_bytes.constData())
+        , m_size(m_bytes.size())
+    {
+    }
+
+    QGstAppSrcMemory(void *mapped, qint64 size)
+        : m_ref(1)
+        , m_mapped(mapped)
+        , m_data(static_cast<const char *>(mapped))
+        , m_size(size)
+    {
+    }
+
+    void ref() { m_ref.ref(); }
+
+    static void release(gpointer data)
+    {
+        QGstAppSrcMemory *memory = static_cast<QGstAppSrcMemory *>(data);
+        if (!memory->m_ref.deref())
+            delete memory;
+    }
+
+    const char *data() const { return m_data; }
+    qint64 size() const { return m_size; }
+
+private:
+    ~QGstAppSrcMemory()
+    {
+        if (m_mapped)
+            munmap(m_mapped, m_size);
+    }
+
+    QAtomicInt m_ref;
+    QByteArray m_bytes;
+    void *m_mapped;
+    const char *m_data;
+    qint64 m_size;
+};
+
+// Default block size when appsrc doesn't ask for a specific amount
+static const unsigned int qt_appsrcMemoryBlockSize = 64 * 1024;
+
 QGstAppSrc::QGstAppSrc(QObject *parent)
     :QObject(parent)
     ,m_stream(0)
@@ -55,6 +195,11 @@ QGstAppSrc::QGstAppSrc(QObject *parent)
     ,m_dataRequested(false)
     ,m_enoughData(false)
     ,m_forceData(false)
+    ,m_pool(new QGstAppSrcBufferPool)
+    ,m_memory(0)
+    ,m_memoryOffset(0)
+    ,m_bytesPushed(0)
+    ,m_allocations(0)
 {
     m_callbacks.need_data   = &QGstAppSrc::on_need_data;
     m_callbacks.enough_data = &QGstAppSrc::on_enough_data;
@@ -65,6 +210,9 @@ QGstAppSrc::~QGstAppSrc()
 {
     if (m_appSrc)
         gst_object_unref(G_OBJECT(m_appSrc));
+
+    releaseMemory();
+    m_pool->deref();
 }
 
 bool QGstAppSrc::setup(GstElement* appsrc)
@@ -84,9 +232,143 @@ bool QGstAppSrc::setup(GstElement* appsrc)
     gst_app_src_set_stream_type(m_appSrc, m_streamType);
     gst_app_src_set_size(m_appSrc, (m_sequential) ? -1 : m_stream->size());
 
+    setupMemory();
+
+    {
+        QMutexLocker locker(&m_statisticsMutex);
+        m_bytesPushed = 0;
+        m_allocations = 0;
+        m_statisticsTimer.start();
+    }
+
     return  m_setup = true;
 }
 
+void QGstAppSrc::setupMemory()
+{
+    releaseMemory();
+
+    if (m_sequential || (m_stream->openMode() & QIODevice::WriteOnly))
+        return;
+
+    QGstAppSrcMemory *memory = 0;
+
+    if (QBuffer *buffer = qobject_cast<QBuffer *>(m_stream)) {
+        memory = new QGstAppSrcMemory(buffer->data());
+    } else if (QFile *file = qobject_cast<QFile *>(m_stream)) {
+        const qint64 size = file->size();
+        // Keep mappings within a reasonable share of the address space
+        const bool fits = sizeof(void *) > 4 || size < Q_INT64_C(256) * 1024 * 1024;
+        if (file->handle() >= 0 && size > 0 && fits) {
+            void *mapped = mmap(0, size, PROT_READ, MAP_SHARED, file->handle(), 0);
+            if (mapped != MAP_FAILED)
+                memory = new QGstAppSrcMemory(mapped, size);
+        }
+    }
+
+    if (memory) {
+        QMutexLocker locker(&m_memoryMutex);
+        m_memory = memory;
+        m_memoryOffset = m_stream->pos();
+    }
+}
+
+void QGstAppSrc::releaseMemory()
+{
+    QMutexLocker locker(&m_memoryMutex);
+    if (m_memory) {
+        QGstAppSrcMemory::release(m_memory);
+        m_memory = 0;
+    }
+}
+
+bool QGstAppSrc::isZeroCopy() const
+{
+    QMutexLocker locker(&m_memoryMutex);
+    return m_memory != 0;
+}
+
+// Called from the streaming thread, the stream object itself is not touched
+bool QGstAppSrc::pushMemory(unsigned int size)
+{
+    QMutexLocker locker(&m_memoryMutex);
+    if (!m_memory || !m_appSrc)
+        return false;
+
+    const qint64 remaining = m_memory->size() - m_memoryOffset;
+    if (remaining <= 0) {
+        // sendEOS() rewinds the stream, leave that to the owner thread
+        m_dataRequested = false;
+        QMetaObject::invokeMethod(this, "sendEOS", Qt::QueuedConnection);
+        return true;
+    }
+
+    if (size == (unsigned int)-1 || size == 0)
+        size = qt_appsrcMemoryBlockSize;
+
+    const int chunk = int(qMin<qint64>(size, remaining));
+    m_memory->ref();
+    GstBuffer *buffer = gst_app_buffer_new((gpointer)(m_memory->data() + m_memoryOffset),
+                                           chunk, QGstAppSrcMemory::release, m_memory);
+    buffer->offset = m_memoryOffset;
+    buffer->offset_end = m_memoryOffset + chunk - 1;
+    m_memoryOffset += chunk;
+    m_dataRequested = false;
+    locker.unlock();
+
+    updateStatistics(chunk, false);
+
+    GstFlowReturn ret = gst_app_src_push_buffer(m_appSrc, buffer);
+    if (ret == GST_FLOW_ERROR)
+        qWarning()<<"appsrc: push buffer error";
+
+    return true;
+}
+
+bool QGstAppSrc::seekMemory(qint64 offset)
+{
+    QMutexLocker locker(&m_memoryMutex);
+    if (!m_memory || offset < 0 || offset > m_memory->size())
+        return false;
+
+    m_memoryOffset = offset;
+    return true;
+}
+
+void QGstAppSrc::updateStatistics(qint64 bytes, bool allocated)
+{
+    QMutexLocker locker(&m_statisticsMutex);
+    m_bytesPushed += bytes;
+    if (allocated)
+        ++m_allocations;
+}
+
+qint64 QGstAppSrc::bytesPushed() const
+{
+    QMutexLocker locker(&m_statisticsMutex);
+    return m_bytesPushed;
+}
+
+int QGstAppSrc::allocationCount() const
+{
+    QMutexLocker locker(&m_statisticsMutex);
+    return m_allocations;
+}
+
+qreal QGstAppSrc::bytesPerSecond() const
+{
+    QMutexLocker locker(&m_statisticsMutex);
+    const qint64 elapsed = m_statisticsTimer.isValid() ? m_statisticsTimer.elapsed() : 0;
+    return elapsed > 0 ? m_bytesPushed * qreal(1000) / elapsed : 0;
+}
+
+qreal QGstAppSrc::allocationsPerSecond() const
+{
+    QMutexLocker locker(&m_statisticsMutex);
+    const qint64 elapsed = m_statisticsTimer.isValid() ? m_statisticsTimer.elapsed() : 0;
+    return elapsed > 0 ? m_allocations * qreal(1000) / elapsed : 0;
+}
+
 void QGstAppSrc::setStream(QIODevice *stream)
 {
     if (stream == 0)
@@ -98,6 +380,8 @@ void QGstAppSrc::setStream(QIODevice *stream)
     if (m_appSrc)
         gst_object_unref(G_OBJECT(m_appSrc));
 
+    releaseMemory();
+
     m_dataRequestSize = -1;
     m_dataRequested = false;
     m_enoughData = false;
@@ -124,6 +408,10 @@ GstAppSrc *QGstAppSrc::element()
 
 void QGstAppSrc::onDataReady()
 {
+    // Zero-copy streams are pushed on demand from the streaming thread
+    if (isZeroCopy())
+        return;
+
     if (!m_enoughData) {
         m_dataRequested = true;
         pushDataToAppSrc();
@@ -151,13 +439,19 @@ void QGstAppSrc::pushDataToAppSrc()
             size = qMin(m_stream->bytesAvailable(), (qint64)m_dataRequestSize);
 
         if (size) {
-            void *data = g_malloc(size);
-            GstBuffer* buffer = gst_app_buffer_new(data, size, g_free, data);
-            buffer->offset = m_stream->pos();
-            qint64 bytesRead = m_stream->read((char*)GST_BUFFER_DATA(buffer), size);
+            bool allocated = false;
+            QGstAppSrcBufferPool::Block *block = m_pool->take(size, &allocated);
+            qint64 bytesRead = m_stream->read(QGstAppSrcBufferPool::data(block), size);
+
+            GstBuffer* buffer = gst_app_buffer_new(QGstAppSrcBufferPool::data(block), qMax<qint64>(bytesRead, 0),
+                                                   QGstAppSrcBufferPool::recycle, block);
+            buffer->offset = m_stream->pos() - qMax<qint64>(bytesRead, 0);
             buffer->offset_end =  buffer->offset + bytesRead - 1;
 
-            if (bytesRead > 0) {
+            if (bytesRead <= 0) {
+                gst_buffer_unref(buffer);
+            } else {
+                updateStatistics(bytesRead, allocated);
                 m_dataRequested = false;
                 m_enoughData = false;
                 GstFlowReturn ret = gst_app_src_push_buffer (GST_APP_SRC (element()), buffer);
@@ -189,6 +483,9 @@ gboolean QGstAppSrc::on_seek_data(GstAppSrc *element, guint64 arg0, gpointer use
 {
     Q_UNUSED(element);
     QGstAppSrc *self = reinterpret_cast<QGstAppSrc*>(userdata);
+    if (self && self->seekMemory(arg0))
+        return true;
+
     if (self && self->isStreamValid()) {
         if (!self->stream()->isSequential())
             QMetaObject::invokeMethod(self, "doSeek", Qt::AutoConnection, Q_ARG(qint64, arg0));
@@ -215,7 +512,8 @@ void QGstAppSrc::on_need_data(GstAppSrc *element, guint arg0, gpointer userdata)
         self->dataRequested() = true;
         self->enoughData() = false;
         self->dataRequestSize()= arg0;
-        QMetaObject::invokeMethod(self, "pushDataToAppSrc", Qt::AutoConnection);
+        if (!self->pushMemory(arg0))
+            QMetaObject::invokeMethod(self, "pushDataToAppSrc", Qt::AutoConnection);
     }
 }
 
@@ -40,12 +40,22 @@
 ****************************************************************************/
 
 #include "qgstreameraudioprobecontrol_p.h"
+#include "qgstaudiobuffer_p.h"
 #include <private/qgstutils_p.h>
 
+// Buffers waiting for the control's thread, about half a second of
+// typical 10-20 ms buffers. QT_GSTREAMER_PROBE_QUEUE_SIZE overrides it.
+static const int defaultAudioProbeQueueCapacity = 32;
+
 QGstreamerAudioProbeControl::QGstreamerAudioProbeControl(QObject *parent)
     : QMediaAudioProbeControl(parent)
+    , m_queueCapacity(defaultAudioProbeQueueCapacity)
+    , m_directDelivery(false)
+    , m_overflowCount(0)
 {
-
+    const int capacity = qgetenv("QT_GSTREAMER_PROBE_QUEUE_SIZE").toInt();
+    if (capacity > 0)
+        m_queueCapacity = capacity;
 }
 
 QGstreamerAudioProbeControl::~QGstreamerAudioProbeControl()
@@ -53,6 +63,43 @@ QGstreamerAudioProbeControl::~QGstreamerAudioProbeControl()
 
 }
 
+/*
+    When direct delivery is enabled audioBufferProbed() is emitted from the
+    streaming thread, receivers connected with Qt::DirectConnection see every
+    buffer without any queueing. Otherwise buffers are queued for the thread
+    of the control; when the queue is full the oldest buffer is dropped and
+    counted in overflowCount().
+*/
+bool QGstreamerAudioProbeControl::directDelivery() const
+{
+    QMutexLocker locker(&m_bufferMutex);
+    return m_directDelivery;
+}
+
+void QGstreamerAudioProbeControl::setDirectDelivery(bool direct)
+{
+    QMutexLocker locker(&m_bufferMutex);
+    m_directDelivery = direct;
+}
+
+int QGstreamerAudioProbeControl::queueCapacity() const
+{
+    QMutexLocker locker(&m_bufferMutex);
+    return m_queueCapacity;
+}
+
+void QGstreamerAudioProbeControl::setQueueCapacity(int capacity)
+{
+    QMutexLocker locker(&m_bufferMutex);
+    m_queueCapacity = qMax(1, capacity);
+}
+
+qulonglong QGstreamerAudioProbeControl::overflowCount() const
+{
+    QMutexLocker locker(&m_bufferMutex);
+    return m_overflowCount;
+}
+
 void QGstreamerAudioProbeControl::bufferProbed(GstBuffer* buffer)
 {
     GstCaps* caps = gst_buffer_get_caps(buffer);
@@ -64,23 +111,36 @@ void QGstreamerAudioProbeControl::bufferProbed(GstBuffer* buffer)
     if (!format.isValid())
         return;
 
-    QAudioBuffer audioBuffer = QAudioBuffer(QByteArray((const char*)buffer->data, buffer->size), format);
+    // References the GstBuffer, the samples are copied only if a receiver writes to them
+    QAudioBuffer audioBuffer = QAudioBuffer(new QGstAudioBuffer(buffer, format));
 
     {
         QMutexLocker locker(&m_bufferMutex);
-        m_pendingBuffer = audioBuffer;
-        QMetaObject::invokeMethod(this, "bufferProbed", Qt::QueuedConnection);
+        if (!m_directDelivery) {
+            // Only the first pending buffer needs to wake up the receiving thread
+            if (m_pendingBuffers.isEmpty())
+                QMetaObject::invokeMethod(this, "bufferProbed", Qt::QueuedConnection);
+
+            if (m_pendingBuffers.size() >= m_queueCapacity) {
+                m_pendingBuffers.dequeue();
+                ++m_overflowCount;
+            }
+            m_pendingBuffers.enqueue(audioBuffer);
+            return;
+        }
     }
+
+    emit audioBufferProbed(audioBuffer);
 }
 
 void QGstreamerAudioProbeControl::bufferProbed()
 {
-    QAudioBuffer audioBuffer;
+    QQueue<QAudioBuffer> buffers;
     {
         QMutexLocker locker(&m_bufferMutex);
-        if (!m_pendingBuffer.isValid())
-            return;
-        audioBuffer = m_pendingBuffer;
+        buffers.swap(m_pendingBuffers);
     }
-    emit audioBufferProbed(audioBuffer);
+
+    while (!buffers.isEmpty())
+        emit audioBufferProbed(buffers.dequeue());
 }
@@ -40,90 +40,105 @@
 ****************************************************************************/
 
 #include <QtCore/qmap.h>
-#include <QtCore/qtimer.h>
 #include <QtCore/qmutex.h>
 #include <QtCore/qlist.h>
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qcoreevent.h>
+#include <QtCore/qpointer.h>
 
 #include "qgstreamerbushelper_p.h"
 
 QT_BEGIN_NAMESPACE
 
+static QEvent::Type dispatchEventType()
+{
+    static const QEvent::Type type = QEvent::Type(QEvent::registerEventType());
+    return type;
+}
 
+/*
+    The sync handler queues the messages that pass the sync filters and
+    wakes the helper's thread with a posted event. The event delivers every
+    message queued by then, so a burst of messages is handled in one pass
+    and nothing is polled while the pipeline is idle.
+*/
 class QGstreamerBusHelperPrivate : public QObject
 {
-    Q_OBJECT
 public:
     QGstreamerBusHelperPrivate(QGstreamerBusHelper *parent, GstBus* bus) :
         QObject(parent),
         m_bus(bus),
         m_helper(parent)
     {
-#ifdef QT_NO_GLIB
-        Q_UNUSED(bus);
-
-        m_intervalTimer = new QTimer(this);
-        m_intervalTimer->setInterval(250);
-
-        connect(m_intervalTimer, SIGNAL(timeout()), SLOT(interval()));
-        m_intervalTimer->start();
-#else
-        m_tag = gst_bus_add_watch_full(bus, 0, busCallback, this, NULL);
-#endif
-
+        // Messages posted before the sync handler was installed are
+        // waiting on the bus
+        QCoreApplication::postEvent(this, new QEvent(dispatchEventType()));
     }
 
     ~QGstreamerBusHelperPrivate()
     {
         m_helper = 0;
-#ifdef QT_NO_GLIB
-        m_intervalTimer->stop();
-#else
-        g_source_remove(m_tag);
-#endif
+
+        foreach (GstMessage *message, m_pendingMessages)
+            gst_message_unref(message);
     }
 
     GstBus* bus() const { return m_bus; }
 
-private slots:
-    void interval()
+    // Called from the thread posting the message
+    void queueMessage(GstMessage* message)
     {
-        GstMessage* message;
-        while ((message = gst_bus_poll(m_bus, GST_MESSAGE_ANY, 0)) != 0) {
-            processMessage(message);
-            gst_message_unref(message);
-        }
-    }
+        QMutexLocker locker(&m_queueMutex);
 
-private:
-    void processMessage(GstMessage* message)
-    {
-        QGstreamerMessage msg(message);
-        doProcessMessage(msg);
+        gst_message_ref(message);
+        m_pendingMessages.append(message);
+
+        // The first message of a burst wakes the helper's thread
+        if (m_pendingMessages.count() == 1)
+            QCoreApplication::postEvent(this, new QEvent(dispatchEventType()));
     }
 
-    void queueMessage(GstMessage* message)
+protected:
+    bool event(QEvent *event)
     {
-        QGstreamerMessage msg(message);
-        QMetaObject::invokeMethod(this, "doProcessMessage", Qt::QueuedConnection,
-                                  Q_ARG(QGstreamerMessage, msg));
+        if (event->type() == dispatchEventType()) {
+            dispatch();
+            return true;
+        }
+
+        return QObject::event(event);
     }
 
-    static gboolean busCallback(GstBus *bus, GstMessage *message, gpointer data)
+private:
+    void dispatch()
     {
-        Q_UNUSED(bus);
-        reinterpret_cast<QGstreamerBusHelperPrivate*>(data)->queueMessage(message);
-        return TRUE;
-    }
+        // A message handler may delete the helper
+        QPointer<QObject> guard(this);
 
-    guint m_tag;
-    GstBus* m_bus;
-    QGstreamerBusHelper*  m_helper;
-#ifdef QT_NO_GLIB
-    QTimer*     m_intervalTimer;
-#endif
+        GstMessage* message;
+        while (guard && m_helper && (message = gst_bus_pop(m_bus)) != 0) {
+            processMessage(QGstreamerMessage(message));
+            gst_message_unref(message);
+        }
+
+        if (!guard)
+            return;
+
+        // Messages queued while these are processed post a new event
+        QList<GstMessage*> messages;
+        {
+            QMutexLocker locker(&m_queueMutex);
+            messages.swap(m_pendingMessages);
+        }
 
-private slots:
-    void doProcessMessage(const QGstreamerMessage& msg)
+        foreach (GstMessage *message, messages) {
+            if (guard && m_helper)
+                processMessage(QGstreamerMessage(message));
+            gst_message_unref(message);
+        }
+    }
+
+    void processMessage(const QGstreamerMessage& msg)
     {
         foreach (QGstreamerBusMessageFilter *filter, busFilters) {
             if (filter->processBusMessage(msg))
@@ -132,6 +147,11 @@ private slots:
         emit m_helper->message(msg);
     }
 
+    GstBus* m_bus;
+    QGstreamerBusHelper*  m_helper;
+    QMutex m_queueMutex;
+    QList<GstMessage*> m_pendingMessages;
+
 public:
     QMutex filterMutex;
     QList<QGstreamerSyncMessageFilter*> syncFilters;
@@ -149,7 +169,9 @@ static GstBusSyncReply syncGstBusFilter(GstBus* bus, GstMessage* message, QGstre
             return GST_BUS_DROP;
     }
 
-    return GST_BUS_PASS;
+    d->queueMessage(message);
+
+    return GST_BUS_DROP;
 }
 
 
@@ -200,5 +222,3 @@ void QGstreamerBusHelper::removeMessageFilter(QObject *filter)
 }
 
 QT_END_NAMESPACE
-
-#include "qgstreamerbushelper.moc"
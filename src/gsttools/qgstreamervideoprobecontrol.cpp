@@ -43,12 +43,22 @@
 #include <private/qvideosurfacegstsink_p.h>
 #include <private/qgstvideobuffer_p.h>
 
+// Every queued frame keeps a GstBuffer out of its pool, sources with few
+// buffers such as v4l2src stall when too many are held.
+// QT_GSTREAMER_PROBE_QUEUE_SIZE overrides it.
+static const int defaultVideoProbeQueueCapacity = 2;
+
 QGstreamerVideoProbeControl::QGstreamerVideoProbeControl(QObject *parent)
     : QMediaVideoProbeControl(parent)
     , m_flushing(false)
     , m_frameProbed(false)
+    , m_queueCapacity(defaultVideoProbeQueueCapacity)
+    , m_directDelivery(false)
+    , m_overflowCount(0)
 {
-
+    const int capacity = qgetenv("QT_GSTREAMER_PROBE_QUEUE_SIZE").toInt();
+    if (capacity > 0)
+        m_queueCapacity = capacity;
 }
 
 QGstreamerVideoProbeControl::~QGstreamerVideoProbeControl()
@@ -62,7 +72,7 @@ void QGstreamerVideoProbeControl::startFlushing()
 
     {
         QMutexLocker locker(&m_frameMutex);
-        m_pendingFrame = QVideoFrame();
+        m_pendingFrames.clear();
     }
 
     // only emit flush if at least one frame was probed
@@ -75,6 +85,41 @@ void QGstreamerVideoProbeControl::stopFlushing()
     m_flushing = false;
 }
 
+/*
+    Same delivery modes as QGstreamerAudioProbeControl: frames are either
+    emitted on the streaming thread or queued, dropping and counting the
+    oldest frame when the queue is full.
+*/
+bool QGstreamerVideoProbeControl::directDelivery() const
+{
+    QMutexLocker locker(&m_frameMutex);
+    return m_directDelivery;
+}
+
+void QGstreamerVideoProbeControl::setDirectDelivery(bool direct)
+{
+    QMutexLocker locker(&m_frameMutex);
+    m_directDelivery = direct;
+}
+
+int QGstreamerVideoProbeControl::queueCapacity() const
+{
+    QMutexLocker locker(&m_frameMutex);
+    return m_queueCapacity;
+}
+
+void QGstreamerVideoProbeControl::setQueueCapacity(int capacity)
+{
+    QMutexLocker locker(&m_frameMutex);
+    m_queueCapacity = qMax(1, capacity);
+}
+
+qulonglong QGstreamerVideoProbeControl::overflowCount() const
+{
+    QMutexLocker locker(&m_frameMutex);
+    return m_overflowCount;
+}
+
 void QGstreamerVideoProbeControl::bufferProbed(GstBuffer* buffer)
 {
     if (m_flushing)
@@ -99,19 +144,30 @@ void QGstreamerVideoProbeControl::bufferProbed(GstBuffer* buffer)
 
     {
         QMutexLocker locker(&m_frameMutex);
-        m_pendingFrame = frame;
-        QMetaObject::invokeMethod(this, "frameProbed", Qt::QueuedConnection);
+        if (!m_directDelivery) {
+            if (m_pendingFrames.isEmpty())
+                QMetaObject::invokeMethod(this, "frameProbed", Qt::QueuedConnection);
+
+            if (m_pendingFrames.size() >= m_queueCapacity) {
+                m_pendingFrames.dequeue();
+                ++m_overflowCount;
+            }
+            m_pendingFrames.enqueue(frame);
+            return;
+        }
     }
+
+    emit videoFrameProbed(frame);
 }
 
 void QGstreamerVideoProbeControl::frameProbed()
 {
-    QVideoFrame frame;
+    QQueue<QVideoFrame> frames;
     {
         QMutexLocker locker(&m_frameMutex);
-        if (!m_pendingFrame.isValid())
-            return;
-        frame = m_pendingFrame;
+        frames.swap(m_pendingFrames);
     }
-    emit videoFrameProbed(frame);
+
+    while (!frames.isEmpty())
+        emit videoFrameProbed(frames.dequeue());
 }
@@ -0,0 +1,261 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qgstsharedmemorybufferpool_p.h"
+#include "qgstvideobuffer_p.h"
+
+#include <private/qsharedmemoryvideobuffer_p.h>
+
+#include <QtCore/qatomic.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qvariant.h>
+#include <QtCore/qvector.h>
+
+#include <gst/video/video.h>
+
+#include <errno.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+// Number of unused blocks kept for reuse
+#define QT_GST_SHARED_MEMORY_POOL_SIZE 8
+
+struct QGstSharedMemoryBlock
+{
+    QGstSharedMemoryPoolState *pool;
+    int fd;
+    uchar *data;
+    int size;
+};
+
+class QGstSharedMemoryPoolState
+{
+public:
+    QGstSharedMemoryPoolState()
+        : ref(1)
+        , detached(false)
+    {
+    }
+
+    static QGstSharedMemoryBlock *createBlock(QGstSharedMemoryPoolState *pool, int size);
+    static void destroyBlock(QGstSharedMemoryBlock *block);
+    static void recycleBlock(gpointer data);
+
+    void clear();
+
+    // One reference for the pool and one for each block, the blocks of
+    // buffers still held by the pipeline can outlive the pool.
+    QAtomicInt ref;
+
+    QMutex mutex;
+    QVector<QGstSharedMemoryBlock *> freeBlocks;
+    bool detached;
+};
+
+QGstSharedMemoryBlock *QGstSharedMemoryPoolState::createBlock(QGstSharedMemoryPoolState *pool, int size)
+{
+    const int fd = QSharedMemoryVideoBuffer::createFileDescriptor(size);
+    if (fd < 0)
+        return 0;
+
+    void *data = ::mmap(0, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (data == MAP_FAILED) {
+        qWarning("QGstSharedMemoryBufferPool: failed to map shared memory: %s", strerror(errno));
+        ::close(fd);
+        return 0;
+    }
+
+    QGstSharedMemoryBlock *block = new QGstSharedMemoryBlock;
+    block->pool = pool;
+    block->fd = fd;
+    block->data = static_cast<uchar *>(data);
+    block->size = size;
+
+    pool->ref.ref();
+
+    return block;
+}
+
+void QGstSharedMemoryPoolState::destroyBlock(QGstSharedMemoryBlock *block)
+{
+    QGstSharedMemoryPoolState *pool = block->pool;
+
+    ::munmap(block->data, block->size);
+    ::close(block->fd);
+    delete block;
+
+    if (!pool->ref.deref())
+        delete pool;
+}
+
+// Free function of the pool's GstBuffers, called from whichever thread
+// drops the last reference to the buffer.
+void QGstSharedMemoryPoolState::recycleBlock(gpointer data)
+{
+    QGstSharedMemoryBlock *block = static_cast<QGstSharedMemoryBlock *>(data);
+    QGstSharedMemoryPoolState *pool = block->pool;
+
+    {
+        QMutexLocker locker(&pool->mutex);
+        if (!pool->detached && pool->freeBlocks.count() < QT_GST_SHARED_MEMORY_POOL_SIZE) {
+            pool->freeBlocks.append(block);
+            return;
+        }
+    }
+
+    destroyBlock(block);
+}
+
+void QGstSharedMemoryPoolState::clear()
+{
+    QMutexLocker locker(&mutex);
+    const QVector<QGstSharedMemoryBlock *> blocks = freeBlocks;
+    freeBlocks.clear();
+    locker.unlock();
+
+    // The pool holds its own reference, destroying the blocks can't delete it
+    foreach (QGstSharedMemoryBlock *block, blocks)
+        destroyBlock(block);
+}
+
+QGstSharedMemoryBufferPool::QGstSharedMemoryBufferPool()
+    : m_state(new QGstSharedMemoryPoolState)
+{
+}
+
+QGstSharedMemoryBufferPool::~QGstSharedMemoryBufferPool()
+{
+    {
+        QMutexLocker locker(&m_state->mutex);
+        m_state->detached = true;
+    }
+
+    m_state->clear();
+
+    if (!m_state->ref.deref())
+        delete m_state;
+}
+
+/*!
+    Returns true if the video sink should offer shared memory buffers to the
+    pipeline, set QT_GSTREAMER_SHM_POOL=1 to enable it.
+*/
+bool QGstSharedMemoryBufferPool::isEnabled()
+{
+    return qgetenv("QT_GSTREAMER_SHM_POOL").toInt() > 0;
+}
+
+bool QGstSharedMemoryBufferPool::isFormatSupported(const QVideoSurfaceFormat &format) const
+{
+    return format.handleType() == QAbstractVideoBuffer::SharedMemoryHandle
+            && !format.frameSize().isEmpty();
+}
+
+GstBuffer *QGstSharedMemoryBufferPool::takeBuffer(const QVideoSurfaceFormat &format, GstCaps *caps)
+{
+    Q_UNUSED(format);
+
+    GstVideoFormat videoFormat = GST_VIDEO_FORMAT_UNKNOWN;
+    int width = 0;
+    int height = 0;
+    if (!gst_video_format_parse_caps(caps, &videoFormat, &width, &height))
+        return 0;
+
+    const int size = gst_video_format_get_size(videoFormat, width, height);
+    if (size <= 0)
+        return 0;
+
+    QGstSharedMemoryBlock *block = 0;
+    {
+        QMutexLocker locker(&m_state->mutex);
+        for (int i = 0; i < m_state->freeBlocks.count(); ++i) {
+            if (m_state->freeBlocks.at(i)->size == size) {
+                block = m_state->freeBlocks.at(i);
+                m_state->freeBlocks.remove(i);
+                break;
+            }
+        }
+    }
+
+    if (!block)
+        block = QGstSharedMemoryPoolState::createBlock(m_state, size);
+
+    if (!block)
+        return 0;
+
+    GstBuffer *buffer = gst_buffer_new();
+    GST_BUFFER_DATA(buffer) = block->data;
+    GST_BUFFER_SIZE(buffer) = block->size;
+    GST_BUFFER_MALLOCDATA(buffer) = reinterpret_cast<guint8 *>(block);
+    GST_BUFFER_FREE_FUNC(buffer) = QGstSharedMemoryPoolState::recycleBlock;
+    gst_buffer_set_caps(buffer, caps);
+
+    return buffer;
+}
+
+void QGstSharedMemoryBufferPool::clear()
+{
+    m_state->clear();
+}
+
+QAbstractVideoBuffer::HandleType QGstSharedMemoryBufferPool::handleType() const
+{
+    return QAbstractVideoBuffer::SharedMemoryHandle;
+}
+
+QAbstractVideoBuffer *QGstSharedMemoryBufferPool::prepareVideoBuffer(GstBuffer *buffer, int bytesPerLine)
+{
+    if (GST_BUFFER_FREE_FUNC(buffer) != QGstSharedMemoryPoolState::recycleBlock)
+        return 0;
+
+    const QGstSharedMemoryBlock *block =
+            reinterpret_cast<const QGstSharedMemoryBlock *>(GST_BUFFER_MALLOCDATA(buffer));
+
+    // The buffer holds a reference to the GstBuffer, which keeps the block
+    // and its file descriptor alive.
+    return new QGstVideoBuffer(buffer, bytesPerLine,
+                               QAbstractVideoBuffer::SharedMemoryHandle, QVariant(block->fd));
+}
+
+QT_END_NAMESPACE
@@ -41,12 +41,27 @@
 
 #include "qgstvideobuffer_p.h"
 
+#include <gst/video/video.h>
+
 QT_BEGIN_NAMESPACE
 
 QGstVideoBuffer::QGstVideoBuffer(GstBuffer *buffer, int bytesPerLine)
-    : QAbstractVideoBuffer(NoHandle)
+    : QAbstractPlanarVideoBuffer(NoHandle)
+    , m_buffer(buffer)
+    , m_bytesPerLine(bytesPerLine)
+    , m_pixelFormat(QVideoFrame::Format_Invalid)
+    , m_mode(NotMapped)
+{
+    gst_buffer_ref(m_buffer);
+}
+
+QGstVideoBuffer::QGstVideoBuffer(GstBuffer *buffer, int bytesPerLine,
+                const QSize &size, QVideoFrame::PixelFormat pixelFormat)
+    : QAbstractPlanarVideoBuffer(NoHandle)
     , m_buffer(buffer)
     , m_bytesPerLine(bytesPerLine)
+    , m_size(size)
+    , m_pixelFormat(pixelFormat)
     , m_mode(NotMapped)
 {
     gst_buffer_ref(m_buffer);
@@ -55,9 +70,10 @@ QGstVideoBuffer::QGstVideoBuffer(GstBuffer *buffer, int bytesPerLine)
 QGstVideoBuffer::QGstVideoBuffer(GstBuffer *buffer, int bytesPerLine,
                 QGstVideoBuffer::HandleType handleType,
                 const QVariant &handle)
-    : QAbstractVideoBuffer(handleType)
+    : QAbstractPlanarVideoBuffer(handleType)
     , m_buffer(buffer)
     , m_bytesPerLine(bytesPerLine)
+    , m_pixelFormat(QVideoFrame::Format_Invalid)
     , m_mode(NotMapped)
     , m_handle(handle)
 {
@@ -75,22 +91,66 @@ QAbstractVideoBuffer::MapMode QGstVideoBuffer::mapMode() const
     return m_mode;
 }
 
-uchar *QGstVideoBuffer::map(MapMode mode, int *numBytes, int *bytesPerLine)
+int QGstVideoBuffer::map(MapMode mode, int *numBytes, int bytesPerLine[4], uchar *data[4])
 {
-    if (mode != NotMapped && m_mode == NotMapped) {
-        if (numBytes)
-            *numBytes = m_buffer->size;
+    if (mode == NotMapped || m_mode != NotMapped)
+        return 0;
 
-        if (bytesPerLine)
-            *bytesPerLine = m_bytesPerLine;
+    if (numBytes)
+        *numBytes = m_buffer->size;
 
-        m_mode = mode;
+    bytesPerLine[0] = m_bytesPerLine;
+    data[0] = m_buffer->data;
+    m_mode = mode;
 
-        return m_buffer->data;
-    } else {
-        return 0;
+    // Report the chroma planes with the padding GStreamer uses for them,
+    // which doesn't always match what the luma stride implies.
+    GstVideoFormat format = GST_VIDEO_FORMAT_UNKNOWN;
+    switch (m_pixelFormat) {
+    case QVideoFrame::Format_YUV420P:
+        format = GST_VIDEO_FORMAT_I420;
+        break;
+    case QVideoFrame::Format_YV12:
+        format = GST_VIDEO_FORMAT_YV12;
+        break;
+    case QVideoFrame::Format_NV12:
+        format = GST_VIDEO_FORMAT_NV12;
+        break;
+    case QVideoFrame::Format_NV21:
+        format = GST_VIDEO_FORMAT_NV21;
+        break;
+    default:
+        return 1;
     }
+
+    const int width = m_size.width();
+    const int height = m_size.height();
+
+    // Planes are returned in memory order, YV12 and NV21 store Cr first.
+    int components[2] = { 1, 2 };
+    int planeCount = 3;
+    if (format == GST_VIDEO_FORMAT_YV12) {
+        qSwap(components[0], components[1]);
+    } else if (format == GST_VIDEO_FORMAT_NV12) {
+        planeCount = 2;
+    } else if (format == GST_VIDEO_FORMAT_NV21) {
+        components[0] = 2;
+        planeCount = 2;
+    }
+
+    for (int i = 1; i < planeCount; ++i) {
+        const int component = components[i - 1];
+        const int offset = gst_video_format_get_component_offset(format, component, width, height);
+        if (offset >= int(m_buffer->size))
+            return 1;
+
+        bytesPerLine[i] = gst_video_format_get_row_stride(format, component, width);
+        data[i] = m_buffer->data + offset;
+    }
+
+    return planeCount;
 }
+
 void QGstVideoBuffer::unmap()
 {
     m_mode = NotMapped;
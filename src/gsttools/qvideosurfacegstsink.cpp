@@ -58,16 +58,39 @@ QT_BEGIN_NAMESPACE
 Q_GLOBAL_STATIC_WITH_ARGS(QMediaPluginLoader, bufferPoolLoader,
         (QGstBufferPoolInterface_iid, QLatin1String("video/bufferpool"), Qt::CaseInsensitive))
 
+enum {
+    PROP_0,
+    PROP_ASYNC_RENDER,
+    PROP_DROP_POLICY,
+    PROP_MAX_QUEUED_FRAMES,
+    PROP_QUEUED_FRAMES,
+    PROP_DROPPED_FRAMES
+};
+
+static const int qt_defaultMaxQueuedFrames = 2;
+static const int qt_maxQueuedFramesLimit = 16;
 
 QVideoSurfaceGstDelegate::QVideoSurfaceGstDelegate(
-    QAbstractVideoSurface *surface)
+    QAbstractVideoSurface *surface, GstElement *sink)
     : m_surface(surface)
     , m_pool(0)
     , m_renderReturn(GST_FLOW_ERROR)
     , m_lastPrerolledBuffer(0)
     , m_bytesPerLine(0)
     , m_startCanceled(false)
+    , m_sink(sink)
+    , m_renderMode(SynchronousRender)
+    , m_dropPolicy(DropOldestFrame)
+    , m_maxQueuedFrames(qt_defaultMaxQueuedFrames)
+    , m_droppedFrames(0)
+    , m_presentPending(false)
+    , m_presentReturn(GST_FLOW_OK)
 {
+    if (qgetenv("QT_GSTREAMER_VIDEOSINK_ASYNC").toInt() > 0)
+        m_renderMode = AsynchronousRender;
+    if (qgetenv("QT_GSTREAMER_VIDEOSINK_DROP_POLICY").toInt() == DropLateFrames)
+        m_dropPolicy = DropLateFrames;
+
     if (m_surface) {
         foreach (QObject *instance, bufferPoolLoader()->instances(QGstBufferPoolPluginKey)) {
             QGstBufferPoolInterface* plugin = qobject_cast<QGstBufferPoolInterface*>(instance);
@@ -75,6 +98,12 @@ QVideoSurfaceGstDelegate::QVideoSurfaceGstDelegate(
                 m_pools.append(plugin);
             }
         }
+
+        // Plugins for hardware buffers take precedence over shared memory
+        if (QGstSharedMemoryBufferPool::isEnabled()) {
+            m_sharedMemoryPool.reset(new QGstSharedMemoryBufferPool);
+            m_pools.append(m_sharedMemoryPool.data());
+        }
         updateSupportedFormats();
         connect(m_surface, SIGNAL(supportedFormatsChanged()), this, SLOT(updateSupportedFormats()));
     }
@@ -82,6 +111,7 @@ QVideoSurfaceGstDelegate::QVideoSurfaceGstDelegate(
 
 QVideoSurfaceGstDelegate::~QVideoSurfaceGstDelegate()
 {
+    flush();
     setLastPrerolledBuffer(0);
 }
 
@@ -93,7 +123,7 @@ QList<QVideoFrame::PixelFormat> QVideoSurfaceGstDelegate::supportedPixelFormats(
         return QList<QVideoFrame::PixelFormat>();
     else if (handleType == QAbstractVideoBuffer::NoHandle)
         return m_supportedPixelFormats;
-    else if (handleType == m_pool->handleType())
+    else if (m_pool && handleType == m_pool->handleType())
         return m_supportedPoolPixelFormats;
     else
         return m_surface->supportedPixelFormats(handleType);
@@ -110,6 +140,9 @@ bool QVideoSurfaceGstDelegate::start(const QVideoSurfaceFormat &format, int byte
     if (!m_surface)
         return false;
 
+    // Frames queued for the previous format must not reach the surface
+    flush();
+
     QMutexLocker locker(&m_mutex);
 
     m_format = format;
@@ -149,6 +182,8 @@ void QVideoSurfaceGstDelegate::stop()
     if (!m_surface)
         return;
 
+    flush();
+
     QMutexLocker locker(&m_mutex);
 
     if (QThread::currentThread() == thread()) {
@@ -194,7 +229,8 @@ GstFlowReturn QVideoSurfaceGstDelegate::render(GstBuffer *buffer)
         videoBuffer = m_pool->prepareVideoBuffer(buffer, m_bytesPerLine);
 
     if (!videoBuffer)
-        videoBuffer = new QGstVideoBuffer(buffer, m_bytesPerLine);
+        videoBuffer = new QGstVideoBuffer(buffer, m_bytesPerLine,
+                                          m_format.frameSize(), m_format.pixelFormat());
 
     m_frame = QVideoFrame(
             videoBuffer,
@@ -203,6 +239,13 @@ GstFlowReturn QVideoSurfaceGstDelegate::render(GstBuffer *buffer)
 
     QVideoSurfaceGstSink::setFrameTimeStamps(&m_frame, buffer);
 
+    if (renderMode() == AsynchronousRender && QThread::currentThread() != thread()) {
+        const QVideoFrame frame = m_frame;
+        m_frame = QVideoFrame();
+        locker.unlock();
+        return enqueueFrame(frame, buffer);
+    }
+
     m_renderReturn = GST_FLOW_OK;
 
     if (QThread::currentThread() == thread()) {
@@ -217,6 +260,135 @@ GstFlowReturn QVideoSurfaceGstDelegate::render(GstBuffer *buffer)
     return m_renderReturn;
 }
 
+void QVideoSurfaceGstDelegate::flush()
+{
+    QMutexLocker locker(&m_queueMutex);
+    m_frameQueue.clear();
+    m_presentReturn = GST_FLOW_OK;
+}
+
+QVideoSurfaceGstDelegate::RenderMode QVideoSurfaceGstDelegate::renderMode() const
+{
+    QMutexLocker locker(&m_queueMutex);
+    return m_renderMode;
+}
+
+void QVideoSurfaceGstDelegate::setRenderMode(RenderMode mode)
+{
+    QMutexLocker locker(&m_queueMutex);
+    m_renderMode = mode;
+}
+
+QVideoSurfaceGstDelegate::DropPolicy QVideoSurfaceGstDelegate::dropPolicy() const
+{
+    QMutexLocker locker(&m_queueMutex);
+    return m_dropPolicy;
+}
+
+void QVideoSurfaceGstDelegate::setDropPolicy(DropPolicy policy)
+{
+    QMutexLocker locker(&m_queueMutex);
+    m_dropPolicy = policy;
+}
+
+int QVideoSurfaceGstDelegate::maxQueuedFrames() const
+{
+    QMutexLocker locker(&m_queueMutex);
+    return m_maxQueuedFrames;
+}
+
+void QVideoSurfaceGstDelegate::setMaxQueuedFrames(int count)
+{
+    QMutexLocker locker(&m_queueMutex);
+    m_maxQueuedFrames = qBound(1, count, qt_maxQueuedFramesLimit);
+
+    while (m_frameQueue.size() > m_maxQueuedFrames) {
+        m_frameQueue.dequeue();
+        ++m_droppedFrames;
+    }
+}
+
+int QVideoSurfaceGstDelegate::queuedFrameCount() const
+{
+    QMutexLocker locker(&m_queueMutex);
+    return m_frameQueue.size();
+}
+
+quint64 QVideoSurfaceGstDelegate::droppedFrameCount() const
+{
+    QMutexLocker locker(&m_queueMutex);
+    return m_droppedFrames;
+}
+
+GstFlowReturn QVideoSurfaceGstDelegate::enqueueFrame(const QVideoFrame &frame, GstBuffer *buffer)
+{
+    QueuedFrame entry;
+    entry.frame = frame;
+    entry.deadline = GST_CLOCK_TIME_NONE;
+
+    // The frame is late once the running time passes the end of the buffer
+    if (m_sink && GST_BUFFER_TIMESTAMP_IS_VALID(buffer)) {
+        GstClockTime end = GST_BUFFER_TIMESTAMP(buffer);
+        if (GST_BUFFER_DURATION_IS_VALID(buffer))
+            end += GST_BUFFER_DURATION(buffer);
+
+        GstBaseSink *baseSink = GST_BASE_SINK(m_sink);
+        GST_OBJECT_LOCK(baseSink);
+        entry.deadline = gst_segment_to_running_time(&baseSink->segment, GST_FORMAT_TIME, end);
+        GST_OBJECT_UNLOCK(baseSink);
+    }
+
+    QMutexLocker locker(&m_queueMutex);
+
+    // The surface failed to present an earlier frame
+    if (m_presentReturn != GST_FLOW_OK) {
+        const GstFlowReturn ret = m_presentReturn;
+        m_presentReturn = GST_FLOW_OK;
+        return ret;
+    }
+
+    // Never block the streaming thread: if the surface can't keep up the
+    // oldest queued frame makes room for the new one.
+    while (m_frameQueue.size() >= m_maxQueuedFrames) {
+        m_frameQueue.dequeue();
+        ++m_droppedFrames;
+    }
+
+    m_frameQueue.enqueue(entry);
+
+    if (!m_presentPending) {
+        m_presentPending = true;
+        QMetaObject::invokeMethod(this, "queuedPresent", Qt::QueuedConnection);
+    }
+
+    return GST_FLOW_OK;
+}
+
+GstClockTime QVideoSurfaceGstDelegate::currentRunningTime() const
+{
+    if (!m_sink)
+        return GST_CLOCK_TIME_NONE;
+
+    GstClock *clock = 0;
+    GstClockTime baseTime = 0;
+
+    GST_OBJECT_LOCK(m_sink);
+    if (GST_STATE(m_sink) == GST_STATE_PLAYING && GST_ELEMENT_CLOCK(m_sink)) {
+        clock = GST_ELEMENT_CLOCK(m_sink);
+        gst_object_ref(clock);
+        baseTime = GST_ELEMENT_CAST(m_sink)->base_time;
+    }
+    GST_OBJECT_UNLOCK(m_sink);
+
+    if (!clock)
+        return GST_CLOCK_TIME_NONE;
+
+    const GstClockTime now = gst_clock_get_time(clock);
+    gst_object_unref(clock);
+
+    return now > baseTime ? now - baseTime : 0;
+}
+
 void QVideoSurfaceGstDelegate::setLastPrerolledBuffer(GstBuffer *prerolledBuffer)
 {
     // discard previously stored buffer
@@ -281,6 +453,57 @@ void QVideoSurfaceGstDelegate::queuedRender()
     m_renderCondition.wakeAll();
 }
 
+void QVideoSurfaceGstDelegate::queuedPresent()
+{
+    QVideoFrame frame;
+
+    {
+        QMutexLocker locker(&m_queueMutex);
+
+        const GstClockTime now = m_dropPolicy == DropLateFrames
+                ? currentRunningTime()
+                : GST_CLOCK_TIME_NONE;
+
+        while (!m_frameQueue.isEmpty()) {
+            QueuedFrame entry = m_frameQueue.dequeue();
+            if (GST_CLOCK_TIME_IS_VALID(now)
+                    && GST_CLOCK_TIME_IS_VALID(entry.deadline)
+                    && entry.deadline < now) {
+                ++m_droppedFrames;
+                continue;
+            }
+
+            frame = entry.frame;
+            break;
+        }
+
+        // Present one frame per event loop iteration, so the surface gets
+        // a chance to repaint in between.
+        m_presentPending = !m_frameQueue.isEmpty();
+        if (m_presentPending)
+            QMetaObject::invokeMethod(this, "queuedPresent", Qt::QueuedConnection);
+    }
+
+    if (!frame.isValid())
+        return;
+
+    if (m_surface.isNull()) {
+        qWarning() << "Rendering video frame to deleted surface, skip the frame";
+    } else if (!m_surface->present(frame)) {
+        switch (m_surface->error()) {
+        case QAbstractVideoSurface::NoError:
+        case QAbstractVideoSurface::StoppedError:
+            break;
+        default: {
+            qWarning() << "Failed to render video frame:" << m_surface->error();
+            QMutexLocker locker(&m_queueMutex);
+            m_presentReturn = GST_FLOW_ERROR;
+            break;
+        }
+        }
+    }
+}
+
 void QVideoSurfaceGstDelegate::updateSupportedFormats()
 {
     QGstBufferPoolInterface *newPool = 0;
@@ -403,7 +626,7 @@ QVideoSurfaceGstSink *QVideoSurfaceGstSink::createSink(QAbstractVideoSurface *su
     QVideoSurfaceGstSink *sink = reinterpret_cast<QVideoSurfaceGstSink *>(
             g_object_new(QVideoSurfaceGstSink::get_type(), 0));
 
-    sink->delegate = new QVideoSurfaceGstDelegate(surface);
+    sink->delegate = new QVideoSurfaceGstDelegate(surface, GST_ELEMENT(sink));
 
     g_signal_connect(G_OBJECT(sink), "notify::show-preroll-frame", G_CALLBACK(handleShowPrerollChange), sink);
 
@@ -458,6 +681,31 @@ void QVideoSurfaceGstSink::class_init(gpointer g_class, gpointer class_data)
 
     GObjectClass *object_class = reinterpret_cast<GObjectClass *>(g_class);
     object_class->finalize = QVideoSurfaceGstSink::finalize;
+    object_class->set_property = QVideoSurfaceGstSink::set_property;
+    object_class->get_property = QVideoSurfaceGstSink::get_property;
+
+    g_object_class_install_property(object_class, PROP_ASYNC_RENDER,
+            g_param_spec_boolean("async-render", "Asynchronous render",
+                                 "Queue frames to the surface instead of waiting for them to be presented",
+                                 FALSE, GParamFlags(G_PARAM_READWRITE)));
+    g_object_class_install_property(object_class, PROP_DROP_POLICY,
+            g_param_spec_int("drop-policy", "Drop policy",
+                             "Frames to drop in asynchronous mode: 0 - oldest queued frame on overflow, "
+                             "1 - also frames which are late according to the pipeline clock",
+                             0, 1, 0, GParamFlags(G_PARAM_READWRITE)));
+    g_object_class_install_property(object_class, PROP_MAX_QUEUED_FRAMES,
+            g_param_spec_int("max-queued-frames", "Maximum queued frames",
+                             "Maximum number of frames waiting to be presented in asynchronous mode",
+                             1, qt_maxQueuedFramesLimit, qt_defaultMaxQueuedFrames,
+                             GParamFlags(G_PARAM_READWRITE)));
+    g_object_class_install_property(object_class, PROP_QUEUED_FRAMES,
+            g_param_spec_int("queued-frames", "Queued frames",
+                             "Number of frames currently waiting to be presented",
+                             0, qt_maxQueuedFramesLimit, 0, G_PARAM_READABLE));
+    g_object_class_install_property(object_class, PROP_DROPPED_FRAMES,
+            g_param_spec_uint64("dropped-frames", "Dropped frames",
+                                "Number of frames dropped in asynchronous mode",
+                                0, G_MAXUINT64, 0, G_PARAM_READABLE));
 }
 
 void QVideoSurfaceGstSink::base_init(gpointer g_class)
@@ -511,6 +759,60 @@ void QVideoSurfaceGstSink::finalize(GObject *object)
     G_OBJECT_CLASS(sink_parent_class)->finalize(object);
 }
 
+void QVideoSurfaceGstSink::set_property(GObject *object, guint id, const GValue *value, GParamSpec *pspec)
+{
+    VO_SINK(object);
+
+    if (!sink->delegate)
+        return;
+
+    switch (id) {
+    case PROP_ASYNC_RENDER:
+        sink->delegate->setRenderMode(g_value_get_boolean(value)
+                                      ? QVideoSurfaceGstDelegate::AsynchronousRender
+                                      : QVideoSurfaceGstDelegate::SynchronousRender);
+        break;
+    case PROP_DROP_POLICY:
+        sink->delegate->setDropPolicy(QVideoSurfaceGstDelegate::DropPolicy(g_value_get_int(value)));
+        break;
+    case PROP_MAX_QUEUED_FRAMES:
+        sink->delegate->setMaxQueuedFrames(g_value_get_int(value));
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, id, pspec);
+        break;
+    }
+}
+
+void QVideoSurfaceGstSink::get_property(GObject *object, guint id, GValue *value, GParamSpec *pspec)
+{
+    VO_SINK(object);
+
+    if (!sink->delegate)
+        return;
+
+    switch (id) {
+    case PROP_ASYNC_RENDER:
+        g_value_set_boolean(value, sink->delegate->renderMode() == QVideoSurfaceGstDelegate::AsynchronousRender);
+        break;
+    case PROP_DROP_POLICY:
+        g_value_set_int(value, sink->delegate->dropPolicy());
+        break;
+    case PROP_MAX_QUEUED_FRAMES:
+        g_value_set_int(value, sink->delegate->maxQueuedFrames());
+        break;
+    case PROP_QUEUED_FRAMES:
+        g_value_set_int(value, sink->delegate->queuedFrameCount());
+        break;
+    case PROP_DROPPED_FRAMES:
+        g_value_set_uint64(value, sink->delegate->droppedFrameCount());
+        break;
+    default:
+        G_OBJECT_WARN_INVALID_PROPERTY_ID(object, id, pspec);
+        break;
+    }
+}
+
 GstStateChangeReturn QVideoSurfaceGstSink::change_state(
         GstElement *element, GstStateChange transition)
 {
@@ -845,6 +1147,7 @@ gboolean QVideoSurfaceGstSink::start(GstBaseSink *base)
 gboolean QVideoSurfaceGstSink::stop(GstBaseSink *base)
 {
     VO_SINK(base);
+    sink->delegate->flush();
     sink->delegate->clearPoolBuffers();
 
     return TRUE;
@@ -863,6 +1166,7 @@ gboolean QVideoSurfaceGstSink::event(GstBaseSink *base, GstEvent *event)
     if (event->type == GST_EVENT_FLUSH_START) {
         VO_SINK(base);
         sink->delegate->setLastPrerolledBuffer(0);
+        sink->delegate->flush();
     }
 
     return TRUE;
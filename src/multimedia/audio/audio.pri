@@ -12,14 +12,16 @@ PUBLIC_HEADERS += \
            audio/qsoundeffect.h \
            audio/qsound.h \
            audio/qaudioprobe.h \
-           audio/qaudiodecoder.h
+           audio/qaudiodecoder.h \
+           audio/qaudiobatchdecoder.h
 
 PRIVATE_HEADERS += \
            audio/qaudiobuffer_p.h \
            audio/qaudiodevicefactory_p.h \
            audio/qwavedecoder_p.h \
            audio/qsamplecache_p.h \
-           audio/qaudiohelpers_p.h
+           audio/qaudiohelpers_p.h \
+           audio/qaudioringbuffer_p.h
 
 SOURCES += \
            audio/qaudio.cpp \
@@ -37,7 +39,16 @@ SOURCES += \
            audio/qaudiobuffer.cpp \
            audio/qaudioprobe.cpp \
            audio/qaudiodecoder.cpp \
-           audio/qaudiohelpers.cpp
+           audio/qaudiobatchdecoder.cpp \
+           audio/qaudiohelpers.cpp \
+           audio/qaudioringbuffer_p.cpp
+
+SSE2_SOURCES += audio/qaudiohelpers_sse2.cpp
+AVX2_SOURCES += audio/qaudiohelpers_avx2.cpp
+
+contains(QT_CPU_FEATURES.$$QT_ARCH, neon) {
+    SOURCES += audio/qaudiohelpers_neon.cpp
+}
 
 unix:!mac {
     config_pulseaudio {
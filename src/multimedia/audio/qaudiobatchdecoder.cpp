@@ -0,0 +1,667 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiobatchdecoder.h"
+#include "qaudiobuffer_p.h"
+
+#include <QtCore/qelapsedtimer.h>
+#include <QtCore/qendian.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qqueue.h>
+#include <QtCore/qthread.h>
+
+QT_BEGIN_NAMESPACE
+
+/*!
+    \class QAudioBatchDecoder
+    \inmodule QtMultimedia
+    \ingroup multimedia
+    \ingroup multimedia_audio
+    \since 5.3
+
+    \brief The QAudioBatchDecoder class decodes many audio files concurrently.
+
+    Jobs added with addJob() are decoded on a pool of worker threads, each
+    running its own QAudioDecoder as fast as the backend can decode. The
+    decoded samples of a job are either collected into one contiguous
+    QAudioBuffer or written to a WAV file, and jobFinished() is emitted when
+    the job completes. Set audioFormat to have every job converted to the
+    same sample format, rate and channel count.
+
+    \code
+        QAudioBatchDecoder *batch = new QAudioBatchDecoder(this);
+        connect(batch, SIGNAL(jobFinished(int,QAudioBuffer)), this, SLOT(index(int,QAudioBuffer)));
+        foreach (const QString &file, files)
+            batch->addJob(file);
+    \endcode
+
+    decodedDuration() and decodingTime() report the throughput of each
+    finished job.
+
+    \sa QAudioDecoder
+*/
+
+/*!
+    \fn void QAudioBatchDecoder::jobFinished(int job, const QAudioBuffer &result)
+
+    Signals that \a job was decoded. For jobs decoding into memory \a result
+    holds all decoded samples, for jobs writing a WAV file it is invalid.
+*/
+
+/*!
+    \fn void QAudioBatchDecoder::jobFailed(int job, QAudioDecoder::Error error, const QString &errorString)
+
+    Signals that \a job could not be decoded because of \a error, described
+    by \a errorString. Jobs that are running when cancel() is called fail with
+    QAudioDecoder::ResourceError.
+*/
+
+/*!
+    \fn void QAudioBatchDecoder::finished()
+
+    Signals that all jobs added so far have finished or failed.
+*/
+
+// Creating and destroying media objects goes through the plugin loader and
+// the default service provider, which must not be entered from several
+// threads at once.
+Q_GLOBAL_STATIC(QMutex, mediaObjectMutex)
+
+namespace {
+
+struct Job
+{
+    int id;
+    int generation;
+    QString fileName;
+    QString waveFileName;
+    QAudioFormat format;
+};
+
+// Hands the collected samples to QAudioBuffer without copying them
+class ByteArrayAudioBuffer : public QAbstractAudioBuffer
+{
+public:
+    ByteArrayAudioBuffer(const QByteArray &data, const QAudioFormat &format)
+        : m_data(data)
+        , m_format(format)
+    {
+    }
+
+    void release() { delete this; }
+
+    QAudioFormat format() const { return m_format; }
+    qint64 startTime() const { return 0; }
+    int frameCount() const { return m_format.framesForBytes(m_data.size()); }
+
+    void *constData() const { return const_cast<char *>(m_data.constData()); }
+
+    void *writableData() { return m_data.data(); }
+    QAbstractAudioBuffer *clone() const { return new ByteArrayAudioBuffer(m_data, m_format); }
+
+private:
+    QByteArray m_data;
+    QAudioFormat m_format;
+};
+
+bool canWriteWave(const QAudioFormat &format)
+{
+    if (format.codec() != QLatin1String("audio/pcm") || format.byteOrder() != QAudioFormat::LittleEndian)
+        return false;
+
+    switch (format.sampleType()) {
+    case QAudioFormat::UnSignedInt:
+        return format.sampleSize() == 8;
+    case QAudioFormat::SignedInt:
+        return format.sampleSize() == 16 || format.sampleSize() == 24 || format.sampleSize() == 32;
+    case QAudioFormat::Float:
+        return format.sampleSize() == 32;
+    default:
+        return false;
+    }
+}
+
+QByteArray waveHeader(const QAudioFormat &format, qint64 dataSize)
+{
+    const quint32 size = quint32(qMin<qint64>(dataSize, 0xffffffffLL - 36));
+    const int blockAlign = format.bytesPerFrame();
+
+    QByteArray header(44, Qt::Uninitialized);
+    uchar *data = reinterpret_cast<uchar *>(header.data());
+    memcpy(data, "RIFF", 4);
+    qToLittleEndian<quint32>(36 + size, data + 4);
+    memcpy(data + 8, "WAVEfmt ", 8);
+    qToLittleEndian<quint32>(16, data + 16);
+    qToLittleEndian<quint16>(format.sampleType() == QAudioFormat::Float ? 3 : 1, data + 20);
+    qToLittleEndian<quint16>(format.channelCount(), data + 22);
+    qToLittleEndian<quint32>(format.sampleRate(), data + 24);
+    qToLittleEndian<quint32>(format.sampleRate() * blockAlign, data + 28);
+    qToLittleEndian<quint16>(blockAlign, data + 32);
+    qToLittleEndian<quint16>(format.sampleSize(), data + 34);
+    memcpy(data + 36, "data", 4);
+    qToLittleEndian<quint32>(size, data + 40);
+    return header;
+}
+
+}
+
+class QAudioBatchDecoderWorker;
+
+class QAudioBatchDecoderPrivate
+{
+public:
+    QAudioBatchDecoderPrivate(QAudioBatchDecoder *q)
+        : q(q)
+        , nextJobId(0)
+        , maximumConcurrentJobs(qMax(1, QThread::idealThreadCount()))
+        , generation(0)
+        , activeJobs(0)
+    {
+    }
+
+    bool takeJob(int workerIndex, Job *job);
+    void wakeWorkers();
+    void jobDone();
+
+    void _q_jobFinished(int job, const QAudioBuffer &result, qint64 duration, qint64 decodingTime);
+    void _q_jobFailed(int job, int error, const QString &errorString);
+
+    struct Statistics
+    {
+        qint64 duration;
+        qint64 decodingTime;
+    };
+
+    QAudioBatchDecoder *q;
+
+    QAudioFormat format;
+    int nextJobId;
+
+    // Shared with the workers
+    mutable QMutex mutex;
+    int maximumConcurrentJobs;
+    int generation;
+    QQueue<Job> pendingJobs;
+
+    // Jobs added and not yet reported, including pending ones
+    int activeJobs;
+    QList<QThread *> threads;
+    QList<QAudioBatchDecoderWorker *> workers;
+    QHash<int, Statistics> statistics;
+};
+
+class QAudioBatchDecoderWorker : public QObject
+{
+    Q_OBJECT
+public:
+    QAudioBatchDecoderWorker(QAudioBatchDecoderPrivate *batch, int index)
+        : m_batch(batch)
+        , m_index(index)
+        , m_decoder(0)
+        , m_busy(false)
+        , m_byteCount(0)
+    {
+    }
+
+    ~QAudioBatchDecoderWorker()
+    {
+        if (m_busy)
+            m_waveFile.remove();
+
+        QMutexLocker locker(mediaObjectMutex());
+        delete m_decoder;
+    }
+
+public Q_SLOTS:
+    void processNext();
+    void abort(int generation);
+
+Q_SIGNALS:
+    void jobFinished(int job, const QAudioBuffer &result, qint64 duration, qint64 decodingTime);
+    void jobFailed(int job, int error, const QString &errorString);
+
+private Q_SLOTS:
+    void readBuffers();
+    void decoderFinished();
+    void decoderError(QAudioDecoder::Error error);
+
+private:
+    bool writeBuffer(const QAudioBuffer &buffer);
+    void fail(QAudioDecoder::Error error, const QString &errorString);
+    void endJob();
+
+    QAudioBatchDecoderPrivate *m_batch;
+    int m_index;
+    QAudioDecoder *m_decoder;
+    Job m_job;
+    bool m_busy;
+    QAudioFormat m_format;
+    QByteArray m_data;
+    QFile m_waveFile;
+    qint64 m_byteCount;
+    QElapsedTimer m_timer;
+};
+
+void QAudioBatchDecoderWorker::processNext()
+{
+    if (m_busy || !m_batch->takeJob(m_index, &m_job))
+        return;
+
+    m_busy = true;
+    m_format = QAudioFormat();
+    m_data = QByteArray();
+    m_byteCount = 0;
+    m_timer.start();
+
+    if (!m_decoder) {
+        {
+            QMutexLocker locker(mediaObjectMutex());
+            m_decoder = new QAudioDecoder(this);
+        }
+        connect(m_decoder, SIGNAL(bufferReady()), SLOT(readBuffers()));
+        connect(m_decoder, SIGNAL(finished()), SLOT(decoderFinished()));
+        connect(m_decoder, SIGNAL(error(QAudioDecoder::Error)), SLOT(decoderError(QAudioDecoder::Error)));
+    }
+
+    if (m_decoder->error() == QAudioDecoder::ServiceMissingError) {
+        fail(QAudioDecoder::ServiceMissingError, m_decoder->errorString());
+        return;
+    }
+
+    QAudioFormat format = m_job.format;
+    if (!m_job.waveFileName.isEmpty()) {
+        if (format.isValid())
+            format.setByteOrder(QAudioFormat::LittleEndian);
+
+        m_waveFile.setFileName(m_job.waveFileName);
+        if (!m_waveFile.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            fail(QAudioDecoder::AccessDeniedError, m_waveFile.errorString());
+            return;
+        }
+    }
+
+    m_decoder->setAudioFormat(format);
+    m_decoder->setSourceFilename(m_job.fileName);
+    m_decoder->start();
+}
+
+void QAudioBatchDecoderWorker::abort(int generation)
+{
+    if (m_busy && m_job.generation < generation)
+        fail(QAudioDecoder::ResourceError, QLatin1String("Decoding cancelled"));
+}
+
+void QAudioBatchDecoderWorker::readBuffers()
+{
+    if (!m_busy)
+        return;
+
+    const QList<QAudioBuffer> buffers = m_decoder->readBuffers();
+    foreach (const QAudioBuffer &buffer, buffers) {
+        if (!writeBuffer(buffer))
+            return;
+    }
+}
+
+bool QAudioBatchDecoderWorker::writeBuffer(const QAudioBuffer &buffer)
+{
+    if (!m_format.isValid()) {
+        m_format = buffer.format();
+
+        if (m_waveFile.isOpen()) {
+            if (!canWriteWave(m_format)) {
+                fail(QAudioDecoder::FormatError, QLatin1String("Decoded format can't be stored in a WAV file"));
+                return false;
+            }
+            m_waveFile.write(waveHeader(m_format, 0));
+        } else if (m_decoder->duration() > 0) {
+            // Avoid growing the block buffer by buffer, with some headroom
+            // as durations are often estimates
+            m_data.reserve(m_format.bytesForDuration(m_decoder->duration() * 1100));
+        }
+    } else if (buffer.format() != m_format) {
+        fail(QAudioDecoder::FormatError, QLatin1String("Decoded format changed while decoding"));
+        return false;
+    }
+
+    if (m_waveFile.isOpen()) {
+        if (m_waveFile.write(buffer.constData<char>(), buffer.byteCount()) != buffer.byteCount()) {
+            fail(QAudioDecoder::ResourceError, m_waveFile.errorString());
+            return false;
+        }
+    } else {
+        m_data.append(buffer.constData<char>(), buffer.byteCount());
+    }
+
+    m_byteCount += buffer.byteCount();
+    return true;
+}
+
+void QAudioBatchDecoderWorker::decoderFinished()
+{
+    if (!m_busy)
+        return;
+
+    // Buffers queued before the end of stream are still waiting
+    readBuffers();
+    if (!m_busy)
+        return;
+
+    QAudioBuffer result;
+    if (m_waveFile.isOpen()) {
+        if (m_format.isValid()) {
+            m_waveFile.seek(0);
+            m_waveFile.write(waveHeader(m_format, m_byteCount));
+        }
+        m_waveFile.close();
+    } else if (m_format.isValid()) {
+        result = QAudioBuffer(new ByteArrayAudioBuffer(m_data, m_format));
+        m_data = QByteArray();
+    }
+
+    const qint64 duration = m_format.isValid() ? m_format.durationForBytes(m_byteCount) : 0;
+    emit jobFinished(m_job.id, result, duration, m_timer.elapsed());
+
+    m_decoder->stop();
+    endJob();
+}
+
+void QAudioBatchDecoderWorker::decoderError(QAudioDecoder::Error error)
+{
+    if (m_busy)
+        fail(error, m_decoder->errorString());
+}
+
+void QAudioBatchDecoderWorker::fail(QAudioDecoder::Error error, const QString &errorString)
+{
+    if (m_waveFile.isOpen()) {
+        m_waveFile.close();
+        m_waveFile.remove();
+    }
+    m_data = QByteArray();
+
+    emit jobFailed(m_job.id, int(error), errorString);
+
+    if (m_decoder)
+        m_decoder->stop();
+    endJob();
+}
+
+void QAudioBatchDecoderWorker::endJob()
+{
+    m_busy = false;
+
+    // Continue once the decoder has returned from emitting its signal
+    QMetaObject::invokeMethod(this, "processNext", Qt::QueuedConnection);
+}
+
+bool QAudioBatchDecoderPrivate::takeJob(int workerIndex, Job *job)
+{
+    QMutexLocker locker(&mutex);
+
+    if (workerIndex >= maximumConcurrentJobs || pendingJobs.isEmpty())
+        return false;
+
+    *job = pendingJobs.dequeue();
+    return true;
+}
+
+void QAudioBatchDecoderPrivate::wakeWorkers()
+{
+    int count;
+    {
+        QMutexLocker locker(&mutex);
+        count = qMin(maximumConcurrentJobs, activeJobs);
+    }
+
+    while (workers.size() < count) {
+        QThread *thread = new QThread;
+        QAudioBatchDecoderWorker *worker = new QAudioBatchDecoderWorker(this, workers.size());
+        worker->moveToThread(thread);
+
+        QObject::connect(thread, SIGNAL(finished()), worker, SLOT(deleteLater()));
+        QObject::connect(worker, SIGNAL(jobFinished(int,QAudioBuffer,qint64,qint64)),
+                         q, SLOT(_q_jobFinished(int,QAudioBuffer,qint64,qint64)));
+        QObject::connect(worker, SIGNAL(jobFailed(int,int,QString)),
+                         q, SLOT(_q_jobFailed(int,int,QString)));
+
+        thread->start();
+        threads.append(thread);
+        workers.append(worker);
+    }
+
+    // Busy workers ignore this and pick up the next job when they are done
+    for (int i = 0; i < count; ++i)
+        QMetaObject::invokeMethod(workers.at(i), "processNext", Qt::QueuedConnection);
+}
+
+void QAudioBatchDecoderPrivate::jobDone()
+{
+    if (--activeJobs == 0)
+        emit q->finished();
+}
+
+void QAudioBatchDecoderPrivate::_q_jobFinished(int job, const QAudioBuffer &result,
+                                               qint64 duration, qint64 decodingTime)
+{
+    Statistics &stats = statistics[job];
+    stats.duration = duration;
+    stats.decodingTime = decodingTime;
+
+    emit q->jobFinished(job, result);
+    jobDone();
+}
+
+void QAudioBatchDecoderPrivate::_q_jobFailed(int job, int error, const QString &errorString)
+{
+    emit q->jobFailed(job, QAudioDecoder::Error(error), errorString);
+    jobDone();
+}
+
+/*!
+    Constructs a batch decoder with the given \a parent.
+*/
+QAudioBatchDecoder::QAudioBatchDecoder(QObject *parent)
+    : QObject(parent)
+    , d(new QAudioBatchDecoderPrivate(this))
+{
+}
+
+/*!
+    Destroys the batch decoder. Running jobs are abandoned and their WAV
+    files removed.
+*/
+QAudioBatchDecoder::~QAudioBatchDecoder()
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->pendingJobs.clear();
+    }
+
+    foreach (QThread *thread, d->threads)
+        thread->quit();
+    foreach (QThread *thread, d->threads) {
+        thread->wait();
+        delete thread;
+    }
+
+    delete d;
+}
+
+/*!
+    \property QAudioBatchDecoder::audioFormat
+    \brief the format jobs are decoded to.
+
+    The format applies to jobs added after it is set. If it is invalid, the
+    default, each file is decoded in its native format.
+*/
+QAudioFormat QAudioBatchDecoder::audioFormat() const
+{
+    return d->format;
+}
+
+void QAudioBatchDecoder::setAudioFormat(const QAudioFormat &format)
+{
+    d->format = format;
+}
+
+/*!
+    \property QAudioBatchDecoder::maximumConcurrentJobs
+    \brief the number of jobs decoded at the same time.
+
+    Defaults to QThread::idealThreadCount().
+*/
+int QAudioBatchDecoder::maximumConcurrentJobs() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->maximumConcurrentJobs;
+}
+
+void QAudioBatchDecoder::setMaximumConcurrentJobs(int count)
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->maximumConcurrentJobs = qMax(1, count);
+    }
+
+    if (d->activeJobs > 0)
+        d->wakeWorkers();
+}
+
+/*!
+    Queues decoding of \a fileName and returns the id of the job.
+
+    If \a waveFileName is empty the decoded samples are delivered in memory
+    by jobFinished(), otherwise they are written to a WAV file of that name.
+    WAV output requires PCM samples in little endian byte order; unsigned
+    8 bit, signed 16, 24 or 32 bit, or 32 bit float.
+*/
+int QAudioBatchDecoder::addJob(const QString &fileName, const QString &waveFileName)
+{
+    Job job;
+    job.id = d->nextJobId++;
+    job.fileName = fileName;
+    job.waveFileName = waveFileName;
+    job.format = d->format;
+
+    {
+        QMutexLocker locker(&d->mutex);
+        job.generation = d->generation;
+        d->pendingJobs.enqueue(job);
+    }
+
+    ++d->activeJobs;
+    d->wakeWorkers();
+
+    return job.id;
+}
+
+/*!
+    \property QAudioBatchDecoder::pendingJobCount
+    \brief the number of jobs waiting for a worker.
+*/
+int QAudioBatchDecoder::pendingJobCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->pendingJobs.size();
+}
+
+/*!
+    \property QAudioBatchDecoder::active
+    \brief whether jobs are pending or being decoded.
+*/
+bool QAudioBatchDecoder::isActive() const
+{
+    return d->activeJobs > 0;
+}
+
+/*!
+    Returns the duration in microseconds of the audio decoded by the finished
+    \a job, or -1 if the job hasn't finished.
+*/
+qint64 QAudioBatchDecoder::decodedDuration(int job) const
+{
+    QHash<int, QAudioBatchDecoderPrivate::Statistics>::const_iterator it = d->statistics.constFind(job);
+    return it != d->statistics.constEnd() ? it->duration : -1;
+}
+
+/*!
+    Returns the time in milliseconds it took to decode the finished \a job,
+    or -1 if the job hasn't finished. Compared to decodedDuration() this gives
+    how many times faster than real time the job was decoded.
+*/
+qint64 QAudioBatchDecoder::decodingTime(int job) const
+{
+    QHash<int, QAudioBatchDecoderPrivate::Statistics>::const_iterator it = d->statistics.constFind(job);
+    return it != d->statistics.constEnd() ? it->decodingTime : -1;
+}
+
+/*!
+    Discards all pending jobs and aborts the running ones, which report
+    jobFailed().
+*/
+void QAudioBatchDecoder::cancel()
+{
+    int generation;
+    int removed;
+    {
+        QMutexLocker locker(&d->mutex);
+        removed = d->pendingJobs.size();
+        d->pendingJobs.clear();
+        generation = ++d->generation;
+    }
+
+    foreach (QAudioBatchDecoderWorker *worker, d->workers)
+        QMetaObject::invokeMethod(worker, "abort", Qt::QueuedConnection, Q_ARG(int, generation));
+
+    if (removed > 0) {
+        d->activeJobs -= removed;
+        if (d->activeJobs == 0)
+            emit finished();
+    }
+}
+
+#include "moc_qaudiobatchdecoder.cpp"
+QT_END_NAMESPACE
+
+#include "qaudiobatchdecoder.moc"
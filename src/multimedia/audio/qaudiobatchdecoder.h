@@ -0,0 +1,96 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QAUDIOBATCHDECODER_H
+#define QAUDIOBATCHDECODER_H
+
+#include <QtCore/qobject.h>
+#include <QtMultimedia/qaudiobuffer.h>
+#include <QtMultimedia/qaudiodecoder.h>
+#include <QtMultimedia/qaudioformat.h>
+
+QT_BEGIN_NAMESPACE
+
+class QAudioBatchDecoderPrivate;
+class Q_MULTIMEDIA_EXPORT QAudioBatchDecoder : public QObject
+{
+    Q_OBJECT
+    Q_PROPERTY(QAudioFormat audioFormat READ audioFormat WRITE setAudioFormat)
+    Q_PROPERTY(int maximumConcurrentJobs READ maximumConcurrentJobs WRITE setMaximumConcurrentJobs)
+    Q_PROPERTY(int pendingJobCount READ pendingJobCount)
+    Q_PROPERTY(bool active READ isActive)
+
+public:
+    explicit QAudioBatchDecoder(QObject *parent = 0);
+    ~QAudioBatchDecoder();
+
+    QAudioFormat audioFormat() const;
+    void setAudioFormat(const QAudioFormat &format);
+
+    int maximumConcurrentJobs() const;
+    void setMaximumConcurrentJobs(int count);
+
+    int addJob(const QString &fileName, const QString &waveFileName = QString());
+
+    int pendingJobCount() const;
+    bool isActive() const;
+
+    qint64 decodedDuration(int job) const;
+    qint64 decodingTime(int job) const;
+
+public Q_SLOTS:
+    void cancel();
+
+Q_SIGNALS:
+    void jobFinished(int job, const QAudioBuffer &result);
+    void jobFailed(int job, QAudioDecoder::Error error, const QString &errorString);
+    void finished();
+
+private:
+    Q_DISABLE_COPY(QAudioBatchDecoder)
+    QAudioBatchDecoderPrivate *d;
+    Q_PRIVATE_SLOT(d, void _q_jobFinished(int, const QAudioBuffer &, qint64, qint64))
+    Q_PRIVATE_SLOT(d, void _q_jobFailed(int, int, const QString &))
+};
+
+QT_END_NAMESPACE
+
+#endif // QAUDIOBATCHDECODER_H
@@ -45,6 +45,7 @@
 #include <qmediaservice.h>
 #include "qaudiodecodercontrol.h"
 #include <private/qmediaserviceprovider_p.h>
+#include "qaudiodecoderbatchreadinterface_p.h"
 
 #include <QtCore/qcoreevent.h>
 #include <QtCore/qmetaobject.h>
@@ -427,6 +428,42 @@ QAudioBuffer QAudioDecoder::read() const
     }
 }
 
+/*!
+    \since 5.3
+
+    Reads up to \a maxCount decoded buffers, or all buffers currently
+    available if \a maxCount is negative. Like read() this function does not
+    block; it returns an empty list if no buffers are available.
+
+    Draining several buffers per \l bufferReady() signal lets the decoder
+    refill its queue while the buffers are processed, which speeds up decoding
+    of whole files considerably.
+
+    \sa read(), bufferAvailable()
+*/
+
+QList<QAudioBuffer> QAudioDecoder::readBuffers(int maxCount) const
+{
+    Q_D(const QAudioDecoder);
+
+    QList<QAudioBuffer> buffers;
+    if (!d->control)
+        return buffers;
+
+    QAudioDecoderBatchReadInterface *batchRead =
+            qobject_cast<QAudioDecoderBatchReadInterface*>(d->control);
+    if (batchRead)
+        return batchRead->readBuffers(maxCount);
+
+    while ((maxCount < 0 || buffers.size() < maxCount) && d->control->bufferAvailable()) {
+        const QAudioBuffer buffer = d->control->read();
+        if (!buffer.isValid())
+            break;
+        buffers.append(buffer);
+    }
+    return buffers;
+}
+
 // Enums
 /*!
     \enum QAudioDecoder::State
@@ -97,6 +97,7 @@ public:
     QString errorString() const;
 
     QAudioBuffer read() const;
+    QList<QAudioBuffer> readBuffers(int maxCount = -1) const;
     bool bufferAvailable() const;
 
     qint64 position() const;
@@ -41,76 +41,384 @@
 
 #include "qaudiohelpers_p.h"
 
+#include <private/qsimd_p.h>
+
 #include <QDebug>
 
+#include <math.h>
+#include <string.h>
+
 QT_BEGIN_NAMESPACE
 
 namespace QAudioHelperInternal
 {
 
-template<class T> void adjustSamples(qreal factor, const void *src, void *dst, int samples)
-{
-    const T *pSrc = (const T *)src;
-    T *pDst = (T*)dst;
-    for ( int i = 0; i < samples; i++ )
-        pDst[i] = pSrc[i] * factor;
-}
-
 // Unsigned samples are biased around 0x80/0x8000 :/
 // This makes a pure template solution a bit unwieldy but possible
 template<class T> struct signedVersion {};
+template<> struct signedVersion<qint8>
+{
+    typedef qint8 TS;
+    enum {offset = 0};
+};
+
 template<> struct signedVersion<quint8>
 {
     typedef qint8 TS;
     enum {offset = 0x80};
 };
 
+template<> struct signedVersion<qint16>
+{
+    typedef qint16 TS;
+    enum {offset = 0};
+};
+
 template<> struct signedVersion<quint16>
 {
     typedef qint16 TS;
     enum {offset = 0x8000};
 };
 
+template<> struct signedVersion<qint32>
+{
+    typedef qint32 TS;
+    enum {offset = 0};
+};
+
 template<> struct signedVersion<quint32>
 {
     typedef qint32 TS;
     enum {offset = 0x80000000};
 };
 
-template<class T> void adjustUnsignedSamples(qreal factor, const void *src, void *dst, int samples)
+template<class T> struct sampleRange {};
+template<> struct sampleRange<qint8> { enum { min = -128, max = 127 }; };
+template<> struct sampleRange<qint16> { enum { min = -32768, max = 32767 }; };
+
+// Scaled samples are rounded to nearest, ties to even, and clamped to the
+// sample range. That is what the SSE and AVX conversions do in the default
+// rounding mode, so every code path gives the same samples.
+template<class TS> inline TS saturate(qint64 value)
+{
+    return TS(qBound<qint64>(sampleRange<TS>::min, value, sampleRange<TS>::max));
+}
+
+inline qint32 saturateRound(double value, double min, double max)
 {
+    // lrint() rounds to nearest even in the default rounding mode
+    return qint32(lrint(qBound(min, value, max)));
+}
+
+// 8 and 16 bit samples are scaled with a 16.16 fixed-point gain,
+// which is exact enough for those sample sizes and avoids a
+// float conversion per sample. The vectorized kernels are handed
+// the same gain, see qMultiplySamples().
+inline qint64 fixedPointGain(qreal factor)
+{
+    return qRound64(factor * 65536);
+}
+
+// Drops the fraction of a 16.16 value, rounding ties to even
+inline qint64 roundFixedPoint(qint64 value)
+{
+    return (value + 0x7fff + ((value >> 16) & 1)) >> 16;
+}
+
+template<class T> void adjustSamples(qreal factor, const void *src, void *dst, int samples)
+{
+    typedef typename signedVersion<T>::TS TS;
+
+    const qint64 gain = fixedPointGain(factor);
     const T *pSrc = (const T *)src;
     T *pDst = (T*)dst;
     for ( int i = 0; i < samples; i++ ) {
-        pDst[i] = signedVersion<T>::offset + ((typename signedVersion<T>::TS)(pSrc[i] - signedVersion<T>::offset) * factor);
+        const qint64 value = roundFixedPoint(qint64(TS(pSrc[i] - signedVersion<T>::offset)) * gain);
+        pDst[i] = T(saturate<TS>(value) + signedVersion<T>::offset);
     }
 }
 
-void qMultiplySamples(qreal factor, const QAudioFormat &format, const void* src, void* dest, int len)
+// Packed 24 bit samples in host byte order, scaled in double precision
+template<bool isUnsigned> void adjustSamples24(qreal factor, const void *src, void *dst, int samples)
 {
-    int samplesCount = len / (format.sampleSize()/8);
+    const qint32 offset = isUnsigned ? 0x800000 : 0;
+    const quint8 *pSrc = (const quint8 *)src;
+    quint8 *pDst = (quint8 *)dst;
+    for ( int i = 0; i < samples; i++, pSrc += 3, pDst += 3 ) {
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        const quint32 raw = pSrc[0] | (pSrc[1] << 8) | (pSrc[2] << 16);
+#else
+        const quint32 raw = (pSrc[0] << 16) | (pSrc[1] << 8) | pSrc[2];
+#endif
+        // Sign extend from 24 bits
+        const qint32 sample = isUnsigned ? qint32(raw) - offset : qint32(raw << 8) >> 8;
+        const quint32 value = quint32(saturateRound(sample * factor, -8388608.0, 8388607.0) + offset);
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+        pDst[0] = quint8(value);
+        pDst[1] = quint8(value >> 8);
+        pDst[2] = quint8(value >> 16);
+#else
+        pDst[0] = quint8(value >> 16);
+        pDst[1] = quint8(value >> 8);
+        pDst[2] = quint8(value);
+#endif
+    }
+}
+
+// 32 bit samples need double precision
+template<class T> void adjustSamples32(qreal factor, const void *src, void *dst, int samples)
+{
+    const T *pSrc = (const T *)src;
+    T *pDst = (T*)dst;
+    for ( int i = 0; i < samples; i++ ) {
+        const qint32 value = saturateRound(qint32(pSrc[i] - signedVersion<T>::offset) * factor,
+                                           -2147483648.0, 2147483647.0);
+        pDst[i] = T(value + signedVersion<T>::offset);
+    }
+}
+
+void adjustFloatSamples(qreal factor, const void *src, void *dst, int samples)
+{
+    const float *pSrc = (const float *)src;
+    float *pDst = (float*)dst;
+    const float gain = factor;
+    for ( int i = 0; i < samples; i++ )
+        pDst[i] = pSrc[i] * gain;
+}
+
+typedef void (*AdjustSamplesFunc)(qreal factor, const void *src, void *dst, int samples);
 
-    switch ( format.sampleSize() ) {
+// Vectorized kernels process as many samples as they can and return the
+// number of samples processed, the remainder is handled by the generic code.
+typedef int (*AdjustSamplesSimdFunc)(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+int qt_adjustSamples_int8_sse2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+int qt_adjustSamples_int16_sse2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+int qt_adjustSamples_int32_sse2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+int qt_adjustSamples_float_sse2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+#endif
+
+#if defined(QT_COMPILER_SUPPORTS_AVX2)
+int qt_adjustSamples_int8_avx2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+int qt_adjustSamples_int16_avx2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+int qt_adjustSamples_float_avx2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+#endif
+
+#if defined(__ARM_NEON__)
+int qt_adjustSamples_int8_neon(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+int qt_adjustSamples_int16_neon(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+int qt_adjustSamples_float_neon(qreal factor, const void *src, void *dst, int samples, bool isUnsigned);
+#endif
+
+static AdjustSamplesSimdFunc simdFunction(int sampleSize, QAudioFormat::SampleType sampleType)
+{
+    if (sampleType == QAudioFormat::Float) {
+        if (sampleSize != 32)
+            return 0;
+#if defined(QT_COMPILER_SUPPORTS_AVX2)
+        if (qCpuHasFeature(AVX2))
+            return qt_adjustSamples_float_avx2;
+#endif
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+        if (qCpuHasFeature(SSE2))
+            return qt_adjustSamples_float_sse2;
+#endif
+#if defined(__ARM_NEON__)
+        if (qCpuHasFeature(NEON))
+            return qt_adjustSamples_float_neon;
+#endif
+        return 0;
+    }
+
+    switch (sampleSize) {
     case 8:
-        if (format.sampleType() == QAudioFormat::SignedInt)
-            QAudioHelperInternal::adjustSamples<qint8>(factor,src,dest,samplesCount);
-        else if (format.sampleType() == QAudioFormat::UnSignedInt)
-            QAudioHelperInternal::adjustUnsignedSamples<quint8>(factor,src,dest,samplesCount);
+#if defined(QT_COMPILER_SUPPORTS_AVX2)
+        if (qCpuHasFeature(AVX2))
+            return qt_adjustSamples_int8_avx2;
+#endif
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+        if (qCpuHasFeature(SSE2))
+            return qt_adjustSamples_int8_sse2;
+#endif
+#if defined(__ARM_NEON__)
+        if (qCpuHasFeature(NEON))
+            return qt_adjustSamples_int8_neon;
+#endif
         break;
     case 16:
-        if (format.sampleType() == QAudioFormat::SignedInt)
-            QAudioHelperInternal::adjustSamples<qint16>(factor,src,dest,samplesCount);
-        else if (format.sampleType() == QAudioFormat::UnSignedInt)
-            QAudioHelperInternal::adjustUnsignedSamples<quint16>(factor,src,dest,samplesCount);
+#if defined(QT_COMPILER_SUPPORTS_AVX2)
+        if (qCpuHasFeature(AVX2))
+            return qt_adjustSamples_int16_avx2;
+#endif
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+        if (qCpuHasFeature(SSE2))
+            return qt_adjustSamples_int16_sse2;
+#endif
+#if defined(__ARM_NEON__)
+        if (qCpuHasFeature(NEON))
+            return qt_adjustSamples_int16_neon;
+#endif
+        break;
+    case 32:
+        // NEON has no double precision vectors on ARMv7, 32 bit integer
+        // samples stay on the generic path there.
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+        if (qCpuHasFeature(SSE2))
+            return qt_adjustSamples_int32_sse2;
+#endif
         break;
     default:
-        if (format.sampleType() == QAudioFormat::SignedInt)
-            QAudioHelperInternal::adjustSamples<qint32>(factor,src,dest,samplesCount);
-        else if (format.sampleType() == QAudioFormat::UnSignedInt)
-            QAudioHelperInternal::adjustUnsignedSamples<quint32>(factor,src,dest,samplesCount);
-        else if (format.sampleType() == QAudioFormat::Float)
-            QAudioHelperInternal::adjustSamples<float>(factor,src,dest,samplesCount);
+        break;
+    }
+
+    return 0;
+}
+
+static AdjustSamplesFunc genericFunction(int sampleSize, QAudioFormat::SampleType sampleType)
+{
+    switch (sampleSize) {
+    case 8:
+        if (sampleType == QAudioFormat::SignedInt)
+            return adjustSamples<qint8>;
+        else if (sampleType == QAudioFormat::UnSignedInt)
+            return adjustSamples<quint8>;
+        break;
+    case 16:
+        if (sampleType == QAudioFormat::SignedInt)
+            return adjustSamples<qint16>;
+        else if (sampleType == QAudioFormat::UnSignedInt)
+            return adjustSamples<quint16>;
+        break;
+    case 24:
+        if (sampleType == QAudioFormat::SignedInt)
+            return adjustSamples24<false>;
+        else if (sampleType == QAudioFormat::UnSignedInt)
+            return adjustSamples24<true>;
+        break;
+    default:
+        if (sampleType == QAudioFormat::SignedInt)
+            return adjustSamples32<qint32>;
+        else if (sampleType == QAudioFormat::UnSignedInt)
+            return adjustSamples32<quint32>;
+        else if (sampleType == QAudioFormat::Float)
+            return adjustFloatSamples;
+    }
+
+    return 0;
+}
+
+void qMultiplySamples(qreal factor, const QAudioFormat &format, const void* src, void* dest, int len)
+{
+    const int sampleSize = format.sampleSize() == 8 || format.sampleSize() == 16
+            || format.sampleSize() == 24 ? format.sampleSize() : 32;
+    const QAudioFormat::SampleType sampleType = format.sampleType();
+    const int samplesCount = len / (sampleSize / 8);
+
+    AdjustSamplesFunc generic = genericFunction(sampleSize, sampleType);
+    if (!generic || samplesCount <= 0)
+        return;
+
+    // Unity gain, nothing to scale
+    if (factor == 1.0) {
+        if (src != dest)
+            memmove(dest, src, samplesCount * (sampleSize / 8));
+        return;
+    }
+
+    // Silence is all zeros unless the samples are biased
+    if (factor == 0.0 && sampleType != QAudioFormat::UnSignedInt) {
+        memset(dest, 0, samplesCount * (sampleSize / 8));
+        return;
+    }
+
+    int processed = 0;
+    if (AdjustSamplesSimdFunc simd = simdFunction(sampleSize, sampleType)) {
+        // Integer kernels for 8 and 16 bit samples scale by the fixed-point
+        // gain of the generic code, so both give the same samples.
+        const qreal simdFactor = sampleSize <= 16 ? fixedPointGain(factor) / 65536.0 : factor;
+        processed = simd(simdFactor, src, dest, samplesCount, sampleType == QAudioFormat::UnSignedInt);
     }
+
+    if (processed < samplesCount) {
+        const int offset = processed * (sampleSize / 8);
+        generic(factor,
+                static_cast<const char *>(src) + offset,
+                static_cast<char *>(dest) + offset,
+                samplesCount - processed);
+    }
+}
+
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+int qt_mixSamples_int16_sse2(float gain, const qint16 *src, float *accumulator, int samples);
+int qt_mixSamples_float_sse2(float gain, const float *src, float *accumulator, int samples);
+int qt_storeMixedSamples_int16_sse2(const float *accumulator, qint16 *dest, int samples);
+#endif
+
+#if defined(__ARM_NEON__)
+int qt_mixSamples_int16_neon(float gain, const qint16 *src, float *accumulator, int samples);
+int qt_mixSamples_float_neon(float gain, const float *src, float *accumulator, int samples);
+int qt_storeMixedSamples_int16_neon(const float *accumulator, qint16 *dest, int samples);
+#endif
+
+bool qIsMixableFormat(const QAudioFormat &format)
+{
+    if (!format.isValid() || format.byteOrder() != QAudioFormat::Endian(QSysInfo::ByteOrder))
+        return false;
+
+    return (format.sampleType() == QAudioFormat::SignedInt && format.sampleSize() == 16)
+            || (format.sampleType() == QAudioFormat::Float && format.sampleSize() == 32);
+}
+
+void qMixSamples(qreal factor, const QAudioFormat &format, const void *src, float *accumulator, int samples)
+{
+    const float gain = factor;
+    int i = 0;
+
+    if (format.sampleType() == QAudioFormat::Float) {
+        const float *pSrc = static_cast<const float *>(src);
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+        if (qCpuHasFeature(SSE2))
+            i = qt_mixSamples_float_sse2(gain, pSrc, accumulator, samples);
+#elif defined(__ARM_NEON__)
+        if (qCpuHasFeature(NEON))
+            i = qt_mixSamples_float_neon(gain, pSrc, accumulator, samples);
+#endif
+        for (; i < samples; ++i)
+            accumulator[i] += pSrc[i] * gain;
+    } else {
+        const qint16 *pSrc = static_cast<const qint16 *>(src);
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+        if (qCpuHasFeature(SSE2))
+            i = qt_mixSamples_int16_sse2(gain, pSrc, accumulator, samples);
+#elif defined(__ARM_NEON__)
+        if (qCpuHasFeature(NEON))
+            i = qt_mixSamples_int16_neon(gain, pSrc, accumulator, samples);
+#endif
+        for (; i < samples; ++i)
+            accumulator[i] += pSrc[i] * gain;
+    }
+}
+
+void qStoreMixedSamples(const QAudioFormat &format, const float *accumulator, void *dest, int samples)
+{
+    // Float output is left unclipped, the backend or the device clips it
+    if (format.sampleType() == QAudioFormat::Float) {
+        memcpy(dest, accumulator, samples * sizeof(float));
+        return;
+    }
+
+    qint16 *pDst = static_cast<qint16 *>(dest);
+    int i = 0;
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+    if (qCpuHasFeature(SSE2))
+        i = qt_storeMixedSamples_int16_sse2(accumulator, pDst, samples);
+#elif defined(__ARM_NEON__)
+    if (qCpuHasFeature(NEON))
+        i = qt_storeMixedSamples_int16_neon(accumulator, pDst, samples);
+#endif
+    for (; i < samples; ++i)
+        pDst[i] = qint16(saturateRound(accumulator[i], -32768.0, 32767.0));
 }
 }
 
@@ -0,0 +1,138 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiohelpers_p.h"
+
+#include <private/qsimd_p.h>
+
+#include <immintrin.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QAudioHelperInternal
+{
+
+// Scales in double precision with the fixed-point gain of the generic code,
+// like the SSE2 kernels.
+static inline __m256i scaleInt32x8(__m256i v, __m256d gain)
+{
+    const __m256d minValue = _mm256_set1_pd(-32768.0);
+    const __m256d maxValue = _mm256_set1_pd(32767.0);
+
+    __m256d lo = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(v)), gain);
+    __m256d hi = _mm256_mul_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(v, 1)), gain);
+    lo = _mm256_min_pd(_mm256_max_pd(lo, minValue), maxValue);
+    hi = _mm256_min_pd(_mm256_max_pd(hi, minValue), maxValue);
+    return _mm256_inserti128_si256(_mm256_castsi128_si256(_mm256_cvtpd_epi32(lo)),
+                                   _mm256_cvtpd_epi32(hi), 1);
+}
+
+// _mm256_packs_epi32 packs within 128 bit lanes, restore the sample order
+static inline __m256i packInt32x16(__m256i lo, __m256i hi)
+{
+    return _mm256_permute4x64_epi64(_mm256_packs_epi32(lo, hi), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+int qt_adjustSamples_int8_avx2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    const __m256d gain = _mm256_set1_pd(factor);
+    const __m128i flip = _mm_set1_epi8(isUnsigned ? char(0x80) : 0);
+
+    const __m128i *pSrc = static_cast<const __m128i *>(src);
+    __m128i *pDst = static_cast<__m128i *>(dst);
+
+    int i = 0;
+    for (; i + 16 <= samples; i += 16, ++pSrc, ++pDst) {
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128(pSrc), flip);
+
+        const __m256i lo = scaleInt32x8(_mm256_cvtepi8_epi32(v), gain);
+        const __m256i hi = scaleInt32x8(_mm256_cvtepi8_epi32(_mm_srli_si128(v, 8)), gain);
+        const __m256i packed = packInt32x16(lo, hi);
+
+        const __m128i result = _mm_packs_epi16(_mm256_castsi256_si128(packed),
+                                               _mm256_extracti128_si256(packed, 1));
+        _mm_storeu_si128(pDst, _mm_xor_si128(result, flip));
+    }
+
+    return i;
+}
+
+int qt_adjustSamples_int16_avx2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    const __m256d gain = _mm256_set1_pd(factor);
+    const __m256i flip = _mm256_set1_epi16(isUnsigned ? short(0x8000) : 0);
+
+    const __m256i *pSrc = static_cast<const __m256i *>(src);
+    __m256i *pDst = static_cast<__m256i *>(dst);
+
+    int i = 0;
+    for (; i + 16 <= samples; i += 16, ++pSrc, ++pDst) {
+        const __m256i v = _mm256_xor_si256(_mm256_loadu_si256(pSrc), flip);
+
+        const __m256i lo = scaleInt32x8(_mm256_cvtepi16_epi32(_mm256_castsi256_si128(v)), gain);
+        const __m256i hi = scaleInt32x8(_mm256_cvtepi16_epi32(_mm256_extracti128_si256(v, 1)), gain);
+
+        _mm256_storeu_si256(pDst, _mm256_xor_si256(packInt32x16(lo, hi), flip));
+    }
+
+    return i;
+}
+
+int qt_adjustSamples_float_avx2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    Q_UNUSED(isUnsigned);
+
+    const __m256 gain = _mm256_set1_ps(factor);
+    const float *pSrc = static_cast<const float *>(src);
+    float *pDst = static_cast<float *>(dst);
+
+    int i = 0;
+    for (; i + 16 <= samples; i += 16) {
+        _mm256_storeu_ps(pDst + i, _mm256_mul_ps(_mm256_loadu_ps(pSrc + i), gain));
+        _mm256_storeu_ps(pDst + i + 8, _mm256_mul_ps(_mm256_loadu_ps(pSrc + i + 8), gain));
+    }
+
+    return i;
+}
+
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,197 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiohelpers_p.h"
+
+#include <private/qsimd_p.h>
+
+#if defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QAudioHelperInternal
+{
+
+// vcvtq_s32_f32 truncates and ARMv7 has no rounding conversion. Adding and
+// subtracting 1.5 * 2^23 rounds to nearest even, like the SSE conversions,
+// for values clamped to the 16 bit range. The narrowing saturates.
+static inline int32x4_t roundInt32x4(float32x4_t f)
+{
+    const float32x4_t magic = vdupq_n_f32(12582912.0f);
+    f = vminq_f32(vmaxq_f32(f, vdupq_n_f32(-32768.0f)), vdupq_n_f32(32767.0f));
+    return vcvtq_s32_f32(vsubq_f32(vaddq_f32(f, magic), magic));
+}
+
+// 8 and 16 bit samples are scaled with the 16.16 fixed-point gain of the
+// generic code, in 64 bit integer lanes, and rounded to nearest even the
+// same way. The narrowing saturates.
+static inline int32x2_t roundFixedPoint(int64x2_t value)
+{
+    const int64x2_t odd = vandq_s64(vshrq_n_s64(value, 16), vdupq_n_s64(1));
+    value = vaddq_s64(value, vaddq_s64(odd, vdupq_n_s64(0x7fff)));
+    return vqmovn_s64(vshrq_n_s64(value, 16));
+}
+
+static inline int32x4_t scaleInt32x4(int32x4_t v, int32x2_t gain)
+{
+    return vcombine_s32(roundFixedPoint(vmull_s32(vget_low_s32(v), gain)),
+                        roundFixedPoint(vmull_s32(vget_high_s32(v), gain)));
+}
+
+static inline int16x8_t scaleInt16x8(int16x8_t v, int32x2_t gain)
+{
+    const int32x4_t lo = scaleInt32x4(vmovl_s16(vget_low_s16(v)), gain);
+    const int32x4_t hi = scaleInt32x4(vmovl_s16(vget_high_s16(v)), gain);
+    return vcombine_s16(vqmovn_s32(lo), vqmovn_s32(hi));
+}
+
+// The factor is a multiple of 1/65536, see qMultiplySamples(). Gains that
+// don't fit the 32 bit lanes are left to the generic code.
+static inline bool fixedPointGain(qreal factor, int32x2_t *gain)
+{
+    const qint64 value = qRound64(factor * 65536);
+    if (value > 0x7fffffff || value < -0x7fffffff)
+        return false;
+    *gain = vdup_n_s32(qint32(value));
+    return true;
+}
+
+int qt_adjustSamples_int8_neon(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    int32x2_t gain;
+    if (!fixedPointGain(factor, &gain))
+        return 0;
+    const int8x8_t flip = vdup_n_s8(isUnsigned ? -128 : 0);
+
+    const qint8 *pSrc = static_cast<const qint8 *>(src);
+    qint8 *pDst = static_cast<qint8 *>(dst);
+
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        const int8x8_t v = veor_s8(vld1_s8(pSrc + i), flip);
+        const int16x8_t scaled = scaleInt16x8(vmovl_s8(v), gain);
+        vst1_s8(pDst + i, veor_s8(vqmovn_s16(scaled), flip));
+    }
+
+    return i;
+}
+
+int qt_adjustSamples_int16_neon(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    int32x2_t gain;
+    if (!fixedPointGain(factor, &gain))
+        return 0;
+    const int16x8_t flip = vdupq_n_s16(isUnsigned ? -32768 : 0);
+
+    const qint16 *pSrc = static_cast<const qint16 *>(src);
+    qint16 *pDst = static_cast<qint16 *>(dst);
+
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        const int16x8_t v = veorq_s16(vld1q_s16(pSrc + i), flip);
+        vst1q_s16(pDst + i, veorq_s16(scaleInt16x8(v, gain), flip));
+    }
+
+    return i;
+}
+
+int qt_adjustSamples_float_neon(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    Q_UNUSED(isUnsigned);
+
+    const float32x4_t gain = vdupq_n_f32(factor);
+    const float *pSrc = static_cast<const float *>(src);
+    float *pDst = static_cast<float *>(dst);
+
+    int i = 0;
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32(pDst + i, vmulq_f32(vld1q_f32(pSrc + i), gain));
+
+    return i;
+}
+
+int qt_mixSamples_int16_neon(float gain, const qint16 *src, float *accumulator, int samples)
+{
+    const float32x4_t g = vdupq_n_f32(gain);
+
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        const int16x8_t v = vld1q_s16(src + i);
+        const float32x4_t lo = vcvtq_f32_s32(vmovl_s16(vget_low_s16(v)));
+        const float32x4_t hi = vcvtq_f32_s32(vmovl_s16(vget_high_s16(v)));
+
+        vst1q_f32(accumulator + i, vmlaq_f32(vld1q_f32(accumulator + i), lo, g));
+        vst1q_f32(accumulator + i + 4, vmlaq_f32(vld1q_f32(accumulator + i + 4), hi, g));
+    }
+
+    return i;
+}
+
+int qt_mixSamples_float_neon(float gain, const float *src, float *accumulator, int samples)
+{
+    const float32x4_t g = vdupq_n_f32(gain);
+
+    int i = 0;
+    for (; i + 4 <= samples; i += 4)
+        vst1q_f32(accumulator + i, vmlaq_f32(vld1q_f32(accumulator + i), vld1q_f32(src + i), g));
+
+    return i;
+}
+
+int qt_storeMixedSamples_int16_neon(const float *accumulator, qint16 *dest, int samples)
+{
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        const int32x4_t a = roundInt32x4(vld1q_f32(accumulator + i));
+        const int32x4_t b = roundInt32x4(vld1q_f32(accumulator + i + 4));
+        vst1q_s16(dest + i, vcombine_s16(vqmovn_s32(a), vqmovn_s32(b)));
+    }
+
+    return i;
+}
+
+}
+
+QT_END_NAMESPACE
+
+#endif // __ARM_NEON__
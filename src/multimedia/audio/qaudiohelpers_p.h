@@ -60,6 +60,13 @@ QT_BEGIN_NAMESPACE
 namespace QAudioHelperInternal
 {
 Q_MULTIMEDIA_EXPORT void qMultiplySamples(qreal factor, const QAudioFormat& format, const void *src, void* dest, int len);
+
+// Mixing accumulates samples scaled by a gain into a float buffer, which is
+// then stored back in the sample format with saturation. Only signed 16 bit
+// and 32 bit float samples in host byte order can be mixed.
+Q_MULTIMEDIA_EXPORT bool qIsMixableFormat(const QAudioFormat &format);
+Q_MULTIMEDIA_EXPORT void qMixSamples(qreal factor, const QAudioFormat &format, const void *src, float *accumulator, int samples);
+Q_MULTIMEDIA_EXPORT void qStoreMixedSamples(const QAudioFormat &format, const float *accumulator, void *dest, int samples);
 }
 
 QT_END_NAMESPACE
@@ -0,0 +1,212 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudiohelpers_p.h"
+
+#include <private/qsimd_p.h>
+
+#include <emmintrin.h>
+
+QT_BEGIN_NAMESPACE
+
+namespace QAudioHelperInternal
+{
+
+// The integer kernels convert to double precision, scale, clamp to the
+// sample range and convert back, rounding to nearest even. 8 and 16 bit
+// samples are handed the 16.16 fixed-point gain of the generic code, whose
+// products are exact in double precision, so the results are identical.
+// Unsigned samples are flipped into the signed range and back.
+
+static inline __m128i scaleInt32x4(__m128i v, __m128d gain)
+{
+    const __m128d minValue = _mm_set1_pd(-32768.0);
+    const __m128d maxValue = _mm_set1_pd(32767.0);
+
+    __m128d lo = _mm_mul_pd(_mm_cvtepi32_pd(v), gain);
+    __m128d hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))), gain);
+    lo = _mm_min_pd(_mm_max_pd(lo, minValue), maxValue);
+    hi = _mm_min_pd(_mm_max_pd(hi, minValue), maxValue);
+    return _mm_unpacklo_epi64(_mm_cvtpd_epi32(lo), _mm_cvtpd_epi32(hi));
+}
+
+int qt_adjustSamples_int8_sse2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    const __m128d gain = _mm_set1_pd(factor);
+    const __m128i flip = _mm_set1_epi8(isUnsigned ? char(0x80) : 0);
+
+    const __m128i *pSrc = static_cast<const __m128i *>(src);
+    __m128i *pDst = static_cast<__m128i *>(dst);
+
+    int i = 0;
+    for (; i + 16 <= samples; i += 16, ++pSrc, ++pDst) {
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128(pSrc), flip);
+
+        // sign extend to 16 and then 32 bit
+        const __m128i lo16 = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+        const __m128i hi16 = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+
+        const __m128i a = scaleInt32x4(_mm_srai_epi32(_mm_unpacklo_epi16(lo16, lo16), 16), gain);
+        const __m128i b = scaleInt32x4(_mm_srai_epi32(_mm_unpackhi_epi16(lo16, lo16), 16), gain);
+        const __m128i c = scaleInt32x4(_mm_srai_epi32(_mm_unpacklo_epi16(hi16, hi16), 16), gain);
+        const __m128i d = scaleInt32x4(_mm_srai_epi32(_mm_unpackhi_epi16(hi16, hi16), 16), gain);
+
+        const __m128i result = _mm_packs_epi16(_mm_packs_epi32(a, b), _mm_packs_epi32(c, d));
+        _mm_storeu_si128(pDst, _mm_xor_si128(result, flip));
+    }
+
+    return i;
+}
+
+int qt_adjustSamples_int16_sse2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    const __m128d gain = _mm_set1_pd(factor);
+    const __m128i flip = _mm_set1_epi16(isUnsigned ? short(0x8000) : 0);
+
+    const __m128i *pSrc = static_cast<const __m128i *>(src);
+    __m128i *pDst = static_cast<__m128i *>(dst);
+
+    int i = 0;
+    for (; i + 8 <= samples; i += 8, ++pSrc, ++pDst) {
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128(pSrc), flip);
+
+        const __m128i lo = scaleInt32x4(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16), gain);
+        const __m128i hi = scaleInt32x4(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16), gain);
+
+        _mm_storeu_si128(pDst, _mm_xor_si128(_mm_packs_epi32(lo, hi), flip));
+    }
+
+    return i;
+}
+
+int qt_adjustSamples_int32_sse2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    const __m128d gain = _mm_set1_pd(factor);
+    const __m128d minValue = _mm_set1_pd(-2147483648.0);
+    const __m128d maxValue = _mm_set1_pd(2147483647.0);
+    const __m128i flip = _mm_set1_epi32(isUnsigned ? int(0x80000000) : 0);
+
+    const __m128i *pSrc = static_cast<const __m128i *>(src);
+    __m128i *pDst = static_cast<__m128i *>(dst);
+
+    int i = 0;
+    for (; i + 4 <= samples; i += 4, ++pSrc, ++pDst) {
+        const __m128i v = _mm_xor_si128(_mm_loadu_si128(pSrc), flip);
+
+        __m128d lo = _mm_mul_pd(_mm_cvtepi32_pd(v), gain);
+        __m128d hi = _mm_mul_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(v, _MM_SHUFFLE(1, 0, 3, 2))), gain);
+        lo = _mm_min_pd(_mm_max_pd(lo, minValue), maxValue);
+        hi = _mm_min_pd(_mm_max_pd(hi, minValue), maxValue);
+
+        const __m128i result = _mm_unpacklo_epi64(_mm_cvtpd_epi32(lo), _mm_cvtpd_epi32(hi));
+        _mm_storeu_si128(pDst, _mm_xor_si128(result, flip));
+    }
+
+    return i;
+}
+
+int qt_adjustSamples_float_sse2(qreal factor, const void *src, void *dst, int samples, bool isUnsigned)
+{
+    Q_UNUSED(isUnsigned);
+
+    const __m128 gain = _mm_set1_ps(factor);
+    const float *pSrc = static_cast<const float *>(src);
+    float *pDst = static_cast<float *>(dst);
+
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        _mm_storeu_ps(pDst + i, _mm_mul_ps(_mm_loadu_ps(pSrc + i), gain));
+        _mm_storeu_ps(pDst + i + 4, _mm_mul_ps(_mm_loadu_ps(pSrc + i + 4), gain));
+    }
+
+    return i;
+}
+
+int qt_mixSamples_int16_sse2(float gain, const qint16 *src, float *accumulator, int samples)
+{
+    const __m128 g = _mm_set1_ps(gain);
+
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(src + i));
+        const __m128 lo = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16));
+        const __m128 hi = _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16));
+
+        _mm_storeu_ps(accumulator + i, _mm_add_ps(_mm_loadu_ps(accumulator + i), _mm_mul_ps(lo, g)));
+        _mm_storeu_ps(accumulator + i + 4, _mm_add_ps(_mm_loadu_ps(accumulator + i + 4), _mm_mul_ps(hi, g)));
+    }
+
+    return i;
+}
+
+int qt_mixSamples_float_sse2(float gain, const float *src, float *accumulator, int samples)
+{
+    const __m128 g = _mm_set1_ps(gain);
+
+    int i = 0;
+    for (; i + 4 <= samples; i += 4)
+        _mm_storeu_ps(accumulator + i, _mm_add_ps(_mm_loadu_ps(accumulator + i), _mm_mul_ps(_mm_loadu_ps(src + i), g)));
+
+    return i;
+}
+
+int qt_storeMixedSamples_int16_sse2(const float *accumulator, qint16 *dest, int samples)
+{
+    // _mm_cvtps_epi32 rounds to nearest even, but turns values out of the
+    // 32 bit range into INT_MIN, so clamp before converting.
+    const __m128 minValue = _mm_set1_ps(-32768.0f);
+    const __m128 maxValue = _mm_set1_ps(32767.0f);
+
+    int i = 0;
+    for (; i + 8 <= samples; i += 8) {
+        const __m128 a = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(accumulator + i), minValue), maxValue);
+        const __m128 b = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(accumulator + i + 4), minValue), maxValue);
+        const __m128i lo = _mm_cvtps_epi32(a);
+        const __m128i hi = _mm_cvtps_epi32(b);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(dest + i), _mm_packs_epi32(lo, hi));
+    }
+
+    return i;
+}
+
+}
+
+QT_END_NAMESPACE
@@ -47,6 +47,8 @@
 
 #include "qaudiodevicefactory_p.h"
 
+#include <QtCore/qvariant.h>
+
 QT_BEGIN_NAMESPACE
 
 /*!
@@ -374,6 +376,26 @@ qint64 QAudioInput::elapsedUSecs() const
     return d->elapsedUSecs();
 }
 
+/*!
+    Returns the time in microseconds between audio being captured by the
+    device and becoming available to read, including data queued by the
+    device and the backend.
+
+    Returns -1 if the platform cannot report the latency, or while the
+    input is stopped.
+
+    \since 5.3
+    \sa processedUSecs()
+*/
+
+qint64 QAudioInput::latencyUSecs() const
+{
+    // Backends that know their latency expose it as a property, which keeps
+    // QAbstractAudioInput's vtable unchanged.
+    const QVariant latency = d->property("latencyUSecs");
+    return latency.isValid() ? latency.toLongLong() : -1;
+}
+
 /*!
     Returns the error state.
 */
@@ -47,6 +47,8 @@
 
 #include "qaudiodevicefactory_p.h"
 
+#include <QtCore/qvariant.h>
+
 
 QT_BEGIN_NAMESPACE
 
@@ -334,6 +336,24 @@ qint64 QAudioOutput::elapsedUSecs() const
     return d->elapsedUSecs();
 }
 
+/*!
+    Returns the time in microseconds until audio data written now will be
+    heard, including data queued by the backend and the device itself.
+
+    Returns -1 if the platform cannot report the latency, or while the
+    output is stopped.
+
+    \since 5.3
+    \sa processedUSecs()
+*/
+qint64 QAudioOutput::latencyUSecs() const
+{
+    // Backends that know their latency expose it as a property, which keeps
+    // QAbstractAudioOutput's vtable unchanged.
+    const QVariant latency = d->property("latencyUSecs");
+    return latency.isValid() ? latency.toLongLong() : -1;
+}
+
 /*!
     Returns the error state.
 */
@@ -89,6 +89,7 @@ public:
 
     qint64 processedUSecs() const;
     qint64 elapsedUSecs() const;
+    qint64 latencyUSecs() const;
 
     QAudio::Error error() const;
     QAudio::State state() const;
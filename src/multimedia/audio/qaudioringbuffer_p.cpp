@@ -0,0 +1,189 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qaudioringbuffer_p.h"
+
+#include <string.h>
+
+QT_BEGIN_NAMESPACE
+
+QAudioRingBuffer::QAudioRingBuffer(int bufferSize)
+    : m_bufferSize(0)
+    , m_buffer(0)
+{
+    resize(bufferSize);
+}
+
+QAudioRingBuffer::~QAudioRingBuffer()
+{
+    delete [] m_buffer;
+}
+
+void QAudioRingBuffer::resize(int bufferSize)
+{
+    if (bufferSize != m_bufferSize) {
+        delete [] m_buffer;
+        m_bufferSize = qMax(0, bufferSize);
+        m_buffer = m_bufferSize > 0 ? new char[m_bufferSize] : 0;
+    }
+
+    reset();
+}
+
+void QAudioRingBuffer::reset()
+{
+    m_readPos = 0;
+    m_writePos = 0;
+    m_bufferUsed.store(0);
+}
+
+QAudioRingBuffer::Region QAudioRingBuffer::acquireReadRegion(int size)
+{
+    const int used = m_bufferUsed.loadAcquire();
+
+    if (used > 0) {
+        const int readSize = qMin(size, qMin(m_bufferSize - m_readPos, used));
+
+        return readSize > 0 ? Region(m_buffer + m_readPos, readSize) : Region(0, 0);
+    }
+
+    return Region(0, 0);
+}
+
+void QAudioRingBuffer::releaseReadRegion(const Region &region)
+{
+    if (region.second <= 0)
+        return;
+
+    m_readPos = (m_readPos + region.second) % m_bufferSize;
+
+    m_bufferUsed.fetchAndAddRelease(-region.second);
+}
+
+QAudioRingBuffer::Region QAudioRingBuffer::acquireWriteRegion(int size)
+{
+    const int free = m_bufferSize - m_bufferUsed.loadAcquire();
+
+    if (free > 0) {
+        const int writeSize = qMin(size, qMin(m_bufferSize - m_writePos, free));
+
+        return writeSize > 0 ? Region(m_buffer + m_writePos, writeSize) : Region(0, 0);
+    }
+
+    return Region(0, 0);
+}
+
+void QAudioRingBuffer::releaseWriteRegion(const Region &region)
+{
+    if (region.second <= 0)
+        return;
+
+    m_writePos = (m_writePos + region.second) % m_bufferSize;
+
+    m_bufferUsed.fetchAndAddRelease(region.second);
+}
+
+int QAudioRingBuffer::read(char *data, int size)
+{
+    int copied = 0;
+
+    while (copied < size) {
+        const Region region = acquireReadRegion(size - copied);
+        if (region.second == 0)
+            break;
+
+        memcpy(data + copied, region.first, region.second);
+        releaseReadRegion(region);
+        copied += region.second;
+    }
+
+    return copied;
+}
+
+int QAudioRingBuffer::write(const char *data, int size)
+{
+    int copied = 0;
+
+    while (copied < size) {
+        const Region region = acquireWriteRegion(size - copied);
+        if (region.second == 0)
+            break;
+
+        memcpy(region.first, data + copied, region.second);
+        releaseWriteRegion(region);
+        copied += region.second;
+    }
+
+    return copied;
+}
+
+int QAudioRingBuffer::skip(int size)
+{
+    int skipped = 0;
+
+    while (skipped < size) {
+        const Region region = acquireReadRegion(size - skipped);
+        if (region.second == 0)
+            break;
+
+        releaseReadRegion(region);
+        skipped += region.second;
+    }
+
+    return skipped;
+}
+
+int QAudioRingBuffer::used() const
+{
+    return m_bufferUsed.loadAcquire();
+}
+
+int QAudioRingBuffer::free() const
+{
+    return m_bufferSize - m_bufferUsed.loadAcquire();
+}
+
+int QAudioRingBuffer::size() const
+{
+    return m_bufferSize;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QAUDIORINGBUFFER_P_H
+#define QAUDIORINGBUFFER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <qtmultimediadefs.h>
+
+#include <QtCore/qatomic.h>
+#include <QtCore/qpair.h>
+
+QT_BEGIN_NAMESPACE
+
+// Single producer, single consumer byte ring buffer. One thread may write
+// while another one reads without any locking; resize() and reset() must
+// not race with either side.
+class Q_MULTIMEDIA_EXPORT QAudioRingBuffer
+{
+public:
+    typedef QPair<char*, int> Region;
+
+    explicit QAudioRingBuffer(int bufferSize = 0);
+    ~QAudioRingBuffer();
+
+    void resize(int bufferSize);
+    void reset();
+
+    // Contiguous regions for zero-copy access, a region may be shorter
+    // than requested when it would wrap around the end of the buffer.
+    Region acquireReadRegion(int size);
+    void releaseReadRegion(const Region &region);
+    Region acquireWriteRegion(int size);
+    void releaseWriteRegion(const Region &region);
+
+    int read(char *data, int size);
+    int write(const char *data, int size);
+    int skip(int size);
+
+    int used() const;
+    int free() const;
+    int size() const;
+
+private:
+    Q_DISABLE_COPY(QAudioRingBuffer)
+
+    int m_bufferSize;
+    int m_readPos;
+    int m_writePos;
+    char *m_buffer;
+    QAtomicInt m_bufferUsed;
+};
+
+QT_END_NAMESPACE
+
+#endif
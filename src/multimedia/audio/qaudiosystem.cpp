@@ -122,6 +122,10 @@ QT_BEGIN_NAMESPACE
     is implemented, see the QAudioOutput class and function
     descriptions.
 
+    A backend that can tell how long it takes until audio written now is
+    heard provides a \c latencyUSecs property of type qint64, which
+    QAudioOutput::latencyUSecs() reads.
+
     \sa QAudioOutput
 */
 
@@ -262,6 +266,12 @@ QT_BEGIN_NAMESPACE
     audio functionality. For a description of the functionality, see
     the QAudioInput class description.
 
+    A backend that can tell how long captured audio takes to become
+    available provides a \c latencyUSecs property of type qint64, which
+    QAudioInput::latencyUSecs() reads. Capture statistics, such as an
+    \c overrunCount property, are exposed the same way and can be read
+    with QObject::property().
+
     \sa QAudioInput
 */
 
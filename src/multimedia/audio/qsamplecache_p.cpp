@@ -42,6 +42,9 @@
 #include "qsamplecache_p.h"
 #include "qwavedecoder_p.h"
 #include <QtNetwork>
+#include <QtCore/qendian.h>
+
+#include <limits>
 
 //#define QT_SAMPLECACHE_DEBUG
 
@@ -91,60 +94,122 @@ QT_BEGIN_NAMESPACE
            m_sample = 0;
        }
     \endcode
+
+    With a capacity set, released samples stay in the cache and are evicted
+    in least recently used order once the decoded data exceeds the capacity.
+    Samples are decoded on a small pool of loading threads, and prefetch()
+    can be used to start decoding samples before they are needed.
+
+    If a preferred format is set, decoded samples with the same sample rate
+    are converted to it, so they can be played without further conversion.
 */
 
 QSampleCache::QSampleCache(QObject *parent)
     : QObject(parent)
-    , m_networkAccessManager(0)
-    , m_mutex(QMutex::Recursive)
     , m_capacity(0)
     , m_usage(0)
-    , m_loadingRefCount(0)
+    , m_hits(0)
+    , m_misses(0)
+    , m_evictions(0)
+    , m_runningLoaders(0)
 {
-    m_loadingThread.setObjectName(QLatin1String("QSampleCache::LoadingThread"));
-    connect(&m_loadingThread, SIGNAL(finished()), this, SIGNAL(isLoadingChanged()));
-    connect(&m_loadingThread, SIGNAL(started()), this, SIGNAL(isLoadingChanged()));
+    const int loaderCount = qBound(1, QThread::idealThreadCount(), 4);
+    for (int i = 0; i < loaderCount; ++i) {
+        Loader *loader = new Loader;
+        loader->thread.setObjectName(QLatin1String("QSampleCache::LoadingThread"));
+        connect(&loader->thread, SIGNAL(started()), this, SLOT(loaderStarted()));
+        connect(&loader->thread, SIGNAL(finished()), this, SLOT(loaderFinished()));
+        m_loaders.append(loader);
+    }
 }
 
-QNetworkAccessManager& QSampleCache::networkAccessManager()
+// Called in loading thread, each loader has its own manager
+QNetworkAccessManager& QSampleCache::networkAccessManager(int loader)
 {
-    if (!m_networkAccessManager)
-        m_networkAccessManager = new QNetworkAccessManager();
-    return *m_networkAccessManager;
+    Loader *l = m_loaders.at(loader);
+    if (!l->networkAccessManager)
+        l->networkAccessManager = new QNetworkAccessManager();
+    return *l->networkAccessManager;
 }
 
 QSampleCache::~QSampleCache()
 {
-    QMutexLocker m(&m_mutex);
-
-    m_loadingThread.quit();
-    m_loadingThread.wait();
+    foreach (Loader *loader, m_loaders) {
+        loader->thread.quit();
+        loader->thread.wait();
+    }
 
-    // Killing the loading thread means that no samples can be
+    // Killing the loading threads means that no samples can be
     // deleted using deleteLater.  And some samples that had deleteLater
     // already called won't have been processed (m_staleSamples)
-    foreach (QSample* sample, m_samples)
+    QMutexLocker m(&m_mutex);
+    QList<QSample*> samples = m_samples.values() + m_staleSamples.toList();
+    m_samples.clear();
+    m_unusedSamples.clear();
+    m.unlock();
+
+    // deleting a sample removes it from m_staleSamples
+    foreach (QSample* sample, samples)
         delete sample;
 
-    foreach (QSample* sample, m_staleSamples)
-        delete sample; // deleting a sample does affect the m_staleSamples list, but foreach copies it
+    foreach (Loader *loader, m_loaders) {
+        delete loader->networkAccessManager;
+        delete loader;
+    }
+}
+
+void QSampleCache::loaderStarted()
+{
+    if (m_runningLoaders++ == 0)
+        emit isLoadingChanged();
+}
+
+void QSampleCache::loaderFinished()
+{
+    if (--m_runningLoaders == 0)
+        emit isLoadingChanged();
+}
 
-    m_networkAccessManager->deleteLater();
+// Picks the loading thread with the least outstanding work
+int QSampleCache::selectLoader() const
+{
+    QMutexLocker locker(&m_loadingMutex);
+    int selected = 0;
+    for (int i = 1; i < m_loaders.size(); ++i) {
+        if (m_loaders.at(i)->refCount < m_loaders.at(selected)->refCount)
+            selected = i;
+    }
+    return selected;
 }
 
-void QSampleCache::loadingRelease()
+void QSampleCache::loadingAcquire(int loader)
 {
+    //lock and add first to make sure live loadingThread will not be killed during this function call
     QMutexLocker locker(&m_loadingMutex);
-    m_loadingRefCount--;
-    if (m_loadingRefCount == 0) {
-        if (m_loadingThread.isRunning())
-            m_loadingThread.exit();
+    Loader *l = m_loaders.at(loader);
+    l->refCount++;
+    if (!l->thread.isRunning())
+        l->thread.start();
+}
+
+void QSampleCache::loadingRelease(int loader)
+{
+    QMutexLocker locker(&m_loadingMutex);
+    Loader *l = m_loaders.at(loader);
+    l->refCount--;
+    if (l->refCount == 0) {
+        if (l->thread.isRunning())
+            l->thread.exit();
     }
 }
 
 bool QSampleCache::isLoading() const
 {
-    return m_loadingThread.isRunning();
+    foreach (Loader *loader, m_loaders) {
+        if (loader->thread.isRunning())
+            return true;
+    }
+    return false;
 }
 
 bool QSampleCache::isCached(const QUrl &url) const
@@ -155,14 +220,6 @@ bool QSampleCache::isCached(const QUrl &url) const
 
 QSample* QSampleCache::requestSample(const QUrl& url)
 {
-    //lock and add first to make sure live loadingThread will not be killed during this function call
-    m_loadingMutex.lock();
-    m_loadingRefCount++;
-    m_loadingMutex.unlock();
-
-    if (!m_loadingThread.isRunning())
-        m_loadingThread.start();
-
 #ifdef QT_SAMPLECACHE_DEBUG
     qDebug() << "QSampleCache: request sample [" << url << "]";
 #endif
@@ -171,19 +228,39 @@ QSample* QSampleCache::requestSample(const QUrl& url)
     QSample* sample;
     if (it == m_samples.end()) {
         sample = new QSample(url, this);
+        sample->m_loader = selectLoader();
         m_samples.insert(url, sample);
-        sample->moveToThread(&m_loadingThread);
+        sample->moveToThread(&m_loaders.at(sample->m_loader)->thread);
+        m_misses++;
     } else {
         sample = *it;
+        if (sample->m_ref == 0)
+            m_unusedSamples.removeOne(sample);
+        m_hits++;
     }
 
     sample->addRef();
+    loadingAcquire(sample->m_loader);
     locker.unlock();
 
     sample->loadIfNecessary();
     return sample;
 }
 
+// Starts loading a sample without holding a reference to it. This only
+// has an effect when a capacity is set, since unreferenced samples are
+// otherwise not kept.
+void QSampleCache::prefetch(const QUrl &url)
+{
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_capacity <= 0 || m_samples.contains(url))
+            return;
+    }
+
+    requestSample(url)->release();
+}
+
 void QSampleCache::setCapacity(qint64 capacity)
 {
     QMutexLocker locker(&m_mutex);
@@ -193,33 +270,88 @@ void QSampleCache::setCapacity(qint64 capacity)
     qDebug() << "QSampleCache: capacity changes from " << m_capacity << "to " << capacity;
 #endif
     if (m_capacity > 0 && capacity <= 0) { //memory management strategy changed
-        for (QMap<QUrl, QSample*>::iterator it = m_samples.begin(); it != m_samples.end();) {
-            QSample* sample = *it;
-            if (sample->m_ref == 0) {
-                unloadSample(sample);
-                it = m_samples.erase(it);
-            } else
-                it++;
+        foreach (QSample* sample, m_unusedSamples) {
+            m_samples.remove(sample->m_url);
+            unloadSample(sample);
         }
+        m_unusedSamples.clear();
     }
 
     m_capacity = capacity;
-    refresh(0);
+    evict();
+}
+
+qint64 QSampleCache::capacity() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_capacity;
+}
+
+void QSampleCache::setPreferredFormat(const QAudioFormat &format)
+{
+    QMutexLocker locker(&m_mutex);
+    m_preferredFormat = format;
+}
+
+QAudioFormat QSampleCache::preferredFormat() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_preferredFormat;
+}
+
+qint64 QSampleCache::usage() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_usage;
+}
+
+int QSampleCache::sampleCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_samples.size();
+}
+
+int QSampleCache::hitCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_hits;
+}
+
+int QSampleCache::missCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_misses;
+}
+
+int QSampleCache::evictionCount() const
+{
+    QMutexLocker locker(&m_mutex);
+    return m_evictions;
 }
 
 // Called locked
 void QSampleCache::unloadSample(QSample *sample)
 {
-    m_usage -= sample->m_soundData.size();
+    m_usage -= sample->m_usage;
+    sample->m_usage = 0;
     m_staleSamples.insert(sample);
     sample->deleteLater();
 }
 
 // Called in both threads
-void QSampleCache::refresh(qint64 usageChange)
+void QSampleCache::refresh(QSample *sample, qint64 usageChange)
 {
     QMutexLocker locker(&m_mutex);
+    if (m_samples.value(sample->m_url) != sample)
+        return; // already unloaded
+    sample->m_usage += usageChange;
     m_usage += usageChange;
+    evict();
+}
+
+// Called locked
+void QSampleCache::evict()
+{
     if (m_capacity <= 0 || m_usage <= m_capacity)
         return;
 
@@ -227,25 +359,19 @@ void QSampleCache::refresh(qint64 usageChange)
     qint64 recoveredSize = 0;
 #endif
 
-    //free unused samples to keep usage under capacity limit.
-    for (QMap<QUrl, QSample*>::iterator it = m_samples.begin(); it != m_samples.end();) {
-        QSample* sample = *it;
-        if (sample->m_ref > 0) {
-            ++it;
-            continue;
-        }
+    //free least recently used samples to keep usage under capacity limit.
+    while (!m_unusedSamples.isEmpty() && m_usage > m_capacity) {
+        QSample* sample = m_unusedSamples.takeFirst();
 #ifdef QT_SAMPLECACHE_DEBUG
-        recoveredSize += sample->m_soundData.size();
+        recoveredSize += sample->m_usage;
 #endif
+        m_samples.remove(sample->m_url);
         unloadSample(sample);
-        it = m_samples.erase(it);
-        if (m_usage <= m_capacity)
-            return;
+        m_evictions++;
     }
 
 #ifdef QT_SAMPLECACHE_DEBUG
-    qDebug() << "QSampleCache: refresh(" << usageChange
-             << ") recovered size =" << recoveredSize
+    qDebug() << "QSampleCache: evict() recovered size =" << recoveredSize
              << "new usage =" << m_usage;
 #endif
 
@@ -272,6 +398,10 @@ QSample::~QSample()
     qDebug() << "~QSample" << this << ": deleted [" << m_url << "]" << QThread::currentThread();
 #endif
     cleanup();
+
+    // Drop the raw data before the mapping it points into goes away
+    m_soundData.clear();
+    delete m_mappedFile;
 }
 
 // Called in application thread
@@ -282,7 +412,7 @@ void QSample::loadIfNecessary()
         m_state = QSample::Loading;
         QMetaObject::invokeMethod(this, "load", Qt::QueuedConnection);
     } else {
-        qobject_cast<QSampleCache*>(m_parent)->loadingRelease();
+        m_parent->loadingRelease(m_loader);
     }
 }
 
@@ -290,13 +420,14 @@ void QSample::loadIfNecessary()
 bool QSampleCache::notifyUnreferencedSample(QSample* sample)
 {
     QMutexLocker locker(&m_mutex);
-    if (m_capacity > 0)
+    if (m_capacity > 0) {
+        m_unusedSamples.append(sample);
         return false;
+    }
     m_samples.remove(sample->m_url);
     unloadSample(sample);
     return true;
 }
-
 // Called in application threadd
 void QSample::release()
 {
@@ -355,7 +486,21 @@ void QSample::decoderReady()
 #ifdef QT_SAMPLECACHE_DEBUG
     qDebug() << "QSample: decoder ready";
 #endif
-    m_parent->refresh(m_waveDecoder->size());
+    m_parent->refresh(this, m_waveDecoder->size());
+
+    // Local files are referenced in place instead of being copied to the heap
+    if (m_waveDecoder->size() <= std::numeric_limits<int>::max()) {
+        if (const uchar *mapped = m_waveDecoder->mapData()) {
+            m_soundData = QByteArray::fromRawData(reinterpret_cast<const char *>(mapped),
+                                                  int(m_waveDecoder->size()));
+            m_sampleReadLength = m_soundData.size();
+            // The mapping lives as long as the file, so keep it out of cleanup()
+            m_mappedFile = m_stream;
+            m_stream = 0;
+            onReady();
+            return;
+        }
+    }
 
     m_soundData.resize(m_waveDecoder->size());
     m_sampleReadLength = 0;
@@ -381,8 +526,24 @@ void QSample::load()
 #ifdef QT_SAMPLECACHE_DEBUG
     qDebug() << "QSample: load [" << m_url << "]";
 #endif
-    m_stream = m_parent->networkAccessManager().get(QNetworkRequest(m_url));
-    connect(m_stream, SIGNAL(error(QNetworkReply::NetworkError)), SLOT(decoderError()));
+    QString localFile;
+    if (m_url.isLocalFile())
+        localFile = m_url.toLocalFile();
+    else if (m_url.scheme() == QLatin1String("qrc"))
+        localFile = QLatin1Char(':') + m_url.path();
+
+    if (!localFile.isEmpty()) {
+        QFile *file = new QFile(localFile);
+        if (!file->open(QIODevice::ReadOnly)) {
+            delete file;
+            decoderError();
+            return;
+        }
+        m_stream = file;
+    } else {
+        m_stream = m_parent->networkAccessManager(m_loader).get(QNetworkRequest(m_url));
+        connect(m_stream, SIGNAL(error(QNetworkReply::NetworkError)), SLOT(decoderError()));
+    }
     m_waveDecoder = new QWaveDecoder(m_stream);
     connect(m_waveDecoder, SIGNAL(formatKnown()), SLOT(decoderReady()));
     connect(m_waveDecoder, SIGNAL(parsingError()), SLOT(decoderError()));
@@ -399,7 +560,7 @@ void QSample::decoderError()
 #endif
     cleanup();
     m_state = QSample::Error;
-    qobject_cast<QSampleCache*>(m_parent)->loadingRelease();
+    m_parent->loadingRelease(m_loader);
     emit error();
 }
 
@@ -412,20 +573,155 @@ void QSample::onReady()
 #endif
     m_audioFormat = m_waveDecoder->audioFormat();
     cleanup();
+    convertToPreferredFormat();
     m_state = QSample::Ready;
-    qobject_cast<QSampleCache*>(m_parent)->loadingRelease();
+    m_parent->loadingRelease(m_loader);
     emit ready();
 }
 
+static bool qt_isConvertibleSampleFormat(const QAudioFormat &format)
+{
+    if (!format.isValid() || format.codec() != QLatin1String("audio/pcm"))
+        return false;
+
+    switch (format.sampleType()) {
+    case QAudioFormat::SignedInt:
+    case QAudioFormat::UnSignedInt:
+        return format.sampleSize() == 8 || format.sampleSize() == 16 || format.sampleSize() == 32;
+    case QAudioFormat::Float:
+        return format.sampleSize() == 32;
+    default:
+        return false;
+    }
+}
+
+// Reads one sample, normalized to [-1, 1]
+static float qt_readSample(const uchar *src, const QAudioFormat &format)
+{
+    const bool little = format.byteOrder() == QAudioFormat::LittleEndian;
+    const bool isUnsigned = format.sampleType() == QAudioFormat::UnSignedInt;
+
+    switch (format.sampleSize()) {
+    case 8:
+        return isUnsigned ? (int(*src) - 0x80) / 128.0f : qint8(*src) / 128.0f;
+    case 16: {
+        const quint16 v = little ? qFromLittleEndian<quint16>(src) : qFromBigEndian<quint16>(src);
+        return isUnsigned ? (int(v) - 0x8000) / 32768.0f : qint16(v) / 32768.0f;
+    }
+    default: {
+        const quint32 v = little ? qFromLittleEndian<quint32>(src) : qFromBigEndian<quint32>(src);
+        if (format.sampleType() == QAudioFormat::Float) {
+            float f;
+            memcpy(&f, &v, sizeof(f));
+            return f;
+        }
+        return isUnsigned ? float((qint64(v) - Q_INT64_C(0x80000000)) / 2147483648.0)
+                          : float(qint32(v) / 2147483648.0);
+    }
+    }
+}
+
+static void qt_writeSample(uchar *dst, const QAudioFormat &format, float value)
+{
+    const bool little = format.byteOrder() == QAudioFormat::LittleEndian;
+    const bool isUnsigned = format.sampleType() == QAudioFormat::UnSignedInt;
+    value = qBound(-1.0f, value, 1.0f);
+
+    switch (format.sampleSize()) {
+    case 8: {
+        const int v = qBound(-128, qRound(value * 128.0f), 127);
+        *dst = isUnsigned ? uchar(v + 0x80) : uchar(qint8(v));
+        break;
+    }
+    case 16: {
+        const int v = qBound(-32768, qRound(value * 32768.0f), 32767);
+        const quint16 out = isUnsigned ? quint16(v + 0x8000) : quint16(qint16(v));
+        if (little)
+            qToLittleEndian<quint16>(out, dst);
+        else
+            qToBigEndian<quint16>(out, dst);
+        break;
+    }
+    default: {
+        quint32 out;
+        if (format.sampleType() == QAudioFormat::Float) {
+            memcpy(&out, &value, sizeof(out));
+        } else {
+            const qint64 v = qBound(Q_INT64_C(-2147483648), qRound64(value * 2147483648.0), Q_INT64_C(2147483647));
+            out = isUnsigned ? quint32(v + Q_INT64_C(0x80000000)) : quint32(qint32(v));
+        }
+        if (little)
+            qToLittleEndian<quint32>(out, dst);
+        else
+            qToBigEndian<quint32>(out, dst);
+        break;
+    }
+    }
+}
+
+// Called in loading thread, locked.
+// Converts sample type, size, byte order and channel count; samples with a
+// different sample rate are kept as decoded.
+void QSample::convertToPreferredFormat()
+{
+    const QAudioFormat target = m_parent->preferredFormat();
+    if (target == m_audioFormat || target.sampleRate() != m_audioFormat.sampleRate()
+            || !qt_isConvertibleSampleFormat(target) || !qt_isConvertibleSampleFormat(m_audioFormat)) {
+        return;
+    }
+
+    const int sourceChannels = m_audioFormat.channelCount();
+    const int targetChannels = target.channelCount();
+    const int sourceSampleBytes = m_audioFormat.sampleSize() / 8;
+    const int targetSampleBytes = target.sampleSize() / 8;
+    const int frames = m_soundData.size() / m_audioFormat.bytesPerFrame();
+
+    QByteArray converted(frames * target.bytesPerFrame(), Qt::Uninitialized);
+    const uchar *src = reinterpret_cast<const uchar *>(m_soundData.constData());
+    uchar *dst = reinterpret_cast<uchar *>(converted.data());
+
+    for (int frame = 0; frame < frames; ++frame) {
+        for (int channel = 0; channel < targetChannels; ++channel) {
+            float value = 0;
+            if (targetChannels == 1 && sourceChannels > 1) {
+                // Downmix to mono
+                for (int i = 0; i < sourceChannels; ++i)
+                    value += qt_readSample(src + i * sourceSampleBytes, m_audioFormat);
+                value /= sourceChannels;
+            } else if (sourceChannels == 1) {
+                value = qt_readSample(src, m_audioFormat);
+            } else if (channel < sourceChannels) {
+                value = qt_readSample(src + channel * sourceSampleBytes, m_audioFormat);
+            }
+            qt_writeSample(dst + channel * targetSampleBytes, target, value);
+        }
+        src += m_audioFormat.bytesPerFrame();
+        dst += target.bytesPerFrame();
+    }
+
+    m_parent->refresh(this, converted.size() - m_soundData.size());
+    m_soundData = converted;
+    m_audioFormat = target;
+
+    // The converted copy no longer needs the mapped pages
+    if (m_mappedFile) {
+        m_mappedFile->deleteLater();
+        m_mappedFile = 0;
+    }
+}
+
 // Called in application thread, then moved to loader thread
 QSample::QSample(const QUrl& url, QSampleCache *parent)
     : m_parent(parent)
     , m_stream(0)
     , m_waveDecoder(0)
+    , m_mappedFile(0)
     , m_url(url)
     , m_sampleReadLength(0)
     , m_state(Creating)
     , m_ref(0)
+    , m_loader(0)
+    , m_usage(0)
 {
 }
 
@@ -59,6 +59,8 @@
 #include <QtCore/qmutex.h>
 #include <QtCore/qmap.h>
 #include <QtCore/qset.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qvector.h>
 #include <qaudioformat.h>
 
 
@@ -85,7 +87,9 @@ public:
 
     State state() const;
     // These are not (currently) locked because they are only meant to be called after these
-    // variables are updated to their final states
+    // variables are updated to their final states.
+    // For local files data() may reference the mapped file rather than a heap copy; it
+    // stays valid for as long as the sample is referenced.
     const QByteArray& data() const { Q_ASSERT(state() == Ready); return m_soundData; }
     const QAudioFormat& format() const { Q_ASSERT(state() == Ready); return m_audioFormat; }
     void release();
@@ -105,6 +109,7 @@ private Q_SLOTS:
 
 private:
     void onReady();
+    void convertToPreferredFormat();
     void cleanup();
     void addRef();
     void loadIfNecessary();
@@ -117,10 +122,13 @@ private:
     QAudioFormat m_audioFormat;
     QIODevice    *m_stream;
     QWaveDecoder *m_waveDecoder;
+    QIODevice    *m_mappedFile;
     QUrl         m_url;
     qint64       m_sampleReadLength;
     State        m_state;
     int          m_ref;
+    int          m_loader;
+    qint64       m_usage;    // bytes accounted to the cache, guarded by the cache
 };
 
 class Q_MULTIMEDIA_EXPORT QSampleCache : public QObject
@@ -133,32 +141,64 @@ public:
     ~QSampleCache();
 
     QSample* requestSample(const QUrl& url);
+    void prefetch(const QUrl& url);
     void setCapacity(qint64 capacity);
+    qint64 capacity() const;
+
+    void setPreferredFormat(const QAudioFormat &format);
+    QAudioFormat preferredFormat() const;
 
     bool isLoading() const;
     bool isCached(const QUrl& url) const;
 
+    qint64 usage() const;
+    int sampleCount() const;
+    int hitCount() const;
+    int missCount() const;
+    int evictionCount() const;
+
 Q_SIGNALS:
     void isLoadingChanged();
 
+private Q_SLOTS:
+    void loaderStarted();
+    void loaderFinished();
+
 private:
+    struct Loader
+    {
+        Loader() : networkAccessManager(0), refCount(0) {}
+
+        QThread thread;
+        QNetworkAccessManager *networkAccessManager;
+        int refCount;
+    };
+
     QMap<QUrl, QSample*> m_samples;
     QSet<QSample*> m_staleSamples;
-    QNetworkAccessManager *m_networkAccessManager;
+    // Unreferenced samples kept by the cache, least recently used first
+    QList<QSample*> m_unusedSamples;
+    QVector<Loader*> m_loaders;
     mutable QMutex m_mutex;
     qint64 m_capacity;
     qint64 m_usage;
-    QThread m_loadingThread;
-
-    QNetworkAccessManager& networkAccessManager();
-    void refresh(qint64 usageChange);
+    QAudioFormat m_preferredFormat;
+    int m_hits;
+    int m_misses;
+    int m_evictions;
+    int m_runningLoaders;
+
+    QNetworkAccessManager& networkAccessManager(int loader);
+    int selectLoader() const;
+    void refresh(QSample *sample, qint64 usageChange);
+    void evict();
     bool notifyUnreferencedSample(QSample* sample);
     void removeUnreferencedSample(QSample* sample);
     void unloadSample(QSample* sample);
 
-    void loadingRelease();
-    int m_loadingRefCount;
-    QMutex m_loadingMutex;
+    void loadingAcquire(int loader);
+    void loadingRelease(int loader);
+    mutable QMutex m_loadingMutex;
 };
 
 QT_END_NAMESPACE
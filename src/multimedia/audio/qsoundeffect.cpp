@@ -148,6 +148,21 @@ QStringList QSoundEffect::supportedMimeTypes()
     return QSoundEffectPrivate::supportedMimeTypes();
 }
 
+/*!
+    \since 5.3
+
+    Loads the sounds at \a sources in the background and keeps them loaded,
+    so that sound effects using one of them are ready sooner and start
+    playing with less latency the first time they are played.
+
+    This is typically called once at startup with the sounds an
+    application plays most often.
+*/
+void QSoundEffect::preload(const QList<QUrl> &sources)
+{
+    QSoundEffectPrivate::preload(sources);
+}
+
 /*!
     \qmlproperty url QtMultimedia::SoundEffect::source
 
@@ -67,6 +67,8 @@
 #ifndef QTM_PULSEAUDIO_DEFAULTBUFFER
 #define QT_PA_STREAM_BUFFER_SIZE_MAX (1024 * 64)  //64KB is a trade-off for balancing control latency and uploading overhead
 #endif
+#define QT_PA_SAMPLE_UPLOAD_SIZE_MAX (1024 * 256) // larger samples are only played through streams
+#define QT_PA_STREAM_POOL_SIZE 4 // idle streams kept per sample spec and category
 
 QT_BEGIN_NAMESPACE
 
@@ -78,6 +80,7 @@ inline pa_sample_spec audioFormatToSampleSpec(const QAudioFormat &format)
 
     spec.rate = format.sampleRate();
     spec.channels = format.channelCount();
+    spec.format = PA_SAMPLE_INVALID;
 
     if (format.sampleSize() == 8)
         spec.format = PA_SAMPLE_U8;
@@ -87,6 +90,12 @@ inline pa_sample_spec audioFormatToSampleSpec(const QAudioFormat &format)
             case QAudioFormat::LittleEndian: spec.format = PA_SAMPLE_S16LE; break;
         }
     }
+    else if (format.sampleSize() == 32 && format.sampleType() == QAudioFormat::Float) {
+        switch (format.byteOrder()) {
+            case QAudioFormat::BigEndian: spec.format = PA_SAMPLE_FLOAT32BE; break;
+            case QAudioFormat::LittleEndian: spec.format = PA_SAMPLE_FLOAT32LE; break;
+        }
+    }
     else if (format.sampleSize() == 32) {
         switch (format.byteOrder()) {
             case QAudioFormat::BigEndian: spec.format = PA_SAMPLE_S32BE; break;
@@ -129,9 +138,14 @@ public:
         return m_context;
     }
 
+    inline pa_volume_t calcVolume(int soundEffectVolume) const
+    {
+        return m_vol * soundEffectVolume / 100;
+    }
+
     inline pa_cvolume * calcVolume(pa_cvolume *dest, int soundEffectVolume)
     {
-        pa_volume_t v = m_vol * soundEffectVolume / 100;
+        pa_volume_t v = calcVolume(soundEffectVolume);
         for (int i = 0; i < dest->channels; ++i)
             dest->values[i] = v;
         return dest;
@@ -311,6 +325,433 @@ public:
 };
 }
 
+// Keeps connected, corked streams for reuse, so that an effect doesn't have
+// to create and connect a stream before it can play, and uploads short
+// samples to the server's sample cache. Everything but the slots must be
+// called with the daemon locked.
+class QSoundEffectStreamPool : public QObject
+{
+    Q_OBJECT
+public:
+    QSoundEffectStreamPool();
+    ~QSoundEffectStreamPool();
+
+    pa_stream *takeStream(const pa_sample_spec &spec, const QString &category);
+    bool recycleStream(pa_stream *stream, const pa_sample_spec &spec, const QString &category);
+    void prewarmStream(const pa_sample_spec &spec, const QString &category);
+
+    void acquireUpload(const QUrl &url, const pa_sample_spec &spec);
+    void releaseUpload(const QUrl &url);
+    QByteArray uploadedSampleName(const QUrl &url) const;
+
+    void preload(const QList<QUrl> &urls);
+
+private Q_SLOTS:
+    void preloadSampleReady();
+    void purgeStreams();
+    void contextReady();
+    void contextFailed();
+
+private:
+    struct PooledStream
+    {
+        pa_stream *stream;
+        pa_sample_spec spec;
+        QString category;
+    };
+
+    struct Upload
+    {
+        QSample *sample;
+        QByteArray name;
+        pa_sample_spec spec;
+        pa_stream *stream;
+        int position;
+        int refs;
+        bool ready;
+    };
+
+    void startUpload(Upload *upload);
+    void preloadSample(const QUrl &url, QSample *sample);
+
+    static void pool_stream_state_callback(pa_stream *s, void *userdata);
+    static void upload_state_callback(pa_stream *s, void *userdata);
+    static void upload_write_callback(pa_stream *s, size_t length, void *userdata);
+
+    QList<PooledStream> m_streams;
+    QList<PooledStream> m_prewarm;
+    QHash<QUrl, Upload *> m_uploads;
+    QHash<QUrl, QSample *> m_preloaded;
+    int m_uploadCount;
+};
+
+Q_GLOBAL_STATIC(QSoundEffectStreamPool, streamPool)
+
+QSoundEffectStreamPool::QSoundEffectStreamPool()
+    : m_uploadCount(0)
+{
+    // Make sure the daemon outlives the pool
+    connect(pulseDaemon(), SIGNAL(contextReady()), SLOT(contextReady()));
+    connect(pulseDaemon(), SIGNAL(contextFailed()), SLOT(contextFailed()));
+}
+
+QSoundEffectStreamPool::~QSoundEffectStreamPool()
+{
+    PulseDaemonLocker locker;
+    foreach (const PooledStream &pooled, m_streams) {
+        pa_stream_set_state_callback(pooled.stream, 0, 0);
+        pa_stream_disconnect(pooled.stream);
+        pa_stream_unref(pooled.stream);
+    }
+    foreach (Upload *upload, m_uploads) {
+        if (upload->stream) {
+            pa_stream_set_state_callback(upload->stream, 0, 0);
+            pa_stream_set_write_callback(upload->stream, 0, 0);
+            pa_stream_unref(upload->stream);
+        }
+        delete upload;
+    }
+}
+
+pa_stream *QSoundEffectStreamPool::takeStream(const pa_sample_spec &spec, const QString &category)
+{
+    for (int i = 0; i < m_streams.size(); ++i) {
+        const PooledStream &pooled = m_streams.at(i);
+        if (pooled.category != category || !pa_sample_spec_equal(&pooled.spec, &spec)
+                || pa_stream_get_state(pooled.stream) != PA_STREAM_READY) {
+            continue;
+        }
+        pa_stream *stream = pooled.stream;
+        pa_stream_set_state_callback(stream, 0, 0);
+        m_streams.removeAt(i);
+        return stream;
+    }
+    return 0;
+}
+
+bool QSoundEffectStreamPool::recycleStream(pa_stream *stream, const pa_sample_spec &spec, const QString &category)
+{
+    if (pa_stream_get_state(stream) != PA_STREAM_READY)
+        return false;
+
+    int idle = 0;
+    foreach (const PooledStream &pooled, m_streams) {
+        if (pooled.category == category && pa_sample_spec_equal(&pooled.spec, &spec))
+            ++idle;
+    }
+    if (idle >= QT_PA_STREAM_POOL_SIZE)
+        return false;
+
+    pa_stream_set_write_callback(stream, 0, 0);
+    pa_stream_set_underflow_callback(stream, 0, 0);
+    pa_stream_set_state_callback(stream, pool_stream_state_callback, this);
+    pa_operation_unref(pa_stream_flush(stream, 0, 0));
+    pa_operation_unref(pa_stream_cork(stream, 1, 0, 0));
+
+    PooledStream pooled;
+    pooled.stream = stream;
+    pooled.spec = spec;
+    pooled.category = category;
+    m_streams.append(pooled);
+    return true;
+}
+
+void QSoundEffectStreamPool::prewarmStream(const pa_sample_spec &spec, const QString &category)
+{
+    if (!pa_sample_spec_valid(&spec))
+        return;
+
+    foreach (const PooledStream &pooled, m_streams) {
+        if (pooled.category == category && pa_sample_spec_equal(&pooled.spec, &spec))
+            return;
+    }
+
+    pa_context *context = pulseDaemon()->context();
+    if (!context || pa_context_get_state(context) != PA_CONTEXT_READY) {
+        // Created once the context is ready
+        PooledStream pending;
+        pending.stream = 0;
+        pending.spec = spec;
+        pending.category = category;
+        m_prewarm.append(pending);
+        return;
+    }
+
+    pa_proplist *propList = pa_proplist_new();
+    if (!category.isNull())
+        pa_proplist_sets(propList, PA_PROP_MEDIA_ROLE, category.toLatin1().constData());
+    const QByteArray name = QString(QLatin1String("QtPulseSample-%1-pool")).arg(::getpid()).toUtf8();
+    pa_stream *stream = pa_stream_new_with_proplist(context, name.constData(), &spec, 0, propList);
+    pa_proplist_free(propList);
+    if (!stream) {
+        qWarning("QSoundEffect(pulseaudio): Failed to create pooled stream");
+        return;
+    }
+
+    pa_stream_set_state_callback(stream, pool_stream_state_callback, this);
+
+    // Effects grow the buffer to fit their sample when they take the stream
+    pa_buffer_attr bufferAttr;
+    bufferAttr.tlength = QT_PA_STREAM_BUFFER_SIZE_MAX / 16;
+    bufferAttr.maxlength = -1;
+    bufferAttr.minreq = bufferAttr.tlength / 2;
+    bufferAttr.prebuf = -1;
+    bufferAttr.fragsize = -1;
+    if (pa_stream_connect_playback(stream, 0, &bufferAttr,
+                                   pa_stream_flags_t(PA_STREAM_START_UNMUTED | PA_STREAM_START_CORKED),
+                                   0, 0) < 0) {
+        qWarning("QSoundEffect(pulseaudio): Failed to connect pooled stream, error = %s",
+                 pa_strerror(pa_context_errno(context)));
+        pa_stream_unref(stream);
+        return;
+    }
+
+    PooledStream pooled;
+    pooled.stream = stream;
+    pooled.spec = spec;
+    pooled.category = category;
+    m_streams.append(pooled);
+}
+
+void QSoundEffectStreamPool::acquireUpload(const QUrl &url, const pa_sample_spec &spec)
+{
+    if (Upload *upload = m_uploads.value(url)) {
+        upload->refs++;
+        return;
+    }
+
+    // Holds the sample, the data is read while uploading
+    QSample *sample = sampleCache()->requestSample(url);
+    if (sample->state() != QSample::Ready) {
+        sample->release();
+        return;
+    }
+
+    Upload *upload = new Upload;
+    upload->sample = sample;
+    upload->name = QString(QLatin1String("QtPulseUpload-%1-%2")).arg(::getpid()).arg(++m_uploadCount).toUtf8();
+    upload->spec = spec;
+    upload->stream = 0;
+    upload->position = 0;
+    upload->refs = 1;
+    upload->ready = false;
+    m_uploads.insert(url, upload);
+
+    startUpload(upload);
+}
+
+void QSoundEffectStreamPool::releaseUpload(const QUrl &url)
+{
+    Upload *upload = m_uploads.value(url);
+    if (!upload || --upload->refs > 0)
+        return;
+
+    m_uploads.remove(url);
+    if (upload->stream) {
+        pa_stream_set_state_callback(upload->stream, 0, 0);
+        pa_stream_set_write_callback(upload->stream, 0, 0);
+        if (pa_stream_get_state(upload->stream) == PA_STREAM_READY)
+            pa_stream_disconnect(upload->stream);
+        pa_stream_unref(upload->stream);
+    }
+    pa_context *context = pulseDaemon()->context();
+    if (upload->ready && context)
+        pa_operation_unref(pa_context_remove_sample(context, upload->name.constData(), 0, 0));
+    upload->sample->release();
+    delete upload;
+}
+
+QByteArray QSoundEffectStreamPool::uploadedSampleName(const QUrl &url) const
+{
+    const Upload *upload = m_uploads.value(url);
+    return upload && upload->ready ? upload->name : QByteArray();
+}
+
+void QSoundEffectStreamPool::startUpload(Upload *upload)
+{
+    pa_context *context = pulseDaemon()->context();
+    if (!context || pa_context_get_state(context) != PA_CONTEXT_READY)
+        return; // started again once the context is ready
+
+    upload->position = 0;
+    upload->stream = pa_stream_new(context, upload->name.constData(), &upload->spec, 0);
+    if (!upload->stream) {
+        qWarning("QSoundEffect(pulseaudio): Failed to create upload stream");
+        return;
+    }
+
+    pa_stream_set_state_callback(upload->stream, upload_state_callback, upload);
+    pa_stream_set_write_callback(upload->stream, upload_write_callback, upload);
+    if (pa_stream_connect_upload(upload->stream, upload->sample->data().size()) < 0) {
+        qWarning("QSoundEffect(pulseaudio): Failed to upload sample, error = %s",
+                 pa_strerror(pa_context_errno(context)));
+        pa_stream_set_state_callback(upload->stream, 0, 0);
+        pa_stream_set_write_callback(upload->stream, 0, 0);
+        pa_stream_unref(upload->stream);
+        upload->stream = 0;
+    }
+}
+
+void QSoundEffectStreamPool::upload_write_callback(pa_stream *s, size_t length, void *userdata)
+{
+    Upload *upload = reinterpret_cast<Upload *>(userdata);
+    const QByteArray &data = upload->sample->data();
+    const int count = qMin(int(length), data.size() - upload->position);
+    if (count > 0) {
+        if (pa_stream_write(s, data.constData() + upload->position, count, 0, 0, PA_SEEK_RELATIVE) != 0) {
+            qWarning("QSoundEffect(pulseaudio): pa_stream_write, error = %s",
+                     pa_strerror(pa_context_errno(pa_stream_get_context(s))));
+            return;
+        }
+        upload->position += count;
+    }
+
+    if (upload->position == data.size()) {
+        pa_stream_set_write_callback(s, 0, 0);
+        pa_stream_finish_upload(s);
+    }
+}
+
+void QSoundEffectStreamPool::upload_state_callback(pa_stream *s, void *userdata)
+{
+    Upload *upload = reinterpret_cast<Upload *>(userdata);
+    switch (pa_stream_get_state(s)) {
+    case PA_STREAM_TERMINATED:
+        // The upload stream terminates once the sample is in the cache
+        upload->ready = upload->position == upload->sample->data().size();
+        QMetaObject::invokeMethod(streamPool(), "purgeStreams", Qt::QueuedConnection);
+        break;
+    case PA_STREAM_FAILED:
+        qWarning("QSoundEffect(pulseaudio): Failed to upload sample");
+        QMetaObject::invokeMethod(streamPool(), "purgeStreams", Qt::QueuedConnection);
+        break;
+    default:
+        break;
+    }
+}
+
+void QSoundEffectStreamPool::pool_stream_state_callback(pa_stream *s, void *userdata)
+{
+    QSoundEffectStreamPool *self = reinterpret_cast<QSoundEffectStreamPool *>(userdata);
+    switch (pa_stream_get_state(s)) {
+    case PA_STREAM_FAILED:
+    case PA_STREAM_TERMINATED:
+        QMetaObject::invokeMethod(self, "purgeStreams", Qt::QueuedConnection);
+        break;
+    default:
+        break;
+    }
+}
+
+// Drops pooled streams that failed and upload streams that are done
+void QSoundEffectStreamPool::purgeStreams()
+{
+    PulseDaemonLocker locker;
+    for (int i = m_streams.size() - 1; i >= 0; --i) {
+        pa_stream *stream = m_streams.at(i).stream;
+        const pa_stream_state_t state = pa_stream_get_state(stream);
+        if (state == PA_STREAM_FAILED || state == PA_STREAM_TERMINATED) {
+            pa_stream_set_state_callback(stream, 0, 0);
+            pa_stream_unref(stream);
+            m_streams.removeAt(i);
+        }
+    }
+
+    foreach (Upload *upload, m_uploads) {
+        if (!upload->stream)
+            continue;
+        const pa_stream_state_t state = pa_stream_get_state(upload->stream);
+        if (state == PA_STREAM_FAILED || state == PA_STREAM_TERMINATED) {
+            pa_stream_set_state_callback(upload->stream, 0, 0);
+            pa_stream_set_write_callback(upload->stream, 0, 0);
+            pa_stream_unref(upload->stream);
+            upload->stream = 0;
+        }
+    }
+}
+
+void QSoundEffectStreamPool::contextReady()
+{
+    PulseDaemonLocker locker;
+    const QList<PooledStream> prewarm = m_prewarm;
+    m_prewarm.clear();
+    foreach (const PooledStream &pending, prewarm)
+        prewarmStream(pending.spec, pending.category);
+
+    foreach (Upload *upload, m_uploads) {
+        if (!upload->ready && !upload->stream)
+            startUpload(upload);
+    }
+}
+
+// The server forgot about our streams and uploads, they are created
+// again when the context is back
+void QSoundEffectStreamPool::contextFailed()
+{
+    PulseDaemonLocker locker;
+    foreach (const PooledStream &pooled, m_streams) {
+        pa_stream_set_state_callback(pooled.stream, 0, 0);
+        pa_stream_unref(pooled.stream);
+        m_prewarm.append(pooled);
+    }
+    m_streams.clear();
+
+    foreach (Upload *upload, m_uploads) {
+        if (upload->stream) {
+            pa_stream_set_state_callback(upload->stream, 0, 0);
+            pa_stream_set_write_callback(upload->stream, 0, 0);
+            pa_stream_unref(upload->stream);
+            upload->stream = 0;
+        }
+        upload->ready = false;
+    }
+}
+
+// Preloaded samples stay referenced for the lifetime of the process
+void QSoundEffectStreamPool::preload(const QList<QUrl> &urls)
+{
+    foreach (const QUrl &url, urls) {
+        if (!url.isValid() || url.isEmpty())
+            continue;
+        if (m_preloaded.contains(url))
+            continue;
+        QSample *sample = sampleCache()->requestSample(url);
+        m_preloaded.insert(url, sample);
+
+        switch (sample->state()) {
+        case QSample::Ready:
+            preloadSample(url, sample);
+            break;
+        case QSample::Error:
+            break;
+        default:
+            connect(sample, SIGNAL(ready()), this, SLOT(preloadSampleReady()));
+            break;
+        }
+    }
+}
+
+void QSoundEffectStreamPool::preloadSampleReady()
+{
+    QSample *sample = qobject_cast<QSample *>(sender());
+    if (!sample)
+        return;
+    disconnect(sample, SIGNAL(ready()), this, SLOT(preloadSampleReady()));
+    preloadSample(m_preloaded.key(sample), sample);
+}
+
+void QSoundEffectStreamPool::preloadSample(const QUrl &url, QSample *sample)
+{
+    const pa_sample_spec spec = audioFormatToSampleSpec(sample->format());
+    if (!pa_sample_spec_valid(&spec))
+        return;
+
+    PulseDaemonLocker locker;
+    prewarmStream(spec, QString());
+    if (sample->data().size() <= QT_PA_SAMPLE_UPLOAD_SIZE_MAX)
+        acquireUpload(url, spec);
+}
+
 class QSoundEffectRef
 {
 public:
@@ -387,11 +828,16 @@ QSoundEffectPrivate::QSoundEffectPrivate(QObject* parent):
     m_loopCount(1),
     m_runningCount(0),
     m_reloadCategory(false),
+    m_uploaded(false),
+    m_uploadPlaying(false),
+    m_uploadSinkInput(-1),
     m_sample(0),
     m_position(0)
 {
     m_ref = new QSoundEffectRef(this);
     pa_sample_spec_init(&m_pulseSpec);
+    m_uploadTimer.setSingleShot(true);
+    connect(&m_uploadTimer, SIGNAL(timeout()), SLOT(uploadPlayFinished()));
 }
 
 void QSoundEffectPrivate::release()
@@ -400,6 +846,8 @@ void QSoundEffectPrivate::release()
     qDebug() << this << "release";
 #endif
     m_ref->notifyDeleted();
+    stopUploadedSample();
+    releaseUpload();
     unloadPulseStream();
     if (m_sample) {
         m_sample->release();
@@ -447,6 +895,11 @@ QStringList QSoundEffectPrivate::supportedMimeTypes()
     return supportedTypes;
 }
 
+void QSoundEffectPrivate::preload(const QList<QUrl> &sources)
+{
+    streamPool()->preload(sources);
+}
+
 QUrl QSoundEffectPrivate::source() const
 {
     return m_source;
@@ -459,6 +912,7 @@ void QSoundEffectPrivate::setSource(const QUrl &url)
     qDebug() << this << "setSource =" << url;
 #endif
     stop();
+    releaseUpload();
     if (m_sample) {
         if (!m_sampleReady) {
             disconnect(m_sample, SIGNAL(error()), this, SLOT(decoderError()));
@@ -632,6 +1086,10 @@ void QSoundEffectPrivate::play()
     if (m_status == QSoundEffect::Null || m_status == QSoundEffect::Error || m_playQueued)
         return;
 
+    if (m_loopCount == 1 && playUploadedSample())
+        return;
+    stopUploadedSample();
+
     PulseDaemonLocker locker;
     if (!m_pulseStream || m_status != QSoundEffect::Ready || m_stopping || m_emptying) {
 #ifdef QT_PA_DEBUG
@@ -701,39 +1159,16 @@ void QSoundEffectPrivate::sampleReady()
         m_name = QString(QLatin1String("QtPulseSample-%1-%2")).arg(::getpid()).arg(quintptr(this)).toUtf8();
 
     PulseDaemonLocker locker;
+    if (!m_uploaded && m_sample->data().size() <= QT_PA_SAMPLE_UPLOAD_SIZE_MAX && pa_sample_spec_valid(&m_pulseSpec)) {
+        streamPool()->acquireUpload(m_source, m_pulseSpec);
+        m_uploaded = true;
+    }
+
     if (m_pulseStream) {
 #ifdef QT_PA_DEBUG
         qDebug() << this << "reuse existing pulsestream";
 #endif
-#ifdef QTM_PULSEAUDIO_DEFAULTBUFFER
-        const pa_buffer_attr *bufferAttr = pa_stream_get_buffer_attr(m_pulseStream);
-        if (bufferAttr->prebuf > uint32_t(m_sample->data().size())) {
-            pa_buffer_attr newBufferAttr;
-            newBufferAttr = *bufferAttr;
-            newBufferAttr.prebuf = m_sample->data().size();
-            pa_operation_unref(pa_stream_set_buffer_attr(m_pulseStream, &newBufferAttr, stream_adjust_prebuffer_callback, m_ref->getRef()));
-        } else {
-            streamReady();
-        }
-#else
-        const pa_buffer_attr *bufferAttr = pa_stream_get_buffer_attr(m_pulseStream);
-        if (bufferAttr->tlength < m_sample->data().size() && bufferAttr->tlength < QT_PA_STREAM_BUFFER_SIZE_MAX) {
-            pa_buffer_attr newBufferAttr;
-            newBufferAttr.maxlength = -1;
-            newBufferAttr.tlength = qMin(m_sample->data().size(), QT_PA_STREAM_BUFFER_SIZE_MAX);
-            newBufferAttr.minreq = bufferAttr->tlength / 2;
-            newBufferAttr.prebuf = -1;
-            newBufferAttr.fragsize = -1;
-            pa_operation_unref(pa_stream_set_buffer_attr(m_pulseStream, &newBufferAttr, stream_reset_buffer_callback, m_ref->getRef()));
-        } else if (bufferAttr->prebuf > uint32_t(m_sample->data().size())) {
-            pa_buffer_attr newBufferAttr;
-            newBufferAttr = *bufferAttr;
-            newBufferAttr.prebuf = m_sample->data().size();
-            pa_operation_unref(pa_stream_set_buffer_attr(m_pulseStream, &newBufferAttr, stream_adjust_prebuffer_callback, m_ref->getRef()));
-        } else {
-            streamReady();
-        }
-#endif
+        adjustPulseStream();
     } else {
         if (!pulseDaemon()->context() || pa_context_get_state(pulseDaemon()->context()) != PA_CONTEXT_READY) {
             connect(pulseDaemon(), SIGNAL(contextReady()), SLOT(contextReady()));
@@ -743,6 +1178,40 @@ void QSoundEffectPrivate::sampleReady()
     }
 }
 
+// Fits the buffer of a stream that was used for another sample
+void QSoundEffectPrivate::adjustPulseStream()
+{
+#ifdef QTM_PULSEAUDIO_DEFAULTBUFFER
+    const pa_buffer_attr *bufferAttr = pa_stream_get_buffer_attr(m_pulseStream);
+    if (bufferAttr->prebuf > uint32_t(m_sample->data().size())) {
+        pa_buffer_attr newBufferAttr;
+        newBufferAttr = *bufferAttr;
+        newBufferAttr.prebuf = m_sample->data().size();
+        pa_operation_unref(pa_stream_set_buffer_attr(m_pulseStream, &newBufferAttr, stream_adjust_prebuffer_callback, m_ref->getRef()));
+    } else {
+        streamReady();
+    }
+#else
+    const pa_buffer_attr *bufferAttr = pa_stream_get_buffer_attr(m_pulseStream);
+    if (bufferAttr->tlength < m_sample->data().size() && bufferAttr->tlength < QT_PA_STREAM_BUFFER_SIZE_MAX) {
+        pa_buffer_attr newBufferAttr;
+        newBufferAttr.maxlength = -1;
+        newBufferAttr.tlength = qMin(m_sample->data().size(), QT_PA_STREAM_BUFFER_SIZE_MAX);
+        newBufferAttr.minreq = bufferAttr->tlength / 2;
+        newBufferAttr.prebuf = -1;
+        newBufferAttr.fragsize = -1;
+        pa_operation_unref(pa_stream_set_buffer_attr(m_pulseStream, &newBufferAttr, stream_reset_buffer_callback, m_ref->getRef()));
+    } else if (bufferAttr->prebuf > uint32_t(m_sample->data().size())) {
+        pa_buffer_attr newBufferAttr;
+        newBufferAttr = *bufferAttr;
+        newBufferAttr.prebuf = m_sample->data().size();
+        pa_operation_unref(pa_stream_set_buffer_attr(m_pulseStream, &newBufferAttr, stream_adjust_prebuffer_callback, m_ref->getRef()));
+    } else {
+        streamReady();
+    }
+#endif
+}
+
 void QSoundEffectPrivate::decoderError()
 {
     qWarning("QSoundEffect(pulseaudio): Error decoding source");
@@ -768,8 +1237,12 @@ void QSoundEffectPrivate::unloadPulseStream()
         pa_stream_set_state_callback(m_pulseStream, 0, 0);
         pa_stream_set_write_callback(m_pulseStream, 0, 0);
         pa_stream_set_underflow_callback(m_pulseStream, 0, 0);
-        pa_stream_disconnect(m_pulseStream);
-        pa_stream_unref(m_pulseStream);
+        // A stream that is still being flushed has operations pending
+        // that refer to it, don't hand it to another effect
+        if (m_emptying || !streamPool()->recycleStream(m_pulseStream, m_pulseSpec, m_streamCategory)) {
+            pa_stream_disconnect(m_pulseStream);
+            pa_stream_unref(m_pulseStream);
+        }
         disconnect(pulseDaemon(), SIGNAL(volumeChanged()), this, SLOT(updateVolume()));
         disconnect(pulseDaemon(), SIGNAL(contextFailed()), this, SLOT(contextFailed()));
         m_pulseStream = 0;
@@ -874,6 +1347,98 @@ void QSoundEffectPrivate::playSample()
         pa_operation_unref(o);
 }
 
+// Plays the sample from the server's sample cache, which doesn't need a
+// stream of our own. The server can't loop it and doesn't tell when it's
+// done, so playback is assumed to end after the sample's duration.
+bool QSoundEffectPrivate::playUploadedSample()
+{
+    if (m_status != QSoundEffect::Ready || (m_playing && !m_uploadPlaying))
+        return false;
+
+    PulseDaemonLocker locker;
+    pa_context *context = pulseDaemon()->context();
+    const QByteArray name = streamPool()->uploadedSampleName(m_source);
+    if (!context || name.isEmpty())
+        return false;
+
+    // Restarting kills the previous playback
+    stopUploadedSample();
+
+    pa_proplist *propList = pa_proplist_new();
+    if (!m_category.isNull())
+        pa_proplist_sets(propList, PA_PROP_MEDIA_ROLE, m_category.toLatin1().constData());
+    const pa_volume_t volume = m_muted ? PA_VOLUME_MUTED : pulseDaemon()->calcVolume(qRound(m_volume * 100));
+    QSoundEffectRef *ref = m_ref->getRef();
+    pa_operation *o = pa_context_play_sample_with_proplist(context, name.constData(), 0, volume, propList,
+                                                           play_sample_callback, ref);
+    pa_proplist_free(propList);
+    if (!o) {
+        ref->release();
+        return false;
+    }
+    pa_operation_unref(o);
+
+#ifdef QT_PA_DEBUG
+    qDebug() << this << "play uploaded sample" << name;
+#endif
+    m_uploadPlaying = true;
+    m_uploadTimer.start(int(m_sample->format().durationForBytes(m_sample->data().size()) / 1000) + 50);
+    setLoopsRemaining(1);
+    setPlaying(true);
+    return true;
+}
+
+void QSoundEffectPrivate::stopUploadedSample()
+{
+    if (!m_uploadPlaying)
+        return;
+
+    m_uploadPlaying = false;
+    m_uploadTimer.stop();
+
+    PulseDaemonLocker locker;
+    if (m_uploadSinkInput >= 0 && pulseDaemon()->context())
+        pa_operation_unref(pa_context_kill_sink_input(pulseDaemon()->context(), m_uploadSinkInput, 0, 0));
+    m_uploadSinkInput = -1;
+}
+
+void QSoundEffectPrivate::releaseUpload()
+{
+    if (!m_uploaded)
+        return;
+
+    PulseDaemonLocker locker;
+    streamPool()->releaseUpload(m_source);
+    m_uploaded = false;
+}
+
+void QSoundEffectPrivate::uploadPlayStarted(int sinkInput)
+{
+    if (sinkInput < 0)
+        return;
+
+    // Stopped before the server started playing it
+    if (!m_uploadPlaying) {
+        PulseDaemonLocker locker;
+        if (pulseDaemon()->context())
+            pa_operation_unref(pa_context_kill_sink_input(pulseDaemon()->context(), sinkInput, 0, 0));
+        return;
+    }
+
+    m_uploadSinkInput = sinkInput;
+}
+
+void QSoundEffectPrivate::uploadPlayFinished()
+{
+    if (!m_uploadPlaying)
+        return;
+
+    m_uploadPlaying = false;
+    m_uploadSinkInput = -1;
+    setLoopsRemaining(0);
+    setPlaying(false);
+}
+
 void QSoundEffectPrivate::stop()
 {
 #ifdef QT_PA_DEBUG
@@ -881,6 +1446,12 @@ void QSoundEffectPrivate::stop()
 #endif
     if (!m_playing)
         return;
+    if (m_uploadPlaying) {
+        stopUploadedSample();
+        setPlaying(false);
+        setLoopsRemaining(0);
+        return;
+    }
     setPlaying(false);
     PulseDaemonLocker locker;
     m_stopping = true;
@@ -929,6 +1500,22 @@ void QSoundEffectPrivate::createPulseStream()
     if (!pulseDaemon()->context())
         return;
 
+    m_streamCategory = m_category;
+    if (pa_stream *stream = streamPool()->takeStream(m_pulseSpec, m_category)) {
+#ifdef QT_PA_DEBUG
+        qDebug() << this << "use pooled pulsestream";
+#endif
+        connect(pulseDaemon(), SIGNAL(volumeChanged()), this, SLOT(updateVolume()));
+        connect(pulseDaemon(), SIGNAL(contextFailed()), this, SLOT(contextFailed()));
+        pa_stream_set_state_callback(stream, stream_state_callback, this);
+        pa_stream_set_write_callback(stream, stream_write_callback, this);
+        pa_stream_set_underflow_callback(stream, stream_underrun_callback, this);
+        m_pulseStream = stream;
+        m_pulseBufferSize = pa_stream_get_buffer_attr(stream)->tlength;
+        adjustPulseStream();
+        return;
+    }
+
     pa_proplist *propList = pa_proplist_new();
     if (!m_category.isNull())
         pa_proplist_sets(propList, PA_PROP_MEDIA_ROLE, m_category.toLatin1().constData());
@@ -1124,6 +1711,21 @@ void QSoundEffectPrivate::setmuted_callback(pa_context *c, int success, void *us
     }
 }
 
+void QSoundEffectPrivate::play_sample_callback(pa_context *c, uint32_t idx, void *userdata)
+{
+    Q_UNUSED(c);
+    QSoundEffectRef *ref = reinterpret_cast<QSoundEffectRef*>(userdata);
+    QSoundEffectPrivate *self = ref->soundEffect();
+    ref->release();
+    if (!self)
+        return;
+
+    if (idx == PA_INVALID_INDEX)
+        qWarning("QSoundEffect(pulseaudio): Failed to play uploaded sample");
+    QMetaObject::invokeMethod(self, "uploadPlayStarted", Qt::QueuedConnection,
+                              Q_ARG(int, idx == PA_INVALID_INDEX ? -1 : int(idx)));
+}
+
 void QSoundEffectPrivate::stream_underrun_callback(pa_stream *s, void *userdata)
 {
     Q_UNUSED(s);
@@ -58,6 +58,7 @@
 
 #include <QtCore/qobject.h>
 #include <QtCore/qdatetime.h>
+#include <QtCore/qtimer.h>
 #include <qmediaplayer.h>
 #include <pulse/pulseaudio.h>
 #include "qsamplecache_p.h"
@@ -74,6 +75,7 @@ public:
     ~QSoundEffectPrivate();
 
     static QStringList supportedMimeTypes();
+    static void preload(const QList<QUrl> &sources);
 
     QUrl source() const;
     void setSource(const QUrl &url);
@@ -118,9 +120,15 @@ private Q_SLOTS:
     void emptyComplete(void *stream);
     void updateVolume();
     void updateMuted();
+    void uploadPlayStarted(int sinkInput);
+    void uploadPlayFinished();
 
 private:
     void playSample();
+    bool playUploadedSample();
+    void stopUploadedSample();
+    void releaseUpload();
+    void adjustPulseStream();
 
     void emptyStream();
     void createPulseStream();
@@ -140,6 +148,7 @@ private:
     static void stream_reset_buffer_callback(pa_stream *s, int success, void *userdata);
     static void setvolume_callback(pa_context *c, int success, void *userdata);
     static void setmuted_callback(pa_context *c, int success, void *userdata);
+    static void play_sample_callback(pa_context *c, uint32_t idx, void *userdata);
 
     pa_stream *m_pulseStream;
     int        m_sinkInputId;
@@ -159,8 +168,16 @@ private:
     QUrl    m_source;
     QByteArray m_name;
     QString m_category;
+    QString m_streamCategory;
     bool m_reloadCategory;
 
+    // Short samples are also uploaded to the server's sample cache and
+    // played from there when they don't loop
+    bool m_uploaded;
+    bool m_uploadPlaying;
+    int m_uploadSinkInput;
+    QTimer m_uploadTimer;
+
     QSample *m_sample;
     int m_position;
     QSoundEffectRef *m_ref;
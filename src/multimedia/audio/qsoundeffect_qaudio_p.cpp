@@ -57,13 +57,363 @@
 #include <QtCore/qmutex.h>
 #include <QtCore/qwaitcondition.h>
 #include <QtCore/qiodevice.h>
+#include <QtCore/qset.h>
+#include <qaudiodeviceinfo.h>
+#include "qaudiohelpers_p.h"
+
+#include <string.h>
 
 //#include <QDebug>
 //#define QT_QAUDIO_DEBUG 1
 
 QT_BEGIN_NAMESPACE
 
-Q_GLOBAL_STATIC(QSampleCache, sampleCache)
+// Samples are stored in the default output device's preferred format,
+// so the output doesn't have to convert them while playing
+class QSoundEffectSampleCache : public QSampleCache
+{
+public:
+    QSoundEffectSampleCache()
+    {
+        setPreferredFormat(QAudioDeviceInfo::defaultOutputDevice().preferredFormat());
+    }
+};
+
+Q_GLOBAL_STATIC(QSoundEffectSampleCache, sampleCache)
+
+// Samples loaded by QSoundEffect::preload() stay referenced for the
+// lifetime of the process
+class QSoundEffectPreloadedSamples
+{
+public:
+    void add(const QUrl &url)
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_urls.contains(url))
+            return;
+        m_urls.insert(url);
+        sampleCache()->requestSample(url);
+    }
+
+private:
+    QMutex m_mutex;
+    QSet<QUrl> m_urls;
+};
+
+Q_GLOBAL_STATIC(QSoundEffectPreloadedSamples, preloadedSamples)
+
+// All effects share one mixer, created in the thread of the first effect
+// that uses it. Effects living in other threads get their own output.
+static QBasicMutex mixerMutex;
+static QSoundEffectMixer *mixerInstance = 0;
+
+QSoundEffectMixer::QSoundEffectMixer(const QAudioFormat &format):
+    m_format(format),
+    m_bytesPerFrame(format.bytesPerFrame()),
+    m_maxVoices(32),
+    m_clients(0),
+    m_output(0),
+    m_mixPosition(0),
+    m_silentFrames(0),
+    m_serial(0),
+    m_mixing(false)
+{
+    const int maxVoices = qgetenv("QT_SOUNDEFFECT_MAX_VOICES").toInt();
+    if (maxVoices > 0)
+        m_maxVoices = maxVoices;
+
+    m_output = new QAudioOutput(m_format, this);
+    connect(m_output, SIGNAL(stateChanged(QAudio::State)), this, SLOT(stateChanged(QAudio::State)));
+    open(QIODevice::ReadOnly);
+}
+
+QSoundEffectMixer::~QSoundEffectMixer()
+{
+    m_output->stop();
+}
+
+QSoundEffectMixer *QSoundEffectMixer::acquire()
+{
+    if (qgetenv("QT_SOUNDEFFECT_MIXER") == "0")
+        return 0;
+
+    QMutexLocker locker(&mixerMutex);
+    if (!mixerInstance) {
+        const QAudioFormat format = sampleCache()->preferredFormat();
+        if (!QAudioHelperInternal::qIsMixableFormat(format))
+            return 0;
+        mixerInstance = new QSoundEffectMixer(format);
+    } else if (mixerInstance->thread() != QThread::currentThread()) {
+        return 0;
+    }
+
+    mixerInstance->m_clients++;
+    return mixerInstance;
+}
+
+void QSoundEffectMixer::release()
+{
+    QMutexLocker locker(&mixerMutex);
+    if (--m_clients > 0)
+        return;
+
+    if (mixerInstance == this)
+        mixerInstance = 0;
+    deleteLater();
+}
+
+void QSoundEffectMixer::play(PrivateSoundSource *source)
+{
+    // Restarting an effect replaces its voice
+    removeVoice(source);
+    if (activeVoiceCount() >= m_maxVoices)
+        stealVoice();
+
+    Voice voice;
+    voice.source = source;
+    voice.offset = 0;
+    voice.serial = ++m_serial;
+    source->m_mixerSerial = voice.serial;
+
+    // The voice starts on the first frame of the next mixed block, so
+    // effects started together play sample aligned
+    m_voices.append(voice);
+    m_silentFrames = 0;
+
+    if (m_output->state() == QAudio::StoppedState) {
+        m_mixPosition = 0;
+        m_output->start(this);
+        if (m_output->error() != QAudio::NoError) {
+            qWarning("QSoundEffect(qaudio): Failed to start the mixer output");
+            stopAll();
+        }
+    }
+}
+
+void QSoundEffectMixer::stop(PrivateSoundSource *source)
+{
+    removeVoice(source);
+}
+
+void QSoundEffectMixer::removeVoice(PrivateSoundSource *source)
+{
+    for (int i = 0; i < m_voices.size(); ++i) {
+        if (m_voices.at(i).source != source)
+            continue;
+        // Don't shift the voices under the mixing loop, they are
+        // compacted once the block is mixed
+        if (m_mixing)
+            m_voices[i].source = 0;
+        else
+            m_voices.remove(i);
+        return;
+    }
+}
+
+int QSoundEffectMixer::activeVoiceCount() const
+{
+    int count = 0;
+    foreach (const Voice &voice, m_voices) {
+        if (voice.source)
+            ++count;
+    }
+    return count;
+}
+
+// The quietest voice is stolen first, the oldest one among equally loud voices
+void QSoundEffectMixer::stealVoice()
+{
+    PrivateSoundSource *victim = 0;
+    qreal victimGain = 0;
+    quint64 victimSerial = 0;
+
+    foreach (const Voice &voice, m_voices) {
+        if (!voice.source)
+            continue;
+        const qreal gain = voice.source->m_muted ? 0 : voice.source->m_volume;
+        if (!victim || gain < victimGain || (gain == victimGain && voice.serial < victimSerial)) {
+            victim = voice.source;
+            victimGain = gain;
+            victimSerial = voice.serial;
+        }
+    }
+
+    if (victim) {
+        removeVoice(victim);
+        victim->soundeffect->stop();
+    }
+}
+
+void QSoundEffectMixer::stopAll()
+{
+    QList<QPointer<PrivateSoundSource> > sources;
+    foreach (const Voice &voice, m_voices) {
+        if (voice.source)
+            sources.append(voice.source);
+    }
+    foreach (const PendingStop &pending, m_pendingStops)
+        sources.append(pending.source);
+    m_voices.clear();
+    m_pendingStops.clear();
+
+    foreach (const QPointer<PrivateSoundSource> &source, sources) {
+        if (source)
+            source->soundeffect->stop();
+    }
+}
+
+qint64 QSoundEffectMixer::playedFrames() const
+{
+    const int queued = m_output->bufferSize() - m_output->bytesFree();
+    return m_mixPosition - qMax(0, queued) / m_bytesPerFrame;
+}
+
+// Effects report that they stopped playing once the output has played
+// their last frame, not when it was mixed
+void QSoundEffectMixer::deliverStops(qint64 playedFrame)
+{
+    QList<PendingStop> due;
+    for (int i = 0; i < m_pendingStops.size(); ) {
+        if (m_pendingStops.at(i).endFrame <= playedFrame)
+            due.append(m_pendingStops.takeAt(i));
+        else
+            ++i;
+    }
+
+    foreach (const PendingStop &pending, due) {
+        if (pending.source && pending.source->m_mixerSerial == pending.serial)
+            pending.source->soundeffect->stop();
+    }
+}
+
+void QSoundEffectMixer::finishVoice(int index, qint64 endFrame)
+{
+    PendingStop pending;
+    pending.source = m_voices.at(index).source;
+    pending.serial = m_voices.at(index).serial;
+    pending.endFrame = endFrame;
+    m_pendingStops.append(pending);
+    m_voices[index].source = 0;
+}
+
+void QSoundEffectMixer::mixVoice(int index, float *accumulator, int frames)
+{
+    const int channels = m_format.channelCount();
+    int mixed = 0;
+
+    while (mixed < frames) {
+        PrivateSoundSource *source = m_voices.at(index).source;
+        if (!source)
+            return;
+
+        const QByteArray &sampleData = source->m_sample->data();
+        const int sampleFrames = sampleData.size() / m_bytesPerFrame;
+        if (source->m_runningCount == 0 || sampleFrames <= 0) {
+            finishVoice(index, m_mixPosition + mixed);
+            return;
+        }
+
+        const int offset = m_voices.at(index).offset;
+        const int count = qMin(frames - mixed, sampleFrames - offset);
+        const qreal gain = source->m_muted ? 0 : source->m_volume;
+        if (gain > 0) {
+            QAudioHelperInternal::qMixSamples(gain, m_format,
+                                              sampleData.constData() + offset * m_bytesPerFrame,
+                                              accumulator + mixed * channels, count * channels);
+        }
+        mixed += count;
+
+        if (offset + count < sampleFrames) {
+            m_voices[index].offset = offset + count;
+            return;
+        }
+
+        // End of the sound, the loop count is updated as the old
+        // per effect output did. This may stop, restart or delete the
+        // effect, which only clears the voice.
+        m_voices[index].offset = 0;
+        if (source->m_runningCount > 0)
+            source->soundeffect->setLoopsRemaining(source->m_runningCount - 1);
+
+        source = m_voices.at(index).source;
+        if (source && source->m_runningCount == 0) {
+            finishVoice(index, m_mixPosition + mixed);
+            return;
+        }
+    }
+}
+
+qint64 QSoundEffectMixer::readData(char *data, qint64 len)
+{
+    // Keep at most three periods queued so that new voices start quickly
+    const int periodSize = m_output->periodSize();
+    if (periodSize > 0)
+        len = qMin<qint64>(len, qMin(3, m_output->bytesFree() / periodSize) * periodSize);
+
+    const int frames = len / m_bytesPerFrame;
+    if (frames <= 0)
+        return 0;
+
+    if (activeVoiceCount() == 0) {
+        m_voices.clear();
+        deliverStops(playedFrames());
+
+        // Keep the stream open for a second of silence, so that effects
+        // played in quick succession don't reopen the device
+        if (m_voices.isEmpty() && m_pendingStops.isEmpty() && m_silentFrames >= m_format.sampleRate())
+            return 0;
+
+        m_silentFrames += frames;
+        m_mixPosition += frames;
+        memset(data, 0, frames * m_bytesPerFrame);
+        return frames * m_bytesPerFrame;
+    }
+
+    m_silentFrames = 0;
+
+    const int samples = frames * m_format.channelCount();
+    if (m_accumulator.size() < samples)
+        m_accumulator.resize(samples);
+    float *accumulator = m_accumulator.data();
+    memset(accumulator, 0, samples * sizeof(float));
+
+    // Voices started while mixing are appended and mixed in this block
+    m_mixing = true;
+    for (int i = 0; i < m_voices.size(); ++i)
+        mixVoice(i, accumulator, frames);
+    m_mixing = false;
+
+    for (int i = m_voices.size() - 1; i >= 0; --i) {
+        if (!m_voices.at(i).source)
+            m_voices.remove(i);
+    }
+
+    QAudioHelperInternal::qStoreMixedSamples(m_format, accumulator, data, samples);
+    m_mixPosition += frames;
+
+    deliverStops(playedFrames());
+
+    return frames * m_bytesPerFrame;
+}
+
+qint64 QSoundEffectMixer::writeData(const char *data, qint64 len)
+{
+    Q_UNUSED(data)
+    Q_UNUSED(len)
+    return 0;
+}
+
+void QSoundEffectMixer::stateChanged(QAudio::State state)
+{
+    if (state == QAudio::IdleState && m_voices.isEmpty()) {
+        // Everything was played, give the device back
+        m_output->stop();
+        deliverStops(m_mixPosition);
+    } else if (state == QAudio::StoppedState && m_output->error() != QAudio::NoError) {
+        qWarning("QSoundEffect(qaudio): Mixer output failed");
+        stopAll();
+    }
+}
 
 QSoundEffectPrivate::QSoundEffectPrivate(QObject* parent):
     QObject(parent),
@@ -78,7 +428,10 @@ QSoundEffectPrivate::~QSoundEffectPrivate()
 void QSoundEffectPrivate::release()
 {
     stop();
-    if (d->m_audioOutput) {
+    if (d->m_mixer) {
+        d->m_mixer->release();
+        d->m_sample->release();
+    } else if (d->m_audioOutput) {
         d->m_audioOutput->stop();
         d->m_audioOutput->deleteLater();
         d->m_sample->release();
@@ -100,6 +453,14 @@ QStringList QSoundEffectPrivate::supportedMimeTypes()
                          << QLatin1String("audio/x-pn-wav");
 }
 
+void QSoundEffectPrivate::preload(const QList<QUrl> &sources)
+{
+    foreach (const QUrl &url, sources) {
+        if (url.isValid() && !url.isEmpty())
+            preloadedSamples()->add(url);
+    }
+}
+
 QUrl QSoundEffectPrivate::source() const
 {
     return d->m_url;
@@ -238,7 +599,9 @@ void QSoundEffectPrivate::play()
         return;
     }
     setPlaying(true);
-    if (d->m_audioOutput && d->m_audioOutput->state() == QAudio::StoppedState && d->m_sampleReady)
+    if (d->m_mixer && d->m_sampleReady)
+        d->m_mixer->play(d);
+    else if (d->m_audioOutput && d->m_audioOutput->state() == QAudio::StoppedState && d->m_sampleReady)
         d->m_audioOutput->start(d);
 }
 
@@ -253,7 +616,9 @@ void QSoundEffectPrivate::stop()
 
     setPlaying(false);
 
-    if (d->m_audioOutput)
+    if (d->m_mixer)
+        d->m_mixer->stop(d);
+    else if (d->m_audioOutput)
         d->m_audioOutput->stop();
 }
 
@@ -317,7 +682,9 @@ PrivateSoundSource::PrivateSoundSource(QSoundEffectPrivate* s):
     m_muted(false),
     m_volume(1.0),
     m_sampleReady(false),
-    m_offset(0)
+    m_offset(0),
+    m_mixer(0),
+    m_mixerSerial(0)
 {
     soundeffect = s;
     m_category = QLatin1String("game");
@@ -334,7 +701,16 @@ void PrivateSoundSource::sampleReady()
 #endif
     disconnect(m_sample, SIGNAL(error()), this, SLOT(decoderError()));
     disconnect(m_sample, SIGNAL(ready()), this, SLOT(sampleReady()));
-    if (!m_audioOutput) {
+
+    // Samples in the mixer's format are played through the shared mixer
+    if (!m_mixer && !m_audioOutput)
+        m_mixer = QSoundEffectMixer::acquire();
+    if (m_mixer && m_sample->format() != m_mixer->format()) {
+        m_mixer->release();
+        m_mixer = 0;
+    }
+
+    if (!m_mixer && !m_audioOutput) {
         m_audioOutput = new QAudioOutput(m_sample->format());
         connect(m_audioOutput,SIGNAL(stateChanged(QAudio::State)), this, SLOT(stateChanged(QAudio::State)));
         if (!m_muted)
@@ -345,8 +721,12 @@ void PrivateSoundSource::sampleReady()
     m_sampleReady = true;
     soundeffect->setStatus(QSoundEffect::Ready);
 
-    if (m_playing)
-        m_audioOutput->start(this);
+    if (m_playing) {
+        if (m_mixer)
+            m_mixer->play(this);
+        else
+            m_audioOutput->start(this);
+    }
 }
 
 void PrivateSoundSource::decoderError()
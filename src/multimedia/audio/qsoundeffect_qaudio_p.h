@@ -54,7 +54,9 @@
 //
 
 #include <QtCore/qobject.h>
+#include <QtCore/qpointer.h>
 #include <QtCore/qurl.h>
+#include <QtCore/qvector.h>
 #include "qaudiooutput.h"
 #include "qsamplecache_p.h"
 #include "qsoundeffect.h"
@@ -62,10 +64,72 @@
 QT_BEGIN_NAMESPACE
 
 class QSoundEffectPrivate;
+class PrivateSoundSource;
+
+// Mixes the voices of all sound effects of a thread into one output stream
+class QSoundEffectMixer : public QIODevice
+{
+    Q_OBJECT
+public:
+    static QSoundEffectMixer *acquire();
+    void release();
+
+    QAudioFormat format() const { return m_format; }
+
+    void play(PrivateSoundSource *source);
+    void stop(PrivateSoundSource *source);
+
+    qint64 readData(char *data, qint64 len);
+    qint64 writeData(const char *data, qint64 len);
+
+private Q_SLOTS:
+    void stateChanged(QAudio::State state);
+
+private:
+    explicit QSoundEffectMixer(const QAudioFormat &format);
+    ~QSoundEffectMixer();
+
+    struct Voice
+    {
+        PrivateSoundSource *source;
+        int offset;
+        quint64 serial;
+    };
+
+    struct PendingStop
+    {
+        QPointer<PrivateSoundSource> source;
+        quint64 serial;
+        qint64 endFrame;
+    };
+
+    void mixVoice(int index, float *accumulator, int frames);
+    void finishVoice(int index, qint64 endFrame);
+    void removeVoice(PrivateSoundSource *source);
+    void stealVoice();
+    int activeVoiceCount() const;
+    qint64 playedFrames() const;
+    void deliverStops(qint64 playedFrame);
+    void stopAll();
+
+    QAudioFormat m_format;
+    int m_bytesPerFrame;
+    int m_maxVoices;
+    int m_clients;
+    QAudioOutput *m_output;
+    QVector<Voice> m_voices;
+    QList<PendingStop> m_pendingStops;
+    QVector<float> m_accumulator;
+    qint64 m_mixPosition;
+    qint64 m_silentFrames;
+    quint64 m_serial;
+    bool m_mixing;
+};
 
 class PrivateSoundSource : public QIODevice
 {
     friend class QSoundEffectPrivate;
+    friend class QSoundEffectMixer;
     Q_OBJECT
 public:
     PrivateSoundSource(QSoundEffectPrivate* s);
@@ -92,6 +156,8 @@ private:
     bool           m_sampleReady;
     qint64         m_offset;
     QString        m_category;
+    QSoundEffectMixer *m_mixer;
+    quint64        m_mixerSerial;
 
     QSoundEffectPrivate *soundeffect;
 };
@@ -107,6 +173,7 @@ public:
     ~QSoundEffectPrivate();
 
     static QStringList supportedMimeTypes();
+    static void preload(const QList<QUrl> &sources);
 
     QUrl source() const;
     void setSource(const QUrl &url);
@@ -43,17 +43,44 @@
 
 #include <QtCore/qtimer.h>
 #include <QtCore/qendian.h>
+#include <QtCore/qfiledevice.h>
 
 QT_BEGIN_NAMESPACE
 
+// WAVE_FORMAT_* tags from mmreg.h
+enum {
+    WaveFormatPcm = 0x0001,
+    WaveFormatIeeeFloat = 0x0003,
+    WaveFormatExtensible = 0xFFFE
+};
+
+// RF64 stores sizes that do not fit in 32 bits in the ds64 chunk and
+// leaves this marker in the RIFF and data chunk size fields.
+static const quint32 Rf64SizeMarker = 0xFFFFFFFF;
+
+static inline quint16 readUInt16(const uchar *data, bool bigEndian)
+{
+    return bigEndian ? qFromBigEndian<quint16>(data) : qFromLittleEndian<quint16>(data);
+}
+
+static inline quint32 readUInt32(const uchar *data, bool bigEndian)
+{
+    return bigEndian ? qFromBigEndian<quint32>(data) : qFromLittleEndian<quint32>(data);
+}
+
 QWaveDecoder::QWaveDecoder(QIODevice *s, QObject *parent):
     QIODevice(parent),
     haveFormat(false),
     dataSize(0),
+    dataOffset(0),
+    readPosition(0),
+    rf64DataSize(0),
     source(s),
     state(QWaveDecoder::InitialState),
     junkToSkip(0),
-    bigEndian(false)
+    bigEndian(false),
+    rf64(false),
+    mappedData(0)
 {
     open(QIODevice::ReadOnly | QIODevice::Unbuffered);
 
@@ -74,7 +101,16 @@ QAudioFormat QWaveDecoder::audioFormat() const
 
 int QWaveDecoder::duration() const
 {
-    return size() * 1000 / (format.sampleSize() / 8) / format.channelCount() / format.sampleRate();
+    const qint64 bytesPerSecond = qint64(format.bytesPerFrame()) * format.sampleRate();
+    if (bytesPerSecond <= 0)
+        return 0;
+    return size() * 1000 / bytesPerSecond;
+}
+
+qint64 QWaveDecoder::frameCount() const
+{
+    const int bytesPerFrame = format.bytesPerFrame();
+    return bytesPerFrame > 0 ? size() / bytesPerFrame : 0;
 }
 
 qint64 QWaveDecoder::size() const
@@ -89,12 +125,72 @@ bool QWaveDecoder::isSequential() const
 
 qint64 QWaveDecoder::bytesAvailable() const
 {
-    return haveFormat ? source->bytesAvailable() : 0;
+    if (!haveFormat)
+        return 0;
+    return qMax(qint64(0), qMin(source->bytesAvailable(), dataSize - readPosition));
+}
+
+qint64 QWaveDecoder::pos() const
+{
+    return readPosition;
+}
+
+/*
+    Moves to \a pos bytes into the sample data. Only possible once the
+    format is known and when the source is random access.
+*/
+bool QWaveDecoder::seek(qint64 pos)
+{
+    if (!haveFormat || source->isSequential() || pos < 0 || pos > dataSize)
+        return false;
+
+    if (!source->seek(dataOffset + pos))
+        return false;
+
+    QIODevice::seek(pos);
+    readPosition = pos;
+    return true;
+}
+
+bool QWaveDecoder::seekToFrame(qint64 frame)
+{
+    const int bytesPerFrame = format.bytesPerFrame();
+    if (bytesPerFrame <= 0)
+        return false;
+    return seek(frame * bytesPerFrame);
+}
+
+/*
+    Maps the sample data of a file source into memory and returns a pointer
+    to it, or 0 if the source is not a file or could not be mapped. The
+    mapping belongs to the source file and stays valid until it is closed
+    or destroyed.
+*/
+const uchar *QWaveDecoder::mapData()
+{
+    if (mappedData || !haveFormat || dataSize <= 0)
+        return mappedData;
+
+    QFileDevice *file = qobject_cast<QFileDevice *>(source);
+    if (file)
+        mappedData = file->map(dataOffset, dataSize);
+    return mappedData;
 }
 
 qint64 QWaveDecoder::readData(char *data, qint64 maxlen)
 {
-    return haveFormat ? source->read(data, maxlen) : 0;
+    if (!haveFormat)
+        return 0;
+
+    // Never hand out trailing chunks (LIST, id3, ...) as samples
+    const qint64 remaining = dataSize - readPosition;
+    if (remaining <= 0)
+        return 0;
+
+    const qint64 bytesRead = source->read(data, qMin(maxlen, remaining));
+    if (bytesRead > 0)
+        readPosition += bytesRead;
+    return bytesRead;
 }
 
 qint64 QWaveDecoder::writeData(const char *data, qint64 len)
@@ -112,6 +208,45 @@ void QWaveDecoder::parsingFailed()
     emit parsingError();
 }
 
+bool QWaveDecoder::parseFormat(const uchar *data, int length)
+{
+    // WAVEFORMAT is 16 bytes, WAVEFORMATEXTENSIBLE adds cbSize,
+    // wValidBitsPerSample, dwChannelMask and the SubFormat GUID.
+    if (length < 16)
+        return false;
+
+    quint16 formatTag = readUInt16(data, bigEndian);
+    const int channels = readUInt16(data + 2, bigEndian);
+    const int sampleRate = readUInt32(data + 4, bigEndian);
+    const int bitsPerSample = readUInt16(data + 14, bigEndian);
+
+    if (formatTag == WaveFormatExtensible) {
+        if (length < 26)
+            return false;
+        // The first two bytes of the SubFormat GUID hold the plain format tag
+        formatTag = readUInt16(data + 24, bigEndian);
+    }
+
+    if (channels <= 0 || sampleRate <= 0 || bitsPerSample <= 0)
+        return false;
+
+    QAudioFormat::SampleType sampleType;
+    if (formatTag == 0 || formatTag == WaveFormatPcm)
+        sampleType = bitsPerSample == 8 ? QAudioFormat::UnSignedInt : QAudioFormat::SignedInt;
+    else if (formatTag == WaveFormatIeeeFloat && bitsPerSample == 32)
+        sampleType = QAudioFormat::Float;
+    else
+        return false;
+
+    format.setCodec(QLatin1String("audio/pcm"));
+    format.setSampleType(sampleType);
+    format.setByteOrder(bigEndian ? QAudioFormat::BigEndian : QAudioFormat::LittleEndian);
+    format.setSampleRate(sampleRate);
+    format.setSampleSize(bitsPerSample);
+    format.setChannelCount(channels);
+    return true;
+}
+
 void QWaveDecoder::handleData()
 {
     // As a special "state", if we have junk to skip, we do
@@ -134,67 +269,76 @@ void QWaveDecoder::handleData()
         RIFFHeader riff;
         source->read(reinterpret_cast<char *>(&riff), sizeof(RIFFHeader));
 
-        // RIFF = little endian RIFF, RIFX = big endian RIFF
-        if (((qstrncmp(riff.descriptor.id, "RIFF", 4) != 0) && (qstrncmp(riff.descriptor.id, "RIFX", 4) != 0))
+        // RIFF = little endian RIFF, RIFX = big endian RIFF, RF64 = little endian 64-bit RIFF
+        if (((qstrncmp(riff.descriptor.id, "RIFF", 4) != 0)
+                && (qstrncmp(riff.descriptor.id, "RIFX", 4) != 0)
+                && (qstrncmp(riff.descriptor.id, "RF64", 4) != 0))
                 || qstrncmp(riff.type, "WAVE", 4) != 0) {
             parsingFailed();
             return;
         } else {
-            state = QWaveDecoder::WaitingForFormatState;
-            if (qstrncmp(riff.descriptor.id, "RIFX", 4) == 0)
-                bigEndian = true;
-            else
-                bigEndian = false;
+            bigEndian = qstrncmp(riff.descriptor.id, "RIFX", 4) == 0;
+            rf64 = qstrncmp(riff.descriptor.id, "RF64", 4) == 0;
+            state = rf64 ? QWaveDecoder::WaitingForDs64State : QWaveDecoder::WaitingForFormatState;
         }
     }
 
-    if (state == QWaveDecoder::WaitingForFormatState) {
-        if (findChunk("fmt ")) {
+    if (state == QWaveDecoder::WaitingForDs64State) {
+        if (findChunk("ds64")) {
             chunk descriptor;
             peekChunk(&descriptor);
 
-            quint32 rawChunkSize = descriptor.size + sizeof(chunk);
-            if (source->bytesAvailable() < qint64(rawChunkSize))
+            // riffSize, dataSize and sampleCount, each as a 64-bit value
+            uchar ds64[24];
+            if (descriptor.size < sizeof(ds64)) {
+                parsingFailed();
+                return;
+            }
+            if (source->bytesAvailable() < qint64(sizeof(chunk) + sizeof(ds64)))
                 return;
 
-            WAVEHeader wave;
-            source->read(reinterpret_cast<char *>(&wave), sizeof(WAVEHeader));
+            source->read(reinterpret_cast<char *>(&descriptor), sizeof(chunk));
+            source->read(reinterpret_cast<char *>(ds64), sizeof(ds64));
+            rf64DataSize = qFromLittleEndian<quint64>(ds64 + 8);
 
-            if (rawChunkSize > sizeof(WAVEHeader))
-                discardBytes(rawChunkSize - sizeof(WAVEHeader));
+            state = QWaveDecoder::WaitingForFormatState;
 
-            // Swizzle this
-            if (bigEndian) {
-                wave.audioFormat = qFromBigEndian<quint16>(wave.audioFormat);
+            junkToSkip = descriptor.size - sizeof(ds64) + (descriptor.size & 1);
+            if (junkToSkip > 0) {
+                discardBytes(junkToSkip);
+                if (junkToSkip > 0)
+                    return;
             }
+        }
+    }
 
-            if (wave.audioFormat != 0 && wave.audioFormat != 1) {
-                // 32bit wave files have format == 0xFFFE (WAVE_FORMAT_EXTENSIBLE).
-                // but don't support them at the moment.
+    if (state == QWaveDecoder::WaitingForFormatState) {
+        if (findChunk("fmt ")) {
+            chunk descriptor;
+            peekChunk(&descriptor);
+
+            const qint64 rawChunkSize = descriptor.size + sizeof(chunk);
+            if (source->bytesAvailable() < rawChunkSize)
+                return;
+
+            // Anything past WAVEFORMATEXTENSIBLE is codec specific
+            uchar wave[40];
+            const int waveSize = qMin<qint64>(descriptor.size, sizeof(wave));
+            source->read(reinterpret_cast<char *>(&descriptor), sizeof(chunk));
+            source->read(reinterpret_cast<char *>(wave), waveSize);
+
+            if (!parseFormat(wave, waveSize)) {
                 parsingFailed();
                 return;
-            } else {
-                format.setCodec(QLatin1String("audio/pcm"));
-
-                if (bigEndian) {
-                    int bps = qFromBigEndian<quint16>(wave.bitsPerSample);
-
-                    format.setSampleType(bps == 8 ? QAudioFormat::UnSignedInt : QAudioFormat::SignedInt);
-                    format.setByteOrder(QAudioFormat::BigEndian);
-                    format.setSampleRate(qFromBigEndian<quint32>(wave.sampleRate));
-                    format.setSampleSize(bps);
-                    format.setChannelCount(qFromBigEndian<quint16>(wave.numChannels));
-                } else {
-                    int bps = qFromLittleEndian<quint16>(wave.bitsPerSample);
-
-                    format.setSampleType(bps == 8 ? QAudioFormat::UnSignedInt : QAudioFormat::SignedInt);
-                    format.setByteOrder(QAudioFormat::LittleEndian);
-                    format.setSampleRate(qFromLittleEndian<quint32>(wave.sampleRate));
-                    format.setSampleSize(bps);
-                    format.setChannelCount(qFromLittleEndian<quint16>(wave.numChannels));
-                }
-
-                state = QWaveDecoder::WaitingForDataState;
+            }
+
+            state = QWaveDecoder::WaitingForDataState;
+
+            junkToSkip = descriptor.size - waveSize + (descriptor.size & 1);
+            if (junkToSkip > 0) {
+                discardBytes(junkToSkip);
+                if (junkToSkip > 0)
+                    return;
             }
         }
     }
@@ -207,8 +351,18 @@ void QWaveDecoder::handleData()
             source->read(reinterpret_cast<char *>(&descriptor), sizeof(chunk));
             if (bigEndian)
                 descriptor.size = qFromBigEndian<quint32>(descriptor.size);
+            else
+                descriptor.size = qFromLittleEndian<quint32>(descriptor.size);
 
             dataSize = descriptor.size;
+            if (rf64 && descriptor.size == Rf64SizeMarker)
+                dataSize = rf64DataSize;
+
+            // Writers that stream to disk often leave the size unpatched
+            if (!source->isSequential()) {
+                dataOffset = source->pos();
+                dataSize = qMin(dataSize, qMax(qint64(0), source->size() - dataOffset));
+            }
 
             haveFormat = true;
             connect(source, SIGNAL(readyRead()), SIGNAL(readyRead()));
@@ -230,10 +384,17 @@ bool QWaveDecoder::enoughDataAvailable()
     if (!peekChunk(&descriptor))
         return false;
 
+    // RF64 keeps its real size in the ds64 chunk, so only a random access
+    // source is known to be complete
+    if (qstrncmp(descriptor.id, "RF64", 4) == 0)
+        return !source->isSequential();
+
     // This is only called for the RIFF/RIFX header, before bigEndian is set,
     // so we have to manually swizzle
     if (qstrncmp(descriptor.id, "RIFX", 4) == 0)
         descriptor.size = qFromBigEndian<quint32>(descriptor.size);
+    else
+        descriptor.size = qFromLittleEndian<quint32>(descriptor.size);
 
     if (source->bytesAvailable() < qint64(sizeof(chunk) + descriptor.size))
         return false;
@@ -253,8 +414,8 @@ bool QWaveDecoder::findChunk(const char *chunkId)
             return true;
 
         // It's possible that bytes->available() is less than the chunk size
-        // if it's corrupt.
-        junkToSkip = qint64(sizeof(chunk) + descriptor.size);
+        // if it's corrupt. Chunks are padded to an even size.
+        junkToSkip = qint64(sizeof(chunk)) + descriptor.size + (descriptor.size & 1);
 
         // Skip the current amount
         if (junkToSkip > 0)
@@ -279,6 +440,8 @@ bool QWaveDecoder::peekChunk(chunk *pChunk)
     source->peek(reinterpret_cast<char *>(pChunk), sizeof(chunk));
     if (bigEndian)
         pChunk->size = qFromBigEndian<quint32>(pChunk->size);
+    else
+        pChunk->size = qFromLittleEndian<quint32>(pChunk->size);
 
     return true;
 }
@@ -289,11 +452,14 @@ void QWaveDecoder::discardBytes(qint64 numBytes)
     // If the iodevice doesn't have this many bytes in it,
     // remember how much more junk we have to skip.
     if (source->isSequential()) {
-        QByteArray r = source->read(qMin(numBytes, qint64(16384))); // uggh, wasted memory, limit to a max of 16k
-        if (r.size() < numBytes)
-            junkToSkip = numBytes - r.size();
-        else
-            junkToSkip = 0;
+        char buffer[4096];
+        while (numBytes > 0) {
+            const qint64 bytesRead = source->read(buffer, qMin(numBytes, qint64(sizeof(buffer))));
+            if (bytesRead <= 0)
+                break;
+            numBytes -= bytesRead;
+        }
+        junkToSkip = numBytes;
     } else {
         quint64 origPos = source->pos();
         source->seek(source->pos() + numBytes);
@@ -71,10 +71,16 @@ public:
 
     QAudioFormat audioFormat() const;
     int duration() const;
+    qint64 frameCount() const;
 
     qint64 size() const;
     bool isSequential() const;
     qint64 bytesAvailable() const;
+    qint64 pos() const;
+    bool seek(qint64 pos);
+    bool seekToFrame(qint64 frame);
+
+    const uchar *mapData();
 
 Q_SIGNALS:
     void formatKnown();
@@ -91,9 +97,11 @@ private:
     bool findChunk(const char *chunkId);
     void discardBytes(qint64 numBytes);
     void parsingFailed();
+    bool parseFormat(const uchar *data, int length);
 
     enum State {
         InitialState,
+        WaitingForDs64State,
         WaitingForFormatState,
         WaitingForDataState
     };
@@ -110,24 +118,19 @@ private:
         chunk       descriptor;
         char        type[4];
     };
-    struct WAVEHeader
-    {
-        chunk       descriptor;
-        quint16     audioFormat;
-        quint16     numChannels;
-        quint32     sampleRate;
-        quint32     byteRate;
-        quint16     blockAlign;
-        quint16     bitsPerSample;
-    };
 
     bool haveFormat;
     qint64 dataSize;
+    qint64 dataOffset;
+    qint64 readPosition;
+    qint64 rf64DataSize;
     QAudioFormat format;
     QIODevice *source;
     State state;
-    quint32 junkToSkip;
+    qint64 junkToSkip;
     bool bigEndian;
+    bool rf64;
+    uchar *mappedData;
 };
 
 QT_END_NAMESPACE
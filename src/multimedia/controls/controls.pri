@@ -39,6 +39,7 @@ PUBLIC_HEADERS += \
     controls/qmediaavailabilitycontrol.h
 
 PRIVATE_HEADERS += \
+    controls/qaudiodecoderbatchreadinterface_p.h \
     controls/qmediaplaylistcontrol_p.h \
     controls/qmediaplaylistsourcecontrol_p.h
 
@@ -44,6 +44,8 @@
 
 #include <QtCore/qobject.h>
 #include <QtCore/qiodevice.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qelapsedtimer.h>
 
 #include <gst/gst.h>
 #include <gst/app/gstappsrc.h>
@@ -51,6 +53,9 @@
 
 QT_BEGIN_NAMESPACE
 
+class QGstAppSrcBufferPool;
+class QGstAppSrcMemory;
+
 class QGstAppSrc  : public QObject
 {
     Q_OBJECT
@@ -78,10 +83,21 @@ public:
                m_stream->isOpen();
     }
 
+    // Streams backed by memory (read-only QBuffer, or a mapped local QFile)
+    // are wrapped into GstBuffers without copying and pushed directly from
+    // the streaming thread.
+    bool isZeroCopy() const;
+
+    qint64 bytesPushed() const;
+    int allocationCount() const;
+    qreal bytesPerSecond() const;
+    qreal allocationsPerSecond() const;
+
 private slots:
     void pushDataToAppSrc();
     bool doSeek(qint64);
     void onDataReady();
+    void sendEOS();
 
     void streamDestroyed();
 private:
@@ -90,7 +106,11 @@ private:
     static void on_need_data(GstAppSrc *element, uint arg0, gpointer userdata);
     static void destroy_notify(gpointer data);
 
-    void sendEOS();
+    void setupMemory();
+    void releaseMemory();
+    bool pushMemory(unsigned int size);
+    bool seekMemory(qint64 offset);
+    void updateStatistics(qint64 bytes, bool allocated);
 
     QIODevice *m_stream;
     GstAppSrc *m_appSrc;
@@ -103,6 +123,16 @@ private:
     bool m_dataRequested;
     bool m_enoughData;
     bool m_forceData;
+
+    QGstAppSrcBufferPool *m_pool;
+    QGstAppSrcMemory *m_memory;
+    mutable QMutex m_memoryMutex;
+    qint64 m_memoryOffset;
+
+    mutable QMutex m_statisticsMutex;
+    QElapsedTimer m_statisticsTimer;
+    qint64 m_bytesPushed;
+    int m_allocations;
 };
 
 QT_END_NAMESPACE
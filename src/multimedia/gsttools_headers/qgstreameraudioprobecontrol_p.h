@@ -45,6 +45,7 @@
 #include <gst/gst.h>
 #include <qmediaaudioprobecontrol.h>
 #include <QtCore/qmutex.h>
+#include <QtCore/qqueue.h>
 #include <qaudiobuffer.h>
 
 QT_BEGIN_NAMESPACE
@@ -52,18 +53,32 @@ QT_BEGIN_NAMESPACE
 class QGstreamerAudioProbeControl : public QMediaAudioProbeControl
 {
     Q_OBJECT
+    Q_PROPERTY(bool directDelivery READ directDelivery WRITE setDirectDelivery)
+    Q_PROPERTY(int queueCapacity READ queueCapacity WRITE setQueueCapacity)
+    Q_PROPERTY(qulonglong overflowCount READ overflowCount)
 public:
     explicit QGstreamerAudioProbeControl(QObject *parent);
     virtual ~QGstreamerAudioProbeControl();
 
     void bufferProbed(GstBuffer* buffer);
 
+    bool directDelivery() const;
+    void setDirectDelivery(bool direct);
+
+    int queueCapacity() const;
+    void setQueueCapacity(int capacity);
+
+    qulonglong overflowCount() const;
+
 private slots:
     void bufferProbed();
 
 private:
-    QAudioBuffer m_pendingBuffer;
-    QMutex m_bufferMutex;
+    QQueue<QAudioBuffer> m_pendingBuffers;
+    int m_queueCapacity;
+    bool m_directDelivery;
+    qulonglong m_overflowCount;
+    mutable QMutex m_bufferMutex;
 };
 
 QT_END_NAMESPACE
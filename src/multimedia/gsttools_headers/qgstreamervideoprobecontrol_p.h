@@ -45,6 +45,7 @@
 #include <gst/gst.h>
 #include <qmediavideoprobecontrol.h>
 #include <QtCore/qmutex.h>
+#include <QtCore/qqueue.h>
 #include <qvideoframe.h>
 
 QT_BEGIN_NAMESPACE
@@ -52,6 +53,9 @@ QT_BEGIN_NAMESPACE
 class QGstreamerVideoProbeControl : public QMediaVideoProbeControl
 {
     Q_OBJECT
+    Q_PROPERTY(bool directDelivery READ directDelivery WRITE setDirectDelivery)
+    Q_PROPERTY(int queueCapacity READ queueCapacity WRITE setQueueCapacity)
+    Q_PROPERTY(qulonglong overflowCount READ overflowCount)
 public:
     explicit QGstreamerVideoProbeControl(QObject *parent);
     virtual ~QGstreamerVideoProbeControl();
@@ -60,14 +64,25 @@ public:
     void startFlushing();
     void stopFlushing();
 
+    bool directDelivery() const;
+    void setDirectDelivery(bool direct);
+
+    int queueCapacity() const;
+    void setQueueCapacity(int capacity);
+
+    qulonglong overflowCount() const;
+
 private slots:
     void frameProbed();
 
 private:
     bool m_flushing;
     bool m_frameProbed; // true if at least one frame was probed
-    QVideoFrame m_pendingFrame;
-    QMutex m_frameMutex;
+    QQueue<QVideoFrame> m_pendingFrames;
+    int m_queueCapacity;
+    bool m_directDelivery;
+    qulonglong m_overflowCount;
+    mutable QMutex m_frameMutex;
 };
 
 QT_END_NAMESPACE
@@ -54,29 +54,36 @@
 //
 
 #include <qabstractvideobuffer.h>
+#include <qvideoframe.h>
+#include <QtCore/qsize.h>
 #include <QtCore/qvariant.h>
 
 #include <gst/gst.h>
 
 QT_BEGIN_NAMESPACE
 
-class QGstVideoBuffer : public QAbstractVideoBuffer
+class QGstVideoBuffer : public QAbstractPlanarVideoBuffer
 {
 public:
     QGstVideoBuffer(GstBuffer *buffer, int bytesPerLine);
+    QGstVideoBuffer(GstBuffer *buffer, int bytesPerLine,
+                    const QSize &size, QVideoFrame::PixelFormat pixelFormat);
     QGstVideoBuffer(GstBuffer *buffer, int bytesPerLine,
                     HandleType handleType, const QVariant &handle);
     ~QGstVideoBuffer();
 
     MapMode mapMode() const;
 
-    uchar *map(MapMode mode, int *numBytes, int *bytesPerLine);
+    using QAbstractPlanarVideoBuffer::map;
+    int map(MapMode mode, int *numBytes, int bytesPerLine[4], uchar *data[4]);
     void unmap();
 
     QVariant handle() const { return m_handle; }
 private:
     GstBuffer *m_buffer;
     int m_bytesPerLine;
+    QSize m_size;
+    QVideoFrame::PixelFormat m_pixelFormat;
     MapMode m_mode;
     QVariant m_handle;
 };
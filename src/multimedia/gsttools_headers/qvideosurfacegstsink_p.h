@@ -59,12 +59,14 @@
 #include <QtCore/qmutex.h>
 #include <QtCore/qqueue.h>
 #include <QtCore/qpointer.h>
+#include <QtCore/qscopedpointer.h>
 #include <QtCore/qwaitcondition.h>
 #include <qvideosurfaceformat.h>
 #include <qvideoframe.h>
 #include <qabstractvideobuffer.h>
 
 #include "qgstbufferpoolinterface_p.h"
+#include "qgstsharedmemorybufferpool_p.h"
 
 QT_BEGIN_NAMESPACE
 class QAbstractVideoSurface;
@@ -73,7 +75,19 @@ class QVideoSurfaceGstDelegate : public QObject
 {
     Q_OBJECT
 public:
-    QVideoSurfaceGstDelegate(QAbstractVideoSurface *surface);
+    enum RenderMode
+    {
+        SynchronousRender,
+        AsynchronousRender
+    };
+
+    enum DropPolicy
+    {
+        DropOldestFrame,
+        DropLateFrames
+    };
+
+    QVideoSurfaceGstDelegate(QAbstractVideoSurface *surface, GstElement *sink = 0);
     ~QVideoSurfaceGstDelegate();
 
     QList<QVideoFrame::PixelFormat> supportedPixelFormats(
@@ -91,6 +105,19 @@ public:
     void clearPoolBuffers();
 
     GstFlowReturn render(GstBuffer *buffer);
+    void flush();
+
+    RenderMode renderMode() const;
+    void setRenderMode(RenderMode mode);
+
+    DropPolicy dropPolicy() const;
+    void setDropPolicy(DropPolicy policy);
+
+    int maxQueuedFrames() const;
+    void setMaxQueuedFrames(int count);
+
+    int queuedFrameCount() const;
+    quint64 droppedFrameCount() const;
 
     GstBuffer *lastPrerolledBuffer() const { return m_lastPrerolledBuffer; }
     void setLastPrerolledBuffer(GstBuffer *lastPrerolledBuffer); // set prerolledBuffer to 0 to discard prerolled buffer
@@ -99,16 +126,27 @@ private slots:
     void queuedStart();
     void queuedStop();
     void queuedRender();
+    void queuedPresent();
 
     void updateSupportedFormats();
 
 private:
+    struct QueuedFrame
+    {
+        QVideoFrame frame;
+        GstClockTime deadline;
+    };
+
+    GstFlowReturn enqueueFrame(const QVideoFrame &frame, GstBuffer *buffer);
+    GstClockTime currentRunningTime() const;
+
     QPointer<QAbstractVideoSurface> m_surface;
     QList<QVideoFrame::PixelFormat> m_supportedPixelFormats;
     //pixel formats of buffers pool native type
     QList<QVideoFrame::PixelFormat> m_supportedPoolPixelFormats;
     QGstBufferPoolInterface *m_pool;
     QList<QGstBufferPoolInterface *> m_pools;
+    QScopedPointer<QGstSharedMemoryBufferPool> m_sharedMemoryPool;
     QMutex m_poolMutex;
     QMutex m_mutex;
     QWaitCondition m_setupCondition;
@@ -121,6 +159,19 @@ private:
     int m_bytesPerLine;
     bool m_started;
     bool m_startCanceled;
+
+    // asynchronous render mode, frames are handed to the surface thread
+    // through a bounded queue without blocking the streaming thread
+    GstElement *m_sink;
+    mutable QMutex m_queueMutex;
+    QQueue<QueuedFrame> m_frameQueue;
+    RenderMode m_renderMode;
+    DropPolicy m_dropPolicy;
+    int m_maxQueuedFrames;
+    quint64 m_droppedFrames;
+    bool m_presentPending;
+    // error of a queued present(), returned by the next render()
+    GstFlowReturn m_presentReturn;
 };
 
 class QVideoSurfaceGstSink
@@ -144,6 +195,9 @@ private:
 
     static void finalize(GObject *object);
 
+    static void set_property(GObject *object, guint id, const GValue *value, GParamSpec *pspec);
+    static void get_property(GObject *object, guint id, GValue *value, GParamSpec *pspec);
+
     static GstStateChangeReturn change_state(GstElement *element, GstStateChange transition);
 
     static GstCaps *get_caps(GstBaseSink *sink);
@@ -1,6 +1,8 @@
 TARGET = QtMultimedia
 QT = core-private network gui-private
 
+CONFIG += simd
+
 QMAKE_DOCS = $$PWD/doc/qtmultimedia.qdocconf
 
 load(qt_module)
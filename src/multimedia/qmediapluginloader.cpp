@@ -99,6 +99,19 @@ QList<QObject*> QMediaPluginLoader::instances(QString const &key)
     return objects;
 }
 
+QList<QJsonObject> QMediaPluginLoader::metaData() const
+{
+    return m_pluginMetadata;
+}
+
+QObject* QMediaPluginLoader::instanceAt(int index)
+{
+    if (index < 0 || index >= m_pluginMetadata.size())
+        return 0;
+
+    return m_factoryLoader->instance(index);
+}
+
 void QMediaPluginLoader::loadMetadata()
 {
 #if !defined QT_NO_DEBUG
@@ -122,6 +135,7 @@ void QMediaPluginLoader::loadMetadata()
     for (int i = 0; i < meta.size(); i++) {
         QJsonObject jsonobj = meta.at(i).value(QStringLiteral("MetaData")).toObject();
         jsonobj.insert(QStringLiteral("index"), i);
+        m_pluginMetadata.append(jsonobj);
 #if !defined QT_NO_DEBUG
         if (showDebug)
             qDebug() << "QMediaPluginLoader: Inserted index " << i << " into metadata: " << jsonobj;
@@ -78,12 +78,17 @@ public:
     QObject* instance(QString const &key);
     QList<QObject*> instances(QString const &key);
 
+    // Metadata of every plugin, with its "index" for instanceAt()
+    QList<QJsonObject> metaData() const;
+    QObject* instanceAt(int index);
+
 private:
     void loadMetadata();
 
     QByteArray  m_iid;
     QString     m_location;
     QMap<QString, QList<QJsonObject> > m_metadata;
+    QList<QJsonObject> m_pluginMetadata;
 
     QFactoryLoader *m_factoryLoader;
 };
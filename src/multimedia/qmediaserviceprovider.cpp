@@ -41,6 +41,15 @@
 
 #include <QtCore/qdebug.h>
 #include <QtCore/qmap.h>
+#include <QtCore/qcoreapplication.h>
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qdatetime.h>
+#include <QtCore/qdir.h>
+#include <QtCore/qjsonarray.h>
+#include <QtCore/qjsondocument.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qsavefile.h>
+#include <QtCore/qstandardpaths.h>
 
 #include "qmediaservice.h"
 #include "qmediaserviceprovider_p.h"
@@ -304,73 +313,311 @@ QMediaServiceProviderHint::Features QMediaServiceProviderHint::features() const
 Q_GLOBAL_STATIC_WITH_ARGS(QMediaPluginLoader, loader,
         (QMediaServiceProviderFactoryInterface_iid, QLatin1String("mediaservice"), Qt::CaseInsensitive))
 
+/*
+    Index of what each media service plugin provides, so queries and the
+    choice of a plugin don't need every plugin loaded. The index is built
+    by loading all plugins once and kept in the cache directory until the
+    set of plugin files changes. Only what the plugin files themselves
+    decide is kept; MIME types, hasSupport() answers and device lists depend
+    on what is installed on the system, for example the GStreamer element
+    registry, and are always asked from the plugins.
+*/
+class QMediaServicePluginIndex
+{
+public:
+    enum Interface
+    {
+        SupportedFormatsInterface = 0x1,
+        FeaturesInterface = 0x2,
+        SupportedDevicesInterface = 0x4,
+        DefaultDeviceInterface = 0x8,
+        CameraInfoInterface = 0x10
+    };
+
+    struct Service
+    {
+        Service() : interfaces(0), features(0) {}
+
+        int interfaces;
+        QMediaServiceProviderHint::Features features;
+    };
+
+    struct Plugin
+    {
+        Plugin() : index(-1) {}
+
+        int index;
+        QMap<QString, Service> services;
+    };
+
+    QMediaServicePluginIndex() : m_loaded(false) {}
+
+    QList<Plugin> plugins(const QString &key)
+    {
+        ensureLoaded();
+
+        QList<Plugin> result;
+        foreach (const Plugin &plugin, m_plugins) {
+            if (plugin.services.contains(key))
+                result.append(plugin);
+        }
+        return result;
+    }
+
+private:
+    void ensureLoaded()
+    {
+        QMutexLocker locker(&m_mutex);
+        if (m_loaded)
+            return;
+        m_loaded = true;
+
+        const bool persistent = qgetenv("QT_MULTIMEDIA_NO_PLUGIN_INDEX").isEmpty();
+        const QByteArray fingerprint = pluginFingerprint();
+
+        if (persistent && read(fingerprint))
+            return;
+
+        build();
+
+        if (persistent)
+            write(fingerprint);
+    }
+
+    // Applications that search different plugin paths would keep replacing
+    // each other's index, so each set of paths gets its own file.
+    static QString indexPath()
+    {
+        const QString location = QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation);
+        if (location.isEmpty())
+            return QString();
+
+        const QByteArray paths = QCoreApplication::libraryPaths().join(QLatin1Char('\n')).toUtf8();
+        const QByteArray key = QCryptographicHash::hash(paths, QCryptographicHash::Sha1).toHex().left(16);
+
+        return location + QStringLiteral("/qtmultimedia/mediaservice-plugins-")
+                + QString::fromLatin1(key) + QStringLiteral(".json");
+    }
+
+    // Changes when plugin files or their metadata change
+    static QByteArray pluginFingerprint()
+    {
+        QCryptographicHash hash(QCryptographicHash::Sha1);
+        hash.addData(QT_VERSION_STR);
+
+        foreach (const QString &path, QCoreApplication::libraryPaths()) {
+            const QDir dir(path + QStringLiteral("/mediaservice"));
+            foreach (const QFileInfo &info, dir.entryInfoList(QDir::Files, QDir::Name)) {
+                hash.addData(info.absoluteFilePath().toUtf8());
+                hash.addData(QByteArray::number(info.size()));
+                hash.addData(QByteArray::number(info.lastModified().toMSecsSinceEpoch()));
+            }
+        }
+
+        foreach (const QJsonObject &metaData, loader()->metaData())
+            hash.addData(QJsonDocument(metaData).toJson(QJsonDocument::Compact));
+
+        return hash.result().toHex();
+    }
+
+    static QStringList serviceKeys(const QJsonObject &metaData)
+    {
+        QJsonArray arr = metaData.value(QStringLiteral("Services")).toArray();
+        // Preserve compatibility with older plugins (made before 5.1) in which
+        // services were declared in the 'Keys' property
+        if (arr.isEmpty())
+            arr = metaData.value(QStringLiteral("Keys")).toArray();
+
+        QStringList keys;
+        foreach (const QJsonValue &value, arr)
+            keys.append(value.toString());
+        return keys;
+    }
+
+    void build()
+    {
+        m_plugins.clear();
+
+        foreach (const QJsonObject &metaData, loader()->metaData()) {
+            Plugin plugin;
+            plugin.index = metaData.value(QStringLiteral("index")).toDouble();
+
+            QObject *obj = loader()->instanceAt(plugin.index);
+            if (!qobject_cast<QMediaServiceProviderPlugin*>(obj))
+                continue;
+
+            const QMediaServiceSupportedFormatsInterface *formats =
+                    qobject_cast<QMediaServiceSupportedFormatsInterface*>(obj);
+            const QMediaServiceFeaturesInterface *features =
+                    qobject_cast<QMediaServiceFeaturesInterface*>(obj);
+
+            foreach (const QString &key, serviceKeys(metaData)) {
+                Service service;
+                if (formats)
+                    service.interfaces |= SupportedFormatsInterface;
+                if (features) {
+                    service.interfaces |= FeaturesInterface;
+                    service.features = features->supportedFeatures(key.toLatin1());
+                }
+                if (qobject_cast<QMediaServiceSupportedDevicesInterface*>(obj))
+                    service.interfaces |= SupportedDevicesInterface;
+                if (qobject_cast<QMediaServiceDefaultDeviceInterface*>(obj))
+                    service.interfaces |= DefaultDeviceInterface;
+                if (qobject_cast<QMediaServiceCameraInfoInterface*>(obj))
+                    service.interfaces |= CameraInfoInterface;
+
+                plugin.services.insert(key, service);
+            }
+
+            m_plugins.append(plugin);
+        }
+    }
+
+    bool read(const QByteArray &fingerprint)
+    {
+        QFile file(indexPath());
+        if (file.fileName().isEmpty() || !file.open(QIODevice::ReadOnly))
+            return false;
+
+        const QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+        if (root.value(QStringLiteral("fingerprint")).toString().toLatin1() != fingerprint)
+            return false;
+
+        QList<Plugin> plugins;
+        foreach (const QJsonValue &pluginValue, root.value(QStringLiteral("plugins")).toArray()) {
+            const QJsonObject pluginObject = pluginValue.toObject();
+
+            Plugin plugin;
+            plugin.index = pluginObject.value(QStringLiteral("index")).toDouble();
+
+            const QJsonObject services = pluginObject.value(QStringLiteral("services")).toObject();
+            for (QJsonObject::const_iterator it = services.constBegin(); it != services.constEnd(); ++it) {
+                const QJsonObject serviceObject = it.value().toObject();
+                Service service;
+                service.interfaces = serviceObject.value(QStringLiteral("interfaces")).toDouble();
+                service.features = QMediaServiceProviderHint::Features(
+                            int(serviceObject.value(QStringLiteral("features")).toDouble()));
+                plugin.services.insert(it.key(), service);
+            }
+
+            plugins.append(plugin);
+        }
+
+        m_plugins = plugins;
+        return true;
+    }
+
+    void write(const QByteArray &fingerprint) const
+    {
+        const QString path = indexPath();
+        if (path.isEmpty() || !QDir().mkpath(QFileInfo(path).absolutePath()))
+            return;
+
+        QJsonArray plugins;
+        foreach (const Plugin &plugin, m_plugins) {
+            QJsonObject services;
+            for (QMap<QString, Service>::const_iterator it = plugin.services.constBegin();
+                 it != plugin.services.constEnd(); ++it) {
+                QJsonObject service;
+                service.insert(QStringLiteral("interfaces"), it.value().interfaces);
+                service.insert(QStringLiteral("features"), int(it.value().features));
+                services.insert(it.key(), service);
+            }
+
+            QJsonObject pluginObject;
+            pluginObject.insert(QStringLiteral("index"), plugin.index);
+            pluginObject.insert(QStringLiteral("services"), services);
+            plugins.append(pluginObject);
+        }
+
+        QJsonObject root;
+        root.insert(QStringLiteral("fingerprint"), QString::fromLatin1(fingerprint));
+        root.insert(QStringLiteral("plugins"), plugins);
+
+        QSaveFile file(path);
+        if (file.open(QIODevice::WriteOnly)) {
+            file.write(QJsonDocument(root).toJson());
+            if (!file.commit())
+                qWarning() << "QMediaServiceProvider: failed to write plugin index" << path;
+        }
+    }
+
+    QMutex m_mutex;
+    bool m_loaded;
+    QList<Plugin> m_plugins;
+};
+
+Q_GLOBAL_STATIC(QMediaServicePluginIndex, pluginIndex)
+
+typedef QMediaServicePluginIndex::Plugin QMediaServicePluginIndexEntry;
 
 class QPluginServiceProvider : public QMediaServiceProvider
 {
     QMap<QMediaService*, QMediaServiceProviderPlugin*> pluginMap;
 
+    static bool provides(const QMediaServicePluginIndexEntry &entry, const QString &key, int interfaces)
+    {
+        return (entry.services.value(key).interfaces & interfaces) == interfaces;
+    }
+
+    static QMediaServiceProviderHint::Features features(const QMediaServicePluginIndexEntry &entry,
+                                                        const QString &key)
+    {
+        return entry.services.value(key).features;
+    }
+
+    static QObject *instance(const QMediaServicePluginIndexEntry &entry)
+    {
+        return loader()->instanceAt(entry.index);
+    }
+
 public:
     QMediaService* requestService(const QByteArray &type, const QMediaServiceProviderHint &hint)
     {
         QString key(QLatin1String(type.constData()));
 
-        QList<QMediaServiceProviderPlugin *>plugins;
-        foreach (QObject *obj, loader()->instances(key)) {
-            QMediaServiceProviderPlugin *plugin =
-                qobject_cast<QMediaServiceProviderPlugin*>(obj);
-            if (plugin)
-                plugins << plugin;
-        }
+        const QList<QMediaServicePluginIndexEntry> plugins = pluginIndex()->plugins(key);
 
         if (!plugins.isEmpty()) {
-            QMediaServiceProviderPlugin *plugin = 0;
+            int selected = -1;
 
             switch (hint.type()) {
             case QMediaServiceProviderHint::Null:
-                plugin = plugins[0];
+                selected = 0;
                 //special case for media player, if low latency was not asked,
                 //prefer services not offering it, since they are likely to support
                 //more formats
                 if (type == QByteArray(Q_MEDIASERVICE_MEDIAPLAYER)) {
-                    foreach (QMediaServiceProviderPlugin *currentPlugin, plugins) {
-                        QMediaServiceFeaturesInterface *iface =
-                                qobject_cast<QMediaServiceFeaturesInterface*>(currentPlugin);
-
-                        if (!iface || !(iface->supportedFeatures(type) &
-                                        QMediaServiceProviderHint::LowLatencyPlayback)) {
-                            plugin = currentPlugin;
+                    for (int i = 0; i < plugins.size(); ++i) {
+                        if (!provides(plugins.at(i), key, QMediaServicePluginIndex::FeaturesInterface)
+                                || !(features(plugins.at(i), key) & QMediaServiceProviderHint::LowLatencyPlayback)) {
+                            selected = i;
                             break;
                         }
-
                     }
                 }
                 break;
             case QMediaServiceProviderHint::SupportedFeatures:
-                plugin = plugins[0];
-                foreach (QMediaServiceProviderPlugin *currentPlugin, plugins) {
-                    QMediaServiceFeaturesInterface *iface =
-                            qobject_cast<QMediaServiceFeaturesInterface*>(currentPlugin);
-
-                    if (iface) {
-                        if ((iface->supportedFeatures(type) & hint.features()) == hint.features()) {
-                            plugin = currentPlugin;
-                            break;
-                        }
+                selected = 0;
+                for (int i = 0; i < plugins.size(); ++i) {
+                    if (provides(plugins.at(i), key, QMediaServicePluginIndex::FeaturesInterface)
+                            && (features(plugins.at(i), key) & hint.features()) == hint.features()) {
+                        selected = i;
+                        break;
                     }
                 }
                 break;
             case QMediaServiceProviderHint::Device: {
-                    foreach (QMediaServiceProviderPlugin *currentPlugin, plugins) {
-                        QMediaServiceSupportedDevicesInterface *iface =
-                                qobject_cast<QMediaServiceSupportedDevicesInterface*>(currentPlugin);
-
-                        if (!iface) {
+                    for (int i = 0; i < plugins.size(); ++i) {
+                        if (!provides(plugins.at(i), key, QMediaServicePluginIndex::SupportedDevicesInterface)) {
                             // the plugin may support the device,
                             // but this choice still can be overridden
-                            plugin = currentPlugin;
+                            selected = i;
                         } else {
-                            if (iface->devices(type).contains(hint.device())) {
-                                plugin = currentPlugin;
+                            QMediaServiceSupportedDevicesInterface *iface =
+                                    qobject_cast<QMediaServiceSupportedDevicesInterface*>(instance(plugins.at(i)));
+                            if (iface && iface->devices(type).contains(hint.device())) {
+                                selected = i;
                                 break;
                             }
                         }
@@ -378,20 +625,26 @@ public:
                 }
                 break;
             case QMediaServiceProviderHint::CameraPosition: {
-                    plugin = plugins[0];
+                    selected = 0;
                     if (type == QByteArray(Q_MEDIASERVICE_CAMERA)
                             && hint.cameraPosition() != QCamera::UnspecifiedPosition) {
-                        foreach (QMediaServiceProviderPlugin *currentPlugin, plugins) {
+                        const int interfaces = QMediaServicePluginIndex::SupportedDevicesInterface
+                                | QMediaServicePluginIndex::CameraInfoInterface;
+                        for (int i = 0; i < plugins.size(); ++i) {
+                            if (!provides(plugins.at(i), key, interfaces))
+                                continue;
+
+                            QObject *obj = instance(plugins.at(i));
                             const QMediaServiceSupportedDevicesInterface *deviceIface =
-                                    qobject_cast<QMediaServiceSupportedDevicesInterface*>(currentPlugin);
+                                    qobject_cast<QMediaServiceSupportedDevicesInterface*>(obj);
                             const QMediaServiceCameraInfoInterface *cameraIface =
-                                    qobject_cast<QMediaServiceCameraInfoInterface*>(currentPlugin);
+                                    qobject_cast<QMediaServiceCameraInfoInterface*>(obj);
 
                             if (deviceIface && cameraIface) {
                                 const QList<QByteArray> cameras = deviceIface->devices(type);
                                 foreach (const QByteArray &camera, cameras) {
                                     if (cameraIface->cameraPosition(camera) == hint.cameraPosition()) {
-                                        plugin = currentPlugin;
+                                        selected = i;
                                         break;
                                     }
                                 }
@@ -402,17 +655,19 @@ public:
                 break;
             case QMediaServiceProviderHint::ContentType: {
                     QMultimedia::SupportEstimate estimate = QMultimedia::NotSupported;
-                    foreach (QMediaServiceProviderPlugin *currentPlugin, plugins) {
+                    for (int i = 0; i < plugins.size(); ++i) {
                         QMultimedia::SupportEstimate currentEstimate = QMultimedia::MaybeSupported;
-                        QMediaServiceSupportedFormatsInterface *iface =
-                                qobject_cast<QMediaServiceSupportedFormatsInterface*>(currentPlugin);
 
-                        if (iface)
-                            currentEstimate = iface->hasSupport(hint.mimeType(), hint.codecs());
+                        if (provides(plugins.at(i), key, QMediaServicePluginIndex::SupportedFormatsInterface)) {
+                            QMediaServiceSupportedFormatsInterface *iface =
+                                    qobject_cast<QMediaServiceSupportedFormatsInterface*>(instance(plugins.at(i)));
+                            if (iface)
+                                currentEstimate = iface->hasSupport(hint.mimeType(), hint.codecs());
+                        }
 
                         if (currentEstimate > estimate) {
                             estimate = currentEstimate;
-                            plugin = currentPlugin;
+                            selected = i;
 
                             if (currentEstimate == QMultimedia::PreferredService)
                                 break;
@@ -422,6 +677,10 @@ public:
                 break;
             }
 
+            QMediaServiceProviderPlugin *plugin = selected >= 0
+                    ? qobject_cast<QMediaServiceProviderPlugin*>(instance(plugins.at(selected)))
+                    : 0;
+
             if (plugin != 0) {
                 QMediaService *service = plugin->create(key);
                 if (service != 0)
@@ -450,43 +709,39 @@ public:
                                      const QStringList& codecs,
                                      int flags) const
     {
-        QList<QObject*> instances = loader()->instances(QLatin1String(serviceType));
+        const QString key = QLatin1String(serviceType);
+        const QList<QMediaServicePluginIndexEntry> plugins = pluginIndex()->plugins(key);
 
-        if (instances.isEmpty())
+        if (plugins.isEmpty())
             return QMultimedia::NotSupported;
 
         bool allServicesProvideInterface = true;
         QMultimedia::SupportEstimate supportEstimate = QMultimedia::NotSupported;
 
-        foreach(QObject *obj, instances) {
-            QMediaServiceSupportedFormatsInterface *iface =
-                    qobject_cast<QMediaServiceSupportedFormatsInterface*>(obj);
-
-
-            if (flags) {
-                QMediaServiceFeaturesInterface *iface =
-                        qobject_cast<QMediaServiceFeaturesInterface*>(obj);
-
-                if (iface) {
-                    QMediaServiceProviderHint::Features features = iface->supportedFeatures(serviceType);
+        foreach (const QMediaServicePluginIndexEntry &entry, plugins) {
+            if (flags && provides(entry, key, QMediaServicePluginIndex::FeaturesInterface)) {
+                const QMediaServiceProviderHint::Features features = entry.services.value(key).features;
 
-                    //if low latency playback was asked, skip services known
-                    //not to provide low latency playback
-                    if ((flags & QMediaPlayer::LowLatency) &&
-                        !(features & QMediaServiceProviderHint::LowLatencyPlayback))
-                            continue;
+                //if low latency playback was asked, skip services known
+                //not to provide low latency playback
+                if ((flags & QMediaPlayer::LowLatency) &&
+                    !(features & QMediaServiceProviderHint::LowLatencyPlayback))
+                        continue;
 
-                    //the same for QIODevice based streams support
-                    if ((flags & QMediaPlayer::StreamPlayback) &&
-                        !(features & QMediaServiceProviderHint::StreamPlayback))
-                            continue;
-                }
+                //the same for QIODevice based streams support
+                if ((flags & QMediaPlayer::StreamPlayback) &&
+                    !(features & QMediaServiceProviderHint::StreamPlayback))
+                        continue;
             }
 
-            if (iface)
-                supportEstimate = qMax(supportEstimate, iface->hasSupport(mimeType, codecs));
-            else
+            if (provides(entry, key, QMediaServicePluginIndex::SupportedFormatsInterface)) {
+                QMediaServiceSupportedFormatsInterface *iface =
+                        qobject_cast<QMediaServiceSupportedFormatsInterface*>(instance(entry));
+                if (iface)
+                    supportEstimate = qMax(supportEstimate, iface->hasSupport(mimeType, codecs));
+            } else {
                 allServicesProvideInterface = false;
+            }
         }
 
         //don't return PreferredService
@@ -500,44 +755,39 @@ public:
         return supportEstimate;
     }
 
+    // Only loads the plugins that can be asked
     QStringList supportedMimeTypes(const QByteArray &serviceType, int flags) const
     {
-        QList<QObject*> instances = loader()->instances(QLatin1String(serviceType));
+        const QString key = QLatin1String(serviceType);
 
         QStringList supportedTypes;
 
-        foreach(QObject *obj, instances) {
-            QMediaServiceSupportedFormatsInterface *iface =
-                    qobject_cast<QMediaServiceSupportedFormatsInterface*>(obj);
-
+        foreach (const QMediaServicePluginIndexEntry &entry, pluginIndex()->plugins(key)) {
+            if (flags && provides(entry, key, QMediaServicePluginIndex::FeaturesInterface)) {
+                const QMediaServiceProviderHint::Features features = entry.services.value(key).features;
 
-            if (flags) {
-                QMediaServiceFeaturesInterface *iface =
-                        qobject_cast<QMediaServiceFeaturesInterface*>(obj);
-
-                if (iface) {
-                    QMediaServiceProviderHint::Features features = iface->supportedFeatures(serviceType);
+                // If low latency playback was asked for, skip MIME types from services known
+                // not to provide low latency playback
+                if ((flags & QMediaPlayer::LowLatency) &&
+                    !(features & QMediaServiceProviderHint::LowLatencyPlayback))
+                    continue;
 
-                    // If low latency playback was asked for, skip MIME types from services known
-                    // not to provide low latency playback
-                    if ((flags & QMediaPlayer::LowLatency) &&
-                        !(features & QMediaServiceProviderHint::LowLatencyPlayback))
+                //the same for QIODevice based streams support
+                if ((flags & QMediaPlayer::StreamPlayback) &&
+                    !(features & QMediaServiceProviderHint::StreamPlayback))
                         continue;
 
-                    //the same for QIODevice based streams support
-                    if ((flags & QMediaPlayer::StreamPlayback) &&
-                        !(features & QMediaServiceProviderHint::StreamPlayback))
-                            continue;
-
-                    //the same for QAbstractVideoSurface support
-                    if ((flags & QMediaPlayer::VideoSurface) &&
-                        !(features & QMediaServiceProviderHint::VideoSurface))
-                            continue;
-                }
+                //the same for QAbstractVideoSurface support
+                if ((flags & QMediaPlayer::VideoSurface) &&
+                    !(features & QMediaServiceProviderHint::VideoSurface))
+                        continue;
             }
 
-            if (iface) {
-                supportedTypes << iface->supportedMimeTypes();
+            if (provides(entry, key, QMediaServicePluginIndex::SupportedFormatsInterface)) {
+                QMediaServiceSupportedFormatsInterface *iface =
+                        qobject_cast<QMediaServiceSupportedFormatsInterface*>(instance(entry));
+                if (iface)
+                    supportedTypes << iface->supportedMimeTypes();
             }
         }
 
@@ -549,9 +799,13 @@ public:
 
     QByteArray defaultDevice(const QByteArray &serviceType) const
     {
-        foreach (QObject *obj, loader()->instances(QLatin1String(serviceType))) {
+        const QString key = QLatin1String(serviceType);
+        foreach (const QMediaServicePluginIndexEntry &entry, pluginIndex()->plugins(key)) {
+            if (!provides(entry, key, QMediaServicePluginIndex::DefaultDeviceInterface))
+                continue;
+
             const QMediaServiceDefaultDeviceInterface *iface =
-                    qobject_cast<QMediaServiceDefaultDeviceInterface*>(obj);
+                    qobject_cast<QMediaServiceDefaultDeviceInterface*>(instance(entry));
 
             if (iface)
                 return iface->defaultDevice(serviceType);
@@ -568,11 +822,15 @@ public:
 
     QList<QByteArray> devices(const QByteArray &serviceType) const
     {
+        const QString key = QLatin1String(serviceType);
         QList<QByteArray> res;
 
-        foreach (QObject *obj, loader()->instances(QLatin1String(serviceType))) {
+        foreach (const QMediaServicePluginIndexEntry &entry, pluginIndex()->plugins(key)) {
+            if (!provides(entry, key, QMediaServicePluginIndex::SupportedDevicesInterface))
+                continue;
+
             QMediaServiceSupportedDevicesInterface *iface =
-                    qobject_cast<QMediaServiceSupportedDevicesInterface*>(obj);
+                    qobject_cast<QMediaServiceSupportedDevicesInterface*>(instance(entry));
 
             if (iface) {
                 res.append(iface->devices(serviceType));
@@ -584,9 +842,13 @@ public:
 
     QString deviceDescription(const QByteArray &serviceType, const QByteArray &device)
     {
-        foreach (QObject *obj, loader()->instances(QLatin1String(serviceType))) {
+        const QString key = QLatin1String(serviceType);
+        foreach (const QMediaServicePluginIndexEntry &entry, pluginIndex()->plugins(key)) {
+            if (!provides(entry, key, QMediaServicePluginIndex::SupportedDevicesInterface))
+                continue;
+
             QMediaServiceSupportedDevicesInterface *iface =
-                    qobject_cast<QMediaServiceSupportedDevicesInterface*>(obj);
+                    qobject_cast<QMediaServiceSupportedDevicesInterface*>(instance(entry));
 
             if (iface) {
                 if (iface->devices(serviceType).contains(device))
@@ -600,7 +862,12 @@ public:
     QCamera::Position cameraPosition(const QByteArray &device) const
     {
         const QByteArray serviceType(Q_MEDIASERVICE_CAMERA);
-        foreach (QObject *obj, loader()->instances(QString::fromLatin1(serviceType))) {
+        const QString key = QString::fromLatin1(serviceType);
+        foreach (const QMediaServicePluginIndexEntry &entry, pluginIndex()->plugins(key)) {
+            if (!provides(entry, key, QMediaServicePluginIndex::CameraInfoInterface))
+                continue;
+
+            QObject *obj = instance(entry);
             const QMediaServiceSupportedDevicesInterface *deviceIface =
                     qobject_cast<QMediaServiceSupportedDevicesInterface*>(obj);
             const QMediaServiceCameraInfoInterface *cameraIface =
@@ -619,7 +886,12 @@ public:
     int cameraOrientation(const QByteArray &device) const
     {
         const QByteArray serviceType(Q_MEDIASERVICE_CAMERA);
-        foreach (QObject *obj, loader()->instances(QString::fromLatin1(serviceType))) {
+        const QString key = QString::fromLatin1(serviceType);
+        foreach (const QMediaServicePluginIndexEntry &entry, pluginIndex()->plugins(key)) {
+            if (!provides(entry, key, QMediaServicePluginIndex::CameraInfoInterface))
+                continue;
+
+            QObject *obj = instance(entry);
             const QMediaServiceSupportedDevicesInterface *deviceIface =
                     qobject_cast<QMediaServiceSupportedDevicesInterface*>(obj);
             const QMediaServiceCameraInfoInterface *cameraIface =
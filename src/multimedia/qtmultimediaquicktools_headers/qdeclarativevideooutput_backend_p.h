@@ -55,6 +55,21 @@ class QAbstractVideoSurface;
 class QDeclarativeVideoOutput;
 class QMediaService;
 
+struct QDeclarativeVideoFrameStatistics
+{
+    QDeclarativeVideoFrameStatistics()
+        : presented(0)
+        , dropped(0)
+        , repeated(0)
+        , averageLateness(0)
+    {}
+
+    int presented;
+    int dropped;
+    int repeated;
+    qreal averageLateness; // in milliseconds
+};
+
 class Q_MULTIMEDIAQUICK_EXPORT QDeclarativeVideoBackend
 {
 public:
@@ -78,6 +93,12 @@ public:
     // The viewport, adjusted for the pixel aspect ratio
     virtual QRectF adjustedViewport() const = 0;
 
+    // Presentation scheduling of frames by their start time, only
+    // meaningful for backends rendering the frames themselves
+    virtual void setFramePacing(bool enabled) { Q_UNUSED(enabled); }
+    virtual QDeclarativeVideoFrameStatistics frameStatistics() const
+    { return QDeclarativeVideoFrameStatistics(); }
+
 protected:
     QDeclarativeVideoOutput *q;
     QPointer<QMediaService> m_service;
@@ -68,6 +68,11 @@ class Q_MULTIMEDIAQUICK_EXPORT QDeclarativeVideoOutput : public QQuickItem
     Q_PROPERTY(bool autoOrientation READ autoOrientation WRITE setAutoOrientation NOTIFY autoOrientationChanged REVISION 2)
     Q_PROPERTY(QRectF sourceRect READ sourceRect NOTIFY sourceRectChanged)
     Q_PROPERTY(QRectF contentRect READ contentRect NOTIFY contentRectChanged)
+    Q_PROPERTY(bool framePacing READ framePacing WRITE setFramePacing NOTIFY framePacingChanged REVISION 3)
+    Q_PROPERTY(int framesPresented READ framesPresented NOTIFY frameStatisticsChanged REVISION 3)
+    Q_PROPERTY(int framesDropped READ framesDropped NOTIFY frameStatisticsChanged REVISION 3)
+    Q_PROPERTY(int framesRepeated READ framesRepeated NOTIFY frameStatisticsChanged REVISION 3)
+    Q_PROPERTY(qreal averageLateness READ averageLateness NOTIFY frameStatisticsChanged REVISION 3)
     Q_ENUMS(FillMode)
 
 public:
@@ -96,6 +101,14 @@ public:
     QRectF sourceRect() const;
     QRectF contentRect() const;
 
+    bool framePacing() const;
+    void setFramePacing(bool enabled);
+
+    int framesPresented() const;
+    int framesDropped() const;
+    int framesRepeated() const;
+    qreal averageLateness() const;
+
     Q_INVOKABLE QPointF mapPointToItem(const QPointF &point) const;
     Q_INVOKABLE QRectF mapRectToItem(const QRectF &rectangle) const;
     Q_INVOKABLE QPointF mapNormalizedPointToItem(const QPointF &point) const;
@@ -119,6 +132,8 @@ Q_SIGNALS:
     void autoOrientationChanged();
     void sourceRectChanged();
     void contentRectChanged();
+    Q_REVISION(3) void framePacingChanged();
+    Q_REVISION(3) void frameStatisticsChanged();
 
 protected:
     QSGNode *updatePaintNode(QSGNode *, UpdatePaintNodeData *);
@@ -150,6 +165,7 @@ private:
     int m_orientation;
     bool m_autoOrientation;
     QVideoOutputOrientationHandler *m_screenOrientationHandler;
+    bool m_framePacing;
 
     QScopedPointer<QDeclarativeVideoBackend> m_backend;
 };
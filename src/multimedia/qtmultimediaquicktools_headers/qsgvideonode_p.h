@@ -61,6 +61,10 @@ public:
     virtual void setCurrentFrame(const QVideoFrame &frame) = 0;
     virtual QVideoFrame::PixelFormat pixelFormat() const = 0;
 
+    // Render thread time spent uploading the last frame in nanoseconds,
+    // or -1 if the node doesn't track it
+    virtual qint64 lastUploadTime() const { return -1; }
+
     void setTexturedRectGeometry(const QRectF &boundingRect, const QRectF &textureRect, int orientation);
 
 private:
@@ -97,6 +97,9 @@ namespace
     \value XvShmImageHandle The handle contains pointer to shared memory XVideo image.
     \value CoreImageHandle The handle contains pointer to Mac OS X CIImage.
     \value QPixmapHandle The handle of the buffer is a QPixmap.
+    \value SharedMemoryHandle The handle of the buffer is the file descriptor, as an int,
+    of shared memory or a dma-buf holding the frame data. The data can also be accessed by
+    mapping the buffer. This value was introduced in Qt 5.3.
     \value UserHandle Start value for user defined handle types.
 
     \sa handleType()
@@ -134,6 +137,7 @@ QAbstractVideoBuffer::QAbstractVideoBuffer(QAbstractVideoBufferPrivate &dd, Hand
     : d_ptr(&dd)
     , m_type(type)
 {
+    d_ptr->q_ptr = this;
 }
 
 /*!
@@ -203,6 +207,125 @@ QAbstractVideoBuffer::HandleType QAbstractVideoBuffer::handleType() const
     \sa unmap(), mapMode()
 */
 
+/*!
+    \since 5.3
+
+    Maps the planes of a video buffer to memory.
+
+    Returns the number of planes mapped, or 0 if the mapping failed.
+    The pointer to each plane is returned in \a data and its line stride in
+    \a bytesPerLine, both arrays must have room for four entries. The total
+    size in bytes of the mapped memory is returned in \a numBytes.
+
+    The planes of a video buffer don't need to be contiguous in memory.
+    Buffers that aren't derived from QAbstractPlanarVideoBuffer return a
+    single plane, the same as map() does, and QVideoFrame calculates the
+    other planes from the frame's pixel format.
+
+    The map \a mode is the same as for map(), and the memory is released
+    with unmap().
+
+    \sa map(), unmap(), QAbstractPlanarVideoBuffer
+*/
+int QAbstractVideoBuffer::mapPlanes(MapMode mode, int *numBytes, int bytesPerLine[4], uchar *data[4])
+{
+    if (d_ptr)
+        return d_ptr->map(mode, numBytes, bytesPerLine, data);
+
+    data[0] = map(mode, numBytes, bytesPerLine);
+    return data[0] ? 1 : 0;
+}
+
+int QAbstractVideoBufferPrivate::map(QAbstractVideoBuffer::MapMode mode,
+                                     int *numBytes,
+                                     int bytesPerLine[4],
+                                     uchar *data[4])
+{
+    data[0] = q_ptr->map(mode, numBytes, bytesPerLine);
+    return data[0] ? 1 : 0;
+}
+
+int QAbstractPlanarVideoBufferPrivate::map(QAbstractVideoBuffer::MapMode mode,
+                                           int *numBytes,
+                                           int bytesPerLine[4],
+                                           uchar *data[4])
+{
+    return q_func()->map(mode, numBytes, bytesPerLine, data);
+}
+
+/*!
+    \class QAbstractPlanarVideoBuffer
+    \brief The QAbstractPlanarVideoBuffer class is an abstraction for planar video data.
+    \inmodule QtMultimedia
+    \ingroup multimedia
+    \ingroup multimedia_video
+    \since 5.3
+
+    QAbstractPlanarVideoBuffer extends QAbstractVideoBuffer to support mapping
+    buffers whose planes are not stored in one contiguous block of memory, or
+    are padded differently than the pixel format implies. Each plane is
+    mapped with its own pointer and line stride, so such buffers can be
+    wrapped in a QVideoFrame without copying the planes into a single block.
+
+    \sa QAbstractVideoBuffer::mapPlanes()
+*/
+
+/*!
+    Constructs an abstract planar video buffer of the given \a type.
+*/
+QAbstractPlanarVideoBuffer::QAbstractPlanarVideoBuffer(HandleType type)
+    : QAbstractVideoBuffer(*new QAbstractPlanarVideoBufferPrivate, type)
+{
+}
+
+/*!
+    \internal
+*/
+QAbstractPlanarVideoBuffer::QAbstractPlanarVideoBuffer(QAbstractVideoBufferPrivate &dd, HandleType type)
+    : QAbstractVideoBuffer(dd, type)
+{
+}
+
+/*!
+    Destroys an abstract planar video buffer.
+*/
+QAbstractPlanarVideoBuffer::~QAbstractPlanarVideoBuffer()
+{
+}
+
+/*!
+    \reimp
+
+    Maps all the planes and returns the first one.
+*/
+uchar *QAbstractPlanarVideoBuffer::map(MapMode mode, int *numBytes, int *bytesPerLine)
+{
+    uchar *data[4];
+    int strides[4];
+    if (map(mode, numBytes, strides, data) <= 0)
+        return 0;
+
+    if (bytesPerLine)
+        *bytesPerLine = strides[0];
+    return data[0];
+}
+
+/*!
+    \fn int QAbstractPlanarVideoBuffer::map(MapMode mode, int *numBytes, int bytesPerLine[4], uchar *data[4])
+
+    Maps the planes of a video buffer to memory.
+
+    Returns the number of planes mapped, or 0 if the mapping failed. The
+    pointer to each plane is returned in \a data, its line stride in
+    \a bytesPerLine and the total size in bytes of the mapped memory in
+    \a numBytes.
+
+    The map \a mode and the release of the memory with unmap() are the same
+    as for QAbstractVideoBuffer::map().
+
+    \sa QAbstractVideoBuffer::mapPlanes()
+*/
+
 /*!
     \fn QAbstractVideoBuffer::unmap()
 
@@ -240,6 +363,8 @@ QDebug operator<<(QDebug dbg, QAbstractVideoBuffer::HandleType type)
         return dbg.nospace() << "CoreImageHandle";
     case QAbstractVideoBuffer::QPixmapHandle:
         return dbg.nospace() << "QPixmapHandle";
+    case QAbstractVideoBuffer::SharedMemoryHandle:
+        return dbg.nospace() << "SharedMemoryHandle";
     default:
         return dbg.nospace() << QString(QLatin1String("UserHandle(%1)")).arg(int(type)).toLatin1().constData();
     }
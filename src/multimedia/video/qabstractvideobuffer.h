@@ -65,6 +65,7 @@ public:
         XvShmImageHandle,
         CoreImageHandle,
         QPixmapHandle,
+        SharedMemoryHandle,
         UserHandle = 1000
     };
 
@@ -85,6 +86,7 @@ public:
     virtual MapMode mapMode() const = 0;
 
     virtual uchar *map(MapMode mode, int *numBytes, int *bytesPerLine) = 0;
+    int mapPlanes(MapMode mode, int *numBytes, int bytesPerLine[4], uchar *data[4]);
     virtual void unmap() = 0;
 
     virtual QVariant handle() const;
@@ -100,6 +102,24 @@ private:
     Q_DISABLE_COPY(QAbstractVideoBuffer)
 };
 
+class QAbstractPlanarVideoBufferPrivate;
+
+class Q_MULTIMEDIA_EXPORT QAbstractPlanarVideoBuffer : public QAbstractVideoBuffer
+{
+public:
+    QAbstractPlanarVideoBuffer(HandleType type);
+    virtual ~QAbstractPlanarVideoBuffer();
+
+    uchar *map(MapMode mode, int *numBytes, int *bytesPerLine);
+    virtual int map(MapMode mode, int *numBytes, int bytesPerLine[4], uchar *data[4]) = 0;
+
+protected:
+    QAbstractPlanarVideoBuffer(QAbstractVideoBufferPrivate &dd, HandleType type);
+
+private:
+    Q_DISABLE_COPY(QAbstractPlanarVideoBuffer)
+};
+
 #ifndef QT_NO_DEBUG_STREAM
 Q_MULTIMEDIA_EXPORT QDebug operator<<(QDebug, QAbstractVideoBuffer::HandleType);
 Q_MULTIMEDIA_EXPORT QDebug operator<<(QDebug, QAbstractVideoBuffer::MapMode);
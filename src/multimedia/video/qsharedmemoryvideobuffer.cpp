@@ -0,0 +1,245 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qsharedmemoryvideobuffer_p.h"
+
+#include "qabstractvideobuffer_p.h"
+#include <qvariant.h>
+#include <QDebug>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+QT_BEGIN_NAMESPACE
+
+class QSharedMemoryVideoBufferPrivate : public QAbstractVideoBufferPrivate
+{
+public:
+    QSharedMemoryVideoBufferPrivate()
+        : fd(-1)
+        , size(0)
+        , offset(0)
+        , bytesPerLine(0)
+        , mapping(0)
+        , mappingSize(0)
+        , writable(false)
+        , mapMode(QAbstractVideoBuffer::NotMapped)
+    {
+    }
+
+    int fd;
+    int size;
+    int offset;
+    int bytesPerLine;
+    void *mapping;
+    size_t mappingSize;
+    bool writable;
+    QAbstractVideoBuffer::MapMode mapMode;
+};
+
+/*!
+    \class QSharedMemoryVideoBuffer
+    \brief The QSharedMemoryVideoBuffer class provides a video buffer in shared memory.
+    \internal
+
+    QSharedMemoryVideoBuffer wraps a file descriptor of shared memory, for example
+    from memfd_create(), shm_open() or a dma-buf exporter, so frames can be passed between
+    threads and processes without copying the frame data. The handle() of the buffer is the
+    file descriptor, and the memory is mapped on the first call to map() and stays mapped
+    until the buffer is destroyed.
+*/
+
+/*!
+    Constructs a video buffer with an image stride of \a bytesPerLine for \a size bytes of
+    memory at \a offset in the shared memory file descriptor \a fd.
+
+    The file descriptor is duplicated, the caller keeps ownership of \a fd.
+*/
+QSharedMemoryVideoBuffer::QSharedMemoryVideoBuffer(int fd, int size, int bytesPerLine, int offset)
+    : QAbstractVideoBuffer(*new QSharedMemoryVideoBufferPrivate, SharedMemoryHandle)
+{
+    Q_D(QSharedMemoryVideoBuffer);
+
+    if (fd >= 0) {
+        d->fd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (d->fd < 0)
+            qWarning("QSharedMemoryVideoBuffer: failed to duplicate file descriptor: %s", strerror(errno));
+    }
+
+    d->size = size;
+    d->offset = offset;
+    d->bytesPerLine = bytesPerLine;
+}
+
+/*!
+    Destroys a shared memory video buffer.
+*/
+QSharedMemoryVideoBuffer::~QSharedMemoryVideoBuffer()
+{
+    Q_D(QSharedMemoryVideoBuffer);
+
+    if (d->mapping)
+        ::munmap(d->mapping, d->mappingSize);
+    if (d->fd >= 0)
+        ::close(d->fd);
+}
+
+/*!
+    Creates an anonymous shared memory object of \a size bytes.
+
+    Returns the file descriptor of the memory, which the caller owns, or -1 if the memory
+    couldn't be created.
+*/
+int QSharedMemoryVideoBuffer::createFileDescriptor(int size)
+{
+    if (size <= 0)
+        return -1;
+
+    int fd = -1;
+
+#if defined(SYS_memfd_create)
+    // MFD_CLOEXEC, the C library may not have the header for it yet.
+    fd = ::syscall(SYS_memfd_create, "qt-video-frame", 0x0001U);
+#endif
+
+    if (fd < 0) {
+        // No memfd, use a POSIX shared memory object that is unlinked right away.
+        const QByteArray name = QByteArray("/qt-video-frame-")
+                + QByteArray::number(::getpid()) + '-'
+                + QByteArray::number(quintptr(&fd), 16);
+
+        fd = ::shm_open(name.constData(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+        if (fd >= 0) {
+            ::shm_unlink(name.constData());
+            ::fcntl(fd, F_SETFD, FD_CLOEXEC);
+        }
+    }
+
+    if (fd < 0) {
+        qWarning("QSharedMemoryVideoBuffer: failed to create shared memory: %s", strerror(errno));
+        return -1;
+    }
+
+    if (::ftruncate(fd, size) != 0) {
+        qWarning("QSharedMemoryVideoBuffer: failed to resize shared memory: %s", strerror(errno));
+        ::close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/*!
+    \reimp
+*/
+QAbstractVideoBuffer::MapMode QSharedMemoryVideoBuffer::mapMode() const
+{
+    return d_func()->mapMode;
+}
+
+/*!
+    \reimp
+*/
+uchar *QSharedMemoryVideoBuffer::map(MapMode mode, int *numBytes, int *bytesPerLine)
+{
+    Q_D(QSharedMemoryVideoBuffer);
+
+    if (d->mapMode != NotMapped || mode == NotMapped || d->fd < 0 || d->size <= 0)
+        return 0;
+
+    if (!d->mapping) {
+        // mmap() needs a page aligned offset, map from the page the frame starts in.
+        const long pageSize = ::sysconf(_SC_PAGESIZE);
+        const off_t pageOffset = d->offset - d->offset % pageSize;
+
+        d->mappingSize = d->size + (d->offset - pageOffset);
+        d->mapping = ::mmap(0, d->mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED, d->fd, pageOffset);
+        d->writable = d->mapping != MAP_FAILED;
+
+        // Memory exported read only, such as a sealed memfd, can still be read.
+        if (d->mapping == MAP_FAILED)
+            d->mapping = ::mmap(0, d->mappingSize, PROT_READ, MAP_SHARED, d->fd, pageOffset);
+
+        if (d->mapping == MAP_FAILED) {
+            qWarning("QSharedMemoryVideoBuffer: failed to map shared memory: %s", strerror(errno));
+            d->mapping = 0;
+            return 0;
+        }
+    }
+
+    if ((mode & WriteOnly) && !d->writable)
+        return 0;
+
+    d->mapMode = mode;
+
+    if (numBytes)
+        *numBytes = d->size;
+
+    if (bytesPerLine)
+        *bytesPerLine = d->bytesPerLine;
+
+    return static_cast<uchar *>(d->mapping) + d->offset % ::sysconf(_SC_PAGESIZE);
+}
+
+/*!
+    \reimp
+*/
+void QSharedMemoryVideoBuffer::unmap()
+{
+    d_func()->mapMode = NotMapped;
+}
+
+/*!
+    \reimp
+
+    Returns the file descriptor of the shared memory as an int.
+*/
+QVariant QSharedMemoryVideoBuffer::handle() const
+{
+    return QVariant(d_func()->fd);
+}
+
+QT_END_NAMESPACE
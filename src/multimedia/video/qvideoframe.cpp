@@ -43,6 +43,7 @@
 
 #include "qimagevideobuffer_p.h"
 #include "qmemoryvideobuffer_p.h"
+#include "qvideoframeconversionhelper_p.h"
 
 #include <qimage.h>
 #include <qpair.h>
@@ -76,28 +77,30 @@ public:
     QVideoFramePrivate()
         : startTime(-1)
         , endTime(-1)
-        , data(0)
         , mappedBytes(0)
-        , bytesPerLine(0)
+        , planeCount(0)
         , pixelFormat(QVideoFrame::Format_Invalid)
         , fieldType(QVideoFrame::ProgressiveFrame)
         , buffer(0)
         , mappedCount(0)
     {
+        memset(data, 0, sizeof(data));
+        memset(bytesPerLine, 0, sizeof(bytesPerLine));
     }
 
     QVideoFramePrivate(const QSize &size, QVideoFrame::PixelFormat format)
         : size(size)
         , startTime(-1)
         , endTime(-1)
-        , data(0)
         , mappedBytes(0)
-        , bytesPerLine(0)
+        , planeCount(0)
         , pixelFormat(format)
         , fieldType(QVideoFrame::ProgressiveFrame)
         , buffer(0)
         , mappedCount(0)
     {
+        memset(data, 0, sizeof(data));
+        memset(bytesPerLine, 0, sizeof(bytesPerLine));
     }
 
     ~QVideoFramePrivate()
@@ -109,9 +112,10 @@ public:
     QSize size;
     qint64 startTime;
     qint64 endTime;
-    uchar *data;
+    uchar *data[4];
+    int bytesPerLine[4];
     int mappedBytes;
-    int bytesPerLine;
+    int planeCount;
     QVideoFrame::PixelFormat pixelFormat;
     QVideoFrame::FieldType fieldType;
     QAbstractVideoBuffer *buffer;
@@ -569,18 +573,50 @@ bool QVideoFrame::map(QAbstractVideoBuffer::MapMode mode)
         }
     }
 
-    Q_ASSERT(d->data == 0);
-    Q_ASSERT(d->bytesPerLine == 0);
+    Q_ASSERT(d->data[0] == 0);
+    Q_ASSERT(d->bytesPerLine[0] == 0);
+    Q_ASSERT(d->planeCount == 0);
     Q_ASSERT(d->mappedBytes == 0);
 
-    d->data = d->buffer->map(mode, &d->mappedBytes, &d->bytesPerLine);
+    d->planeCount = d->buffer->mapPlanes(mode, &d->mappedBytes, d->bytesPerLine, d->data);
+    if (d->planeCount == 0)
+        return false;
 
-    if (d->data) {
-        d->mappedCount++;
-        return true;
+    if (d->planeCount == 1) {
+        // The buffer is one block of memory, work out where the other
+        // planes of planar formats start
+        const int height = d->size.height();
+        const int stride = d->bytesPerLine[0];
+
+        switch (d->pixelFormat) {
+        case Format_YUV420P:
+        case Format_YV12: {
+            // The chroma stride is usually half the luma stride, but may be
+            // padded. Derive it from the size of the chroma planes.
+            const int chromaHeight = (height + 1) / 2;
+            int chromaStride = stride / 2;
+            if (chromaHeight > 0 && d->mappedBytes > stride * height)
+                chromaStride = (d->mappedBytes - stride * height) / (2 * chromaHeight);
+
+            d->planeCount = 3;
+            d->bytesPerLine[1] = d->bytesPerLine[2] = chromaStride;
+            d->data[1] = d->data[0] + stride * height;
+            d->data[2] = d->data[1] + chromaStride * chromaHeight;
+            break;
+        }
+        case Format_NV12:
+        case Format_NV21:
+            d->planeCount = 2;
+            d->bytesPerLine[1] = stride;
+            d->data[1] = d->data[0] + stride * height;
+            break;
+        default:
+            break;
+        }
     }
 
-    return false;
+    d->mappedCount++;
+    return true;
 }
 
 /*!
@@ -609,8 +645,9 @@ void QVideoFrame::unmap()
 
     if (d->mappedCount == 0) {
         d->mappedBytes = 0;
-        d->bytesPerLine = 0;
-        d->data = 0;
+        d->planeCount = 0;
+        memset(d->bytesPerLine, 0, sizeof(d->bytesPerLine));
+        memset(d->data, 0, sizeof(d->data));
 
         d->buffer->unmap();
     }
@@ -628,7 +665,21 @@ void QVideoFrame::unmap()
 */
 int QVideoFrame::bytesPerLine() const
 {
-    return d->bytesPerLine;
+    return d->bytesPerLine[0];
+}
+
+/*!
+    \since 5.3
+
+    Returns the number of bytes in a scan line of a \a plane.
+
+    This value is only valid while the frame data is \l {map()}{mapped}.
+
+    \sa bits(), map(), mappedBytes(), planeCount()
+*/
+int QVideoFrame::bytesPerLine(int plane) const
+{
+    return plane >= 0 && plane < d->planeCount ? d->bytesPerLine[plane] : 0;
 }
 
 /*!
@@ -644,7 +695,28 @@ int QVideoFrame::bytesPerLine() const
 */
 uchar *QVideoFrame::bits()
 {
-    return d->data;
+    return d->data[0];
+}
+
+/*!
+    \since 5.3
+
+    Returns a pointer to the start of the frame data buffer for a \a plane.
+
+    Planes are numbered in the order they are stored in the pixel format,
+    so the second plane of a Format_YV12 frame holds the Cr samples.
+
+    This value is only valid while the frame data is \l {map()}{mapped}.
+
+    Changes made to data accessed via this pointer (when mapped with write access)
+    are only guaranteed to have been persisted when unmap() is called and when the
+    buffer has been mapped for writing.
+
+    \sa map(), mappedBytes(), bytesPerLine(), planeCount()
+*/
+uchar *QVideoFrame::bits(int plane)
+{
+    return plane >= 0 && plane < d->planeCount ? d->data[plane] : 0;
 }
 
 /*!
@@ -659,7 +731,24 @@ uchar *QVideoFrame::bits()
 */
 const uchar *QVideoFrame::bits() const
 {
-    return d->data;
+    return d->data[0];
+}
+
+/*!
+    \since 5.3
+
+    Returns a pointer to the start of the frame data buffer for a \a plane.
+
+    This value is only valid while the frame data is \l {map()}{mapped}.
+
+    If the buffer was not mapped with read access, the contents of this
+    buffer will initially be uninitialized.
+
+    \sa map(), mappedBytes(), bytesPerLine(), planeCount()
+*/
+const uchar *QVideoFrame::bits(int plane) const
+{
+    return plane >= 0 && plane < d->planeCount ? d->data[plane] : 0;
 }
 
 /*!
@@ -674,6 +763,24 @@ int QVideoFrame::mappedBytes() const
     return d->mappedBytes;
 }
 
+/*!
+    \since 5.3
+
+    Returns the number of planes in the video frame.
+
+    Planar formats like Format_YUV420P have more than one plane, their
+    chroma planes are calculated from the pixel format when the buffer maps
+    all of its data as one block.
+
+    This value is only valid while the frame data is \l {map()}{mapped}.
+
+    \sa map(), bits(), bytesPerLine()
+*/
+int QVideoFrame::planeCount() const
+{
+    return d->planeCount;
+}
+
 /*!
     Returns a type specific handle to a video frame's buffer.
 
@@ -769,6 +876,52 @@ void QVideoFrame::setMetaData(const QString &key, const QVariant &value)
         d->metadata.remove(key);
 }
 
+/*!
+    \since 5.3
+
+    Returns a copy of the frame contents as an image of \a size, or of the
+    frame size if \a size is empty.
+
+    Frames in a pixel format QImage supports are copied as is when no scaling
+    is needed. Other frames, including planar and packed YUV frames, are
+    converted to QImage::Format_RGB32, or QImage::Format_ARGB32 when the frame
+    has an alpha channel; YUV frames are interpreted as ITU-R BT.601. Scaling
+    is done in the same pass as the conversion.
+
+    The frame is mapped read only for the duration of the call if it is not
+    already mapped. Returns a null image if the frame cannot be read or its
+    pixel format cannot be converted.
+*/
+QImage QVideoFrame::image(const QSize &size) const
+{
+    QVideoFrame frame(*this);
+
+    const bool wasMapped = frame.isMapped();
+    if (wasMapped ? !frame.isReadable() : !frame.map(QAbstractVideoBuffer::ReadOnly))
+        return QImage();
+
+    const QSize outputSize = size.isEmpty() ? frame.size() : size;
+    const QImage::Format imageFormat = imageFormatFromPixelFormat(frame.pixelFormat());
+
+    QImage result;
+    if (imageFormat != QImage::Format_Invalid && outputSize == frame.size()) {
+        result = QImage(frame.bits(), frame.width(), frame.height(),
+                        frame.bytesPerLine(), imageFormat).copy();
+    } else if (qt_canConvertVideoFrameToRgb32(frame.pixelFormat())) {
+        const bool hasAlpha = frame.pixelFormat() == Format_ARGB32
+                || frame.pixelFormat() == Format_ARGB32_Premultiplied
+                || frame.pixelFormat() == Format_BGRA32;
+        result = QImage(outputSize, hasAlpha ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+        if (!qt_convertVideoFrameToRgb32(frame, QRect(QPoint(0, 0), frame.size()), &result))
+            result = QImage();
+    }
+
+    if (!wasMapped)
+        frame.unmap();
+
+    return result;
+}
+
 /*!
     Returns a video pixel format equivalent to an image \a format.  If there is no equivalent
     format QVideoFrame::InvalidType is returned instead.
@@ -139,10 +139,14 @@ public:
     void unmap();
 
     int bytesPerLine() const;
+    int bytesPerLine(int plane) const;
 
     uchar *bits();
+    uchar *bits(int plane);
     const uchar *bits() const;
+    const uchar *bits(int plane) const;
     int mappedBytes() const;
+    int planeCount() const;
 
     QVariant handle() const;
 
@@ -156,6 +160,8 @@ public:
     QVariant metaData(const QString &key) const;
     void setMetaData(const QString &key, const QVariant &value);
 
+    QImage image(const QSize &size = QSize()) const;
+
     static PixelFormat pixelFormatFromImageFormat(QImage::Format format);
     static QImage::Format imageFormatFromPixelFormat(PixelFormat format);
 
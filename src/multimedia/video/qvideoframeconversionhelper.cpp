@@ -0,0 +1,490 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qvideoframeconversionhelper_p.h"
+
+#include <private/qsimd_p.h>
+
+#include <QtCore/qrunnable.h>
+#include <QtCore/qsemaphore.h>
+#include <QtCore/qthreadpool.h>
+#include <QtCore/qvarlengtharray.h>
+#include <QtCore/qvector.h>
+#include <QtGui/qrgb.h>
+
+QT_BEGIN_NAMESPACE
+
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+int qt_yuvToRgb32Line_sse2(const uchar *y, const uchar *u, const uchar *v,
+                           quint32 *output, int width,
+                           const QYuvToRgbCoefficients &coefficients);
+#endif
+
+#if defined(__ARM_NEON__)
+int qt_yuvToRgb32Line_neon(const uchar *y, const uchar *u, const uchar *v,
+                           quint32 *output, int width,
+                           const QYuvToRgbCoefficients &coefficients);
+#endif
+
+namespace {
+
+// ITU-R BT.601 and BT.709, limited (16-235) and full (0-255) range
+const QYuvToRgbCoefficients bt601Coefficients = { 16, 298, 409, -100, -208, 516 };
+const QYuvToRgbCoefficients bt601FullRangeCoefficients = { 0, 256, 359, -88, -183, 454 };
+const QYuvToRgbCoefficients bt709Coefficients = { 16, 298, 459, -55, -136, 541 };
+const QYuvToRgbCoefficients bt709FullRangeCoefficients = { 0, 256, 403, -48, -120, 475 };
+
+// Below this many output pixels the cost of waking up worker threads
+// outweighs the gain.
+const int parallelConversionThreshold = 640 * 360;
+const int maximumConversionBands = 8;
+
+inline uchar clampToByte(int value)
+{
+    return value < 0 ? 0 : (value > 255 ? 255 : uchar(value));
+}
+
+void yuvToRgb32Line(const uchar *y, const uchar *u, const uchar *v,
+                    quint32 *output, int width,
+                    const QYuvToRgbCoefficients &coefficients)
+{
+    int i = 0;
+
+#if defined(QT_COMPILER_SUPPORTS_SSE2)
+    if (qCpuHasFeature(SSE2))
+        i = qt_yuvToRgb32Line_sse2(y, u, v, output, width, coefficients);
+#endif
+#if defined(__ARM_NEON__)
+    if (qCpuHasFeature(NEON))
+        i = qt_yuvToRgb32Line_neon(y, u, v, output, width, coefficients);
+#endif
+
+    for (; i < width; ++i) {
+        const int c = (y[i] - coefficients.yOffset) * coefficients.y + 128;
+        const int d = u[i] - 128;
+        const int e = v[i] - 128;
+
+        const int r = (c + coefficients.rv * e) >> 8;
+        const int g = (c + coefficients.gu * d + coefficients.gv * e) >> 8;
+        const int b = (c + coefficients.bu * d) >> 8;
+
+        output[i] = 0xff000000 | (clampToByte(r) << 16) | (clampToByte(g) << 8) | clampToByte(b);
+    }
+}
+
+inline quint32 expand565(quint16 pixel)
+{
+    const quint32 r = (pixel >> 11) & 0x1f;
+    const quint32 g = (pixel >> 5) & 0x3f;
+    const quint32 b = pixel & 0x1f;
+    return 0xff000000 | (((r << 3) | (r >> 2)) << 16) | (((g << 2) | (g >> 4)) << 8) | ((b << 3) | (b >> 2));
+}
+
+inline quint32 expand555(quint16 pixel)
+{
+    const quint32 r = (pixel >> 10) & 0x1f;
+    const quint32 g = (pixel >> 5) & 0x1f;
+    const quint32 b = pixel & 0x1f;
+    return 0xff000000 | (((r << 3) | (r >> 2)) << 16) | (((g << 3) | (g >> 2)) << 8) | ((b << 3) | (b >> 2));
+}
+
+// RGB frames only need their pixels picked and reordered, no arithmetic
+// beyond unpremultiplying when the output keeps alpha.
+void rgbToRgb32Line(QVideoFrame::PixelFormat format, const uchar *row, const int *columns,
+                    quint32 *output, int width, bool keepAlpha)
+{
+    const quint32 opaque = keepAlpha ? 0 : 0xff000000;
+
+    switch (format) {
+    case QVideoFrame::Format_RGB32:
+        for (int i = 0; i < width; ++i)
+            output[i] = 0xff000000 | reinterpret_cast<const quint32 *>(row)[columns[i]];
+        break;
+    case QVideoFrame::Format_ARGB32:
+        for (int i = 0; i < width; ++i)
+            output[i] = opaque | reinterpret_cast<const quint32 *>(row)[columns[i]];
+        break;
+    case QVideoFrame::Format_ARGB32_Premultiplied:
+        for (int i = 0; i < width; ++i) {
+            const quint32 pixel = reinterpret_cast<const quint32 *>(row)[columns[i]];
+            output[i] = keepAlpha ? qUnpremultiply(pixel) : 0xff000000 | pixel;
+        }
+        break;
+    case QVideoFrame::Format_BGRA32:
+    case QVideoFrame::Format_BGR32:
+        // 0xBBGGRRAA, the alpha byte of BGR32 is undefined
+        for (int i = 0; i < width; ++i) {
+            const quint32 pixel = reinterpret_cast<const quint32 *>(row)[columns[i]];
+            const quint32 alpha = format == QVideoFrame::Format_BGRA32 ? (pixel & 0xff) << 24 | opaque
+                                                                       : 0xff000000;
+            output[i] = alpha | ((pixel >> 8) & 0xff) << 16 | ((pixel >> 16) & 0xff) << 8 | pixel >> 24;
+        }
+        break;
+    case QVideoFrame::Format_RGB24:
+        for (int i = 0; i < width; ++i) {
+            const uchar *pixel = row + 3 * columns[i];
+            output[i] = 0xff000000 | pixel[0] << 16 | pixel[1] << 8 | pixel[2];
+        }
+        break;
+    case QVideoFrame::Format_BGR24:
+        for (int i = 0; i < width; ++i) {
+            const uchar *pixel = row + 3 * columns[i];
+            output[i] = 0xff000000 | pixel[2] << 16 | pixel[1] << 8 | pixel[0];
+        }
+        break;
+    case QVideoFrame::Format_RGB565:
+        for (int i = 0; i < width; ++i)
+            output[i] = expand565(reinterpret_cast<const quint16 *>(row)[columns[i]]);
+        break;
+    case QVideoFrame::Format_RGB555:
+        for (int i = 0; i < width; ++i)
+            output[i] = expand555(reinterpret_cast<const quint16 *>(row)[columns[i]]);
+        break;
+    default:
+        break;
+    }
+}
+
+bool isRgbFormat(QVideoFrame::PixelFormat format)
+{
+    switch (format) {
+    case QVideoFrame::Format_RGB32:
+    case QVideoFrame::Format_ARGB32:
+    case QVideoFrame::Format_ARGB32_Premultiplied:
+    case QVideoFrame::Format_BGRA32:
+    case QVideoFrame::Format_BGR32:
+    case QVideoFrame::Format_RGB24:
+    case QVideoFrame::Format_BGR24:
+    case QVideoFrame::Format_RGB565:
+    case QVideoFrame::Format_RGB555:
+        return true;
+    default:
+        return false;
+    }
+}
+
+struct ConversionContext
+{
+    QVideoFrame::PixelFormat format;
+    const uchar *planes[3];
+    int strides[3];
+    QRect source;
+    QImage *output;
+    QVector<int> columns;
+    QYuvToRgbCoefficients coefficients;
+    bool keepAlpha;
+};
+
+bool setupPlanes(const QVideoFrame &frame, ConversionContext *context)
+{
+    const uchar *bits = frame.bits();
+    const int bytesPerLine = frame.bytesPerLine();
+
+    switch (frame.pixelFormat()) {
+    case QVideoFrame::Format_YUV420P:
+    case QVideoFrame::Format_YV12: {
+        if (frame.planeCount() < 3)
+            return false;
+
+        // Planes are in memory order, the Cr plane comes first in YV12
+        const bool swapped = frame.pixelFormat() == QVideoFrame::Format_YV12;
+        const int u = swapped ? 2 : 1;
+        const int v = swapped ? 1 : 2;
+
+        context->planes[0] = bits;
+        context->planes[1] = frame.bits(u);
+        context->planes[2] = frame.bits(v);
+        context->strides[0] = bytesPerLine;
+        context->strides[1] = frame.bytesPerLine(u);
+        context->strides[2] = frame.bytesPerLine(v);
+        return true;
+    }
+    case QVideoFrame::Format_NV12:
+    case QVideoFrame::Format_NV21:
+        if (frame.planeCount() < 2)
+            return false;
+
+        context->planes[0] = bits;
+        context->planes[1] = frame.bits(1);
+        context->planes[2] = 0;
+        context->strides[0] = bytesPerLine;
+        context->strides[1] = frame.bytesPerLine(1);
+        context->strides[2] = 0;
+        return true;
+    case QVideoFrame::Format_UYVY:
+    case QVideoFrame::Format_YUYV:
+        context->planes[0] = bits;
+        context->planes[1] = 0;
+        context->planes[2] = 0;
+        context->strides[0] = bytesPerLine;
+        context->strides[1] = 0;
+        context->strides[2] = 0;
+        return true;
+    default:
+        if (!isRgbFormat(frame.pixelFormat()))
+            return false;
+
+        context->planes[0] = bits;
+        context->planes[1] = 0;
+        context->planes[2] = 0;
+        context->strides[0] = bytesPerLine;
+        context->strides[1] = 0;
+        context->strides[2] = 0;
+        return true;
+    }
+}
+
+// Gathers the Y, Cb and Cr samples of one output row, resampled
+// horizontally to the output width, and converts them.
+void convertRows(const ConversionContext &context, int firstRow, int lastRow)
+{
+    const int width = context.output->width();
+    const int height = context.output->height();
+    const int *columns = context.columns.constData();
+
+    QVarLengthArray<uchar, 3 * 1920> lines(3 * width);
+    uchar *y = lines.data();
+    uchar *u = y + width;
+    uchar *v = u + width;
+
+    const bool unscaled = width == context.source.width();
+
+    for (int row = firstRow; row < lastRow; ++row) {
+        const int sourceRow = context.source.y()
+                + int((2 * qint64(row) + 1) * context.source.height() / (2 * height));
+        quint32 *output = reinterpret_cast<quint32 *>(context.output->scanLine(row));
+        const uchar *yLine = y;
+
+        switch (context.format) {
+        case QVideoFrame::Format_YUV420P:
+        case QVideoFrame::Format_YV12: {
+            const uchar *yRow = context.planes[0] + sourceRow * context.strides[0];
+            const uchar *uRow = context.planes[1] + sourceRow / 2 * context.strides[1];
+            const uchar *vRow = context.planes[2] + sourceRow / 2 * context.strides[2];
+
+            if (unscaled) {
+                yLine = yRow + context.source.x();
+                for (int i = 0; i < width; ++i) {
+                    const int x = columns[i] >> 1;
+                    u[i] = uRow[x];
+                    v[i] = vRow[x];
+                }
+            } else {
+                for (int i = 0; i < width; ++i) {
+                    const int x = columns[i];
+                    y[i] = yRow[x];
+                    u[i] = uRow[x >> 1];
+                    v[i] = vRow[x >> 1];
+                }
+            }
+            break;
+        }
+        case QVideoFrame::Format_NV12:
+        case QVideoFrame::Format_NV21: {
+            const uchar *yRow = context.planes[0] + sourceRow * context.strides[0];
+            const uchar *uvRow = context.planes[1] + sourceRow / 2 * context.strides[1];
+            uchar *first = context.format == QVideoFrame::Format_NV12 ? u : v;
+            uchar *second = context.format == QVideoFrame::Format_NV12 ? v : u;
+
+            if (unscaled)
+                yLine = yRow + context.source.x();
+
+            for (int i = 0; i < width; ++i) {
+                const int x = columns[i];
+                if (!unscaled)
+                    y[i] = yRow[x];
+                first[i] = uvRow[x & ~1];
+                second[i] = uvRow[x | 1];
+            }
+            break;
+        }
+        case QVideoFrame::Format_UYVY: {
+            const uchar *row = context.planes[0] + sourceRow * context.strides[0];
+            for (int i = 0; i < width; ++i) {
+                const uchar *pair = row + ((columns[i] >> 1) << 2);
+                u[i] = pair[0];
+                y[i] = pair[1 + ((columns[i] & 1) << 1)];
+                v[i] = pair[2];
+            }
+            break;
+        }
+        case QVideoFrame::Format_YUYV: {
+            const uchar *row = context.planes[0] + sourceRow * context.strides[0];
+            for (int i = 0; i < width; ++i) {
+                const uchar *pair = row + ((columns[i] >> 1) << 2);
+                y[i] = pair[(columns[i] & 1) << 1];
+                u[i] = pair[1];
+                v[i] = pair[3];
+            }
+            break;
+        }
+        default:
+            rgbToRgb32Line(context.format, context.planes[0] + sourceRow * context.strides[0],
+                           columns, output, width, context.keepAlpha);
+            continue;
+        }
+
+        yuvToRgb32Line(yLine, u, v, output, width, context.coefficients);
+    }
+}
+
+class ConversionTask : public QRunnable
+{
+public:
+    ConversionTask(const ConversionContext *context, int firstRow, int lastRow, QSemaphore *done)
+        : m_context(context)
+        , m_firstRow(firstRow)
+        , m_lastRow(lastRow)
+        , m_done(done)
+    {
+    }
+
+    void run()
+    {
+        convertRows(*m_context, m_firstRow, m_lastRow);
+        m_done->release();
+    }
+
+private:
+    const ConversionContext *m_context;
+    int m_firstRow;
+    int m_lastRow;
+    QSemaphore *m_done;
+};
+
+}
+
+bool qt_canConvertVideoFrameToRgb32(QVideoFrame::PixelFormat format)
+{
+    switch (format) {
+    case QVideoFrame::Format_YUV420P:
+    case QVideoFrame::Format_YV12:
+    case QVideoFrame::Format_NV12:
+    case QVideoFrame::Format_NV21:
+    case QVideoFrame::Format_UYVY:
+    case QVideoFrame::Format_YUYV:
+        return true;
+    default:
+        return isRgbFormat(format);
+    }
+}
+
+QYuvToRgbCoefficients qt_yuvToRgbCoefficients(QVideoSurfaceFormat::YCbCrColorSpace colorSpace,
+                                              bool fullRange)
+{
+    switch (colorSpace) {
+    case QVideoSurfaceFormat::YCbCr_BT709:
+    case QVideoSurfaceFormat::YCbCr_xvYCC709:
+        return fullRange ? bt709FullRangeCoefficients : bt709Coefficients;
+    case QVideoSurfaceFormat::YCbCr_JPEG:
+        return bt601FullRangeCoefficients;
+    default:
+        return fullRange ? bt601FullRangeCoefficients : bt601Coefficients;
+    }
+}
+
+bool qt_convertVideoFrameToRgb32(const QVideoFrame &frame, const QRect &source, QImage *output,
+                                 QVideoSurfaceFormat::YCbCrColorSpace colorSpace, bool fullRange)
+{
+    if (!frame.isMapped() || !output || output->isNull())
+        return false;
+
+    if (output->format() != QImage::Format_RGB32 && output->format() != QImage::Format_ARGB32)
+        return false;
+
+    ConversionContext context;
+    context.format = frame.pixelFormat();
+    context.source = source.intersected(QRect(QPoint(0, 0), frame.size()));
+    context.output = output;
+    context.coefficients = qt_yuvToRgbCoefficients(colorSpace, fullRange);
+    context.keepAlpha = output->format() == QImage::Format_ARGB32;
+
+    if (context.source.isEmpty() || !setupPlanes(frame, &context))
+        return false;
+
+    // Chroma is shared by pixel pairs, keep the source rectangle aligned to them
+    if ((context.source.x() & 1) && !isRgbFormat(context.format))
+        context.source.adjust(-1, 0, 0, 0);
+
+    const int width = output->width();
+    const int height = output->height();
+
+    context.columns.resize(width);
+    for (int i = 0; i < width; ++i) {
+        context.columns[i] = context.source.x()
+                + int((2 * qint64(i) + 1) * context.source.width() / (2 * width));
+    }
+
+    int bands = 1;
+    if (width * height >= parallelConversionThreshold)
+        bands = qBound(1, QThreadPool::globalInstance()->maxThreadCount(), maximumConversionBands);
+
+    if (bands == 1) {
+        convertRows(context, 0, height);
+        return true;
+    }
+
+    // The calling thread converts the first band itself
+    QSemaphore done;
+    const int rowsPerBand = (height + bands - 1) / bands;
+    int started = 0;
+    for (int band = 1; band < bands; ++band) {
+        const int firstRow = band * rowsPerBand;
+        const int lastRow = qMin(height, firstRow + rowsPerBand);
+        if (firstRow >= lastRow)
+            break;
+
+        ConversionTask *task = new ConversionTask(&context, firstRow, lastRow, &done);
+        if (QThreadPool::globalInstance()->tryStart(task)) {
+            ++started;
+        } else {
+            convertRows(context, firstRow, lastRow);
+            delete task;
+        }
+    }
+
+    convertRows(context, 0, qMin(height, rowsPerBand));
+    done.acquire(started);
+
+    return true;
+}
+
+QT_END_NAMESPACE
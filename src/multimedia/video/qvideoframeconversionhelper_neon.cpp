@@ -0,0 +1,104 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qvideoframeconversionhelper_p.h"
+
+#include <private/qsimd_p.h>
+
+#if defined(__ARM_NEON__)
+
+#include <arm_neon.h>
+
+QT_BEGIN_NAMESPACE
+
+static inline uint8x8_t packChannel(int32x4_t lo, int32x4_t hi)
+{
+    // arithmetic shift like the scalar path, then saturate to 0..255
+    return vqmovun_s16(vcombine_s16(vqmovn_s32(vshrq_n_s32(lo, 8)),
+                                    vqmovn_s32(vshrq_n_s32(hi, 8))));
+}
+
+// Converts 8 pixels per iteration with 32 bit products, the results
+// are identical to the generic implementation.
+int qt_yuvToRgb32Line_neon(const uchar *y, const uchar *u, const uchar *v,
+                           quint32 *output, int width,
+                           const QYuvToRgbCoefficients &coefficients)
+{
+    const int16x8_t yOffset = vdupq_n_s16(coefficients.yOffset);
+    const int16x8_t chromaOffset = vdupq_n_s16(128);
+    const int32x4_t rounding = vdupq_n_s32(128);
+    const int16_t cy = coefficients.y;
+    const int16_t rv = coefficients.rv;
+    const int16_t gu = coefficients.gu;
+    const int16_t gv = coefficients.gv;
+    const int16_t bu = coefficients.bu;
+
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        const int16x8_t c = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(y + i))), yOffset);
+        const int16x8_t d = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(u + i))), chromaOffset);
+        const int16x8_t e = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(v + i))), chromaOffset);
+
+        const int32x4_t cLo = vmlal_n_s16(rounding, vget_low_s16(c), cy);
+        const int32x4_t cHi = vmlal_n_s16(rounding, vget_high_s16(c), cy);
+
+        const int32x4_t rLo = vmlal_n_s16(cLo, vget_low_s16(e), rv);
+        const int32x4_t rHi = vmlal_n_s16(cHi, vget_high_s16(e), rv);
+        const int32x4_t gLo = vmlal_n_s16(vmlal_n_s16(cLo, vget_low_s16(d), gu), vget_low_s16(e), gv);
+        const int32x4_t gHi = vmlal_n_s16(vmlal_n_s16(cHi, vget_high_s16(d), gu), vget_high_s16(e), gv);
+        const int32x4_t bLo = vmlal_n_s16(cLo, vget_low_s16(d), bu);
+        const int32x4_t bHi = vmlal_n_s16(cHi, vget_high_s16(d), bu);
+
+        // RGB32 is B, G, R, A in memory
+        uint8x8x4_t pixels;
+        pixels.val[0] = packChannel(bLo, bHi);
+        pixels.val[1] = packChannel(gLo, gHi);
+        pixels.val[2] = packChannel(rLo, rHi);
+        pixels.val[3] = vdup_n_u8(0xff);
+        vst4_u8(reinterpret_cast<uint8_t *>(output + i), pixels);
+    }
+
+    return i;
+}
+
+QT_END_NAMESPACE
+
+#endif // __ARM_NEON__
@@ -0,0 +1,95 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QVIDEOFRAMECONVERSIONHELPER_P_H
+#define QVIDEOFRAMECONVERSIONHELPER_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <qvideoframe.h>
+#include <qvideosurfaceformat.h>
+#include <QtCore/qrect.h>
+#include <QtGui/qimage.h>
+
+QT_BEGIN_NAMESPACE
+
+// Fixed-point YCbCr to RGB coefficients, 8 fractional bits.
+struct QYuvToRgbCoefficients
+{
+    int yOffset;
+    int y;
+    int rv;
+    int gu;
+    int gv;
+    int bu;
+};
+
+// Returns the coefficients for \a colorSpace. YCbCr_Undefined selects BT.601,
+// YCbCr_JPEG is always full range.
+Q_MULTIMEDIA_EXPORT QYuvToRgbCoefficients qt_yuvToRgbCoefficients(
+        QVideoSurfaceFormat::YCbCrColorSpace colorSpace, bool fullRange = false);
+
+Q_MULTIMEDIA_EXPORT bool qt_canConvertVideoFrameToRgb32(QVideoFrame::PixelFormat format);
+
+// Converts and scales the \a source rectangle of a mapped \a frame into
+// \a output, which must be a Format_RGB32 or Format_ARGB32 image of the
+// wanted size. Large outputs are split into row bands converted in parallel.
+// YUV frames are decoded with the coefficients of \a colorSpace and
+// \a fullRange, RGB frames keep their alpha when \a output has one.
+Q_MULTIMEDIA_EXPORT bool qt_convertVideoFrameToRgb32(const QVideoFrame &frame,
+                                                     const QRect &source,
+                                                     QImage *output,
+                                                     QVideoSurfaceFormat::YCbCrColorSpace colorSpace
+                                                            = QVideoSurfaceFormat::YCbCr_Undefined,
+                                                     bool fullRange = false);
+
+QT_END_NAMESPACE
+
+#endif
@@ -0,0 +1,111 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qvideoframeconversionhelper_p.h"
+
+#include <private/qsimd_p.h>
+
+#include <emmintrin.h>
+
+QT_BEGIN_NAMESPACE
+
+// Converts 8 pixels per iteration. The products are computed with
+// _mm_madd_epi16 on interleaved (value, value) pairs so they don't
+// overflow 16 bits, the rounding constant rides along as a 1 * 128 term.
+int qt_yuvToRgb32Line_sse2(const uchar *y, const uchar *u, const uchar *v,
+                           quint32 *output, int width,
+                           const QYuvToRgbCoefficients &coefficients)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i alpha = _mm_set1_epi8(char(0xff));
+    const __m128i yOffset = _mm_set1_epi16(coefficients.yOffset);
+    const __m128i chromaOffset = _mm_set1_epi16(128);
+    const __m128i one = _mm_set1_epi16(1);
+
+    // (c, e) * (y, rv), (c, d) * (y, bu), (c, d) * (y, gu), (e, 1) * (gv, 128)
+    const __m128i rCoefficients = _mm_set_epi16(coefficients.rv, coefficients.y, coefficients.rv, coefficients.y,
+                                                coefficients.rv, coefficients.y, coefficients.rv, coefficients.y);
+    const __m128i bCoefficients = _mm_set_epi16(coefficients.bu, coefficients.y, coefficients.bu, coefficients.y,
+                                                coefficients.bu, coefficients.y, coefficients.bu, coefficients.y);
+    const __m128i gCoefficients = _mm_set_epi16(coefficients.gu, coefficients.y, coefficients.gu, coefficients.y,
+                                                coefficients.gu, coefficients.y, coefficients.gu, coefficients.y);
+    const __m128i gvCoefficients = _mm_set_epi16(128, coefficients.gv, 128, coefficients.gv,
+                                                 128, coefficients.gv, 128, coefficients.gv);
+    const __m128i rounding = _mm_set1_epi32(128);
+
+    int i = 0;
+    for (; i + 8 <= width; i += 8) {
+        const __m128i c = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(y + i)), zero), yOffset);
+        const __m128i d = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(u + i)), zero), chromaOffset);
+        const __m128i e = _mm_sub_epi16(_mm_unpacklo_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i *>(v + i)), zero), chromaOffset);
+
+        const __m128i ceLo = _mm_unpacklo_epi16(c, e);
+        const __m128i ceHi = _mm_unpackhi_epi16(c, e);
+        const __m128i cdLo = _mm_unpacklo_epi16(c, d);
+        const __m128i cdHi = _mm_unpackhi_epi16(c, d);
+        const __m128i e1Lo = _mm_unpacklo_epi16(e, one);
+        const __m128i e1Hi = _mm_unpackhi_epi16(e, one);
+
+        const __m128i rLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ceLo, rCoefficients), rounding), 8);
+        const __m128i rHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(ceHi, rCoefficients), rounding), 8);
+        const __m128i bLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdLo, bCoefficients), rounding), 8);
+        const __m128i bHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdHi, bCoefficients), rounding), 8);
+        const __m128i gLo = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdLo, gCoefficients),
+                                                         _mm_madd_epi16(e1Lo, gvCoefficients)), 8);
+        const __m128i gHi = _mm_srai_epi32(_mm_add_epi32(_mm_madd_epi16(cdHi, gCoefficients),
+                                                         _mm_madd_epi16(e1Hi, gvCoefficients)), 8);
+
+        // saturate to 0..255, 8 pixels in the low half of each register
+        const __m128i r = _mm_packus_epi16(_mm_packs_epi32(rLo, rHi), zero);
+        const __m128i g = _mm_packus_epi16(_mm_packs_epi32(gLo, gHi), zero);
+        const __m128i b = _mm_packus_epi16(_mm_packs_epi32(bLo, bHi), zero);
+
+        // RGB32 is B, G, R, A in memory
+        const __m128i bg = _mm_unpacklo_epi8(b, g);
+        const __m128i ra = _mm_unpacklo_epi8(r, alpha);
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i), _mm_unpacklo_epi16(bg, ra));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(output + i + 4), _mm_unpackhi_epi16(bg, ra));
+    }
+
+    return i;
+}
+
+QT_END_NAMESPACE
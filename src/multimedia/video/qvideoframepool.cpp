@@ -0,0 +1,396 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qvideoframepool.h"
+
+#include <qabstractvideobuffer.h>
+#include <QtCore/qatomic.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qvector.h>
+
+QT_BEGIN_NAMESPACE
+
+// Alignment of the frame data, enough for the widest SIMD loads used by
+// the frame conversion helpers.
+#define QT_VIDEOFRAMEPOOL_ALIGNMENT 32
+
+#define QT_VIDEOFRAMEPOOL_DEFAULT_CAPACITY 4
+
+class QPooledVideoBuffer;
+
+class QVideoFramePoolPrivate
+{
+public:
+    QVideoFramePoolPrivate(int bytes, const QSize &size, int bytesPerLine, QVideoFrame::PixelFormat format)
+        : ref(1)
+        , bytes(bytes)
+        , size(size)
+        , bytesPerLine(bytesPerLine)
+        , pixelFormat(format)
+        , capacity(QT_VIDEOFRAMEPOOL_DEFAULT_CAPACITY)
+        , hits(0)
+        , misses(0)
+        , active(0)
+        , detached(false)
+    {
+    }
+
+    void recycle(QPooledVideoBuffer *buffer);
+    void trim(int count);
+
+    // One reference for the pool, and one for each buffer it allocated, so
+    // frames can outlive the pool.
+    QAtomicInt ref;
+
+    const int bytes;
+    const QSize size;
+    const int bytesPerLine;
+    const QVideoFrame::PixelFormat pixelFormat;
+
+    QMutex mutex;
+    QVector<QPooledVideoBuffer *> freeBuffers;
+    int capacity;
+    int hits;
+    int misses;
+    int active;
+    bool detached;
+};
+
+class QPooledVideoBuffer : public QAbstractVideoBuffer
+{
+public:
+    QPooledVideoBuffer(QVideoFramePoolPrivate *pool, uchar *data)
+        : QAbstractVideoBuffer(NoHandle)
+        , m_pool(pool)
+        , m_data(data)
+        , m_mapMode(NotMapped)
+    {
+        m_pool->ref.ref();
+    }
+
+    ~QPooledVideoBuffer()
+    {
+        qFreeAligned(m_data);
+
+        if (!m_pool->ref.deref())
+            delete m_pool;
+    }
+
+    void release()
+    {
+        m_mapMode = NotMapped;
+        m_pool->recycle(this);
+    }
+
+    MapMode mapMode() const { return m_mapMode; }
+
+    uchar *map(MapMode mode, int *numBytes, int *bytesPerLine)
+    {
+        if (m_mapMode != NotMapped || mode == NotMapped)
+            return 0;
+
+        m_mapMode = mode;
+
+        if (numBytes)
+            *numBytes = m_pool->bytes;
+
+        if (bytesPerLine)
+            *bytesPerLine = m_pool->bytesPerLine;
+
+        return m_data;
+    }
+
+    void unmap() { m_mapMode = NotMapped; }
+
+private:
+    QVideoFramePoolPrivate *m_pool;
+    uchar *m_data;
+    MapMode m_mapMode;
+};
+
+void QVideoFramePoolPrivate::recycle(QPooledVideoBuffer *buffer)
+{
+    QMutexLocker locker(&mutex);
+
+    --active;
+    if (!detached && freeBuffers.count() < capacity) {
+        freeBuffers.append(buffer);
+        return;
+    }
+
+    locker.unlock();
+
+    delete buffer;
+}
+
+void QVideoFramePoolPrivate::trim(int count)
+{
+    // Called with the mutex locked, the pool keeps its own reference so
+    // deleting the buffers can't delete the pool.
+    while (freeBuffers.count() > count)
+        delete freeBuffers.takeLast();
+}
+
+/*!
+    \class QVideoFramePool
+    \brief The QVideoFramePool class recycles the memory of video frames of one format.
+    \inmodule QtMultimedia
+    \ingroup multimedia
+    \ingroup multimedia_video
+    \since 5.3
+
+    Applications that generate their own video, for example to present it
+    to a QAbstractVideoSurface, usually create a new QVideoFrame for every
+    frame. Each of those allocates and frees a block of memory large enough
+    for the whole frame.
+
+    A QVideoFramePool hands out frames of a fixed size and pixel format.
+    When the last copy of a frame is destroyed its memory is returned to the
+    pool, and the next call to frame() reuses it. The frame data is aligned
+    to 32 bytes.
+
+    \code
+    QVideoFramePool pool(width * height * 4, QSize(width, height), width * 4,
+                         QVideoFrame::Format_ARGB32);
+
+    QVideoFrame frame = pool.frame();
+    frame.map(QAbstractVideoBuffer::WriteOnly);
+    render(frame.bits());
+    frame.unmap();
+    surface->present(frame);
+    \endcode
+
+    The pool keeps at most capacity() unused frames, further frames that are
+    returned to it are freed. The hitCount() and missCount() statistics
+    show how often frame() could reuse memory, and can be used to choose a
+    capacity.
+
+    Frames handed out by a pool stay valid after the pool is destroyed. The
+    pool can be used from more than one thread.
+
+    \sa QVideoFrame
+*/
+
+/*!
+    Constructs a pool of video frames of \a size with a \a format pixel
+    format.
+
+    The \a bytes and \a bytesPerLine arguments are the same as for the
+    QVideoFrame constructor that allocates frame memory.
+*/
+QVideoFramePool::QVideoFramePool(int bytes, const QSize &size, int bytesPerLine, QVideoFrame::PixelFormat format)
+    : d(new QVideoFramePoolPrivate(bytes, size, bytesPerLine, format))
+{
+}
+
+/*!
+    Destroys a video frame pool.
+
+    The unused frame memory is freed, frames still in use free their memory
+    when they are destroyed.
+*/
+QVideoFramePool::~QVideoFramePool()
+{
+    {
+        QMutexLocker locker(&d->mutex);
+        d->detached = true;
+        d->trim(0);
+    }
+
+    if (!d->ref.deref())
+        delete d;
+}
+
+/*!
+    Returns a video frame from the pool.
+
+    The memory of the frame is reused from a frame that was returned to the
+    pool if there is one, otherwise new memory is allocated. The content of
+    the frame data is undefined.
+
+    Returns an invalid frame if the memory couldn't be allocated.
+*/
+QVideoFrame QVideoFramePool::frame()
+{
+    QPooledVideoBuffer *buffer = 0;
+
+    {
+        QMutexLocker locker(&d->mutex);
+
+        if (!d->freeBuffers.isEmpty()) {
+            buffer = d->freeBuffers.takeLast();
+            ++d->hits;
+        } else {
+            ++d->misses;
+        }
+
+        if (buffer)
+            ++d->active;
+    }
+
+    if (!buffer && d->bytes > 0) {
+        uchar *data = static_cast<uchar *>(qMallocAligned(d->bytes, QT_VIDEOFRAMEPOOL_ALIGNMENT));
+        if (!data)
+            return QVideoFrame();
+
+        buffer = new QPooledVideoBuffer(d, data);
+
+        QMutexLocker locker(&d->mutex);
+        ++d->active;
+    }
+
+    if (!buffer)
+        return QVideoFrame();
+
+    return QVideoFrame(buffer, d->size, d->pixelFormat);
+}
+
+/*!
+    Returns the number of bytes of the frames in the pool.
+*/
+int QVideoFramePool::mappedBytes() const
+{
+    return d->bytes;
+}
+
+/*!
+    Returns the dimensions of the frames in the pool.
+*/
+QSize QVideoFramePool::frameSize() const
+{
+    return d->size;
+}
+
+/*!
+    Returns the number of bytes in a scan line of the frames in the pool.
+*/
+int QVideoFramePool::bytesPerLine() const
+{
+    return d->bytesPerLine;
+}
+
+/*!
+    Returns the pixel format of the frames in the pool.
+*/
+QVideoFrame::PixelFormat QVideoFramePool::pixelFormat() const
+{
+    return d->pixelFormat;
+}
+
+/*!
+    Returns the maximum number of unused frames the pool keeps.
+
+    The default capacity is 4.
+*/
+int QVideoFramePool::capacity() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->capacity;
+}
+
+/*!
+    Sets the maximum number of unused frames the pool keeps to \a capacity.
+
+    Unused frames above the new capacity are freed.
+*/
+void QVideoFramePool::setCapacity(int capacity)
+{
+    QMutexLocker locker(&d->mutex);
+    d->capacity = qMax(0, capacity);
+    d->trim(d->capacity);
+}
+
+/*!
+    Returns the number of times frame() reused the memory of a frame.
+
+    \sa missCount(), resetStatistics()
+*/
+int QVideoFramePool::hitCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->hits;
+}
+
+/*!
+    Returns the number of times frame() had to allocate new memory.
+
+    A high miss count compared to hitCount() means more frames are in use at
+    a time than the capacity() of the pool.
+
+    \sa hitCount(), resetStatistics()
+*/
+int QVideoFramePool::missCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->misses;
+}
+
+/*!
+    Returns the number of frames from the pool that are in use.
+*/
+int QVideoFramePool::activeCount() const
+{
+    QMutexLocker locker(&d->mutex);
+    return d->active;
+}
+
+/*!
+    Resets the hitCount() and missCount() statistics to 0.
+*/
+void QVideoFramePool::resetStatistics()
+{
+    QMutexLocker locker(&d->mutex);
+    d->hits = 0;
+    d->misses = 0;
+}
+
+/*!
+    Frees the memory of the unused frames in the pool.
+
+    Frames in use are not affected, and are returned to the pool as usual.
+*/
+void QVideoFramePool::clear()
+{
+    QMutexLocker locker(&d->mutex);
+    d->trim(0);
+}
+
+QT_END_NAMESPACE
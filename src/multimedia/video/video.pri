@@ -5,6 +5,7 @@ PUBLIC_HEADERS += \
     video/qabstractvideobuffer.h \
     video/qabstractvideosurface.h \
     video/qvideoframe.h \
+    video/qvideoframepool.h \
     video/qvideosurfaceformat.h \
     video/qvideoprobe.h
 
@@ -12,6 +13,7 @@ PRIVATE_HEADERS += \
     video/qabstractvideobuffer_p.h \
     video/qimagevideobuffer_p.h \
     video/qmemoryvideobuffer_p.h \
+    video/qvideoframeconversionhelper_p.h \
     video/qvideooutputorientationhandler_p.h \
     video/qvideosurfaceoutput_p.h
 
@@ -21,11 +23,26 @@ SOURCES += \
     video/qimagevideobuffer.cpp \
     video/qmemoryvideobuffer.cpp \
     video/qvideoframe.cpp \
+    video/qvideoframeconversionhelper.cpp \
+    video/qvideoframepool.cpp \
     video/qvideooutputorientationhandler.cpp \
     video/qvideosurfaceformat.cpp \
     video/qvideosurfaceoutput.cpp \
     video/qvideoprobe.cpp
 
+unix:!android {
+    PRIVATE_HEADERS += video/qsharedmemoryvideobuffer_p.h
+    SOURCES += video/qsharedmemoryvideobuffer.cpp
+
+    linux: LIBS_PRIVATE += -lrt
+}
+
+SSE2_SOURCES += video/qvideoframeconversionhelper_sse2.cpp
+
+contains(QT_CPU_FEATURES.$$QT_ARCH, neon) {
+    SOURCES += video/qvideoframeconversionhelper_neon.cpp
+}
+
 
 
 
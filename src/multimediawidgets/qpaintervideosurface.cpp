@@ -47,6 +47,8 @@
 #include <qvariant.h>
 #include <qvideosurfaceformat.h>
 
+#include <private/qvideoframeconversionhelper_p.h>
+
 #if !defined(QT_NO_OPENGL) && !defined(QT_OPENGL_ES_1_CL) && !defined(QT_OPENGL_ES_1)
 #include <qglshaderprogram.h>
 #include <QtGui/QOpenGLContext>
@@ -59,6 +61,13 @@
 #include <QtDebug>
 QT_BEGIN_NAMESPACE
 
+// Shared memory buffers are mapped and uploaded the same way as buffers without a handle.
+static inline bool qt_isMappableHandleType(QAbstractVideoBuffer::HandleType type)
+{
+    return type == QAbstractVideoBuffer::NoHandle
+            || type == QAbstractVideoBuffer::SharedMemoryHandle;
+}
+
 QVideoSurfacePainter::~QVideoSurfacePainter()
 {
 }
@@ -84,16 +93,29 @@ public:
     void updateColors(int brightness, int contrast, int hue, int saturation);
 
 private:
+    void drawImage(QPainter *painter, const QRectF &target, const QImage &image, const QRectF &source);
+
     QList<QVideoFrame::PixelFormat> m_imagePixelFormats;
     QVideoFrame m_frame;
     QSize m_imageSize;
     QImage::Format m_imageFormat;
     QVideoSurfaceFormat::Direction m_scanLineDirection;
+    QVideoSurfaceFormat::YCbCrColorSpace m_colorSpace;
+
+    // YUV frames are converted in software to an RGB32 image of the
+    // painted size
+    QImage m_convertedImage;
+    QRect m_convertedSource;
+    bool m_convert;
+    bool m_convertedImageDirty;
 };
 
 QVideoSurfaceGenericPainter::QVideoSurfaceGenericPainter()
     : m_imageFormat(QImage::Format_Invalid)
     , m_scanLineDirection(QVideoSurfaceFormat::TopToBottom)
+    , m_colorSpace(QVideoSurfaceFormat::YCbCr_Undefined)
+    , m_convert(false)
+    , m_convertedImageDirty(true)
 {
     m_imagePixelFormats
         << QVideoFrame::Format_RGB32
@@ -101,7 +123,13 @@ QVideoSurfaceGenericPainter::QVideoSurfaceGenericPainter()
         << QVideoFrame::Format_RGB24
 #endif
         << QVideoFrame::Format_ARGB32
-        << QVideoFrame::Format_RGB565;
+        << QVideoFrame::Format_RGB565
+        << QVideoFrame::Format_YUV420P
+        << QVideoFrame::Format_YV12
+        << QVideoFrame::Format_NV12
+        << QVideoFrame::Format_NV21
+        << QVideoFrame::Format_UYVY
+        << QVideoFrame::Format_YUYV;
 }
 
 QList<QVideoFrame::PixelFormat> QVideoSurfaceGenericPainter::supportedPixelFormats(
@@ -110,6 +138,7 @@ QList<QVideoFrame::PixelFormat> QVideoSurfaceGenericPainter::supportedPixelForma
     switch (handleType) {
     case QAbstractVideoBuffer::QPixmapHandle:
     case QAbstractVideoBuffer::NoHandle:
+    case QAbstractVideoBuffer::SharedMemoryHandle:
         return m_imagePixelFormats;
     default:
         ;
@@ -123,6 +152,7 @@ bool QVideoSurfaceGenericPainter::isFormatSupported(const QVideoSurfaceFormat &f
     case QAbstractVideoBuffer::QPixmapHandle:
         return true;
     case QAbstractVideoBuffer::NoHandle:
+    case QAbstractVideoBuffer::SharedMemoryHandle:
         return m_imagePixelFormats.contains(format.pixelFormat())
                && !format.frameSize().isEmpty();
     default:
@@ -137,9 +167,17 @@ QAbstractVideoSurface::Error QVideoSurfaceGenericPainter::start(const QVideoSurf
     m_imageFormat = QVideoFrame::imageFormatFromPixelFormat(format.pixelFormat());
     m_imageSize = format.frameSize();
     m_scanLineDirection = format.scanLineDirection();
+    m_colorSpace = format.yCbCrColorSpace();
+    m_convertedImage = QImage();
+    m_convertedImageDirty = true;
+
+    m_convert = m_imageFormat == QImage::Format_Invalid
+            && qt_canConvertVideoFrameToRgb32(format.pixelFormat());
+    if (m_convert)
+        m_imageFormat = QImage::Format_RGB32;
 
     const QAbstractVideoBuffer::HandleType t = format.handleType();
-    if (t == QAbstractVideoBuffer::NoHandle) {
+    if (qt_isMappableHandleType(t)) {
         if (m_imageFormat != QImage::Format_Invalid
 #ifdef QT_OPENGL_ES
                 && format.pixelFormat() != QVideoFrame::Format_RGB24
@@ -156,11 +194,13 @@ QAbstractVideoSurface::Error QVideoSurfaceGenericPainter::start(const QVideoSurf
 void QVideoSurfaceGenericPainter::stop()
 {
     m_frame = QVideoFrame();
+    m_convertedImage = QImage();
 }
 
 QAbstractVideoSurface::Error QVideoSurfaceGenericPainter::setCurrentFrame(const QVideoFrame &frame)
 {
     m_frame = frame;
+    m_convertedImageDirty = true;
 
     return QAbstractVideoSurface::NoError;
 }
@@ -175,6 +215,34 @@ QAbstractVideoSurface::Error QVideoSurfaceGenericPainter::paint(
 
     if (m_frame.handleType() == QAbstractVideoBuffer::QPixmapHandle) {
         painter->drawPixmap(target, m_frame.handle().value<QPixmap>(), source);
+    } else if (m_convert) {
+        // Convert no larger than the source, the painter only ever scales down
+        // what was converted at full resolution anyway.
+        const QRect sourceRect = source.toAlignedRect();
+        const QSize targetSize = painter->transform().mapRect(target).size().toSize();
+        const QSize size = targetSize.boundedTo(sourceRect.size()).expandedTo(QSize(1, 1));
+
+        if (m_convertedImage.size() != size) {
+            m_convertedImage = QImage(size, QImage::Format_RGB32);
+            m_convertedImageDirty = true;
+        }
+
+        if (m_convertedImageDirty || m_convertedSource != sourceRect) {
+            if (!m_frame.map(QAbstractVideoBuffer::ReadOnly))
+                return QAbstractVideoSurface::IncorrectFormatError;
+
+            const bool converted = qt_convertVideoFrameToRgb32(
+                        m_frame, sourceRect, &m_convertedImage, m_colorSpace);
+            m_frame.unmap();
+
+            if (!converted)
+                return QAbstractVideoSurface::IncorrectFormatError;
+
+            m_convertedSource = sourceRect;
+            m_convertedImageDirty = false;
+        }
+
+        drawImage(painter, target, m_convertedImage, QRectF(QPointF(0, 0), size));
     } else if (m_frame.map(QAbstractVideoBuffer::ReadOnly)) {
         QImage image(
                 m_frame.bits(),
@@ -183,17 +251,7 @@ QAbstractVideoSurface::Error QVideoSurfaceGenericPainter::paint(
                 m_frame.bytesPerLine(),
                 m_imageFormat);
 
-        if (m_scanLineDirection == QVideoSurfaceFormat::BottomToTop) {
-            const QTransform oldTransform = painter->transform();
-
-            painter->scale(1, -1);
-            painter->translate(0, -target.bottom());
-            painter->drawImage(
-                QRectF(target.x(), 0, target.width(), target.height()), image, source);
-            painter->setTransform(oldTransform);
-        } else {
-            painter->drawImage(target, image, source);
-        }
+        drawImage(painter, target, image, source);
 
         m_frame.unmap();
     } else if (m_frame.isValid()) {
@@ -208,6 +266,22 @@ void QVideoSurfaceGenericPainter::updateColors(int, int, int, int)
 {
 }
 
+void QVideoSurfaceGenericPainter::drawImage(
+        QPainter *painter, const QRectF &target, const QImage &image, const QRectF &source)
+{
+    if (m_scanLineDirection == QVideoSurfaceFormat::BottomToTop) {
+        const QTransform oldTransform = painter->transform();
+
+        painter->scale(1, -1);
+        painter->translate(0, -target.bottom());
+        painter->drawImage(
+            QRectF(target.x(), 0, target.width(), target.height()), image, source);
+        painter->setTransform(oldTransform);
+    } else {
+        painter->drawImage(target, image, source);
+    }
+}
+
 #if !defined(QT_NO_OPENGL) && !defined(QT_OPENGL_ES_1_CL) && !defined(QT_OPENGL_ES_1)
 
 #ifndef Q_OS_MAC
@@ -325,6 +399,7 @@ QList<QVideoFrame::PixelFormat> QVideoSurfaceGLPainter::supportedPixelFormats(
 {
     switch (handleType) {
     case QAbstractVideoBuffer::NoHandle:
+    case QAbstractVideoBuffer::SharedMemoryHandle:
         return m_imagePixelFormats;
     case QAbstractVideoBuffer::QPixmapHandle:
     case QAbstractVideoBuffer::GLTextureHandle:
@@ -342,6 +417,7 @@ bool QVideoSurfaceGLPainter::isFormatSupported(const QVideoSurfaceFormat &format
     } else {
         switch (format.handleType()) {
         case QAbstractVideoBuffer::NoHandle:
+        case QAbstractVideoBuffer::SharedMemoryHandle:
             return m_imagePixelFormats.contains(format.pixelFormat());
         case QAbstractVideoBuffer::QPixmapHandle:
         case QAbstractVideoBuffer::GLTextureHandle:
@@ -715,7 +791,7 @@ QAbstractVideoSurface::Error QVideoSurfaceArbFpPainter::start(const QVideoSurfac
 
     const char *program = 0;
 
-    if (format.handleType() == QAbstractVideoBuffer::NoHandle) {
+    if (qt_isMappableHandleType(format.handleType())) {
         switch (format.pixelFormat()) {
         case QVideoFrame::Format_RGB32:
             initRgbTextureInfo(GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, format.frameSize());
@@ -818,7 +894,7 @@ QAbstractVideoSurface::Error QVideoSurfaceArbFpPainter::start(const QVideoSurfac
                 m_frameSize = format.frameSize();
                 m_colorSpace = format.yCbCrColorSpace();
 
-                if (m_handleType == QAbstractVideoBuffer::NoHandle)
+                if (qt_isMappableHandleType(m_handleType))
                     glGenTextures(m_textureCount, m_textureIds);
             }
         }
@@ -853,7 +929,7 @@ QAbstractVideoSurface::Error QVideoSurfaceArbFpPainter::paint(
     }
 
     const QAbstractVideoBuffer::HandleType h = m_frame.handleType();
-    if (h == QAbstractVideoBuffer::NoHandle || h == QAbstractVideoBuffer::GLTextureHandle) {
+    if (qt_isMappableHandleType(h) || h == QAbstractVideoBuffer::GLTextureHandle) {
         bool stencilTestEnabled = glIsEnabled(GL_STENCIL_TEST);
         bool scissorTestEnabled = glIsEnabled(GL_SCISSOR_TEST);
 
@@ -1081,7 +1157,7 @@ QAbstractVideoSurface::Error QVideoSurfaceGlslPainter::start(const QVideoSurface
 
     const char *fragmentProgram = 0;
 
-    if (format.handleType() == QAbstractVideoBuffer::NoHandle) {
+    if (qt_isMappableHandleType(format.handleType())) {
         switch (format.pixelFormat()) {
         case QVideoFrame::Format_RGB32:
             initRgbTextureInfo(GL_RGBA, GL_RGBA, GL_UNSIGNED_BYTE, format.frameSize());
@@ -1166,7 +1242,7 @@ QAbstractVideoSurface::Error QVideoSurfaceGlslPainter::start(const QVideoSurface
         m_frameSize = format.frameSize();
         m_colorSpace = format.yCbCrColorSpace();
 
-        if (m_handleType == QAbstractVideoBuffer::NoHandle)
+        if (qt_isMappableHandleType(m_handleType))
             glGenTextures(m_textureCount, m_textureIds);
     }
 
@@ -1199,7 +1275,7 @@ QAbstractVideoSurface::Error QVideoSurfaceGlslPainter::paint(
     }
 
     const QAbstractVideoBuffer::HandleType h = m_frame.handleType();
-    if (h == QAbstractVideoBuffer::NoHandle || h == QAbstractVideoBuffer::GLTextureHandle) {
+    if (qt_isMappableHandleType(h) || h == QAbstractVideoBuffer::GLTextureHandle) {
         bool stencilTestEnabled = glIsEnabled(GL_STENCIL_TEST);
         bool scissorTestEnabled = glIsEnabled(GL_SCISSOR_TEST);
 
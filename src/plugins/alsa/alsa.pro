@@ -10,12 +10,14 @@ LIBS += -lasound
 HEADERS += \
     qalsaplugin.h \
     qalsaaudiodeviceinfo.h \
+    qalsaaudiodevicecache.h \
     qalsaaudioinput.h \
     qalsaaudiooutput.h
 
 SOURCES += \
     qalsaplugin.cpp \
     qalsaaudiodeviceinfo.cpp \
+    qalsaaudiodevicecache.cpp \
     qalsaaudioinput.cpp \
     qalsaaudiooutput.cpp
 
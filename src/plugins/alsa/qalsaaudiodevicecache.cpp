@@ -0,0 +1,498 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qalsaaudiodevicecache.h"
+#include "qalsaaudiodeviceinfo.h"
+
+#include <QtCore/qglobal.h>
+#include <QtCore/qrunnable.h>
+#include <QtCore/qstring.h>
+
+#include <alsa/version.h>
+
+#include <sys/stat.h>
+
+QT_BEGIN_NAMESPACE
+
+Q_GLOBAL_STATIC(QAlsaAudioDeviceCache, deviceCache)
+
+QAlsaAudioDeviceCapabilities::QAlsaAudioDeviceCapabilities()
+    : valid(false)
+    , minChannels(0)
+    , maxChannels(0)
+    , minRate(0)
+    , maxRate(0)
+{
+}
+
+class QAlsaAudioDeviceCache::PrefetchTask : public QRunnable
+{
+public:
+    PrefetchTask(QAlsaAudioDeviceCache *cache) : m_cache(cache) {}
+
+    void run()
+    {
+        QList<QByteArray> inputs;
+        QList<QByteArray> outputs;
+        {
+            QMutexLocker locker(&m_cache->m_mutex);
+            m_cache->scan(&locker);
+            if (m_cache->m_cancelled)
+                return;
+            inputs = m_cache->m_lists.inputDevices;
+            outputs = m_cache->m_lists.outputDevices;
+        }
+
+        // The first device of each list is the default device
+        if (!outputs.isEmpty() && !isCancelled())
+            m_cache->capabilities(outputs.first(), QAudio::AudioOutput);
+        if (!inputs.isEmpty() && !isCancelled())
+            m_cache->capabilities(inputs.first(), QAudio::AudioInput);
+    }
+
+private:
+    bool isCancelled() const
+    {
+        QMutexLocker locker(&m_cache->m_mutex);
+        return m_cache->m_cancelled;
+    }
+
+    QAlsaAudioDeviceCache *m_cache;
+};
+
+/*
+    Process wide cache of the ALSA devices and of what their hardware
+    supports. Listing the devices walks the name hints of every card and
+    probing a device opens it, so both are done once, on a background
+    thread when the plugin is loaded. The cache is refreshed when a device
+    node is added to or removed from /dev/snd.
+*/
+QAlsaAudioDeviceCache::QAlsaAudioDeviceCache()
+    : m_scanning(false)
+    , m_scanned(false)
+    , m_cancelled(false)
+    , m_generation(0)
+{
+    m_threadPool.setMaxThreadCount(1);
+}
+
+QAlsaAudioDeviceCache::~QAlsaAudioDeviceCache()
+{
+    // The cache is destroyed at exit, the prefetch task may still be running
+    {
+        QMutexLocker locker(&m_mutex);
+        m_cancelled = true;
+    }
+    m_threadPool.waitForDone();
+}
+
+QAlsaAudioDeviceCache *QAlsaAudioDeviceCache::instance()
+{
+    return deviceCache();
+}
+
+void QAlsaAudioDeviceCache::prefetch()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_scanned || m_scanning)
+        return;
+
+    m_scanning = true;
+    m_threadPool.start(new PrefetchTask(this));
+}
+
+QList<QByteArray> QAlsaAudioDeviceCache::availableDevices(QAudio::Mode mode)
+{
+    QMutexLocker locker(&m_mutex);
+    update(&locker);
+
+    return mode == QAudio::AudioInput ? m_lists.inputDevices : m_lists.outputDevices;
+}
+
+void QAlsaAudioDeviceCache::surroundSupport(bool *surround40, bool *surround51, bool *surround71)
+{
+    QMutexLocker locker(&m_mutex);
+    update(&locker);
+
+    *surround40 = m_lists.surround40;
+    *surround51 = m_lists.surround51;
+    *surround71 = m_lists.surround71;
+}
+
+QAlsaAudioDeviceCapabilities QAlsaAudioDeviceCache::capabilities(const QByteArray &device, QAudio::Mode mode)
+{
+    const QPair<QByteArray, int> key(device, int(mode));
+
+    QMutexLocker locker(&m_mutex);
+    update(&locker);
+
+    QHash<QPair<QByteArray, int>, QAlsaAudioDeviceCapabilities>::const_iterator it = m_capabilities.constFind(key);
+    if (it != m_capabilities.constEnd())
+        return it.value();
+
+    const qint64 generation = m_generation;
+    locker.unlock();
+
+    const QAlsaAudioDeviceCapabilities capabilities = probe(device, mode);
+
+    // A device that couldn't be opened, for example because it is busy, is
+    // probed again next time.
+    locker.relock();
+    if (capabilities.valid && generation == m_generation)
+        m_capabilities.insert(key, capabilities);
+
+    return capabilities;
+}
+
+bool QAlsaAudioDeviceCache::supports(const QAlsaAudioDeviceSettings &settings)
+{
+    const QAlsaAudioDeviceCapabilities capabilities = this->capabilities(settings.device, settings.mode);
+    if (!capabilities.valid)
+        return false;
+
+    if (isProbed(settings))
+        return capabilities.supportedSettings.contains(settings);
+
+    // Other combinations are rare, rule out what the ranges can before
+    // opening the device for them.
+    if ((settings.channelCount != -1
+         && (uint(settings.channelCount) < capabilities.minChannels
+             || uint(settings.channelCount) > capabilities.maxChannels))
+            || (settings.sampleRate != -1
+                && (uint(settings.sampleRate) < capabilities.minRate
+                    || uint(settings.sampleRate) > capabilities.maxRate))) {
+        return false;
+    }
+
+    QMutexLocker locker(&m_mutex);
+    QHash<QAlsaAudioDeviceSettings, bool>::const_iterator it = m_supportedSettings.constFind(settings);
+    if (it != m_supportedSettings.constEnd())
+        return it.value();
+
+    const qint64 generation = m_generation;
+    locker.unlock();
+
+    bool opened = false;
+    const bool supported = probe(settings, &opened);
+
+    locker.relock();
+    if (opened && generation == m_generation)
+        m_supportedSettings.insert(settings, supported);
+
+    return supported;
+}
+
+// Called with the mutex locked
+void QAlsaAudioDeviceCache::update(QMutexLocker *locker)
+{
+    while (m_scanning)
+        m_scanFinished.wait(&m_mutex);
+
+    if (m_scanned && m_generation == deviceGeneration())
+        return;
+
+    m_scanning = true;
+    scan(locker);
+}
+
+// Called with the mutex locked and m_scanning set, the mutex is released
+// while the devices are listed.
+void QAlsaAudioDeviceCache::scan(QMutexLocker *locker)
+{
+    // Read before scanning, so a change while scanning causes another scan
+    const qint64 generation = deviceGeneration();
+
+    locker->unlock();
+    DeviceLists lists;
+    scanDevices(&lists);
+    locker->relock();
+
+    m_lists = lists;
+    m_capabilities.clear();
+    m_supportedSettings.clear();
+    m_generation = generation;
+    m_scanned = true;
+    m_scanning = false;
+    m_scanFinished.wakeAll();
+}
+
+qint64 QAlsaAudioDeviceCache::deviceGeneration()
+{
+    // udev adds and removes the card's nodes when it is plugged or unplugged
+    struct stat info;
+    if (::stat("/dev/snd", &info) != 0)
+        return 0;
+
+#if defined(Q_OS_LINUX)
+    return qint64(info.st_mtim.tv_sec) * 1000000000 + info.st_mtim.tv_nsec;
+#else
+    return qint64(info.st_mtime);
+#endif
+}
+
+void QAlsaAudioDeviceCache::scanDevices(DeviceLists *lists)
+{
+    void **hints;
+    char *name, *descr, *io;
+    int card = -1;
+
+#if(SND_LIB_MAJOR == 1 && SND_LIB_MINOR == 0 && SND_LIB_SUBMINOR >= 14)
+    // Create a list of all current audio devices for each mode
+    while (snd_card_next(&card) == 0 && card >= 0) {
+        if (snd_device_name_hint(card, "pcm", &hints) < 0)
+            continue;
+
+        void **n = hints;
+        while (*n != NULL) {
+            name = snd_device_name_get_hint(*n, "NAME");
+            descr = snd_device_name_get_hint(*n, "DESC");
+            io = snd_device_name_get_hint(*n, "IOID");
+
+            if (name != NULL && descr != NULL) {
+                const QString deviceName = QLatin1String(name);
+                if (deviceName.contains(QLatin1String("surround40")))
+                    lists->surround40 = true;
+                if (deviceName.contains(QLatin1String("surround51")))
+                    lists->surround51 = true;
+                if (deviceName.contains(QLatin1String("surround71")))
+                    lists->surround71 = true;
+
+                if (qstrcmp(name, "null") != 0) {
+                    const QByteArray device = deviceName.toLocal8Bit();
+                    const bool isDefault =
+                            QString(QLatin1String(descr)).contains(QLatin1String("Default Audio Device"));
+
+                    if (io == NULL || qstrcmp(io, "Input") == 0) {
+                        if (isDefault)
+                            lists->inputDevices.prepend(device);
+                        else
+                            lists->inputDevices.append(device);
+                    }
+                    if (io == NULL || qstrcmp(io, "Output") == 0) {
+                        if (isDefault)
+                            lists->outputDevices.prepend(device);
+                        else
+                            lists->outputDevices.append(device);
+                    }
+                }
+            }
+
+            free(name);
+            free(descr);
+            free(io);
+            ++n;
+        }
+
+        snd_device_name_free_hint(hints);
+    }
+#else
+    int idx = 0;
+    char* cardName;
+
+    while (snd_card_get_name(idx, &cardName) == 0) {
+        lists->inputDevices.append(cardName);
+        lists->outputDevices.append(cardName);
+        idx++;
+    }
+
+    while (snd_card_next(&card) == 0 && card >= 0) {
+        if (snd_device_name_hint(card, "pcm", &hints) < 0)
+            continue;
+
+        void **n = hints;
+        while (*n != NULL) {
+            name = snd_device_name_get_hint(*n, "NAME");
+            descr = snd_device_name_get_hint(*n, "DESC");
+            io = snd_device_name_get_hint(*n, "IOID");
+            if (name != NULL && descr != NULL) {
+                const QString deviceName = QLatin1String(name);
+                if (deviceName.contains(QLatin1String("surround40")))
+                    lists->surround40 = true;
+                if (deviceName.contains(QLatin1String("surround51")))
+                    lists->surround51 = true;
+                if (deviceName.contains(QLatin1String("surround71")))
+                    lists->surround71 = true;
+            }
+            free(name);
+            free(descr);
+            free(io);
+            ++n;
+        }
+
+        snd_device_name_free_hint(hints);
+    }
+#endif
+
+    if (lists->inputDevices.size() > 0)
+        lists->inputDevices.append("default");
+    if (lists->outputDevices.size() > 0)
+        lists->outputDevices.append("default");
+}
+
+// The formats QAlsaAudioDeviceInfo::testSettings() asks for, and the channel
+// counts and rates it lists.
+static const snd_pcm_format_t qt_probedFormats[] = {
+    SND_PCM_FORMAT_S8, SND_PCM_FORMAT_U8,
+    SND_PCM_FORMAT_S16_LE, SND_PCM_FORMAT_S16_BE, SND_PCM_FORMAT_U16_LE, SND_PCM_FORMAT_U16_BE,
+    SND_PCM_FORMAT_S32_LE, SND_PCM_FORMAT_S32_BE, SND_PCM_FORMAT_U32_LE, SND_PCM_FORMAT_U32_BE,
+    SND_PCM_FORMAT_FLOAT_LE, SND_PCM_FORMAT_FLOAT_BE
+};
+static const int qt_probedChannelCounts[] = { 1, 2, 4, 6, 8 };
+
+template<class T, int N> static bool qt_contains(const T (&values)[N], T value)
+{
+    for (int i = 0; i < N; ++i) {
+        if (values[i] == value)
+            return true;
+    }
+    return false;
+}
+
+bool QAlsaAudioDeviceCache::isProbed(const QAlsaAudioDeviceSettings &settings)
+{
+    return qt_contains(qt_probedFormats, settings.format)
+            && qt_contains(qt_probedChannelCounts, settings.channelCount)
+            && qt_contains(SAMPLE_RATES, uint(settings.sampleRate));
+}
+
+QAlsaAudioDeviceCapabilities QAlsaAudioDeviceCache::probe(const QByteArray &device, QAudio::Mode mode)
+{
+    QAlsaAudioDeviceCapabilities capabilities;
+
+    snd_pcm_stream_t stream = mode == QAudio::AudioOutput
+                            ? SND_PCM_STREAM_PLAYBACK : SND_PCM_STREAM_CAPTURE;
+
+    // Don't wait for a device that is in use, it is probed again later
+    snd_pcm_t *handle = 0;
+    if (snd_pcm_open(&handle, device.constData(), stream, SND_PCM_NONBLOCK) < 0)
+        return capabilities;
+
+    snd_pcm_hw_params_t *params;
+    snd_pcm_hw_params_alloca(&params);
+    if (snd_pcm_hw_params_any(handle, params) < 0) {
+        snd_pcm_close(handle);
+        return capabilities;
+    }
+
+    capabilities.valid = true;
+    snd_pcm_hw_params_get_channels_min(params, &capabilities.minChannels);
+    snd_pcm_hw_params_get_channels_max(params, &capabilities.maxChannels);
+    snd_pcm_hw_params_get_rate_min(params, &capabilities.minRate, 0);
+    snd_pcm_hw_params_get_rate_max(params, &capabilities.maxRate, 0);
+
+    probeSettings(&capabilities, handle, params, device, mode);
+
+    snd_pcm_close(handle);
+
+    return capabilities;
+}
+
+// Tests every listed combination against the configuration space of the
+// open device. Each setting restricts the space the next one is tested
+// against, as a rate may only be available for some formats, so the
+// restrictions are made on copies of the full space.
+void QAlsaAudioDeviceCache::probeSettings(QAlsaAudioDeviceCapabilities *capabilities, snd_pcm_t *handle,
+                                          snd_pcm_hw_params_t *params, const QByteArray &device,
+                                          QAudio::Mode mode)
+{
+    snd_pcm_hw_params_t *formatParams;
+    snd_pcm_hw_params_t *channelParams;
+    snd_pcm_hw_params_alloca(&formatParams);
+    snd_pcm_hw_params_alloca(&channelParams);
+
+    for (uint f = 0; f < sizeof(qt_probedFormats) / sizeof(qt_probedFormats[0]); ++f) {
+        const snd_pcm_format_t format = qt_probedFormats[f];
+        if (snd_pcm_hw_params_test_format(handle, params, format) < 0)
+            continue;
+
+        snd_pcm_hw_params_copy(formatParams, params);
+        if (snd_pcm_hw_params_set_format(handle, formatParams, format) < 0)
+            continue;
+
+        for (uint c = 0; c < sizeof(qt_probedChannelCounts) / sizeof(qt_probedChannelCounts[0]); ++c) {
+            const int channels = qt_probedChannelCounts[c];
+            if (snd_pcm_hw_params_test_channels(handle, formatParams, channels) < 0)
+                continue;
+
+            snd_pcm_hw_params_copy(channelParams, formatParams);
+            if (snd_pcm_hw_params_set_channels(handle, channelParams, channels) < 0)
+                continue;
+
+            for (uint r = 0; r < MAX_SAMPLE_RATES; ++r) {
+                if (snd_pcm_hw_params_test_rate(handle, channelParams, SAMPLE_RATES[r], 0) == 0) {
+                    capabilities->supportedSettings.insert(
+                                QAlsaAudioDeviceSettings(device, mode, format, channels, SAMPLE_RATES[r]));
+                }
+            }
+        }
+    }
+}
+
+bool QAlsaAudioDeviceCache::probe(const QAlsaAudioDeviceSettings &settings, bool *opened)
+{
+    snd_pcm_stream_t stream = settings.mode == QAudio::AudioOutput
+                            ? SND_PCM_STREAM_PLAYBACK : SND_PCM_STREAM_CAPTURE;
+
+    snd_pcm_t *handle = 0;
+    if (snd_pcm_open(&handle, settings.device.constData(), stream, SND_PCM_NONBLOCK) < 0)
+        return false;
+
+    *opened = true;
+
+    snd_pcm_hw_params_t *params;
+    snd_pcm_hw_params_alloca(&params);
+
+    // Each setting restricts the configuration space the next one is
+    // tested against, as a rate may only be available for some formats.
+    int err = snd_pcm_hw_params_any(handle, params);
+    if (err >= 0)
+        err = snd_pcm_hw_params_set_format(handle, params, settings.format);
+    if (err >= 0 && settings.channelCount != -1)
+        err = snd_pcm_hw_params_set_channels(handle, params, settings.channelCount);
+    if (err >= 0 && settings.sampleRate != -1)
+        err = snd_pcm_hw_params_set_rate(handle, params, settings.sampleRate, 0);
+
+    snd_pcm_close(handle);
+
+    return err >= 0;
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,168 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists for the convenience
+// of other Qt classes.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#ifndef QALSAAUDIODEVICECACHE_H
+#define QALSAAUDIODEVICECACHE_H
+
+#include <alsa/asoundlib.h>
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qpair.h>
+#include <QtCore/qset.h>
+#include <QtCore/qthreadpool.h>
+#include <QtCore/qwaitcondition.h>
+
+#include <QtMultimedia/qaudio.h>
+
+QT_BEGIN_NAMESPACE
+
+struct QAlsaAudioDeviceSettings
+{
+    QAlsaAudioDeviceSettings(const QByteArray &device, QAudio::Mode mode,
+                             snd_pcm_format_t format, int channelCount, int sampleRate)
+        : device(device), mode(mode), format(format)
+        , channelCount(channelCount), sampleRate(sampleRate) {}
+
+    QByteArray device;
+    QAudio::Mode mode;
+    snd_pcm_format_t format;
+    int channelCount;
+    int sampleRate;
+};
+
+inline bool operator==(const QAlsaAudioDeviceSettings &a, const QAlsaAudioDeviceSettings &b)
+{
+    return a.device == b.device && a.mode == b.mode && a.format == b.format
+            && a.channelCount == b.channelCount && a.sampleRate == b.sampleRate;
+}
+
+inline uint qHash(const QAlsaAudioDeviceSettings &settings, uint seed = 0)
+{
+    return qHash(settings.device, seed) ^ uint(settings.mode) ^ (uint(settings.format) << 2)
+            ^ (uint(settings.channelCount) << 8) ^ (uint(settings.sampleRate) << 12);
+}
+
+// What the hardware of a device accepts, from one probe of its hw params.
+// The combinations QAlsaAudioDeviceInfo lists are tested up front, the
+// channel and rate ranges rule out most of the others without opening the
+// device again.
+struct QAlsaAudioDeviceCapabilities
+{
+    QAlsaAudioDeviceCapabilities();
+
+    bool valid;
+    unsigned int minChannels;
+    unsigned int maxChannels;
+    unsigned int minRate;
+    unsigned int maxRate;
+    QSet<QAlsaAudioDeviceSettings> supportedSettings;
+};
+
+class QAlsaAudioDeviceCache
+{
+public:
+    QAlsaAudioDeviceCache();
+    ~QAlsaAudioDeviceCache();
+
+    static QAlsaAudioDeviceCache *instance();
+
+    void prefetch();
+
+    QList<QByteArray> availableDevices(QAudio::Mode mode);
+    void surroundSupport(bool *surround40, bool *surround51, bool *surround71);
+    QAlsaAudioDeviceCapabilities capabilities(const QByteArray &device, QAudio::Mode mode);
+    bool supports(const QAlsaAudioDeviceSettings &settings);
+
+private:
+    struct DeviceLists
+    {
+        DeviceLists() : surround40(false), surround51(false), surround71(false) {}
+
+        QList<QByteArray> inputDevices;
+        QList<QByteArray> outputDevices;
+        bool surround40;
+        bool surround51;
+        bool surround71;
+    };
+
+    class PrefetchTask;
+    friend class PrefetchTask;
+
+    void update(QMutexLocker *locker);
+    void scan(QMutexLocker *locker);
+    static qint64 deviceGeneration();
+    static void scanDevices(DeviceLists *lists);
+    static QAlsaAudioDeviceCapabilities probe(const QByteArray &device, QAudio::Mode mode);
+    static void probeSettings(QAlsaAudioDeviceCapabilities *capabilities, snd_pcm_t *handle,
+                              snd_pcm_hw_params_t *params, const QByteArray &device, QAudio::Mode mode);
+    static bool isProbed(const QAlsaAudioDeviceSettings &settings);
+    static bool probe(const QAlsaAudioDeviceSettings &settings, bool *opened);
+
+    QMutex m_mutex;
+    QWaitCondition m_scanFinished;
+    bool m_scanning;
+    bool m_scanned;
+    bool m_cancelled;
+    qint64 m_generation;
+    DeviceLists m_lists;
+    QHash<QPair<QByteArray, int>, QAlsaAudioDeviceCapabilities> m_capabilities;
+    QHash<QAlsaAudioDeviceSettings, bool> m_supportedSettings;
+    // Declared last, so the prefetch task is done before the rest goes away
+    QThreadPool m_threadPool;
+};
+
+QT_END_NAMESPACE
+
+#endif // QALSAAUDIODEVICECACHE_H
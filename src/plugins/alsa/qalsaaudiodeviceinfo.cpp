@@ -51,6 +51,7 @@
 //
 
 #include "qalsaaudiodeviceinfo.h"
+#include "qalsaaudiodevicecache.h"
 
 #include <alsa/version.h>
 
@@ -58,17 +59,12 @@ QT_BEGIN_NAMESPACE
 
 QAlsaAudioDeviceInfo::QAlsaAudioDeviceInfo(QByteArray dev, QAudio::Mode mode)
 {
-    handle = 0;
-
     device = QLatin1String(dev);
     this->mode = mode;
-
-    checkSurround();
 }
 
 QAlsaAudioDeviceInfo::~QAlsaAudioDeviceInfo()
 {
-    close();
 }
 
 bool QAlsaAudioDeviceInfo::isFormatSupported(const QAudioFormat& format) const
@@ -142,72 +138,16 @@ QList<QAudioFormat::SampleType> QAlsaAudioDeviceInfo::supportedSampleTypes()
     return typez;
 }
 
-bool QAlsaAudioDeviceInfo::open()
+QByteArray QAlsaAudioDeviceInfo::pcmDeviceName() const
 {
-    int err = 0;
     QString dev = device;
-    QList<QByteArray> devices = availableDevices(mode);
 
-    if(dev.compare(QLatin1String("default")) == 0) {
-#if(SND_LIB_MAJOR == 1 && SND_LIB_MINOR == 0 && SND_LIB_SUBMINOR >= 14)
-        if (devices.size() > 0)
-            dev = QLatin1String(devices.first().constData());
-        else
-            return false;
-#else
-        dev = QLatin1String("hw:0,0");
-#endif
-    } else {
 #if(SND_LIB_MAJOR == 1 && SND_LIB_MINOR == 0 && SND_LIB_SUBMINOR >= 14)
-        dev = device;
-#else
-        int idx = 0;
-        char *name;
-
-        QString shortName = device.mid(device.indexOf(QLatin1String("="),0)+1);
-
-        while (snd_card_get_name(idx,&name) == 0) {
-            if(dev.contains(QLatin1String(name)))
-                break;
-            idx++;
-        }
-        dev = QString(QLatin1String("hw:%1,0")).arg(idx);
-#endif
-    }
-    if(mode == QAudio::AudioOutput) {
-        err=snd_pcm_open( &handle,dev.toLocal8Bit().constData(),SND_PCM_STREAM_PLAYBACK,0);
-    } else {
-        err=snd_pcm_open( &handle,dev.toLocal8Bit().constData(),SND_PCM_STREAM_CAPTURE,0);
-    }
-    if(err < 0) {
-        handle = 0;
-        return false;
-    }
-    return true;
-}
-
-void QAlsaAudioDeviceInfo::close()
-{
-    if(handle)
-        snd_pcm_close(handle);
-    handle = 0;
-}
-
-bool QAlsaAudioDeviceInfo::testSettings(const QAudioFormat& format) const
-{
-    // Set nearest to closest settings that do work.
-    // See if what is in settings will work (return value).
-    int err = -1;
-    snd_pcm_t* pcmHandle;
-    snd_pcm_hw_params_t *params;
-    QString dev;
-
-#if(SND_LIB_MAJOR == 1 && SND_LIB_MINOR == 0 && SND_LIB_SUBMINOR >= 14)
-    dev = device;
     if (dev.compare(QLatin1String("default")) == 0) {
-        QList<QByteArray> devices = availableDevices(QAudio::AudioOutput);
-        if (!devices.isEmpty())
-            dev = QLatin1String(devices.first().constData());
+        QList<QByteArray> devices = availableDevices(mode);
+        if (devices.isEmpty())
+            return QByteArray();
+        dev = QLatin1String(devices.first().constData());
     }
 #else
     if (dev.compare(QLatin1String("default")) == 0) {
@@ -227,20 +167,15 @@ bool QAlsaAudioDeviceInfo::testSettings(const QAudioFormat& format) const
     }
 #endif
 
-    snd_pcm_stream_t stream = mode == QAudio::AudioOutput
-                            ? SND_PCM_STREAM_PLAYBACK : SND_PCM_STREAM_CAPTURE;
+    return dev.toLocal8Bit();
+}
 
-    if (snd_pcm_open(&pcmHandle, dev.toLocal8Bit().constData(), stream, 0) < 0)
+bool QAlsaAudioDeviceInfo::testSettings(const QAudioFormat& format) const
+{
+    // For now, just accept only audio/pcm codec
+    if (!format.codec().startsWith(QLatin1String("audio/pcm")))
         return false;
 
-    snd_pcm_nonblock(pcmHandle, 0);
-    snd_pcm_hw_params_alloca(&params);
-    snd_pcm_hw_params_any(pcmHandle, params);
-
-    // set the values!
-    snd_pcm_hw_params_set_channels(pcmHandle, params, format.channelCount());
-    snd_pcm_hw_params_set_rate(pcmHandle, params, format.sampleRate(), 0);
-
     snd_pcm_format_t pcmFormat = SND_PCM_FORMAT_UNKNOWN;
     switch (format.sampleSize()) {
     case 8:
@@ -271,34 +206,16 @@ bool QAlsaAudioDeviceInfo::testSettings(const QAudioFormat& format) const
         }
     }
 
-    if (pcmFormat != SND_PCM_FORMAT_UNKNOWN)
-        err = snd_pcm_hw_params_set_format(pcmHandle, params, pcmFormat);
-
-    // For now, just accept only audio/pcm codec
-    if (!format.codec().startsWith(QLatin1String("audio/pcm")))
-        err = -1;
-
-    if (err >= 0 && format.channelCount() != -1) {
-        err = snd_pcm_hw_params_test_channels(pcmHandle, params, format.channelCount());
-        if (err >= 0)
-            err = snd_pcm_hw_params_set_channels(pcmHandle, params, format.channelCount());
-    }
-
-    if (err >= 0 && format.sampleRate() != -1) {
-        err = snd_pcm_hw_params_test_rate(pcmHandle, params, format.sampleRate(), 0);
-        if (err >= 0)
-            err = snd_pcm_hw_params_set_rate(pcmHandle, params, format.sampleRate(), 0);
-    }
-
-    if (err >= 0 && pcmFormat != SND_PCM_FORMAT_UNKNOWN)
-        err = snd_pcm_hw_params_set_format(pcmHandle, params, pcmFormat);
-
-    if (err >= 0)
-        err = snd_pcm_hw_params(pcmHandle, params);
+    if (pcmFormat == SND_PCM_FORMAT_UNKNOWN)
+        return false;
 
-    snd_pcm_close(pcmHandle);
+    // Each combination is probed once and the answer cached
+    const QByteArray dev = pcmDeviceName();
+    if (dev.isEmpty())
+        return false;
 
-    return (err == 0);
+    return QAlsaAudioDeviceCache::instance()->supports(
+                QAlsaAudioDeviceSettings(dev, mode, pcmFormat, format.channelCount(), format.sampleRate()));
 }
 
 void QAlsaAudioDeviceInfo::updateLists()
@@ -311,12 +228,16 @@ void QAlsaAudioDeviceInfo::updateLists()
     typez.clear();
     codecz.clear();
 
-    if(!handle)
-        open();
-
-    if(!handle)
+    const QByteArray dev = pcmDeviceName();
+    if (dev.isEmpty() || !QAlsaAudioDeviceCache::instance()->capabilities(dev, mode).valid)
         return;
 
+    bool surround40 = false;
+    bool surround51 = false;
+    bool surround71 = false;
+    if (mode == QAudio::AudioOutput)
+        QAlsaAudioDeviceCache::instance()->surroundSupport(&surround40, &surround51, &surround71);
+
     for(int i=0; i<(int)MAX_SAMPLE_RATES; i++) {
         //if(snd_pcm_hw_params_test_rate(handle, params, SAMPLE_RATES[i], dir) == 0)
         sampleRatez.append(SAMPLE_RATES[i]);
@@ -335,69 +256,11 @@ void QAlsaAudioDeviceInfo::updateLists()
     typez.append(QAudioFormat::UnSignedInt);
     typez.append(QAudioFormat::Float);
     codecz.append(QLatin1String("audio/pcm"));
-    close();
 }
 
 QList<QByteArray> QAlsaAudioDeviceInfo::availableDevices(QAudio::Mode mode)
 {
-    QList<QByteArray> devices;
-    QByteArray filter;
-
-#if(SND_LIB_MAJOR == 1 && SND_LIB_MINOR == 0 && SND_LIB_SUBMINOR >= 14)
-    // Create a list of all current audio devices that support mode
-    void **hints;
-    char *name, *descr, *io;
-    int card = -1;
-
-    if(mode == QAudio::AudioInput) {
-        filter = "Input";
-    } else {
-        filter = "Output";
-    }
-
-    while (snd_card_next(&card) == 0 && card >= 0) {
-        if (snd_device_name_hint(card, "pcm", &hints) < 0)
-            continue;
-
-        void **n = hints;
-        while (*n != NULL) {
-            name = snd_device_name_get_hint(*n, "NAME");
-            if (name != 0 && qstrcmp(name, "null") != 0) {
-                descr = snd_device_name_get_hint(*n, "DESC");
-                io = snd_device_name_get_hint(*n, "IOID");
-
-                if ((descr != NULL) && ((io == NULL) || (io == filter))) {
-                    QString deviceName = QLatin1String(name);
-                    QString deviceDescription = QLatin1String(descr);
-                    if (deviceDescription.contains(QLatin1String("Default Audio Device")))
-                        devices.prepend(deviceName.toLocal8Bit().constData());
-                    else
-                        devices.append(deviceName.toLocal8Bit().constData());
-                }
-
-                free(descr);
-                free(io);
-            }
-            free(name);
-            ++n;
-        }
-
-        snd_device_name_free_hint(hints);
-    }
-#else
-    int idx = 0;
-    char* name;
-
-    while(snd_card_get_name(idx,&name) == 0) {
-        devices.append(name);
-        idx++;
-    }
-#endif
-
-    if (devices.size() > 0)
-        devices.append("default");
-
-    return devices;
+    return QAlsaAudioDeviceCache::instance()->availableDevices(mode);
 }
 
 QByteArray QAlsaAudioDeviceInfo::defaultInputDevice()
@@ -418,47 +281,4 @@ QByteArray QAlsaAudioDeviceInfo::defaultOutputDevice()
     return devices.first();
 }
 
-void QAlsaAudioDeviceInfo::checkSurround()
-{
-    surround40 = false;
-    surround51 = false;
-    surround71 = false;
-
-    void **hints;
-    char *name, *descr, *io;
-    int card = -1;
-
-    while (snd_card_next(&card) == 0 && card >= 0) {
-        if (snd_device_name_hint(card, "pcm", &hints) < 0)
-            continue;
-
-        void **n = hints;
-        while (*n != NULL) {
-            name = snd_device_name_get_hint(*n, "NAME");
-            descr = snd_device_name_get_hint(*n, "DESC");
-            io = snd_device_name_get_hint(*n, "IOID");
-            if((name != NULL) && (descr != NULL)) {
-                QString deviceName = QLatin1String(name);
-                if (mode == QAudio::AudioOutput) {
-                    if(deviceName.contains(QLatin1String("surround40")))
-                        surround40 = true;
-                    if(deviceName.contains(QLatin1String("surround51")))
-                        surround51 = true;
-                    if(deviceName.contains(QLatin1String("surround71")))
-                        surround71 = true;
-                }
-            }
-            if(name != NULL)
-                free(name);
-            if(descr != NULL)
-                free(descr);
-            if(io != NULL)
-                free(io);
-            ++n;
-        }
-
-        snd_device_name_free_hint(hints);
-    }
-}
-
 QT_END_NAMESPACE
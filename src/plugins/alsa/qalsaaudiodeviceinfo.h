@@ -95,13 +95,7 @@ public:
     static QList<QByteArray> availableDevices(QAudio::Mode);
 
 private:
-    bool open();
-    void close();
-
-    void checkSurround();
-    bool surround40;
-    bool surround51;
-    bool surround71;
+    QByteArray pcmDeviceName() const;
 
     QString device;
     QAudio::Mode mode;
@@ -112,8 +106,6 @@ private:
     QList<QAudioFormat::Endian> byteOrderz;
     QStringList codecz;
     QList<QAudioFormat::SampleType> typez;
-    snd_pcm_t* handle;
-    snd_pcm_hw_params_t *params;
 };
 
 QT_END_NAMESPACE
@@ -51,14 +51,177 @@
 //
 
 #include <QtCore/qcoreapplication.h>
+#include <QtCore/qthread.h>
 #include <QtMultimedia/private/qaudiohelpers_p.h>
 #include "qalsaaudioinput.h"
 #include "qalsaaudiodeviceinfo.h"
 
+#include <pthread.h>
+#include <sched.h>
+
 QT_BEGIN_NAMESPACE
 
 //#define DEBUG_AUDIO 1
 
+// Period timestamps kept for periodTimestamps()
+const int MaxPeriodTimestamps = 64;
+
+class QAlsaAudioInputThread : public QThread
+{
+public:
+    QAlsaAudioInputThread(QAlsaAudioInput *input)
+        : m_input(input)
+    {
+    }
+
+    void requestStop() { m_stop.store(1); }
+
+protected:
+    void run();
+
+private:
+    bool recover(int err);
+    void raisePriority();
+    void store(const char *data, int len);
+
+    QAlsaAudioInput *m_input;
+    QAtomicInt m_stop;
+};
+
+void QAlsaAudioInputThread::raisePriority()
+{
+    sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO)
+            + (sched_get_priority_max(SCHED_FIFO) - sched_get_priority_min(SCHED_FIFO)) / 2;
+
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        qWarning("QAudioInput: could not enable realtime scheduling for the ALSA thread");
+}
+
+bool QAlsaAudioInputThread::recover(int err)
+{
+    if (err == -EPIPE || err == -ESTRPIPE) {
+        QMutexLocker locker(&m_input->statsMutex);
+        ++m_input->overruns;
+    }
+
+    // Capture doesn't restart by itself after an xrun
+    snd_pcm_t *handle = m_input->handle;
+    if (snd_pcm_recover(handle, err, 1) < 0
+            || (snd_pcm_state(handle) == SND_PCM_STATE_PREPARED && snd_pcm_start(handle) < 0)) {
+        QMetaObject::invokeMethod(m_input, "captureError", Qt::QueuedConnection);
+        return false;
+    }
+    return true;
+}
+
+// Copies from the mmap area into the ring, applying the volume on the way
+void QAlsaAudioInputThread::store(const char *data, int len)
+{
+    QAudioRingBuffer &captureBuffer = m_input->captureBuffer;
+    const qreal volume = m_input->m_volume;
+
+    while (len > 0) {
+        const QAudioRingBuffer::Region region = captureBuffer.acquireWriteRegion(len);
+        if (region.second == 0) {
+            // The reader fell behind by a whole ring, drop the rest
+            QMutexLocker locker(&m_input->statsMutex);
+            ++m_input->overruns;
+            return;
+        }
+
+        if (volume < 1.0f)
+            QAudioHelperInternal::qMultiplySamples(volume, m_input->settings, data, region.first, region.second);
+        else
+            memcpy(region.first, data, region.second);
+
+        captureBuffer.releaseWriteRegion(region);
+        data += region.second;
+        len -= region.second;
+    }
+}
+
+void QAlsaAudioInputThread::run()
+{
+    if (m_input->realtime)
+        raisePriority();
+
+    snd_pcm_t *handle = m_input->handle;
+    const int frameBytes = snd_pcm_frames_to_bytes(handle, 1);
+    const int periodBytes = snd_pcm_frames_to_bytes(handle, m_input->period_frames);
+    const int periodMSecs = qMax(1, int(m_input->period_time / 1000));
+    const int timeout = qMax(10, 2 * periodMSecs);
+    qint64 framesCaptured = 0;
+
+    while (!m_stop.load()) {
+        int err = snd_pcm_wait(handle, timeout);
+        if (err < 0 && !recover(err))
+            return;
+
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+        if (avail < 0) {
+            if (!recover(avail))
+                return;
+            continue;
+        }
+
+        while (avail > 0) {
+            const snd_pcm_channel_area_t *areas = 0;
+            snd_pcm_uframes_t offset = 0;
+            snd_pcm_uframes_t frames = avail;
+
+            err = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+            if (err < 0) {
+                if (!recover(err))
+                    return;
+                break;
+            }
+            if (frames == 0)
+                break;
+
+            // Interleaved access, so the first area covers all channels
+            const char *data = static_cast<const char *>(areas[0].addr)
+                    + (areas[0].first + offset * areas[0].step) / 8;
+            store(data, frames * frameBytes);
+
+            const snd_pcm_sframes_t committed = snd_pcm_mmap_commit(handle, offset, frames);
+            if (committed < 0 || snd_pcm_uframes_t(committed) != frames) {
+                if (!recover(committed < 0 ? int(committed) : -EPIPE))
+                    return;
+                break;
+            }
+
+            avail -= frames;
+            framesCaptured += frames;
+        }
+
+        // The device stamped the moment it had 'pending' frames waiting for
+        // us, so the newest of those was captured at that time.
+        snd_pcm_uframes_t pending = 0;
+        snd_htimestamp_t tstamp;
+        const bool stamped = snd_pcm_htimestamp(handle, &pending, &tstamp) == 0
+                && (tstamp.tv_sec != 0 || tstamp.tv_nsec != 0);
+
+        {
+            QMutexLocker locker(&m_input->statsMutex);
+            m_input->delayFrames = pending;
+            if (stamped) {
+                QAlsaAudioInput::PeriodTimestamp period;
+                period.frame = framesCaptured + pending;
+                period.timestamp = qint64(tstamp.tv_sec) * 1000000 + tstamp.tv_nsec / 1000;
+                m_input->timestamps.append(period);
+                if (m_input->timestamps.size() > MaxPeriodTimestamps)
+                    m_input->timestamps.removeFirst();
+            }
+        }
+
+        if (m_input->captureBuffer.used() >= periodBytes
+                && m_input->feedPending.testAndSetOrdered(0, 1)) {
+            QMetaObject::invokeMethod(m_input, "userFeed", Qt::QueuedConnection);
+        }
+    }
+}
+
 QAlsaAudioInput::QAlsaAudioInput(const QByteArray &device)
 {
     bytesAvailable = 0;
@@ -82,6 +245,13 @@ QAlsaAudioInput::QAlsaAudioInput(const QByteArray &device)
 
     m_device = device;
 
+    mmapRequested = qgetenv("QT_ALSA_INPUT_MMAP").toInt() > 0;
+    mmapMode = false;
+    realtime = mmapRequested && qgetenv("QT_ALSA_INPUT_REALTIME").toInt() > 0;
+    captureThread = 0;
+    delayFrames = 0;
+    overruns = 0;
+
     timer = new QTimer(this);
     connect(timer,SIGNAL(timeout()),SLOT(userFeed()));
 }
@@ -92,6 +262,7 @@ QAlsaAudioInput::~QAlsaAudioInput()
     disconnect(timer, SIGNAL(timeout()));
     QCoreApplication::processEvents();
     delete timer;
+    delete captureThread;
 }
 
 void QAlsaAudioInput::setVolume(qreal vol)
@@ -308,6 +479,19 @@ bool QAlsaAudioInput::open()
         return false;
     }
 
+    mmapMode = mmapRequested;
+    access = mmapMode ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED;
+
+    if (mmapMode && buffer_size > 0) {
+        // The capture thread doesn't depend on the event loop, so honour
+        // small buffers; four periods per buffer.
+        const int bytesPerSecond = settings.sampleRate() * settings.channelCount() * settings.sampleSize() / 8;
+        if (bytesPerSecond > 0) {
+            buffer_time = qMax<qint64>(1000, qint64(buffer_size) * 1000000 / bytesPerSecond);
+            period_time = buffer_time / 4;
+        }
+    }
+
 
     QString dev = QString(QLatin1String(m_device.constData()));
     QList<QByteArray> devices = QAlsaAudioDeviceInfo::availableDevices(QAudio::AudioInput);
@@ -357,7 +541,7 @@ bool QAlsaAudioInput::open()
 
     bool fatal = false;
     QString errMessage;
-    unsigned int chunks = 8;
+    unsigned int chunks = mmapMode ? 4 : 8;
 
     err = snd_pcm_hw_params_any( handle, hwparams );
     if ( err < 0 ) {
@@ -373,6 +557,12 @@ bool QAlsaAudioInput::open()
     }
     if ( !fatal ) {
         err = snd_pcm_hw_params_set_access( handle, hwparams, access );
+        if ( err < 0 && mmapMode ) {
+            qWarning("QAudioInput: device does not support mmap access, using read access");
+            mmapMode = false;
+            access = SND_PCM_ACCESS_RW_INTERLEAVED;
+            err = snd_pcm_hw_params_set_access( handle, hwparams, access );
+        }
         if ( err < 0 ) {
             fatal = true;
             errMessage = QString::fromLatin1("QAudioInput: snd_pcm_hw_params_set_access: err = %1").arg(err);
@@ -448,13 +638,30 @@ bool QAlsaAudioInput::open()
     snd_pcm_sw_params_set_start_threshold(handle,swparams,period_frames);
     snd_pcm_sw_params_set_stop_threshold(handle,swparams,buffer_frames);
     snd_pcm_sw_params_set_avail_min(handle, swparams,period_frames);
+    if (mmapMode) {
+        // Have the device stamp every period for periodTimestamps()
+        snd_pcm_sw_params_set_tstamp_mode(handle, swparams, SND_PCM_TSTAMP_ENABLE);
+#if SND_LIB_VERSION >= 0x01001c
+        snd_pcm_sw_params_set_tstamp_type(handle, swparams, SND_PCM_TSTAMP_TYPE_MONOTONIC);
+#endif
+    }
     snd_pcm_sw_params(handle, swparams);
 
     // Step 4: Prepare audio
     ringBuffer.resize(buffer_size);
+    if (mmapMode) {
+        captureBuffer.resize(2 * buffer_size);
+        QMutexLocker locker(&statsMutex);
+        timestamps.clear();
+        delayFrames = 0;
+        overruns = 0;
+    }
     snd_pcm_prepare( handle );
     snd_pcm_start(handle);
 
+    if (mmapMode)
+        startCaptureThread();
+
     // Step 5: Setup timer
     bytesAvailable = checkBytesReady();
 
@@ -475,6 +682,7 @@ bool QAlsaAudioInput::open()
 void QAlsaAudioInput::close()
 {
     timer->stop();
+    stopCaptureThread();
 
     if ( handle ) {
         snd_pcm_drop( handle );
@@ -490,6 +698,8 @@ int QAlsaAudioInput::checkBytesReady()
     else if(deviceState != QAudio::ActiveState
             && deviceState != QAudio::IdleState)
         bytesAvailable = 0;
+    else if (mmapMode)
+        bytesAvailable = captureBuffer.used();
     else {
         int frames = snd_pcm_avail_update(handle);
         if (frames < 0) {
@@ -514,6 +724,9 @@ qint64 QAlsaAudioInput::read(char* data, qint64 len)
     if ( !handle )
         return 0;
 
+    if (mmapMode)
+        return readFromCaptureBuffer(data, len);
+
     int bytesRead = 0;
     int bytesInRingbufferBeforeRead = ringBuffer.bytesOfDataInBuffer();
 
@@ -649,6 +862,136 @@ qint64 QAlsaAudioInput::read(char* data, qint64 len)
     return 0;
 }
 
+qint64 QAlsaAudioInput::readFromCaptureBuffer(char *data, qint64 len)
+{
+    feedPending.store(0);
+
+    if (deviceState != QAudio::ActiveState && deviceState != QAudio::IdleState)
+        return 0;
+
+    qint64 bytesRead = 0;
+
+    if (pullMode) {
+        // Hand contiguous blocks to the device straight from the ring
+        qint64 l = 0;
+        forever {
+            const QAudioRingBuffer::Region region = captureBuffer.acquireReadRegion(captureBuffer.size());
+            if (region.second == 0)
+                break;
+
+            l = audioSource->write(region.first, region.second);
+            if (l <= 0)
+                break;
+
+            captureBuffer.releaseReadRegion(QAudioRingBuffer::Region(region.first, int(l)));
+            bytesRead += l;
+            if (l < region.second)
+                break;
+        }
+
+        if (l < 0) {
+            close();
+            errorState = QAudio::IOError;
+            deviceState = QAudio::StoppedState;
+            emit stateChanged(deviceState);
+            return 0;
+        } else if (bytesRead == 0 && captureBuffer.used() > 0) {
+            if (deviceState != QAudio::IdleState) {
+                errorState = QAudio::NoError;
+                deviceState = QAudio::IdleState;
+                emit stateChanged(deviceState);
+            }
+            return 0;
+        }
+    } else {
+        bytesRead = captureBuffer.read(data, int(qMin<qint64>(len, captureBuffer.size())));
+    }
+
+    bytesAvailable = captureBuffer.used();
+
+    if (bytesRead > 0) {
+        totalTimeValue += bytesRead;
+        resuming = false;
+        if (deviceState != QAudio::ActiveState) {
+            errorState = QAudio::NoError;
+            deviceState = QAudio::ActiveState;
+            emit stateChanged(deviceState);
+        }
+    }
+
+    return bytesRead;
+}
+
+void QAlsaAudioInput::startCaptureThread()
+{
+    if (!captureThread)
+        captureThread = new QAlsaAudioInputThread(this);
+    else if (captureThread->isRunning())
+        return;
+
+    feedPending.store(0);
+    captureThread->start(realtime ? QThread::TimeCriticalPriority : QThread::HighestPriority);
+}
+
+void QAlsaAudioInput::stopCaptureThread()
+{
+    if (captureThread && captureThread->isRunning()) {
+        captureThread->requestStop();
+        captureThread->wait();
+        delete captureThread;
+        captureThread = 0;
+    }
+}
+
+void QAlsaAudioInput::captureError()
+{
+    if (deviceState == QAudio::StoppedState)
+        return;
+
+    close();
+    errorState = QAudio::FatalError;
+    emit errorChanged(errorState);
+    deviceState = QAudio::StoppedState;
+    emit stateChanged(deviceState);
+}
+
+qint64 QAlsaAudioInput::latencyUSecs() const
+{
+    if (!handle || settings.sampleRate() <= 0)
+        return -1;
+
+    snd_pcm_sframes_t frames = 0;
+    if (mmapMode) {
+        QMutexLocker locker(&statsMutex);
+        frames = delayFrames + snd_pcm_bytes_to_frames(handle, captureBuffer.used());
+    } else if (snd_pcm_delay(handle, &frames) < 0) {
+        frames = 0;
+    }
+
+    return qint64(1000000) * frames / settings.sampleRate();
+}
+
+int QAlsaAudioInput::overrunCount() const
+{
+    QMutexLocker locker(&statsMutex);
+    return overruns;
+}
+
+// Each entry maps "frame" and "timestamp" to the fields of a PeriodTimestamp,
+// oldest first.
+QVariantList QAlsaAudioInput::periodTimestamps() const
+{
+    QMutexLocker locker(&statsMutex);
+    QVariantList periods;
+    foreach (const PeriodTimestamp &period, timestamps) {
+        QVariantMap entry;
+        entry.insert(QStringLiteral("frame"), period.frame);
+        entry.insert(QStringLiteral("timestamp"), period.timestamp);
+        periods.append(entry);
+    }
+    return periods;
+}
+
 void QAlsaAudioInput::resume()
 {
     if(deviceState == QAudio::SuspendedState) {
@@ -664,6 +1007,12 @@ void QAlsaAudioInput::resume()
                 xrun_recovery(err);
 
             bytesAvailable = buffer_size;
+
+            if (mmapMode) {
+                captureBuffer.reset();
+                bytesAvailable = 0;
+                startCaptureThread();
+            }
         }
         resuming = true;
         deviceState = QAudio::ActiveState;
@@ -711,6 +1060,7 @@ void QAlsaAudioInput::suspend()
 {
     if(deviceState == QAudio::ActiveState||resuming) {
         timer->stop();
+        stopCaptureThread();
         deviceState = QAudio::SuspendedState;
         emit stateChanged(deviceState);
     }
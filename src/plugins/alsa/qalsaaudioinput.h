@@ -62,15 +62,20 @@
 #include <QtCore/qstring.h>
 #include <QtCore/qstringlist.h>
 #include <QtCore/qdatetime.h>
+#include <QtCore/qmutex.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qvariant.h>
 
 #include <QtMultimedia/qaudio.h>
 #include <QtMultimedia/qaudiodeviceinfo.h>
 #include <QtMultimedia/qaudiosystem.h>
+#include <QtMultimedia/private/qaudioringbuffer_p.h>
 
 QT_BEGIN_NAMESPACE
 
 
 class InputPrivate;
+class QAlsaAudioInputThread;
 
 class RingBuffer
 {
@@ -97,7 +102,11 @@ private:
 
 class QAlsaAudioInput : public QAbstractAudioInput
 {
+    friend class QAlsaAudioInputThread;
     Q_OBJECT
+    Q_PROPERTY(qint64 latencyUSecs READ latencyUSecs)
+    Q_PROPERTY(int overrunCount READ overrunCount)
+    Q_PROPERTY(QVariantList periodTimestamps READ periodTimestamps)
 public:
     QAlsaAudioInput(const QByteArray &device);
     ~QAlsaAudioInput();
@@ -124,6 +133,11 @@ public:
     QAudioFormat format() const;
     void setVolume(qreal);
     qreal volume() const;
+
+    qint64 latencyUSecs() const;
+    int overrunCount() const;
+    QVariantList periodTimestamps() const;
+
     bool resuming;
     snd_pcm_t* handle;
     qint64 totalTimeValue;
@@ -135,9 +149,13 @@ public:
 private slots:
     void userFeed();
     bool deviceReady();
+    void captureError();
 
 private:
     int checkBytesReady();
+    qint64 readFromCaptureBuffer(char *data, qint64 len);
+    void startCaptureThread();
+    void stopCaptureThread();
     int xrun_recovery(int err);
     int setFormat();
     bool open();
@@ -165,6 +183,28 @@ private:
     snd_timestamp_t* timestamp;
     snd_pcm_hw_params_t *hwparams;
     qreal m_volume;
+
+    // Mmap mode: a dedicated thread takes periods straight out of the
+    // device's mmap area into captureBuffer, which read() drains.
+    bool mmapRequested;
+    bool mmapMode;
+    bool realtime;
+    QAlsaAudioInputThread *captureThread;
+    QAudioRingBuffer captureBuffer;
+    QAtomicInt feedPending;
+    // Device timestamp of a captured period: frame is the number of frames
+    // captured since start() when the device stamped them at timestamp
+    // (microseconds, monotonic clock where ALSA supports it).
+    struct PeriodTimestamp
+    {
+        qint64 frame;
+        qint64 timestamp;
+    };
+
+    mutable QMutex statsMutex;
+    QList<PeriodTimestamp> timestamps;
+    snd_pcm_sframes_t delayFrames;
+    int overruns;
 };
 
 class InputPrivate : public QIODevice
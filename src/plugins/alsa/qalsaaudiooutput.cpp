@@ -51,14 +51,134 @@
 //
 
 #include <QtCore/qcoreapplication.h>
+#include <QtCore/qthread.h>
 #include <QtMultimedia/private/qaudiohelpers_p.h>
 #include "qalsaaudiooutput.h"
 #include "qalsaaudiodeviceinfo.h"
 
+#include <pthread.h>
+#include <sched.h>
+
 QT_BEGIN_NAMESPACE
 
 //#define DEBUG_AUDIO 1
 
+class QAlsaAudioOutputThread : public QThread
+{
+public:
+    QAlsaAudioOutputThread(QAlsaAudioOutput *output)
+        : m_output(output)
+    {
+    }
+
+    void requestStop() { m_stop.store(1); }
+
+protected:
+    void run();
+
+private:
+    bool recover(int err);
+    void raisePriority();
+
+    QAlsaAudioOutput *m_output;
+    QAtomicInt m_stop;
+};
+
+void QAlsaAudioOutputThread::raisePriority()
+{
+    sched_param param;
+    param.sched_priority = sched_get_priority_min(SCHED_FIFO)
+            + (sched_get_priority_max(SCHED_FIFO) - sched_get_priority_min(SCHED_FIFO)) / 2;
+
+    if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &param) != 0)
+        qWarning("QAudioOutput: could not enable realtime scheduling for the ALSA thread");
+}
+
+bool QAlsaAudioOutputThread::recover(int err)
+{
+    if (err == -EPIPE || err == -ESTRPIPE) {
+        QMutexLocker locker(&m_output->statsMutex);
+        ++m_output->xruns;
+    }
+
+    if (snd_pcm_recover(m_output->handle, err, 1) < 0) {
+        QMetaObject::invokeMethod(m_output, "feederError", Qt::QueuedConnection);
+        return false;
+    }
+    return true;
+}
+
+void QAlsaAudioOutputThread::run()
+{
+    if (m_output->realtime)
+        raisePriority();
+
+    snd_pcm_t *handle = m_output->handle;
+    QAudioRingBuffer &ringBuffer = m_output->ringBuffer;
+
+    const snd_pcm_uframes_t bufferFrames = m_output->buffer_frames;
+    const snd_pcm_uframes_t periodFrames = m_output->period_frames;
+    const int periodMSecs = qMax(1, int(m_output->period_time / 1000));
+    const int timeout = qMax(10, 2 * periodMSecs);
+
+    while (!m_stop.load()) {
+        int err = snd_pcm_wait(handle, timeout);
+        if (err < 0 && !recover(err))
+            return;
+
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+        if (avail < 0) {
+            if (!recover(avail))
+                return;
+            continue;
+        }
+
+        snd_pcm_sframes_t written = 0;
+        while (avail > 0) {
+            const QAudioRingBuffer::Region region
+                    = ringBuffer.acquireReadRegion(snd_pcm_frames_to_bytes(handle, avail));
+            const snd_pcm_sframes_t frames = snd_pcm_bytes_to_frames(handle, region.second);
+            if (frames <= 0)
+                break;
+
+            const snd_pcm_sframes_t result = snd_pcm_writei(handle, region.first, frames);
+            if (result < 0) {
+                if (!recover(result))
+                    return;
+                break;
+            }
+
+            ringBuffer.releaseReadRegion(QAudioRingBuffer::Region(region.first,
+                                                                  snd_pcm_frames_to_bytes(handle, result)));
+            avail -= result;
+            written += result;
+        }
+
+        snd_pcm_sframes_t delay = 0;
+        if (snd_pcm_delay(handle, &delay) < 0)
+            delay = 0;
+
+        {
+            QMutexLocker locker(&m_output->statsMutex);
+            m_output->framesWritten += written;
+            m_output->delayFrames = delay;
+        }
+
+        if (ringBuffer.used() == 0) {
+            // The device is about to run dry and there is nothing to give it
+            if (snd_pcm_uframes_t(avail) + periodFrames >= bufferFrames)
+                m_output->starvedCount.ref();
+            if (written == 0)
+                usleep(periodMSecs * 500);
+        }
+
+        if (ringBuffer.free() >= ringBuffer.size() / 2
+                && m_output->feedPending.testAndSetOrdered(0, 1)) {
+            QMetaObject::invokeMethod(m_output, "userFeed", Qt::QueuedConnection);
+        }
+    }
+}
+
 QAlsaAudioOutput::QAlsaAudioOutput(const QByteArray &device)
 {
     bytesAvailable = 0;
@@ -86,6 +206,15 @@ QAlsaAudioOutput::QAlsaAudioOutput(const QByteArray &device)
 
     m_device = device;
 
+    threaded = qgetenv("QT_ALSA_OUTPUT_THREAD").toInt() > 0;
+    realtime = threaded && qgetenv("QT_ALSA_OUTPUT_REALTIME").toInt() > 0;
+    feederThread = 0;
+    lastStarvedCount = 0;
+    lastXrunCount = 0;
+    framesWritten = 0;
+    delayFrames = 0;
+    xruns = 0;
+
     timer = new QTimer(this);
     connect(timer,SIGNAL(timeout()),SLOT(userFeed()));
 }
@@ -96,6 +225,7 @@ QAlsaAudioOutput::~QAlsaAudioOutput()
     disconnect(timer, SIGNAL(timeout()));
     QCoreApplication::processEvents();
     delete timer;
+    delete feederThread;
 }
 
 void QAlsaAudioOutput::setVolume(qreal vol)
@@ -323,6 +453,16 @@ bool QAlsaAudioOutput::open()
         return false;
     }
 
+    if (threaded && buffer_size > 0) {
+        // The feeder thread doesn't depend on the event loop, so honour
+        // small buffers; four periods per buffer.
+        const int bytesPerSecond = settings.sampleRate() * settings.channelCount() * settings.sampleSize() / 8;
+        if (bytesPerSecond > 0) {
+            buffer_time = qMax<qint64>(1000, qint64(buffer_size) * 1000000 / bytesPerSecond);
+            period_time = buffer_time / 4;
+        }
+    }
+
     QString dev = QString(QLatin1String(m_device.constData()));
     QList<QByteArray> devices = QAlsaAudioDeviceInfo::availableDevices(QAudio::AudioOutput);
     if(dev.compare(QLatin1String("default")) == 0) {
@@ -510,6 +650,36 @@ bool QAlsaAudioOutput::open()
     if(audioBuffer == 0)
         audioBuffer = new char[snd_pcm_frames_to_bytes(handle,buffer_frames)];
     snd_pcm_prepare( handle );
+
+    clockStamp.restart();
+    timeStamp.restart();
+    elapsedTimeOffset = 0;
+    errorState  = QAudio::NoError;
+    totalTimeValue = 0;
+    opened = true;
+
+    if (threaded) {
+        // Step 5: The device starts on its own once the first period
+        // is written by the feeder thread.
+        ringBuffer.resize(2 * buffer_size);
+        {
+            QMutexLocker locker(&statsMutex);
+            framesWritten = 0;
+            delayFrames = 0;
+            xruns = 0;
+        }
+        lastXrunCount = 0;
+        lastStarvedCount = starvedCount.load();
+        bytesAvailable = bytesFree();
+
+        startFeederThread();
+
+        // Step 6: The timer is only a fallback, the feeder thread asks for
+        // more data when the ring buffer runs half empty.
+        timer->start(qMax<int>(period_time / 1000, buffer_time / 2000));
+        return true;
+    }
+
     snd_pcm_start(handle);
 
     // Step 5: Setup callback and timer fallback
@@ -519,19 +689,13 @@ bool QAlsaAudioOutput::open()
     // Step 6: Start audio processing
     timer->start(period_time/1000);
 
-    clockStamp.restart();
-    timeStamp.restart();
-    elapsedTimeOffset = 0;
-    errorState  = QAudio::NoError;
-    totalTimeValue = 0;
-    opened = true;
-
     return true;
 }
 
 void QAlsaAudioOutput::close()
 {
     timer->stop();
+    stopFeederThread();
 
     if ( handle ) {
         snd_pcm_drain( handle );
@@ -547,6 +711,69 @@ void QAlsaAudioOutput::close()
     opened = false;
 }
 
+void QAlsaAudioOutput::startFeederThread()
+{
+    if (!feederThread)
+        feederThread = new QAlsaAudioOutputThread(this);
+    else if (feederThread->isRunning())
+        return;
+
+    feedPending.store(0);
+    feederThread->start(realtime ? QThread::TimeCriticalPriority : QThread::HighestPriority);
+}
+
+void QAlsaAudioOutput::stopFeederThread()
+{
+    if (feederThread && feederThread->isRunning()) {
+        feederThread->requestStop();
+        feederThread->wait();
+        delete feederThread;
+        feederThread = 0;
+    }
+}
+
+bool QAlsaAudioOutput::feederStarved()
+{
+    const int count = starvedCount.load();
+    const bool starved = count != lastStarvedCount;
+    lastStarvedCount = count;
+    return starved;
+}
+
+void QAlsaAudioOutput::feederError()
+{
+    if (deviceState == QAudio::StoppedState)
+        return;
+
+    close();
+    errorState = QAudio::FatalError;
+    emit errorChanged(errorState);
+    deviceState = QAudio::StoppedState;
+    emit stateChanged(deviceState);
+}
+
+qint64 QAlsaAudioOutput::latencyUSecs() const
+{
+    if (!handle || settings.sampleRate() <= 0)
+        return -1;
+
+    snd_pcm_sframes_t frames = 0;
+    if (threaded) {
+        QMutexLocker locker(&statsMutex);
+        frames = delayFrames + snd_pcm_bytes_to_frames(handle, ringBuffer.used());
+    } else if (snd_pcm_delay(handle, &frames) < 0) {
+        frames = 0;
+    }
+
+    return qint64(1000000) * frames / settings.sampleRate();
+}
+
+int QAlsaAudioOutput::xrunCount() const
+{
+    QMutexLocker locker(&statsMutex);
+    return xruns;
+}
+
 int QAlsaAudioOutput::bytesFree() const
 {
     if(resuming)
@@ -555,6 +782,12 @@ int QAlsaAudioOutput::bytesFree() const
     if(deviceState != QAudio::ActiveState && deviceState != QAudio::IdleState)
         return 0;
 
+    if (threaded) {
+        // Only hand out whole frames, so ring buffer regions stay frame aligned
+        const int frameBytes = snd_pcm_frames_to_bytes(handle, 1);
+        return frameBytes > 0 ? ringBuffer.free() / frameBytes * frameBytes : 0;
+    }
+
     int frames = snd_pcm_avail_update(handle);
     if (frames == -EPIPE) {
         // Try and handle buffer underrun
@@ -593,6 +826,36 @@ qint64 QAlsaAudioOutput::write( const char *data, qint64 len )
 
     frames = snd_pcm_bytes_to_frames(handle, space);
 
+    if (threaded) {
+        const int frameBytes = snd_pcm_frames_to_bytes(handle, 1);
+        space = frames * frameBytes;
+
+        int written = 0;
+        while (written < space) {
+            const QAudioRingBuffer::Region region = ringBuffer.acquireWriteRegion(space - written);
+            if (region.second == 0)
+                break;
+
+            if (m_volume < 1.0f)
+                QAudioHelperInternal::qMultiplySamples(m_volume, settings, data + written, region.first, region.second);
+            else
+                memcpy(region.first, data + written, region.second);
+
+            ringBuffer.releaseWriteRegion(region);
+            written += region.second;
+        }
+
+        if (written > 0) {
+            resuming = false;
+            errorState = QAudio::NoError;
+            if (deviceState != QAudio::ActiveState) {
+                deviceState = QAudio::ActiveState;
+                emit stateChanged(deviceState);
+            }
+        }
+        return written;
+    }
+
     if (m_volume < 1.0f) {
         char out[space];
         QAudioHelperInternal::qMultiplySamples(m_volume, settings, data, out, space);
@@ -651,6 +914,11 @@ int QAlsaAudioOutput::notifyInterval() const
 
 qint64 QAlsaAudioOutput::processedUSecs() const
 {
+    if (threaded) {
+        QMutexLocker locker(&statsMutex);
+        return qint64(1000000) * framesWritten / settings.sampleRate();
+    }
+
     return qint64(1000000) * totalTimeValue / settings.sampleRate();
 }
 
@@ -664,9 +932,13 @@ void QAlsaAudioOutput::resume()
             if(err < 0)
                 xrun_recovery(err);
 
-            err = snd_pcm_start(handle);
-            if(err < 0)
-                xrun_recovery(err);
+            if (threaded) {
+                startFeederThread();
+            } else {
+                err = snd_pcm_start(handle);
+                if(err < 0)
+                    xrun_recovery(err);
+            }
 
             bytesAvailable = (int)snd_pcm_frames_to_bytes(handle, buffer_frames);
         }
@@ -675,7 +947,7 @@ void QAlsaAudioOutput::resume()
         deviceState = QAudio::ActiveState;
 
         errorState = QAudio::NoError;
-        timer->start(period_time/1000);
+        timer->start(threaded ? qMax<int>(period_time / 1000, buffer_time / 2000) : period_time / 1000);
         emit stateChanged(deviceState);
     }
 }
@@ -695,6 +967,7 @@ void QAlsaAudioOutput::suspend()
 {
     if(deviceState == QAudio::ActiveState || deviceState == QAudio::IdleState || resuming) {
         timer->stop();
+        stopFeederThread();
         deviceState = QAudio::SuspendedState;
         errorState = QAudio::NoError;
         emit stateChanged(deviceState);
@@ -703,6 +976,8 @@ void QAlsaAudioOutput::suspend()
 
 void QAlsaAudioOutput::userFeed()
 {
+    feedPending.store(0);
+
     if(deviceState == QAudio::StoppedState || deviceState == QAudio::SuspendedState)
         return;
 #ifdef DEBUG_AUDIO
@@ -764,7 +1039,8 @@ bool QAlsaAudioOutput::deviceReady()
         } else if(l == 0) {
             // Did not get any data to output
             bytesAvailable = bytesFree();
-            if(bytesAvailable > snd_pcm_frames_to_bytes(handle, buffer_frames-period_frames)) {
+            if (threaded ? feederStarved()
+                    : bytesAvailable > snd_pcm_frames_to_bytes(handle, buffer_frames-period_frames)) {
                 // Underrun
                 if (deviceState != QAudio::IdleState) {
                     errorState = QAudio::UnderrunError;
@@ -783,7 +1059,8 @@ bool QAlsaAudioOutput::deviceReady()
         }
     } else {
         bytesAvailable = bytesFree();
-        if(bytesAvailable > snd_pcm_frames_to_bytes(handle, buffer_frames-period_frames)) {
+        if (threaded ? feederStarved()
+                : bytesAvailable > snd_pcm_frames_to_bytes(handle, buffer_frames-period_frames)) {
             // Underrun
             if (deviceState != QAudio::IdleState) {
                 errorState = QAudio::UnderrunError;
@@ -797,7 +1074,20 @@ bool QAlsaAudioOutput::deviceReady()
     if(deviceState != QAudio::ActiveState)
         return true;
 
+    if (threaded) {
+        const int count = xrunCount();
+        if (count != lastXrunCount) {
+            lastXrunCount = count;
+            errorState = QAudio::UnderrunError;
+            emit errorChanged(errorState);
+        }
+    }
+
     if(intervalTime && (timeStamp.elapsed() + elapsedTimeOffset) > intervalTime) {
+#ifdef DEBUG_AUDIO
+        if (threaded)
+            qDebug()<<"latency ="<<latencyUSecs()<<"us, xruns ="<<xrunCount();
+#endif
         emit notify();
         elapsedTimeOffset = timeStamp.elapsed() + elapsedTimeOffset - intervalTime;
         timeStamp.restart();
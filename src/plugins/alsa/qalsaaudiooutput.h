@@ -61,17 +61,23 @@
 #include <QtCore/qstring.h>
 #include <QtCore/qstringlist.h>
 #include <QtCore/qdatetime.h>
+#include <QtCore/qmutex.h>
 
 #include <QtMultimedia/qaudio.h>
 #include <QtMultimedia/qaudiodeviceinfo.h>
 #include <QtMultimedia/qaudiosystem.h>
+#include <QtMultimedia/private/qaudioringbuffer_p.h>
 
 QT_BEGIN_NAMESPACE
 
+class QAlsaAudioOutputThread;
+
 class QAlsaAudioOutput : public QAbstractAudioOutput
 {
     friend class OutputPrivate;
+    friend class QAlsaAudioOutputThread;
     Q_OBJECT
+    Q_PROPERTY(qint64 latencyUSecs READ latencyUSecs)
 public:
     QAlsaAudioOutput(const QByteArray &device);
     ~QAlsaAudioOutput();
@@ -99,6 +105,8 @@ public:
     void setVolume(qreal);
     qreal volume() const;
 
+    qint64 latencyUSecs() const;
+    int xrunCount() const;
 
     QIODevice* audioSource;
     QAudioFormat settings;
@@ -110,6 +118,7 @@ private slots:
     void feedback();
     void updateAvailable();
     bool deviceReady();
+    void feederError();
 
 signals:
     void processMore();
@@ -133,6 +142,10 @@ private:
     bool open();
     void close();
 
+    void startFeederThread();
+    void stopFeederThread();
+    bool feederStarved();
+
     QTimer* timer;
     QByteArray m_device;
     int bytesAvailable;
@@ -147,6 +160,21 @@ private:
     snd_timestamp_t* timestamp;
     snd_pcm_hw_params_t *hwparams;
     qreal m_volume;
+
+    // Threaded mode: a dedicated thread waits on the device and drains
+    // ringBuffer, which the owner thread fills from the QIODevice.
+    bool threaded;
+    bool realtime;
+    QAlsaAudioOutputThread *feederThread;
+    QAudioRingBuffer ringBuffer;
+    QAtomicInt feedPending;
+    QAtomicInt starvedCount;
+    int lastStarvedCount;
+    int lastXrunCount;
+    mutable QMutex statsMutex;
+    qint64 framesWritten;
+    snd_pcm_sframes_t delayFrames;
+    int xruns;
 };
 
 class OutputPrivate : public QIODevice
@@ -41,6 +41,7 @@
 
 #include "qalsaplugin.h"
 #include "qalsaaudiodeviceinfo.h"
+#include "qalsaaudiodevicecache.h"
 #include "qalsaaudioinput.h"
 #include "qalsaaudiooutput.h"
 
@@ -49,6 +50,8 @@ QT_BEGIN_NAMESPACE
 QAlsaPlugin::QAlsaPlugin(QObject *parent)
     : QAudioSystemPlugin(parent)
 {
+    // List and probe the devices before the application asks for them
+    QAlsaAudioDeviceCache::instance()->prefetch();
 }
 
 QList<QByteArray> QAlsaPlugin::availableDevices(QAudio::Mode mode) const
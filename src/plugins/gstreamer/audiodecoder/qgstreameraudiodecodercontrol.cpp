@@ -124,6 +124,11 @@ QAudioBuffer QGstreamerAudioDecoderControl::read()
     return m_session->read();
 }
 
+QList<QAudioBuffer> QGstreamerAudioDecoderControl::readBuffers(int maxCount)
+{
+    return m_session->read(maxCount);
+}
+
 bool QGstreamerAudioDecoderControl::bufferAvailable() const
 {
     return m_session->bufferAvailable();
@@ -49,6 +49,7 @@
 #include <qaudiobuffer.h>
 #include <qaudiodecoder.h>
 #include <qaudiodecodercontrol.h>
+#include <private/qaudiodecoderbatchreadinterface_p.h>
 
 #include <limits.h>
 
@@ -58,9 +59,10 @@ QT_BEGIN_NAMESPACE
 class QGstreamerAudioDecoderSession;
 class QGstreamerAudioDecoderService;
 
-class QGstreamerAudioDecoderControl : public QAudioDecoderControl
+class QGstreamerAudioDecoderControl : public QAudioDecoderControl, public QAudioDecoderBatchReadInterface
 {
     Q_OBJECT
+    Q_INTERFACES(QAudioDecoderBatchReadInterface)
 
 public:
     QGstreamerAudioDecoderControl(QGstreamerAudioDecoderSession *session, QObject *parent = 0);
@@ -81,6 +83,7 @@ public:
     void setAudioFormat(const QAudioFormat &format);
 
     QAudioBuffer read();
+    QList<QAudioBuffer> readBuffers(int maxCount);
     bool bufferAvailable() const;
 
     qint64 position() const;
@@ -44,6 +44,7 @@
 #include <private/qgstreamerbushelper_p.h>
 
 #include <private/qgstutils_p.h>
+#include <private/qgstaudiobuffer_p.h>
 
 #include <gst/gstvalue.h>
 #include <gst/base/gstbasesrc.h>
@@ -57,6 +58,9 @@
 #include <QtCore/qstandardpaths.h>
 #include <QtCore/qurl.h>
 
+// Decoded buffers appsink holds before blocking the decoder, the sink
+// doesn't sync to the clock so decoding runs as fast as it is read.
+// QT_GSTREAMER_AUDIODECODER_QUEUE_SIZE overrides it.
 #define MAX_BUFFERS_IN_QUEUE 4
 
 QT_BEGIN_NAMESPACE
@@ -88,10 +92,15 @@ QGstreamerAudioDecoderSession::QGstreamerAudioDecoderSession(QObject *parent)
 #endif
      mDevice(0),
      m_buffersAvailable(0),
+     m_maxBuffersInQueue(MAX_BUFFERS_IN_QUEUE),
      m_position(-1),
      m_duration(-1),
      m_durationQueries(0)
 {
+    const int queueSize = qgetenv("QT_GSTREAMER_AUDIODECODER_QUEUE_SIZE").toInt();
+    if (queueSize > 0)
+        m_maxBuffersInQueue = queueSize;
+
     // Create pipeline here
     m_playbin = gst_element_factory_make("playbin2", NULL);
 
@@ -434,41 +443,54 @@ void QGstreamerAudioDecoderSession::setAudioFormat(const QAudioFormat &format)
 
 QAudioBuffer QGstreamerAudioDecoderSession::read()
 {
-    QAudioBuffer audioBuffer;
+    const QList<QAudioBuffer> buffers = read(1);
+    return buffers.isEmpty() ? QAudioBuffer() : buffers.first();
+}
+
+QList<QAudioBuffer> QGstreamerAudioDecoderSession::read(int maxCount)
+{
+    QList<QAudioBuffer> audioBuffers;
 
     int buffersAvailable;
+    int count;
     {
         QMutexLocker locker(&m_buffersMutex);
         buffersAvailable = m_buffersAvailable;
+        count = maxCount < 0 ? buffersAvailable : qMin(maxCount, buffersAvailable);
 
         // need to decrement before pulling a buffer
         // to make sure assert in QGstreamerAudioDecoderSession::new_buffer works
-        m_buffersAvailable--;
+        m_buffersAvailable -= count;
     }
 
+    if (count == 0)
+        return audioBuffers;
 
-    if (buffersAvailable) {
-        if (buffersAvailable == 1)
-            emit bufferAvailableChanged(false);
+    if (count == buffersAvailable)
+        emit bufferAvailableChanged(false);
 
+    qint64 position = -1;
+    for (int i = 0; i < count; ++i) {
         GstBuffer *buffer = gst_app_sink_pull_buffer(m_appSink);
+        if (!buffer)
+            break;
 
         QAudioFormat format = QGstUtils::audioFormatForBuffer(buffer);
         if (format.isValid()) {
-            // XXX At the moment we have to copy data from GstBuffer into QAudioBuffer.
-            // We could improve performance by implementing QAbstractAudioBuffer for GstBuffer.
-            qint64 position = getPositionFromBuffer(buffer);
-            audioBuffer = QAudioBuffer(QByteArray((const char*)buffer->data, buffer->size), format, position);
-            position /= 1000; // convert to milliseconds
-            if (position != m_position) {
-                m_position = position;
-                emit positionChanged(m_position);
-            }
+            // The audio buffer references the GstBuffer, the samples are not copied
+            audioBuffers.append(QAudioBuffer(new QGstAudioBuffer(buffer, format)));
+            position = getPositionFromBuffer(buffer);
         }
         gst_buffer_unref(buffer);
     }
 
-    return audioBuffer;
+    position /= 1000; // convert to milliseconds
+    if (!audioBuffers.isEmpty() && position != m_position) {
+        m_position = position;
+        emit positionChanged(m_position);
+    }
+
+    return audioBuffers;
 }
 
 bool QGstreamerAudioDecoderSession::bufferAvailable() const
@@ -503,7 +525,7 @@ GstFlowReturn QGstreamerAudioDecoderSession::new_buffer(GstAppSink *, gpointer u
         QMutexLocker locker(&session->m_buffersMutex);
         buffersAvailable = session->m_buffersAvailable;
         session->m_buffersAvailable++;
-        Q_ASSERT(session->m_buffersAvailable <= MAX_BUFFERS_IN_QUEUE);
+        Q_ASSERT(session->m_buffersAvailable <= session->m_maxBuffersInQueue);
     }
 
     if (!buffersAvailable)
@@ -538,7 +560,7 @@ void QGstreamerAudioDecoderSession::addAppSink()
     memset(&callbacks, 0, sizeof(callbacks));
     callbacks.new_buffer = &new_buffer;
     gst_app_sink_set_callbacks(m_appSink, &callbacks, this, NULL);
-    gst_app_sink_set_max_buffers(m_appSink, MAX_BUFFERS_IN_QUEUE);
+    gst_app_sink_set_max_buffers(m_appSink, m_maxBuffersInQueue);
     gst_base_sink_set_sync(GST_BASE_SINK(m_appSink), FALSE);
 
     gst_bin_add(GST_BIN(m_outputBin), GST_ELEMENT(m_appSink));
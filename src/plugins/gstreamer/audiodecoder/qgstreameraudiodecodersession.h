@@ -95,6 +95,7 @@ public:
     void setAudioFormat(const QAudioFormat &format);
 
     QAudioBuffer read();
+    QList<QAudioBuffer> read(int maxCount);
     bool bufferAvailable() const;
 
     qint64 position() const;
@@ -146,6 +147,7 @@ private:
 
     mutable QMutex m_buffersMutex;
     int m_buffersAvailable;
+    int m_maxBuffersInQueue;
 
     qint64 m_position;
     qint64 m_duration;
@@ -60,6 +60,8 @@
 #include "camerabincapturedestination.h"
 #include "camerabincapturebufferformat.h"
 #include <private/qgstreamerbushelper_p.h>
+#include <private/qgstvideobuffer_p.h>
+#include <private/qvideosurfacegstsink_p.h>
 #include <private/qgstreamervideorendererinterface_p.h>
 #include <qmediarecorder.h>
 
@@ -827,32 +829,16 @@ bool CameraBinSession::processSyncMessage(const QGstreamerMessage &message)
 
                     GstCaps *caps = gst_buffer_get_caps(buffer);
                     if (caps) {
-                        GstStructure *structure = gst_caps_get_structure(caps, 0);
-                        gint width = 0;
-                        gint height = 0;
 #if CAMERABIN_DEBUG
-                        qDebug() << "Preview caps:" << gst_structure_to_string(structure);
+                        qDebug() << "Preview caps:" << gst_caps_to_string(caps);
 #endif
-
-                        if (structure &&
-                            gst_structure_get_int(structure, "width", &width) &&
-                            gst_structure_get_int(structure, "height", &height) &&
-                            width > 0 && height > 0) {
-                            if (qstrcmp(gst_structure_get_name(structure), "video/x-raw-rgb") == 0) {
-                                QImage::Format format = QImage::Format_Invalid;
-                                int bpp = 0;
-                                gst_structure_get_int(structure, "bpp", &bpp);
-
-                                if (bpp == 24)
-                                    format = QImage::Format_RGB888;
-                                else if (bpp == 32)
-                                    format = QImage::Format_RGB32;
-
-                                if (format != QImage::Format_Invalid) {
-                                    img = QImage((const uchar *)buffer->data, width, height, format);
-                                    img.bits(); //detach
-                                 }
-                            }
+                        int bytesPerLine = 0;
+                        const QVideoSurfaceFormat format = QVideoSurfaceGstSink::formatForCaps(caps, &bytesPerLine);
+                        if (format.isValid() && !format.frameSize().isEmpty()) {
+                            const QVideoFrame frame(new QGstVideoBuffer(buffer, bytesPerLine),
+                                                    format.frameSize(),
+                                                    format.pixelFormat());
+                            img = frame.image();
                         }
                         gst_caps_unref(caps);
 
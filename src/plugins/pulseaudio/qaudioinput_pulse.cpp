@@ -54,17 +54,23 @@ QT_BEGIN_NAMESPACE
 
 const int PeriodTimeMs = 50;
 
+// Ring for callback mode: the requested buffer size, but at least four fragments
+static int ringBufferSize(int fragmentSize, int bufferSize, const pa_sample_spec &spec)
+{
+    const int frameSize = pa_frame_size(&spec);
+    const int size = qMax(bufferSize, 4 * fragmentSize);
+    return size - size % frameSize;
+}
+
 // Map from void* (for userdata) to QPulseAudioInput instance
 // protected by pulse mainloop lock
 QMap<void *, QPulseAudioInput*> QPulseAudioInput::s_inputsMap;
 
 static void inputStreamReadCallback(pa_stream *stream, size_t length, void *userdata)
 {
-    Q_UNUSED(userdata);
     Q_UNUSED(length);
     Q_UNUSED(stream);
-    QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
-    pa_threaded_mainloop_signal(pulseEngine->mainloop(), 0);
+    static_cast<QPulseAudioInput*>(userdata)->streamReadCallback();
 }
 
 static void inputStreamStateCallback(pa_stream *stream, void *userdata)
@@ -172,6 +178,9 @@ QPulseAudioInput::QPulseAudioInput(const QByteArray &device)
     , m_periodTime(PeriodTimeMs)
     , m_stream(0)
     , m_device(device)
+    , m_tempBufferOffset(0)
+    , m_callbackMode(qgetenv("QT_PULSEAUDIO_INPUT_CALLBACK").toInt() > 0)
+    , m_reportedOverruns(0)
 {
     m_timer = new QTimer(this);
     connect(m_timer, SIGNAL(timeout()), SLOT(userFeed()));
@@ -336,6 +345,10 @@ bool QPulseAudioInput::open()
     else
         buffer_attr.fragsize = (uint32_t) m_periodSize;
 
+    // The read callback may fire while we wait for the stream to get ready
+    if (m_callbackMode)
+        m_ringBuffer.resize(ringBufferSize(buffer_attr.fragsize, m_bufferSize, spec));
+
     if (pa_stream_connect_record(m_stream, m_device.data(), &buffer_attr, (pa_stream_flags_t)flags) < 0) {
         qWarning() << "pa_stream_connect_record() failed!";
         m_errorState = QAudio::FatalError;
@@ -352,6 +365,16 @@ bool QPulseAudioInput::open()
     if (actualBufferAttr->tlength != (uint32_t)-1)
         m_bufferSize = actualBufferAttr->tlength;
 
+    if (m_callbackMode) {
+        // Safe while we hold the lock, the callback only runs on the mainloop
+        m_ringBuffer.resize(ringBufferSize(m_periodSize, m_bufferSize, spec));
+        m_feedPending.store(0);
+        m_overruns.store(0);
+        m_droppedBytes.store(0);
+        m_peakFill.store(0);
+        m_reportedOverruns = 0;
+    }
+
     setPulseVolume();
 
     pa_threaded_mainloop_unlock(pulseEngine->mainloop());
@@ -382,6 +405,10 @@ void QPulseAudioInput::close()
         pa_threaded_mainloop_unlock(pulseEngine->mainloop());
     }
 
+    m_ringBuffer.reset();
+    m_tempBuffer.clear();
+    m_tempBufferOffset = 0;
+
     if (!m_pullMode && m_audioSource) {
         delete m_audioSource;
         m_audioSource = 0;
@@ -418,6 +445,8 @@ int QPulseAudioInput::checkBytesReady()
 {
     if (m_deviceState != QAudio::ActiveState && m_deviceState != QAudio::IdleState) {
         m_bytesAvailable = 0;
+    } else if (m_callbackMode) {
+        m_bytesAvailable = m_ringBuffer.used();
     } else {
         m_bytesAvailable = pa_stream_readable_size(m_stream);
     }
@@ -430,6 +459,90 @@ int QPulseAudioInput::bytesReady() const
     return qMax(m_bytesAvailable, 0);
 }
 
+// Called on the PulseAudio mainloop thread with the mainloop locked
+void QPulseAudioInput::streamReadCallback()
+{
+    if (!m_callbackMode) {
+        QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
+        pa_threaded_mainloop_signal(pulseEngine->mainloop(), 0);
+        return;
+    }
+
+    const int frameSize = pa_frame_size(&m_spec);
+
+    while (pa_stream_readable_size(m_stream) > 0) {
+        const void *audioBuffer = 0;
+        size_t readLength = 0;
+
+        if (pa_stream_peek(m_stream, &audioBuffer, &readLength) < 0) {
+            qWarning() << QString("pa_stream_peek() failed: %1").arg(pa_strerror(pa_context_errno(pa_stream_get_context(m_stream))));
+            return;
+        }
+
+        if (readLength == 0)
+            break;
+
+        // A null buffer is a hole in the stream, there is nothing to copy
+        if (audioBuffer) {
+            int writable = qMin<size_t>(readLength, m_ringBuffer.free());
+            writable -= writable % frameSize;
+            m_ringBuffer.write(static_cast<const char *>(audioBuffer), writable);
+
+            if (size_t(writable) < readLength) {
+                m_overruns.ref();
+                m_droppedBytes.fetchAndAddRelaxed(int(readLength) - writable);
+            }
+        }
+
+        pa_stream_drop(m_stream);
+    }
+
+    const int used = m_ringBuffer.used();
+    if (used > m_peakFill.load())
+        m_peakFill.store(used);
+
+    if (m_feedPending.testAndSetOrdered(0, 1))
+        QMetaObject::invokeMethod(this, "userFeed", Qt::QueuedConnection);
+}
+
+qint64 QPulseAudioInput::readFromRingBuffer(char *data, qint64 len)
+{
+    m_feedPending.store(0);
+
+    qint64 readBytes = 0;
+
+    if (m_pullMode) {
+        // Hand whole contiguous fragments to the device straight from the ring
+        forever {
+            const QAudioRingBuffer::Region region = m_ringBuffer.acquireReadRegion(m_ringBuffer.size());
+            if (region.second == 0)
+                break;
+
+            const qint64 actualLength = m_audioSource->write(region.first, region.second);
+            if (actualLength > 0) {
+                m_ringBuffer.releaseReadRegion(QAudioRingBuffer::Region(region.first, int(actualLength)));
+                m_totalTimeValue += actualLength;
+                readBytes += actualLength;
+            }
+
+            if (actualLength < region.second) {
+                // Whatever the device didn't take stays in the ring
+                m_errorState = QAudio::UnderrunError;
+                m_deviceState = QAudio::IdleState;
+                emit stateChanged(m_deviceState);
+                break;
+            }
+        }
+    } else {
+        readBytes = m_ringBuffer.read(data, int(qMin<qint64>(len, m_ringBuffer.size())));
+        m_totalTimeValue += readBytes;
+    }
+
+    m_bytesAvailable = checkBytesReady();
+
+    return readBytes;
+}
+
 qint64 QPulseAudioInput::read(char *data, qint64 len)
 {
     m_bytesAvailable = checkBytesReady();
@@ -440,19 +553,23 @@ qint64 QPulseAudioInput::read(char *data, qint64 len)
         emit stateChanged(m_deviceState);
     }
 
+    if (m_callbackMode)
+        return readFromRingBuffer(data, len);
+
     int readBytes = 0;
 
-    if (!m_pullMode && !m_tempBuffer.isEmpty()) {
-        readBytes = qMin(static_cast<int>(len), m_tempBuffer.size());
-        memcpy(data, m_tempBuffer.constData(), readBytes);
+    // Leftovers are consumed from an offset rather than erased from the front
+    if (!m_pullMode && m_tempBufferOffset < m_tempBuffer.size()) {
+        readBytes = qMin(static_cast<int>(len), m_tempBuffer.size() - m_tempBufferOffset);
+        memcpy(data, m_tempBuffer.constData() + m_tempBufferOffset, readBytes);
         m_totalTimeValue += readBytes;
+        m_tempBufferOffset += readBytes;
 
-        if (readBytes < m_tempBuffer.size()) {
-            m_tempBuffer.remove(0, readBytes);
+        if (m_tempBufferOffset < m_tempBuffer.size())
             return readBytes;
-        }
 
-        m_tempBuffer.clear();
+        m_tempBuffer.resize(0);
+        m_tempBufferOffset = 0;
     }
 
     while (pa_stream_readable_size(m_stream) > 0) {
@@ -659,6 +776,9 @@ bool QPulseAudioInput::deviceReady()
     }
     m_bytesAvailable = checkBytesReady();
 
+    if (m_callbackMode)
+        reportOverruns();
+
     if (m_deviceState != QAudio::ActiveState)
         return true;
 
@@ -671,6 +791,37 @@ bool QPulseAudioInput::deviceReady()
     return true;
 }
 
+// The counters are exposed as properties, only trace them here
+void QPulseAudioInput::reportOverruns()
+{
+#ifdef DEBUG_PULSE
+    const int overruns = m_overruns.load();
+    if (overruns != m_reportedOverruns) {
+        qDebug() << "QPulseAudioInput: capture buffer overrun," << overruns - m_reportedOverruns
+                 << "fragments lost," << droppedBytes() << "bytes dropped since start";
+        m_reportedOverruns = overruns;
+    }
+
+    qDebug() << "QPulseAudioInput: buffer fill" << m_ringBuffer.used() << "peak" << peakBufferFill()
+             << "of" << m_ringBuffer.size();
+#endif
+}
+
+int QPulseAudioInput::overrunCount() const
+{
+    return m_overruns.load();
+}
+
+int QPulseAudioInput::droppedBytes() const
+{
+    return m_droppedBytes.load();
+}
+
+int QPulseAudioInput::peakBufferFill() const
+{
+    return m_peakFill.load();
+}
+
 qint64 QPulseAudioInput::elapsedUSecs() const
 {
     if (m_deviceState == QAudio::StoppedState)
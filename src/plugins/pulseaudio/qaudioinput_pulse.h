@@ -63,6 +63,8 @@
 #include "qaudiodeviceinfo.h"
 #include "qaudiosystem.h"
 
+#include <QtMultimedia/private/qaudioringbuffer_p.h>
+
 #include <pulse/pulseaudio.h>
 
 QT_BEGIN_NAMESPACE
@@ -72,6 +74,9 @@ class InputPrivate;
 class QPulseAudioInput : public QAbstractAudioInput
 {
     Q_OBJECT
+    Q_PROPERTY(int overrunCount READ overrunCount)
+    Q_PROPERTY(int droppedBytes READ droppedBytes)
+    Q_PROPERTY(int peakBufferFill READ peakBufferFill)
 
 public:
     QPulseAudioInput(const QByteArray &device);
@@ -101,6 +106,12 @@ public:
     void setVolume(qreal volume);
     qreal volume() const;
 
+    int overrunCount() const;
+    int droppedBytes() const;
+    int peakBufferFill() const;
+
+    void streamReadCallback();
+
     qint64 m_totalTimeValue;
     QIODevice *m_audioSource;
     QAudioFormat m_format;
@@ -115,6 +126,8 @@ private slots:
 
 private:
     int checkBytesReady();
+    qint64 readFromRingBuffer(char *data, qint64 len);
+    void reportOverruns();
     bool open();
     void close();
     void setPulseVolume();
@@ -139,7 +152,18 @@ private:
     QByteArray m_streamName;
     QByteArray m_device;
     QByteArray m_tempBuffer;
+    int m_tempBufferOffset;
     pa_sample_spec m_spec;
+
+    // Callback mode: the read callback on the PulseAudio mainloop thread
+    // fills m_ringBuffer, which the owner thread drains.
+    bool m_callbackMode;
+    QAudioRingBuffer m_ringBuffer;
+    QAtomicInt m_feedPending;
+    QAtomicInt m_overruns;
+    QAtomicInt m_droppedBytes;
+    QAtomicInt m_peakFill;
+    int m_reportedOverruns;
 };
 
 class InputPrivate : public QIODevice
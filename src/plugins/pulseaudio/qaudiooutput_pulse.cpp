@@ -61,10 +61,7 @@ const int LowLatencyBufferSizeMs = 40;
 static void  outputStreamWriteCallback(pa_stream *stream, size_t length, void *userdata)
 {
     Q_UNUSED(stream);
-    Q_UNUSED(length);
-    Q_UNUSED(userdata);
-    QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
-    pa_threaded_mainloop_signal(pulseEngine->mainloop(), 0);
+    ((QPulseAudioOutput*)userdata)->streamWriteCallback(length);
 }
 
 static void outputStreamStateCallback(pa_stream *stream, void *userdata)
@@ -159,6 +156,7 @@ QPulseAudioOutput::QPulseAudioOutput(const QByteArray &device)
     , m_audioBuffer(0)
     , m_resuming(false)
     , m_volume(1.0)
+    , m_callbackMode(qgetenv("QT_PULSEAUDIO_OUTPUT_CALLBACK").toInt() > 0)
 {
     connect(m_tickTimer, SIGNAL(timeout()), SLOT(userFeed()));
 }
@@ -190,6 +188,69 @@ void QPulseAudioOutput::streamUnderflowCallback()
     }
 }
 
+// Called on the PulseAudio mainloop thread with the mainloop locked, or
+// from dataQueued() with the lock taken.
+void QPulseAudioOutput::streamWriteCallback(size_t length)
+{
+    if (!m_callbackMode) {
+        QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
+        pa_threaded_mainloop_signal(pulseEngine->mainloop(), 0);
+        return;
+    }
+
+    const int frameSize = pa_frame_size(&m_spec);
+
+    while (length > 0) {
+        QAudioRingBuffer::Region region = m_ringBuffer.acquireReadRegion(qMin<size_t>(length, m_ringBuffer.size()));
+        region.second -= region.second % frameSize;
+        if (region.second <= 0) {
+            // PulseAudio won't ask again until it is given something. The
+            // owner thread may have queued data after the ring was found
+            // empty but before the flag was raised, so look again; whoever
+            // clears the flag does the write.
+            m_writeStarved.store(1);
+            if (m_ringBuffer.used() >= frameSize && m_writeStarved.testAndSetOrdered(1, 0))
+                continue;
+            break;
+        }
+
+        // Copy straight into the stream's memory block, pa_stream_write()
+        // then only has to hand it over.
+        void *buffer = 0;
+        size_t bufferSize = region.second;
+        if (pa_stream_begin_write(m_stream, &buffer, &bufferSize) == 0 && buffer) {
+            bufferSize = qMin<size_t>(bufferSize, region.second);
+            bufferSize -= bufferSize % frameSize;
+            if (bufferSize > 0) {
+                memcpy(buffer, region.first, bufferSize);
+            } else {
+                pa_stream_cancel_write(m_stream);
+                buffer = 0;
+            }
+        } else {
+            buffer = 0;
+        }
+
+        if (!buffer) {
+            buffer = region.first;
+            bufferSize = region.second;
+        }
+
+        if (pa_stream_write(m_stream, buffer, bufferSize, 0, 0, PA_SEEK_RELATIVE) < 0) {
+            qWarning() << QString("pa_stream_write(): %1").arg(pa_strerror(pa_context_errno(pa_stream_get_context(m_stream))));
+            break;
+        }
+
+        m_ringBuffer.releaseReadRegion(QAudioRingBuffer::Region(region.first, int(bufferSize)));
+        length -= qMin(length, bufferSize);
+    }
+
+    if (m_pullMode && m_ringBuffer.free() >= m_ringBuffer.size() / 2
+            && m_feedPending.testAndSetOrdered(0, 1)) {
+        QMetaObject::invokeMethod(this, "userFeed", Qt::QueuedConnection);
+    }
+}
+
 void QPulseAudioOutput::start(QIODevice *device)
 {
     if (m_deviceState != QAudio::StoppedState)
@@ -310,7 +371,10 @@ bool QPulseAudioOutput::open()
     requestedBuffer.prebuf = (uint32_t)-1;
     requestedBuffer.tlength = m_bufferSize;
 
-    if (pa_stream_connect_playback(m_stream, m_device.data(), (m_bufferSize > 0) ? &requestedBuffer : NULL, (pa_stream_flags_t)0, &m_chVolume, NULL) < 0) {
+    // Timing updates keep pa_stream_get_latency() answerable without a round trip
+    const pa_stream_flags_t flags = pa_stream_flags_t(PA_STREAM_AUTO_TIMING_UPDATE | PA_STREAM_INTERPOLATE_TIMING);
+
+    if (pa_stream_connect_playback(m_stream, m_device.data(), (m_bufferSize > 0) ? &requestedBuffer : NULL, flags, &m_chVolume, NULL) < 0) {
         qWarning() << "pa_stream_connect_playback() failed!";
         return false;
     }
@@ -323,7 +387,15 @@ bool QPulseAudioOutput::open()
     m_periodSize = pa_usec_to_bytes(m_periodTime*1000, &spec);
     m_bufferSize = buffer->tlength;
     m_maxBufferSize = buffer->maxlength;
-    m_audioBuffer = new char[m_maxBufferSize];
+    if (m_callbackMode) {
+        // Room for two target lengths, so the owner thread can be late by a
+        // whole buffer without the stream running dry.
+        m_ringBuffer.resize(2 * m_bufferSize);
+        m_feedPending.store(0);
+        m_writeStarved.store(1);
+    } else {
+        m_audioBuffer = new char[m_maxBufferSize];
+    }
 #ifdef DEBUG_PULSE
     qDebug() << "Buffering info:";
     qDebug() << "\tMax length: " << buffer->maxlength;
@@ -338,6 +410,10 @@ bool QPulseAudioOutput::open()
     m_opened = true;
     m_tickTimer->start(m_periodTime);
 
+    // Prime the ring right away rather than a period from now
+    if (m_callbackMode && m_pullMode)
+        QMetaObject::invokeMethod(this, "userFeed", Qt::QueuedConnection);
+
     m_elapsedTimeOffset = 0;
     m_timeStamp.restart();
     m_clockStamp.restart();
@@ -374,6 +450,7 @@ void QPulseAudioOutput::close()
         m_audioSource = 0;
     }
     m_opened = false;
+    m_ringBuffer.reset();
     if (m_audioBuffer) {
         delete[] m_audioBuffer;
         m_audioBuffer = 0;
@@ -387,7 +464,31 @@ void QPulseAudioOutput::userFeed()
 
     m_resuming = false;
 
-    if (m_pullMode) {
+    if (m_pullMode && m_callbackMode) {
+        m_feedPending.store(0);
+
+        // Read straight into the ring, no staging buffer needed
+        qint64 audioBytesPulled = 0;
+        forever {
+            const QAudioRingBuffer::Region region = m_ringBuffer.acquireWriteRegion(m_ringBuffer.free());
+            if (region.second == 0)
+                break;
+
+            const qint64 bytesRead = m_audioSource->read(region.first, region.second);
+            if (bytesRead <= 0)
+                break;
+
+            m_ringBuffer.releaseWriteRegion(QAudioRingBuffer::Region(region.first, int(bytesRead)));
+            audioBytesPulled += bytesRead;
+            if (bytesRead < region.second)
+                break;
+        }
+
+        if (audioBytesPulled > 0)
+            dataQueued(audioBytesPulled);
+        else
+            resumeStarvedWrite();
+    } else if (m_pullMode) {
         int writableSize = bytesFree();
         int chunks = writableSize / m_periodSize;
         if (chunks == 0)
@@ -428,21 +529,44 @@ void QPulseAudioOutput::userFeed()
 
 qint64 QPulseAudioOutput::write(const char *data, qint64 len)
 {
-    QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
+    if (m_callbackMode) {
+        len = m_ringBuffer.write(data, int(qMin<qint64>(len, m_ringBuffer.free())));
+    } else {
+        QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
 
-    pa_threaded_mainloop_lock(pulseEngine->mainloop());
-    len = qMin(len, static_cast<qint64>(pa_stream_writable_size(m_stream)));
-    pa_stream_write(m_stream, data, len, 0, 0, PA_SEEK_RELATIVE);
-    pa_threaded_mainloop_unlock(pulseEngine->mainloop());
+        pa_threaded_mainloop_lock(pulseEngine->mainloop());
+        len = qMin(len, static_cast<qint64>(pa_stream_writable_size(m_stream)));
+        pa_stream_write(m_stream, data, len, 0, 0, PA_SEEK_RELATIVE);
+        pa_threaded_mainloop_unlock(pulseEngine->mainloop());
+    }
+
+    dataQueued(len);
+
+    return len;
+}
+
+void QPulseAudioOutput::dataQueued(qint64 len)
+{
     m_totalTimeValue += len;
 
+    resumeStarvedWrite();
+
     m_errorState = QAudio::NoError;
     if (m_deviceState != QAudio::ActiveState) {
         m_deviceState = QAudio::ActiveState;
         emit stateChanged(m_deviceState);
     }
+}
 
-    return len;
+// Only takes the mainloop lock when the write callback went unanswered
+void QPulseAudioOutput::resumeStarvedWrite()
+{
+    if (m_callbackMode && m_writeStarved.testAndSetOrdered(1, 0)) {
+        QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
+        pa_threaded_mainloop_lock(pulseEngine->mainloop());
+        streamWriteCallback(pa_stream_writable_size(m_stream));
+        pa_threaded_mainloop_unlock(pulseEngine->mainloop());
+    }
 }
 
 void QPulseAudioOutput::stop()
@@ -461,6 +585,9 @@ int QPulseAudioOutput::bytesFree() const
     if (m_deviceState != QAudio::ActiveState && m_deviceState != QAudio::IdleState)
         return 0;
 
+    if (m_callbackMode)
+        return m_ringBuffer.free();
+
     QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
     pa_threaded_mainloop_lock(pulseEngine->mainloop());
     int writableSize = pa_stream_writable_size(m_stream);
@@ -570,6 +697,26 @@ void QPulseAudioOutput::suspend()
     }
 }
 
+qint64 QPulseAudioOutput::latencyUSecs() const
+{
+    if (!m_stream)
+        return -1;
+
+    QPulseAudioEngine *pulseEngine = QPulseAudioEngine::instance();
+    pa_usec_t latency = 0;
+    int negative = 0;
+
+    pa_threaded_mainloop_lock(pulseEngine->mainloop());
+    if (pa_stream_get_latency(m_stream, &latency, &negative) < 0 || negative)
+        latency = 0;
+    pa_threaded_mainloop_unlock(pulseEngine->mainloop());
+
+    if (m_callbackMode)
+        latency += pa_bytes_to_usec(m_ringBuffer.used(), &m_spec);
+
+    return latency;
+}
+
 qint64 QPulseAudioOutput::elapsedUSecs() const
 {
     if (m_deviceState == QAudio::StoppedState)
@@ -63,6 +63,8 @@
 #include "qaudiodeviceinfo.h"
 #include "qaudiosystem.h"
 
+#include <QtMultimedia/private/qaudioringbuffer_p.h>
+
 #include <pulse/pulseaudio.h>
 
 QT_BEGIN_NAMESPACE
@@ -71,6 +73,7 @@ class QPulseAudioOutput : public QAbstractAudioOutput
 {
     friend class OutputPrivate;
     Q_OBJECT
+    Q_PROPERTY(qint64 latencyUSecs READ latencyUSecs)
 
 public:
     QPulseAudioOutput(const QByteArray &device);
@@ -101,13 +104,18 @@ public:
     void setCategory(const QString &category);
     QString category() const;
 
+    qint64 latencyUSecs() const;
+
 public:
     void streamUnderflowCallback();
+    void streamWriteCallback(size_t length);
 
 private:
     bool open();
     void close();
     qint64 write(const char *data, qint64 len);
+    void dataQueued(qint64 len);
+    void resumeStarvedWrite();
 
 private Q_SLOTS:
     void userFeed();
@@ -140,6 +148,13 @@ private:
     qreal m_volume;
     pa_cvolume m_chVolume;
     pa_sample_spec m_spec;
+
+    // Callback mode: the write callback on the PulseAudio mainloop thread
+    // drains m_ringBuffer, which the owner thread fills.
+    bool m_callbackMode;
+    QAudioRingBuffer m_ringBuffer;
+    QAtomicInt m_feedPending;
+    QAtomicInt m_writeStarved;
 };
 
 class OutputPrivate : public QIODevice
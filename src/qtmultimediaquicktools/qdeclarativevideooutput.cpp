@@ -131,7 +131,8 @@ QDeclarativeVideoOutput::QDeclarativeVideoOutput(QQuickItem *parent) :
     m_geometryDirty(true),
     m_orientation(0),
     m_autoOrientation(false),
-    m_screenOrientationHandler(0)
+    m_screenOrientationHandler(0),
+    m_framePacing(false)
 {
     setFlag(ItemHasContents, true);
 }
@@ -247,8 +248,10 @@ bool QDeclarativeVideoOutput::createBackend(QMediaService *service)
     if (!backendAvailable) {
         qWarning() << Q_FUNC_INFO << "Media service has neither renderer nor window control available.";
         m_backend.reset();
-    } else if (!m_geometryDirty) {
-        m_backend->updateGeometry();
+    } else {
+        m_backend->setFramePacing(m_framePacing);
+        if (!m_geometryDirty)
+            m_backend->updateGeometry();
     }
 
     return backendAvailable;
@@ -502,6 +505,95 @@ void QDeclarativeVideoOutput::setAutoOrientation(bool autoOrientation)
     emit autoOrientationChanged();
 }
 
+/*!
+    \qmlproperty bool QtMultimedia::VideoOutput::framePacing
+
+    This property enables scheduling of video frames by their presentation
+    time. When enabled, a few frames are buffered and every rendered frame
+    shows the one that is due closest to the display refresh. Frames which
+    are already late when a newer one is due are dropped.
+
+    This smooths playback of content whose frame rate does not match the
+    refresh rate of the display, at the cost of a little latency.
+
+    By default \c framePacing is disabled.
+
+    \sa framesPresented, framesDropped, framesRepeated, averageLateness
+
+    \since QtMultimedia 5.3
+*/
+bool QDeclarativeVideoOutput::framePacing() const
+{
+    return m_framePacing;
+}
+
+void QDeclarativeVideoOutput::setFramePacing(bool enabled)
+{
+    if (enabled == m_framePacing)
+        return;
+
+    m_framePacing = enabled;
+    if (m_backend)
+        m_backend->setFramePacing(enabled);
+
+    emit framePacingChanged();
+    emit frameStatisticsChanged();
+}
+
+/*!
+    \qmlproperty int QtMultimedia::VideoOutput::framesPresented
+
+    This property holds the number of frames rendered since \l framePacing
+    was enabled.
+
+    \since QtMultimedia 5.3
+*/
+int QDeclarativeVideoOutput::framesPresented() const
+{
+    return m_backend ? m_backend->frameStatistics().presented : 0;
+}
+
+/*!
+    \qmlproperty int QtMultimedia::VideoOutput::framesDropped
+
+    This property holds the number of frames that were skipped because a
+    newer frame was already due, since \l framePacing was enabled.
+
+    \since QtMultimedia 5.3
+*/
+int QDeclarativeVideoOutput::framesDropped() const
+{
+    return m_backend ? m_backend->frameStatistics().dropped : 0;
+}
+
+/*!
+    \qmlproperty int QtMultimedia::VideoOutput::framesRepeated
+
+    This property holds the number of times the previous frame was rendered
+    again because no buffered frame was due yet, since \l framePacing was
+    enabled.
+
+    \since QtMultimedia 5.3
+*/
+int QDeclarativeVideoOutput::framesRepeated() const
+{
+    return m_backend ? m_backend->frameStatistics().repeated : 0;
+}
+
+/*!
+    \qmlproperty real QtMultimedia::VideoOutput::averageLateness
+
+    This property holds how late, in milliseconds, rendered frames were
+    on average relative to their presentation time when \l framePacing is
+    enabled.
+
+    \since QtMultimedia 5.3
+*/
+qreal QDeclarativeVideoOutput::averageLateness() const
+{
+    return m_backend ? m_backend->frameStatistics().averageLateness : 0;
+}
+
 /*!
     \qmlproperty rectangle QtMultimedia::VideoOutput::contentRect
 
@@ -48,16 +48,31 @@
 #include <private/qsgvideonode_p.h>
 
 #include <QtGui/QOpenGLContext>
+#include <QtGui/qscreen.h>
+#include <QtQuick/qquickwindow.h>
 
 QT_BEGIN_NAMESPACE
 
 Q_GLOBAL_STATIC_WITH_ARGS(QMediaPluginLoader, videoNodeFactoryLoader,
         (QSGVideoNodeFactoryInterface_iid, QLatin1String("video/videonode"), Qt::CaseInsensitive))
 
+// Frames buffered ahead when frame pacing is enabled
+static const int qt_maxScheduledFrames = 4;
+
+// Frames arriving further apart than this, or this late, restart the
+// mapping of start times to the presentation clock (seek, pause)
+static const qint64 qt_streamDiscontinuity = 1000000;
+static const qint64 qt_streamStall = 100000;
+
 QDeclarativeVideoRendererBackend::QDeclarativeVideoRendererBackend(QDeclarativeVideoOutput *parent)
     : QDeclarativeVideoBackend(parent),
       m_glContext(0),
-      m_frameChanged(false)
+      m_frameChanged(false),
+      m_framePacing(false),
+      m_streamOffset(0),
+      m_lastStartTime(-1),
+      m_streamOffsetValid(false),
+      m_totalLateness(0)
 {
     m_surface = new QSGVideoItemSurface(this);
     QObject::connect(m_surface, SIGNAL(surfaceFormatChanged(QVideoSurfaceFormat)),
@@ -71,6 +86,8 @@ QDeclarativeVideoRendererBackend::QDeclarativeVideoRendererBackend(QDeclarativeV
 
     // Append existing node factories as fallback if we have no plugins
     m_videoNodeFactories.append(&m_i420Factory);
+    m_videoNodeFactories.append(&m_nv12Factory);
+    m_videoNodeFactories.append(&m_packedYuvFactory);
     m_videoNodeFactories.append(&m_rgbFactory);
     m_videoNodeFactories.append(&m_textureFactory);
 }
@@ -190,6 +207,9 @@ QSGNode *QDeclarativeVideoRendererBackend::updatePaintNode(QSGNode *oldNode,
 
     QMutexLocker lock(&m_frameMutex);
 
+    if (m_framePacing)
+        selectScheduledFrame();
+
     if (!m_glContext) {
         m_glContext = QOpenGLContext::currentContext();
         m_surface->scheduleOpenGLContextUpdate();
@@ -272,16 +292,132 @@ QOpenGLContext *QDeclarativeVideoRendererBackend::glContext() const
     return m_glContext;
 }
 
+void QDeclarativeVideoRendererBackend::setFramePacing(bool enabled)
+{
+    QMutexLocker lock(&m_frameMutex);
+    if (enabled == m_framePacing)
+        return;
+
+    m_framePacing = enabled;
+
+    if (!m_scheduledFrames.isEmpty()) {
+        // Keep showing the most recent frame
+        m_frame = m_scheduledFrames.last().frame;
+        m_frameChanged = true;
+        m_scheduledFrames.clear();
+    }
+
+    m_streamOffsetValid = false;
+    m_statistics = QDeclarativeVideoFrameStatistics();
+    m_totalLateness = 0;
+    if (!m_presentationClock.isValid())
+        m_presentationClock.start();
+}
+
+QDeclarativeVideoFrameStatistics QDeclarativeVideoRendererBackend::frameStatistics() const
+{
+    QMutexLocker lock(&m_frameMutex);
+    return m_statistics;
+}
+
 void QDeclarativeVideoRendererBackend::present(const QVideoFrame &frame)
 {
     m_frameMutex.lock();
-    m_frame = frame;
-    m_frameChanged = true;
+    if (m_framePacing && frame.isValid()) {
+        scheduleFrame(frame);
+    } else {
+        m_scheduledFrames.clear();
+        m_frame = frame;
+        m_frameChanged = true;
+    }
     m_frameMutex.unlock();
 
     q->update();
 }
 
+// Called locked
+void QDeclarativeVideoRendererBackend::scheduleFrame(const QVideoFrame &frame)
+{
+    const qint64 now = m_presentationClock.nsecsElapsed() / 1000;
+    const qint64 startTime = frame.startTime();
+
+    ScheduledFrame scheduled;
+    scheduled.frame = frame;
+    scheduled.due = now;
+
+    if (startTime >= 0) {
+        const qint64 offset = now - startTime;
+        if (!m_streamOffsetValid
+                || startTime < m_lastStartTime
+                || startTime - m_lastStartTime > qt_streamDiscontinuity
+                || offset - m_streamOffset > qt_streamStall
+                || offset < m_streamOffset) {
+            // Frames arriving earlier than expected move the mapping forward,
+            // so it follows the frame that had the least delay
+            m_streamOffset = offset;
+            m_streamOffsetValid = true;
+        }
+        m_lastStartTime = startTime;
+        scheduled.due = startTime + m_streamOffset;
+    }
+
+    if (m_scheduledFrames.size() >= qt_maxScheduledFrames) {
+        m_scheduledFrames.dequeue();
+        m_statistics.dropped++;
+    }
+
+    m_scheduledFrames.enqueue(scheduled);
+}
+
+// Called locked on the render thread, picks the frame to show until the next vsync
+void QDeclarativeVideoRendererBackend::selectScheduledFrame()
+{
+    if (m_scheduledFrames.isEmpty())
+        return;
+
+    qreal refreshRate = 60;
+    if (q->window() && q->window()->screen() && q->window()->screen()->refreshRate() > 0)
+        refreshRate = q->window()->screen()->refreshRate();
+
+    const qint64 now = m_presentationClock.nsecsElapsed() / 1000;
+    const qint64 horizon = now + qint64(500000 / refreshRate);
+
+    bool selected = false;
+    while (!m_scheduledFrames.isEmpty() && m_scheduledFrames.head().due <= horizon) {
+        if (selected)
+            m_statistics.dropped++;
+
+        const ScheduledFrame scheduled = m_scheduledFrames.dequeue();
+        m_frame = scheduled.frame;
+        m_totalLateness += qMax(Q_INT64_C(0), now - scheduled.due);
+        selected = true;
+    }
+
+    if (selected) {
+        m_frameChanged = true;
+        m_statistics.presented++;
+        m_statistics.averageLateness = m_totalLateness / qreal(m_statistics.presented) / 1000;
+    } else if (!m_frameChanged) {
+        m_statistics.repeated++;
+    }
+
+    // Come back at the next vsync for the frames still waiting
+    if (!m_scheduledFrames.isEmpty())
+        QMetaObject::invokeMethod(q, "update", Qt::QueuedConnection);
+
+    notifyFrameStatistics();
+}
+
+// Called locked, statistics are published at most a few times per second
+void QDeclarativeVideoRendererBackend::notifyFrameStatistics()
+{
+    if (m_statisticsTimer.isValid() && m_statisticsTimer.elapsed() < 250)
+        return;
+
+    m_statisticsTimer.start();
+    QMetaObject::invokeMethod(q, "frameStatisticsChanged", Qt::QueuedConnection);
+}
+
 void QDeclarativeVideoRendererBackend::stop()
 {
     present(QVideoFrame());
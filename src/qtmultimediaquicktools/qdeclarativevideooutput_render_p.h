@@ -45,10 +45,14 @@
 
 #include "qdeclarativevideooutput_backend_p.h"
 #include "qsgvideonode_i420.h"
+#include "qsgvideonode_nv12.h"
+#include "qsgvideonode_packedyuv.h"
 #include "qsgvideonode_rgb.h"
 #include "qsgvideonode_texture.h"
 
 #include <QtCore/qmutex.h>
+#include <QtCore/qqueue.h>
+#include <QtCore/qelapsedtimer.h>
 #include <QtMultimedia/qabstractvideosurface.h>
 
 QT_BEGIN_NAMESPACE
@@ -73,12 +77,24 @@ public:
     QAbstractVideoSurface *videoSurface() const;
     QRectF adjustedViewport() const Q_DECL_OVERRIDE;
     QOpenGLContext *glContext() const;
+    void setFramePacing(bool enabled) Q_DECL_OVERRIDE;
+    QDeclarativeVideoFrameStatistics frameStatistics() const Q_DECL_OVERRIDE;
 
     friend class QSGVideoItemSurface;
     void present(const QVideoFrame &frame);
     void stop();
 
 private:
+    struct ScheduledFrame
+    {
+        QVideoFrame frame;
+        qint64 due;     // microseconds on m_presentationClock
+    };
+
+    void scheduleFrame(const QVideoFrame &frame);
+    void selectScheduledFrame();
+    void notifyFrameStatistics();
+
     QPointer<QVideoRendererControl> m_rendererControl;
     QList<QSGVideoNodeFactoryInterface*> m_videoNodeFactories;
     QSGVideoItemSurface *m_surface;
@@ -86,9 +102,22 @@ private:
     QVideoFrame m_frame;
     bool m_frameChanged;
     QSGVideoNodeFactory_I420 m_i420Factory;
+    QSGVideoNodeFactory_NV12 m_nv12Factory;
+    QSGVideoNodeFactory_PackedYUV m_packedYuvFactory;
     QSGVideoNodeFactory_RGB m_rgbFactory;
     QSGVideoNodeFactory_Texture m_textureFactory;
-    QMutex m_frameMutex;
+    mutable QMutex m_frameMutex;
+
+    bool m_framePacing;
+    QQueue<ScheduledFrame> m_scheduledFrames;
+    QElapsedTimer m_presentationClock;
+    qint64 m_streamOffset;         // Maps frame start times to m_presentationClock
+    qint64 m_lastStartTime;
+    bool m_streamOffsetValid;
+    QDeclarativeVideoFrameStatistics m_statistics;
+    qint64 m_totalLateness;
+    QElapsedTimer m_statisticsTimer;
+
     QRectF m_renderedRect;         // Destination pixel coordinates, clipped
     QRectF m_sourceTextureRect;    // Source texture coordinates
 };
@@ -39,6 +39,7 @@
 **
 ****************************************************************************/
 #include "qsgvideonode_i420.h"
+#include "qsgvideotextureuploader.h"
 #include <QtCore/qmutex.h>
 #include <QtQuick/qsgtexturematerial.h>
 #include <QtQuick/qsgmaterial.h>
@@ -53,7 +54,8 @@ QList<QVideoFrame::PixelFormat> QSGVideoNodeFactory_I420::supportedPixelFormats(
 {
     QList<QVideoFrame::PixelFormat> formats;
 
-    if (handleType == QAbstractVideoBuffer::NoHandle)
+    if (handleType == QAbstractVideoBuffer::NoHandle
+            || handleType == QAbstractVideoBuffer::SharedMemoryHandle)
         formats << QVideoFrame::Format_YUV420P << QVideoFrame::Format_YV12;
 
     return formats;
@@ -153,13 +155,13 @@ public:
 
     virtual int compare(const QSGMaterial *other) const {
         const QSGVideoMaterial_YUV420 *m = static_cast<const QSGVideoMaterial_YUV420 *>(other);
-        int d = m_textureIds[0] - m->m_textureIds[0];
+        int d = m_uploader.texture(0) - m->m_uploader.texture(0);
         if (d)
             return d;
-        else if ((d = m_textureIds[1] - m->m_textureIds[1]) != 0)
+        else if ((d = m_uploader.texture(1) - m->m_uploader.texture(1)) != 0)
             return d;
         else
-            return m_textureIds[2] - m->m_textureIds[2];
+            return m_uploader.texture(2) - m->m_uploader.texture(2);
     }
 
     void updateBlending() {
@@ -172,13 +174,14 @@ public:
     }
 
     void bind();
-    void bindTexture(int id, int w, int h, const uchar *bits);
 
     QVideoSurfaceFormat m_format;
-    QSize m_textureSize;
+    QSGVideoTextureUploader m_uploader;
 
-    static const uint Num_Texture_IDs = 3;
-    GLuint m_textureIds[Num_Texture_IDs];
+    // Identifies the frame currently in the textures, so presenting
+    // the same frame again doesn't upload it again
+    const uchar *m_uploadedBits;
+    qint64 m_uploadedStartTime;
 
     qreal m_opacity;
     QMatrix4x4 m_colorMatrix;
@@ -189,41 +192,18 @@ public:
 
 QSGVideoMaterial_YUV420::QSGVideoMaterial_YUV420(const QVideoSurfaceFormat &format) :
     m_format(format),
+    m_uploadedBits(0),
+    m_uploadedStartTime(-1),
     m_opacity(1.0)
 {
-    memset(m_textureIds, 0, sizeof(m_textureIds));
-
-    switch (format.yCbCrColorSpace()) {
-    case QVideoSurfaceFormat::YCbCr_JPEG:
-        m_colorMatrix = QMatrix4x4(
-                    1.0f,  0.000f,  1.402f, -0.701f,
-                    1.0f, -0.344f, -0.714f,  0.529f,
-                    1.0f,  1.772f,  0.000f, -0.886f,
-                    0.0f,  0.000f,  0.000f,  1.0000f);
-        break;
-    case QVideoSurfaceFormat::YCbCr_BT709:
-    case QVideoSurfaceFormat::YCbCr_xvYCC709:
-        m_colorMatrix = QMatrix4x4(
-                    1.164f,  0.000f,  1.793f, -0.5727f,
-                    1.164f, -0.534f, -0.213f,  0.3007f,
-                    1.164f,  2.115f,  0.000f, -1.1302f,
-                    0.0f,    0.000f,  0.000f,  1.0000f);
-        break;
-    default: //BT 601:
-        m_colorMatrix = QMatrix4x4(
-                    1.164f,  0.000f,  1.596f, -0.8708f,
-                    1.164f, -0.392f, -0.813f,  0.5296f,
-                    1.164f,  2.017f,  0.000f, -1.081f,
-                    0.0f,    0.000f,  0.000f,  1.0000f);
-    }
+
+    m_colorMatrix = qt_yuvColorMatrix(format.yCbCrColorSpace());
 
     setFlag(Blending, false);
 }
 
 QSGVideoMaterial_YUV420::~QSGVideoMaterial_YUV420()
 {
-    if (!m_textureSize.isEmpty())
-        glDeleteTextures(Num_Texture_IDs, m_textureIds);
 }
 
 void QSGVideoMaterial_YUV420::bind()
@@ -236,53 +216,48 @@ void QSGVideoMaterial_YUV420::bind()
             int fw = m_frame.width();
             int fh = m_frame.height();
 
-            // Frame has changed size, recreate textures...
-            if (m_textureSize != m_frame.size()) {
-                if (!m_textureSize.isEmpty())
-                    glDeleteTextures(Num_Texture_IDs, m_textureIds);
-                glGenTextures(Num_Texture_IDs, m_textureIds);
-                m_textureSize = m_frame.size();
-            }
-
             const uchar *bits = m_frame.bits();
-            int bpl = m_frame.bytesPerLine();
-            int bpl2 = (bpl / 2 + 3) & ~3;
-            int offsetU = bpl * fh;
-            int offsetV = bpl * fh + bpl2 * fh / 2;
-
-            if (m_frame.pixelFormat() == QVideoFrame::Format_YV12)
-                qSwap(offsetU, offsetV);
-
-
-            functions->glActiveTexture(GL_TEXTURE1);
-            bindTexture(m_textureIds[1], fw/2, fh / 2, bits + offsetU);
-            functions->glActiveTexture(GL_TEXTURE2);
-            bindTexture(m_textureIds[2], fw/2, fh / 2, bits + offsetV);
-            functions->glActiveTexture(GL_TEXTURE0); // Finish with 0 as default texture unit
-            bindTexture(m_textureIds[0], fw, fh, bits);
+            const qint64 startTime = m_frame.startTime();
+
+            if ((bits != m_uploadedBits || startTime != m_uploadedStartTime || startTime == -1
+                    || m_uploader.planeCount() == 0) && m_frame.planeCount() >= 3) {
+                // The texture units expect U then V, YV12 stores V first
+                int u = 1;
+                int v = 2;
+                if (m_frame.pixelFormat() == QVideoFrame::Format_YV12)
+                    qSwap(u, v);
+
+                QSGVideoTextureUploader::Plane planes[3];
+                planes[0].width = fw;
+                planes[0].height = fh;
+                planes[0].bytesPerLine = m_frame.bytesPerLine(0);
+                planes[0].bits = bits;
+                planes[1].width = fw / 2;
+                planes[1].height = fh / 2;
+                planes[1].bytesPerLine = m_frame.bytesPerLine(u);
+                planes[1].bits = m_frame.bits(u);
+                planes[2].width = fw / 2;
+                planes[2].height = fh / 2;
+                planes[2].bytesPerLine = m_frame.bytesPerLine(v);
+                planes[2].bits = m_frame.bits(v);
+
+                m_uploader.upload(planes, 3);
+                m_uploadedBits = bits;
+                m_uploadedStartTime = startTime;
+            }
 
             m_frame.unmap();
         }
 
         m_frame = QVideoFrame();
-    } else {
-        functions->glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, m_textureIds[1]);
-        functions->glActiveTexture(GL_TEXTURE2);
-        glBindTexture(GL_TEXTURE_2D, m_textureIds[2]);
-        functions->glActiveTexture(GL_TEXTURE0); // Finish with 0 as default texture unit
-        glBindTexture(GL_TEXTURE_2D, m_textureIds[0]);
     }
-}
 
-void QSGVideoMaterial_YUV420::bindTexture(int id, int w, int h, const uchar *bits)
-{
-    glBindTexture(GL_TEXTURE_2D, id);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE, w, h, 0, GL_LUMINANCE, GL_UNSIGNED_BYTE, bits);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    functions->glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_uploader.texture(1));
+    functions->glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, m_uploader.texture(2));
+    functions->glActiveTexture(GL_TEXTURE0); // Finish with 0 as default texture unit
+    glBindTexture(GL_TEXTURE_2D, m_uploader.texture(0));
 }
 
 QSGVideoNode_I420::QSGVideoNode_I420(const QVideoSurfaceFormat &format) :
@@ -303,6 +278,11 @@ void QSGVideoNode_I420::setCurrentFrame(const QVideoFrame &frame)
     markDirty(DirtyMaterial);
 }
 
+qint64 QSGVideoNode_I420::lastUploadTime() const
+{
+    return m_material->m_uploader.lastUploadTime();
+}
+
 
 void QSGVideoMaterialShader_YUV420::updateState(const RenderState &state,
                                                 QSGMaterial *newMaterial,
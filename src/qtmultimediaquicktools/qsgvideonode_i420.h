@@ -58,9 +58,9 @@ public:
         return m_format.pixelFormat();
     }
     void setCurrentFrame(const QVideoFrame &frame);
+    qint64 lastUploadTime() const;
 
 private:
-    void bindTexture(int id, int unit, int w, int h, const uchar *bits);
 
     QVideoSurfaceFormat m_format;
     QSGVideoMaterial_YUV420 *m_material;
@@ -0,0 +1,299 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+#include "qsgvideonode_packedyuv.h"
+#include "qsgvideotextureuploader.h"
+#include <QtCore/qmutex.h>
+#include <QtQuick/qsgmaterial.h>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions>
+#include <QtGui/QOpenGLShaderProgram>
+
+QT_BEGIN_NAMESPACE
+
+QList<QVideoFrame::PixelFormat> QSGVideoNodeFactory_PackedYUV::supportedPixelFormats(
+                                        QAbstractVideoBuffer::HandleType handleType) const
+{
+    QList<QVideoFrame::PixelFormat> formats;
+
+    if (handleType == QAbstractVideoBuffer::NoHandle
+            || handleType == QAbstractVideoBuffer::SharedMemoryHandle)
+        formats << QVideoFrame::Format_UYVY << QVideoFrame::Format_YUYV;
+
+    return formats;
+}
+
+QSGVideoNode *QSGVideoNodeFactory_PackedYUV::createNode(const QVideoSurfaceFormat &format)
+{
+    if (supportedPixelFormats(format.handleType()).contains(format.pixelFormat()))
+        return new QSGVideoNode_PackedYUV(format);
+
+    return 0;
+}
+
+
+class QSGVideoMaterialShader_PackedYUV : public QSGMaterialShader
+{
+public:
+    void updateState(const RenderState &state, QSGMaterial *newMaterial, QSGMaterial *oldMaterial);
+
+    virtual char const *const *attributeNames() const {
+        static const char *names[] = {
+            "qt_VertexPosition",
+            "qt_VertexTexCoord",
+            0
+        };
+        return names;
+    }
+
+protected:
+
+    virtual const char *vertexShader() const {
+        const char *shader =
+        "uniform highp mat4 qt_Matrix;                      \n"
+        "attribute highp vec4 qt_VertexPosition;            \n"
+        "attribute highp vec2 qt_VertexTexCoord;            \n"
+        "varying highp vec2 qt_TexCoord;                    \n"
+        "void main() {                                      \n"
+        "    qt_TexCoord = qt_VertexTexCoord;               \n"
+        "    gl_Position = qt_Matrix * qt_VertexPosition;   \n"
+        "}";
+        return shader;
+    }
+
+    // Each line is sampled twice: as luminance/alpha pairs at full width
+    // for Y, and as RGBA at half width for the chroma of each pixel pair
+    virtual const char *fragmentShader() const {
+        static const char *shader =
+        "uniform sampler2D plane1Texture;"
+        "uniform sampler2D plane2Texture;"
+        "uniform mediump mat4 colorMatrix;"
+        "uniform lowp float opacity;"
+        "uniform bool uyvy;"
+        ""
+        "varying highp vec2 qt_TexCoord;"
+        ""
+        "void main()"
+        "{"
+        "    mediump vec2 pair = texture2D(plane1Texture, qt_TexCoord).ra;"
+        "    mediump vec4 macro = texture2D(plane2Texture, qt_TexCoord);"
+        "    mediump vec4 color = uyvy ? vec4(pair.y, macro.r, macro.b, 1.)"
+        "                              : vec4(pair.x, macro.g, macro.a, 1.);"
+        "    gl_FragColor = colorMatrix * color * opacity;"
+        "}";
+        return shader;
+    }
+
+    virtual void initialize() {
+        m_id_matrix = program()->uniformLocation("qt_Matrix");
+        m_id_plane1Texture = program()->uniformLocation("plane1Texture");
+        m_id_plane2Texture = program()->uniformLocation("plane2Texture");
+        m_id_colorMatrix = program()->uniformLocation("colorMatrix");
+        m_id_opacity = program()->uniformLocation("opacity");
+        m_id_uyvy = program()->uniformLocation("uyvy");
+    }
+
+    int m_id_matrix;
+    int m_id_plane1Texture;
+    int m_id_plane2Texture;
+    int m_id_colorMatrix;
+    int m_id_opacity;
+    int m_id_uyvy;
+};
+
+
+class QSGVideoMaterial_PackedYUV : public QSGMaterial
+{
+public:
+    QSGVideoMaterial_PackedYUV(const QVideoSurfaceFormat &format);
+    ~QSGVideoMaterial_PackedYUV();
+
+    virtual QSGMaterialType *type() const {
+        static QSGMaterialType theType;
+        return &theType;
+    }
+
+    virtual QSGMaterialShader *createShader() const {
+        return new QSGVideoMaterialShader_PackedYUV;
+    }
+
+    virtual int compare(const QSGMaterial *other) const {
+        const QSGVideoMaterial_PackedYUV *m = static_cast<const QSGVideoMaterial_PackedYUV *>(other);
+        int d = m_uploader.texture(0) - m->m_uploader.texture(0);
+        if (d)
+            return d;
+        else
+            return m_uploader.texture(1) - m->m_uploader.texture(1);
+    }
+
+    void updateBlending() {
+        setFlag(Blending, qFuzzyCompare(m_opacity, qreal(1.0)) ? false : true);
+    }
+
+    void setCurrentFrame(const QVideoFrame &frame) {
+        QMutexLocker lock(&m_frameMutex);
+        m_frame = frame;
+    }
+
+    void bind();
+
+    QVideoSurfaceFormat m_format;
+    QSGVideoTextureUploader m_uploader;
+
+    const uchar *m_uploadedBits;
+    qint64 m_uploadedStartTime;
+
+    qreal m_opacity;
+    QMatrix4x4 m_colorMatrix;
+
+    QVideoFrame m_frame;
+    QMutex m_frameMutex;
+};
+
+QSGVideoMaterial_PackedYUV::QSGVideoMaterial_PackedYUV(const QVideoSurfaceFormat &format) :
+    m_format(format),
+    m_uploadedBits(0),
+    m_uploadedStartTime(-1),
+    m_opacity(1.0)
+{
+    m_colorMatrix = qt_yuvColorMatrix(format.yCbCrColorSpace());
+
+    setFlag(Blending, false);
+}
+
+QSGVideoMaterial_PackedYUV::~QSGVideoMaterial_PackedYUV()
+{
+}
+
+void QSGVideoMaterial_PackedYUV::bind()
+{
+    QOpenGLFunctions *functions = QOpenGLContext::currentContext()->functions();
+
+    QMutexLocker lock(&m_frameMutex);
+    if (m_frame.isValid()) {
+        if (m_frame.map(QAbstractVideoBuffer::ReadOnly)) {
+            const uchar *bits = m_frame.bits();
+            const qint64 startTime = m_frame.startTime();
+
+            if (bits != m_uploadedBits || startTime != m_uploadedStartTime || startTime == -1
+                    || m_uploader.planeCount() == 0) {
+                const int fw = m_frame.width();
+                const int fh = m_frame.height();
+                const int bpl = m_frame.bytesPerLine();
+
+                QSGVideoTextureUploader::Plane planes[2];
+                planes[0].width = fw;
+                planes[0].height = fh;
+                planes[0].format = GL_LUMINANCE_ALPHA;
+                planes[0].bytesPerPixel = 2;
+                planes[0].bytesPerLine = bpl;
+                planes[0].bits = bits;
+                planes[1].width = fw / 2;
+                planes[1].height = fh;
+                planes[1].format = GL_RGBA;
+                planes[1].bytesPerPixel = 4;
+                planes[1].bytesPerLine = bpl;
+                planes[1].bits = bits;
+
+                m_uploader.upload(planes, 2);
+                m_uploadedBits = bits;
+                m_uploadedStartTime = startTime;
+            }
+
+            m_frame.unmap();
+        }
+
+        m_frame = QVideoFrame();
+    }
+
+    functions->glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, m_uploader.texture(1));
+    functions->glActiveTexture(GL_TEXTURE0); // Finish with 0 as default texture unit
+    glBindTexture(GL_TEXTURE_2D, m_uploader.texture(0));
+}
+
+QSGVideoNode_PackedYUV::QSGVideoNode_PackedYUV(const QVideoSurfaceFormat &format) :
+    m_format(format)
+{
+    setFlag(QSGNode::OwnsMaterial);
+    m_material = new QSGVideoMaterial_PackedYUV(format);
+    setMaterial(m_material);
+}
+
+QSGVideoNode_PackedYUV::~QSGVideoNode_PackedYUV()
+{
+}
+
+void QSGVideoNode_PackedYUV::setCurrentFrame(const QVideoFrame &frame)
+{
+    m_material->setCurrentFrame(frame);
+    markDirty(DirtyMaterial);
+}
+
+qint64 QSGVideoNode_PackedYUV::lastUploadTime() const
+{
+    return m_material->m_uploader.lastUploadTime();
+}
+
+
+void QSGVideoMaterialShader_PackedYUV::updateState(const RenderState &state,
+                                                   QSGMaterial *newMaterial,
+                                                   QSGMaterial *oldMaterial)
+{
+    Q_UNUSED(oldMaterial);
+
+    QSGVideoMaterial_PackedYUV *mat = static_cast<QSGVideoMaterial_PackedYUV *>(newMaterial);
+    program()->setUniformValue(m_id_plane1Texture, 0);
+    program()->setUniformValue(m_id_plane2Texture, 1);
+
+    mat->bind();
+
+    program()->setUniformValue(m_id_colorMatrix, mat->m_colorMatrix);
+    program()->setUniformValue(m_id_uyvy, GLint(mat->m_format.pixelFormat() == QVideoFrame::Format_UYVY));
+    if (state.isOpacityDirty()) {
+        mat->m_opacity = state.opacity();
+        program()->setUniformValue(m_id_opacity, GLfloat(mat->m_opacity));
+    }
+
+    if (state.isMatrixDirty())
+        program()->setUniformValue(m_id_matrix, state.combinedMatrix());
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,238 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include "qsgvideotextureuploader.h"
+#include <QtCore/qelapsedtimer.h>
+#include <QtGui/QOpenGLContext>
+#include <QtGui/QOpenGLFunctions>
+
+#ifndef GL_PIXEL_UNPACK_BUFFER
+#define GL_PIXEL_UNPACK_BUFFER 0x88EC
+#endif
+
+#ifndef GL_UNPACK_ROW_LENGTH
+#define GL_UNPACK_ROW_LENGTH 0x0CF2
+#endif
+
+QT_BEGIN_NAMESPACE
+
+QSGVideoTextureUploader::QSGVideoTextureUploader()
+    : m_functions(0)
+    , m_planeCount(0)
+    , m_bufferIndex(0)
+    , m_initialized(false)
+    , m_useBuffers(false)
+    , m_useRowLength(false)
+    , m_lastUploadTime(-1)
+{
+    memset(m_textures, 0, sizeof(m_textures));
+    memset(m_buffers, 0, sizeof(m_buffers));
+    for (int i = 0; i < MaxPlanes; ++i)
+        m_planeFormats[i] = GL_LUMINANCE;
+}
+
+QSGVideoTextureUploader::~QSGVideoTextureUploader()
+{
+    release();
+}
+
+void QSGVideoTextureUploader::initialize()
+{
+    QOpenGLContext *context = QOpenGLContext::currentContext();
+    m_functions = context->functions();
+
+    const int major = context->format().majorVersion();
+    const int minor = context->format().minorVersion();
+
+    if (context->isOpenGLES()) {
+        m_useRowLength = major >= 3 || context->hasExtension("GL_EXT_unpack_subimage");
+        m_useBuffers = major >= 3 || context->hasExtension("GL_NV_pixel_buffer_object");
+    } else {
+        m_useRowLength = true;
+        m_useBuffers = major > 2 || (major == 2 && minor >= 1)
+                || context->hasExtension("GL_ARB_pixel_buffer_object");
+    }
+
+    if (!qgetenv("QT_QUICK_VIDEO_NO_PBO").isEmpty())
+        m_useBuffers = false;
+
+    m_initialized = true;
+}
+
+void QSGVideoTextureUploader::release()
+{
+    if (!m_planeCount)
+        return;
+
+    glDeleteTextures(m_planeCount, m_textures);
+    if (m_useBuffers) {
+        for (int i = 0; i < BufferCount; ++i)
+            m_functions->glDeleteBuffers(m_planeCount, m_buffers[i]);
+    }
+
+    memset(m_textures, 0, sizeof(m_textures));
+    memset(m_buffers, 0, sizeof(m_buffers));
+    m_planeCount = 0;
+}
+
+// Textures keep their storage as long as the plane layout stays the same,
+// frames are then only uploaded with glTexSubImage2D
+void QSGVideoTextureUploader::allocate(const Plane *planes, int planeCount)
+{
+    bool changed = planeCount != m_planeCount;
+    for (int i = 0; i < planeCount && !changed; ++i) {
+        changed = m_planeSizes[i] != QSize(planes[i].width, planes[i].height)
+                || m_planeFormats[i] != planes[i].format;
+    }
+
+    if (!changed)
+        return;
+
+    release();
+
+    m_planeCount = planeCount;
+    glGenTextures(m_planeCount, m_textures);
+    if (m_useBuffers) {
+        for (int i = 0; i < BufferCount; ++i)
+            m_functions->glGenBuffers(m_planeCount, m_buffers[i]);
+    }
+
+    for (int i = 0; i < m_planeCount; ++i) {
+        const Plane &plane = planes[i];
+        m_planeSizes[i] = QSize(plane.width, plane.height);
+        m_planeFormats[i] = plane.format;
+
+        glBindTexture(GL_TEXTURE_2D, m_textures[i]);
+        glTexImage2D(GL_TEXTURE_2D, 0, plane.format, plane.width, plane.height, 0,
+                     plane.format, GL_UNSIGNED_BYTE, 0);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+}
+
+void QSGVideoTextureUploader::upload(const Plane *planes, int planeCount)
+{
+    QElapsedTimer timer;
+    timer.start();
+
+    if (!m_initialized)
+        initialize();
+
+    allocate(planes, qMin<int>(planeCount, MaxPlanes));
+
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (int i = 0; i < m_planeCount; ++i)
+        uploadPlane(i, planes[i]);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+    if (m_useBuffers) {
+        m_functions->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        m_bufferIndex = (m_bufferIndex + 1) % BufferCount;
+    }
+
+    m_lastUploadTime = timer.nsecsElapsed();
+}
+
+void QSGVideoTextureUploader::uploadPlane(int index, const Plane &plane)
+{
+    const int lineSize = plane.width * plane.bytesPerPixel;
+    const uchar *bits = plane.bits;
+    int bytesPerLine = plane.bytesPerLine;
+
+    if (bytesPerLine != lineSize && (!m_useRowLength || bytesPerLine % plane.bytesPerPixel)) {
+        // No way to describe the stride to GL, pack the lines
+        m_packed.resize(lineSize * plane.height);
+        for (int y = 0; y < plane.height; ++y)
+            memcpy(m_packed.data() + y * lineSize, bits + y * bytesPerLine, lineSize);
+        bits = reinterpret_cast<const uchar *>(m_packed.constData());
+        bytesPerLine = lineSize;
+    }
+
+    if (m_useRowLength)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, bytesPerLine / plane.bytesPerPixel);
+
+    glBindTexture(GL_TEXTURE_2D, m_textures[index]);
+
+    if (m_useBuffers) {
+        // Respecifying the buffer store orphans the one a previous upload
+        // may still be reading from
+        const int size = bytesPerLine * (plane.height - 1) + lineSize;
+        m_functions->glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_buffers[m_bufferIndex][index]);
+        m_functions->glBufferData(GL_PIXEL_UNPACK_BUFFER, size, bits, GL_STREAM_DRAW);
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height,
+                        plane.format, GL_UNSIGNED_BYTE, 0);
+    } else {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, plane.width, plane.height,
+                        plane.format, GL_UNSIGNED_BYTE, bits);
+    }
+
+    if (m_useRowLength)
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+QMatrix4x4 qt_yuvColorMatrix(QVideoSurfaceFormat::YCbCrColorSpace colorSpace)
+{
+    switch (colorSpace) {
+    case QVideoSurfaceFormat::YCbCr_JPEG:
+        return QMatrix4x4(
+                    1.0f,  0.000f,  1.402f, -0.701f,
+                    1.0f, -0.344f, -0.714f,  0.529f,
+                    1.0f,  1.772f,  0.000f, -0.886f,
+                    0.0f,  0.000f,  0.000f,  1.0000f);
+    case QVideoSurfaceFormat::YCbCr_BT709:
+    case QVideoSurfaceFormat::YCbCr_xvYCC709:
+        return QMatrix4x4(
+                    1.164f,  0.000f,  1.793f, -0.5727f,
+                    1.164f, -0.534f, -0.213f,  0.3007f,
+                    1.164f,  2.115f,  0.000f, -1.1302f,
+                    0.0f,    0.000f,  0.000f,  1.0000f);
+    default: //BT 601:
+        return QMatrix4x4(
+                    1.164f,  0.000f,  1.596f, -0.8708f,
+                    1.164f, -0.392f, -0.813f,  0.5296f,
+                    1.164f,  2.017f,  0.000f, -1.081f,
+                    0.0f,    0.000f,  0.000f,  1.0000f);
+    }
+}
+
+QT_END_NAMESPACE
@@ -0,0 +1,120 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#ifndef QSGVIDEOTEXTUREUPLOADER_H
+#define QSGVIDEOTEXTUREUPLOADER_H
+
+#include <QtCore/qbytearray.h>
+#include <QtCore/qsize.h>
+#include <QtGui/qmatrix4x4.h>
+#include <QtGui/qopengl.h>
+#include <QtMultimedia/qvideosurfaceformat.h>
+
+QT_BEGIN_NAMESPACE
+
+class QOpenGLFunctions;
+
+// Streams video planes into textures that are allocated once per frame
+// layout. Where pixel buffer objects are available the data goes through
+// a ring of them, so the render thread doesn't wait for the transfer.
+// Must be used and destroyed with the rendering context current.
+class QSGVideoTextureUploader
+{
+public:
+    struct Plane
+    {
+        Plane()
+            : width(0)
+            , height(0)
+            , format(GL_LUMINANCE)
+            , bytesPerPixel(1)
+            , bytesPerLine(0)
+            , bits(0)
+        {
+        }
+
+        int width;
+        int height;
+        GLenum format;
+        int bytesPerPixel;
+        int bytesPerLine;
+        const uchar *bits;
+    };
+
+    enum { MaxPlanes = 3, BufferCount = 3 };
+
+    QSGVideoTextureUploader();
+    ~QSGVideoTextureUploader();
+
+    void upload(const Plane *planes, int planeCount);
+
+    GLuint texture(int plane) const { return m_textures[plane]; }
+    int planeCount() const { return m_planeCount; }
+
+    // Time the last upload took on the render thread, in nanoseconds
+    qint64 lastUploadTime() const { return m_lastUploadTime; }
+
+private:
+    void initialize();
+    void allocate(const Plane *planes, int planeCount);
+    void uploadPlane(int index, const Plane &plane);
+    void release();
+
+    QOpenGLFunctions *m_functions;
+    GLuint m_textures[MaxPlanes];
+    GLuint m_buffers[BufferCount][MaxPlanes];
+    QSize m_planeSizes[MaxPlanes];
+    GLenum m_planeFormats[MaxPlanes];
+    int m_planeCount;
+    int m_bufferIndex;
+    bool m_initialized;
+    bool m_useBuffers;
+    bool m_useRowLength;
+    QByteArray m_packed;
+    qint64 m_lastUploadTime;
+};
+
+// Matrix the YUV video nodes' shaders convert with, for a color space
+QMatrix4x4 qt_yuvColorMatrix(QVideoSurfaceFormat::YCbCrColorSpace colorSpace);
+
+QT_END_NAMESPACE
+
+#endif // QSGVIDEOTEXTUREUPLOADER_H
@@ -22,13 +22,19 @@ SOURCES += \
     qdeclarativevideooutput_render.cpp \
     qdeclarativevideooutput_window.cpp \
     qsgvideonode_i420.cpp \
+    qsgvideonode_nv12.cpp \
+    qsgvideonode_packedyuv.cpp \
     qsgvideonode_rgb.cpp \
-    qsgvideonode_texture.cpp
+    qsgvideonode_texture.cpp \
+    qsgvideotextureuploader.cpp
 
 HEADERS += \
     $$PRIVATE_HEADERS \
     qdeclarativevideooutput_render_p.h \
     qdeclarativevideooutput_window_p.h \
     qsgvideonode_i420.h \
+    qsgvideonode_nv12.h \
+    qsgvideonode_packedyuv.h \
     qsgvideonode_rgb.h \
-    qsgvideonode_texture.h
+    qsgvideonode_texture.h \
+    qsgvideotextureuploader.h
@@ -42,6 +42,7 @@
 #include <QtTest/QtTest>
 #include <QDebug>
 #include "qaudiodecoder.h"
+#include "qaudiobatchdecoder.h"
 
 #define TEST_FILE_NAME "testdata/test.wav"
 #define TEST_UNSUPPORTED_FILE_NAME "testdata/test-unsupported.avi"
@@ -69,6 +70,8 @@ private slots:
     void unsupportedFileTest();
     void corruptedFileTest();
     void deviceTest();
+    void readBuffersTest();
+    void batchTest();
 };
 
 void tst_QAudioDecoderBackend::init()
@@ -546,6 +549,152 @@ void tst_QAudioDecoderBackend::deviceTest()
     QCOMPARE(d.duration(), qint64(-1));
 }
 
+void tst_QAudioDecoderBackend::readBuffersTest()
+{
+    QAudioDecoder d;
+    qint64 duration = 0;
+    int sampleCount = 0;
+
+    QSignalSpy errorSpy(&d, SIGNAL(error(QAudioDecoder::Error)));
+    QSignalSpy finishedSpy(&d, SIGNAL(finished()));
+    QSignalSpy positionSpy(&d, SIGNAL(positionChanged(qint64)));
+
+    QFileInfo fileInfo(QFINDTESTDATA(TEST_FILE_NAME));
+    d.setSourceFilename(fileInfo.absoluteFilePath());
+
+    d.start();
+    QTRY_VERIFY(d.state() == QAudioDecoder::DecodingState);
+    QTRY_VERIFY(d.bufferAvailable());
+
+    // Let the backend queue up several buffers, they are pulled as a batch
+    QTest::qWait(100);
+
+    bool checkedCopy = false;
+    while (sampleCount < 44094) {
+        QTRY_VERIFY(d.bufferAvailable() || !finishedSpy.isEmpty());
+        if (!d.bufferAvailable())
+            break;
+
+        positionSpy.clear();
+        const QList<QAudioBuffer> buffers = d.readBuffers(4);
+        QVERIFY(!buffers.isEmpty());
+        QVERIFY(buffers.size() <= 4);
+
+        // One position update per batch, for the last buffer pulled
+        QCOMPARE(positionSpy.count(), 1);
+
+        foreach (const QAudioBuffer &buffer, buffers) {
+            QVERIFY(buffer.isValid());
+            QCOMPARE(buffer.format().channelCount(), 1);
+            QCOMPARE(buffer.format().sampleRate(), 44100);
+            QCOMPARE(buffer.format().sampleSize(), 16);
+            QVERIFY(buffer.constData() != 0);
+            QCOMPARE(buffer.byteCount(), buffer.sampleCount() * 2);
+
+            duration += buffer.duration();
+            sampleCount += buffer.sampleCount();
+        }
+
+        // The buffers wrap the decoder's memory, writing has to detach
+        if (!checkedCopy) {
+            const QAudioBuffer original = buffers.first();
+            const qint16 sample = original.constData<qint16>()[0];
+
+            QAudioBuffer copy = original;
+            qint16 *data = copy.data<qint16>();
+            QVERIFY(data != original.constData<qint16>());
+            data[0] = ~sample;
+
+            QCOMPARE(original.constData<qint16>()[0], sample);
+            QCOMPARE(copy.constData<qint16>()[0], qint16(~sample));
+            checkedCopy = true;
+        }
+    }
+
+    QVERIFY(errorSpy.isEmpty());
+    QCOMPARE(sampleCount, 44094);
+    QVERIFY(qAbs(duration - 1000000) < 20000);
+    QVERIFY(d.readBuffers().isEmpty());
+    QTRY_COMPARE(finishedSpy.count(), 1);
+
+    d.stop();
+    QTRY_COMPARE(d.state(), QAudioDecoder::StoppedState);
+}
+
+void tst_QAudioDecoderBackend::batchTest()
+{
+    QAudioBatchDecoder batch;
+    batch.setMaximumConcurrentJobs(2);
+
+    QSignalSpy finishedSpy(&batch, SIGNAL(jobFinished(int,QAudioBuffer)));
+    QSignalSpy failedSpy(&batch, SIGNAL(jobFailed(int,QAudioDecoder::Error,QString)));
+    QSignalSpy doneSpy(&batch, SIGNAL(finished()));
+
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    const QString waveFileName = dir.path() + QLatin1String("/batch.wav");
+    const QString fileName = QFileInfo(QFINDTESTDATA(TEST_FILE_NAME)).absoluteFilePath();
+
+    const int first = batch.addJob(fileName);
+    const int second = batch.addJob(fileName, waveFileName);
+    const int corrupted = batch.addJob(QFileInfo(QFINDTESTDATA(TEST_CORRUPTED_FILE_NAME)).absoluteFilePath());
+    QVERIFY(batch.isActive());
+
+    QTRY_COMPARE_WITH_TIMEOUT(doneSpy.count(), 1, 10000);
+    QVERIFY(!batch.isActive());
+    QCOMPARE(finishedSpy.count(), 2);
+    QCOMPARE(failedSpy.count(), 1);
+    QCOMPARE(failedSpy.at(0).at(0).toInt(), corrupted);
+
+    for (int i = 0; i < finishedSpy.count(); ++i) {
+        const int job = finishedSpy.at(i).at(0).toInt();
+        const QAudioBuffer result = finishedSpy.at(i).at(1).value<QAudioBuffer>();
+
+        // Test file is 44.1K 16bit mono, 44094 samples
+        QVERIFY(qAbs(batch.decodedDuration(job) - 1000000) < 20000);
+        QVERIFY(batch.decodingTime(job) >= 0);
+
+        if (job == first) {
+            QVERIFY(result.isValid());
+            QCOMPARE(result.sampleCount(), 44094);
+            QCOMPARE(result.format().sampleRate(), 44100);
+        } else {
+            QCOMPARE(job, second);
+            QVERIFY(!result.isValid());
+            QCOMPARE(QFileInfo(waveFileName).size(), qint64(44 + 44094 * 2));
+        }
+    }
+
+    // Everything gets converted to the batch format
+    QAudioFormat format;
+    format.setChannelCount(2);
+    format.setSampleSize(16);
+    format.setSampleRate(22050);
+    format.setCodec("audio/pcm");
+    format.setSampleType(QAudioFormat::SignedInt);
+    batch.setAudioFormat(format);
+
+    finishedSpy.clear();
+    doneSpy.clear();
+    batch.addJob(fileName);
+    QTRY_COMPARE_WITH_TIMEOUT(doneSpy.count(), 1, 10000);
+    QCOMPARE(finishedSpy.count(), 1);
+
+    const QAudioBuffer converted = finishedSpy.at(0).at(1).value<QAudioBuffer>();
+    QCOMPARE(converted.format().channelCount(), 2);
+    QCOMPARE(converted.format().sampleRate(), 22050);
+    QVERIFY(qAbs(converted.duration() - 1000000) < 20000);
+
+    // Cancelling drops pending jobs
+    batch.setMaximumConcurrentJobs(1);
+    doneSpy.clear();
+    for (int i = 0; i < 10; ++i)
+        batch.addJob(fileName);
+    batch.cancel();
+    QCOMPARE(batch.pendingJobCount(), 0);
+    QTRY_COMPARE_WITH_TIMEOUT(doneSpy.count(), 1, 10000);
+}
+
 QTEST_MAIN(tst_QAudioDecoderBackend)
 
 #include "tst_qaudiodecoderbackend.moc"
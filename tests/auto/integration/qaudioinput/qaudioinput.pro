@@ -8,3 +8,6 @@ CONFIG += testcase insignificant_test
 HEADERS += wavheader.h
 SOURCES += wavheader.cpp tst_qaudioinput.cpp
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0
+
+# The ALSA backend reports its capture latency
+unix:!mac:!android:!config_pulseaudio:config_alsa: DEFINES += QT_AUDIO_INPUT_LATENCY
@@ -116,6 +116,9 @@ private slots:
     void volume_data(){generate_audiofile_testrows();}
     void volume();
 
+    void pullMmap_data(){generate_audiofile_testrows();}
+    void pullMmap();
+
 private:
     typedef QSharedPointer<QFile> FilePtr;
 
@@ -903,6 +906,73 @@ void tst_QAudioInput::volume()
     audioInput.setVolume(volume);
 }
 
+// The ALSA backend captures from the device's mmap area on a thread of its
+// own when QT_ALSA_INPUT_MMAP is set, other backends ignore the variable.
+void tst_QAudioInput::pullMmap()
+{
+    QFETCH(FilePtr, audioFile);
+    QFETCH(QAudioFormat, audioFormat);
+
+    const QByteArray mmap = qgetenv("QT_ALSA_INPUT_MMAP");
+    qputenv("QT_ALSA_INPUT_MMAP", "1");
+    QAudioInput audioInput(audioFormat, this);
+    if (mmap.isNull())
+        qunsetenv("QT_ALSA_INPUT_MMAP");
+    else
+        qputenv("QT_ALSA_INPUT_MMAP", mmap);
+
+    audioInput.setNotifyInterval(100);
+
+    QSignalSpy notifySignal(&audioInput, SIGNAL(notify()));
+    QSignalSpy stateSignal(&audioInput, SIGNAL(stateChanged(QAudio::State)));
+
+    audioFile->close();
+    audioFile->open(QIODevice::WriteOnly);
+    WavHeader wavHeader(audioFormat);
+    QVERIFY(wavHeader.write(*audioFile));
+
+    audioInput.start(audioFile.data());
+
+    QTRY_VERIFY2((stateSignal.count() > 0),"didn't emit signals on start()");
+    QVERIFY2((audioInput.state() == QAudio::ActiveState || audioInput.state() == QAudio::IdleState),
+             "didn't transition to ActiveState or IdleState after start()");
+    QVERIFY2((audioInput.error() == QAudio::NoError), "error state is not equal to QAudio::NoError after start()");
+    QVERIFY(audioInput.periodSize() > 0);
+    stateSignal.clear();
+
+    // Allow some recording to happen
+    QTest::qWait(1000);
+
+    qint64 processedUs = audioInput.processedUSecs();
+
+    const qint64 latencyUs = audioInput.latencyUSecs();
+#ifdef QT_AUDIO_INPUT_LATENCY
+    QVERIFY2(latencyUs >= 0,
+             QString("latencyUSecs() should be known while recording (%1)").arg(latencyUs).toLocal8Bit().constData());
+#else
+    QCOMPARE(latencyUs, qint64(-1));
+#endif
+
+    audioInput.stop();
+    QTRY_VERIFY2((stateSignal.count() == 1),
+                 QString("didn't emit StoppedState signal after stop(), got %1 signals instead").arg(stateSignal.count()).toLocal8Bit().constData());
+    QVERIFY2((audioInput.state() == QAudio::StoppedState), "didn't transitions to StoppedState after stop()");
+    QCOMPARE(audioInput.latencyUSecs(), qint64(-1));
+
+    QVERIFY2(qTolerantCompare(processedUs, 1000000LL),
+             QString("processedUSecs() doesn't fall in acceptable range, should be 1000000 (%1)").arg(processedUs).toLocal8Bit().constData());
+    QVERIFY2((audioInput.error() == QAudio::NoError), "error() is not QAudio::NoError after stop()");
+    QVERIFY2(notifySignal.count() > 0, "not emitting notify() signal");
+
+    // The capture thread's data made it to the file
+    const qint64 dataLength = audioFile->pos() - WavHeader::headerLength();
+    QVERIFY2(dataLength > 0, "no audio data captured");
+    QCOMPARE(dataLength % audioFormat.bytesPerFrame(), qint64(0));
+
+    WavHeader::writeDataLength(*audioFile, dataLength);
+    audioFile->close();
+}
+
 QTEST_MAIN(tst_QAudioInput)
 
 #include "tst_qaudioinput.moc"
@@ -10,3 +10,6 @@ SOURCES += wavheader.cpp tst_qaudiooutput.cpp
 
 mac: CONFIG += insignificant_test
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0
+
+# The PulseAudio and ALSA backends report their latency
+unix:!mac:!android:if(config_pulseaudio|config_alsa): DEFINES += QT_AUDIO_OUTPUT_LATENCY
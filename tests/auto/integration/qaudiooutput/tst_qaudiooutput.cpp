@@ -535,6 +535,12 @@ void tst_QAudioOutput::pull()
     // Check that 'elapsed' increases
     QTest::qWait(40);
     QVERIFY2((audioOutput.elapsedUSecs() > 0), "elapsedUSecs() is still zero after start()");
+#ifdef QT_AUDIO_OUTPUT_LATENCY
+    // Data is queued in the device while the stream is active
+    QTRY_VERIFY2((audioOutput.latencyUSecs() > 0), "latencyUSecs() is not positive while playing");
+#else
+    QCOMPARE(audioOutput.latencyUSecs(), qint64(-1));
+#endif
 
     // Wait until playback finishes
     QTest::qWait(3000); // 3 seconds should be plenty
@@ -557,6 +563,7 @@ void tst_QAudioOutput::pull()
              QString("processedUSecs() doesn't equal file duration in us (%1)").arg(processedUs).toLocal8Bit().constData());
     QVERIFY2((audioOutput.error() == QAudio::NoError), "error() is not QAudio::NoError after stop()");
     QVERIFY2((audioOutput.elapsedUSecs() == (qint64)0), "elapsedUSecs() not equal to zero in StoppedState");
+    QCOMPARE(audioOutput.latencyUSecs(), qint64(-1));
     QVERIFY2(notifySignal.count() > 0, "not emitting notify() signal");
 
     audioFile->close();
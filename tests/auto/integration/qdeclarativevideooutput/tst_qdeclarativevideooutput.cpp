@@ -120,6 +120,7 @@ public slots:
 private slots:
     void fillMode();
     void orientation();
+    void framePacing();
     void surfaceSource();
     void sourceRect();
 
@@ -265,6 +266,47 @@ void tst_QDeclarativeVideoOutput::orientation()
     delete videoOutput;
 }
 
+void tst_QDeclarativeVideoOutput::framePacing()
+{
+    QQmlComponent component(&m_engine);
+    component.setData(m_plainQML, QUrl());
+
+    QObject *videoOutput = component.create();
+    QVERIFY(videoOutput != 0);
+
+    SurfaceHolder holder(this);
+    videoOutput->setProperty("source", QVariant::fromValue(static_cast<QObject*>(&holder)));
+
+    QSignalSpy propSpy(videoOutput, SIGNAL(framePacingChanged()));
+    QSignalSpy statisticsSpy(videoOutput, SIGNAL(frameStatisticsChanged()));
+
+    // Disabled by default
+    QCOMPARE(videoOutput->property("framePacing").toBool(), false);
+    QCOMPARE(propSpy.count(), 0);
+
+    videoOutput->setProperty("framePacing", QVariant(true));
+    QCOMPARE(videoOutput->property("framePacing").toBool(), true);
+    QCOMPARE(propSpy.count(), 1);
+    QCOMPARE(statisticsSpy.count(), 1);
+
+    // Same value should not reemit
+    videoOutput->setProperty("framePacing", QVariant(true));
+    QCOMPARE(propSpy.count(), 1);
+
+    // Frames are only counted when rendered
+    holder.presentDummyFrame(QSize(200, 100));
+    QCOMPARE(videoOutput->property("framesPresented").toInt(), 0);
+    QCOMPARE(videoOutput->property("framesDropped").toInt(), 0);
+    QCOMPARE(videoOutput->property("framesRepeated").toInt(), 0);
+    QCOMPARE(videoOutput->property("averageLateness").toReal(), qreal(0));
+
+    videoOutput->setProperty("framePacing", QVariant(false));
+    QCOMPARE(videoOutput->property("framePacing").toBool(), false);
+    QCOMPARE(propSpy.count(), 2);
+
+    delete videoOutput;
+}
+
 void tst_QDeclarativeVideoOutput::surfaceSource()
 {
     QQmlComponent component(&m_engine);
@@ -84,6 +84,9 @@ private slots:
     void playlist();
     void surfaceTest_data();
     void surfaceTest();
+    void asyncSurfaceTest_data();
+    void asyncSurfaceTest();
+    void asyncSurfaceErrorTest();
 
 private:
     QMediaContent selectVideoFile(const QStringList& mediaCandidates);
@@ -119,6 +122,8 @@ public:
 
     QList<QVideoFrame> m_frameList;
     int m_totalFrames; // used instead of the list when frames are not stored
+    int m_presentDelay; // milliseconds present() takes, to simulate a slow surface
+    bool m_failPresent;
 
 private:
     bool m_storeFrames;
@@ -947,8 +952,97 @@ void tst_QMediaPlayerBackend::surfaceTest()
     QVERIFY(surface.m_totalFrames >= 25);
 }
 
+// Sets an environment variable for the lifetime of the object
+class EnvironmentVariable
+{
+public:
+    EnvironmentVariable(const char *name, const QByteArray &value)
+        : m_name(name), m_oldValue(qgetenv(name))
+    {
+        qputenv(name, value);
+    }
+
+    ~EnvironmentVariable()
+    {
+        if (m_oldValue.isNull())
+            qunsetenv(m_name);
+        else
+            qputenv(m_name, m_oldValue);
+    }
+
+private:
+    const char *m_name;
+    QByteArray m_oldValue;
+};
+
+void tst_QMediaPlayerBackend::asyncSurfaceTest_data()
+{
+    QTest::addColumn<QByteArray>("dropPolicy");
+
+    QTest::newRow("drop oldest frame") << QByteArray("0");
+    QTest::newRow("drop late frames") << QByteArray("1");
+}
+
+// The GStreamer video sink hands frames to the surface through a queue
+void tst_QMediaPlayerBackend::asyncSurfaceTest()
+{
+    // 25 fps video file
+    if (localVideoFile.isNull())
+        QSKIP("Video format is not supported");
+
+    QFETCH(QByteArray, dropPolicy);
+
+    EnvironmentVariable async("QT_GSTREAMER_VIDEOSINK_ASYNC", "1");
+    EnvironmentVariable policy("QT_GSTREAMER_VIDEOSINK_DROP_POLICY", dropPolicy);
+
+    // Presenting takes longer than a frame, so frames have to be dropped
+    TestVideoSurface surface;
+    surface.m_presentDelay = 100;
+
+    QMediaPlayer player;
+    QSignalSpy errorSpy(&player, SIGNAL(error(QMediaPlayer::Error)));
+    player.setVideoOutput(&surface);
+    player.setMedia(localVideoFile);
+    player.play();
+
+    // The streaming thread isn't held up by the slow surface
+    QTRY_VERIFY(player.position() >= 1000);
+    player.stop();
+
+    QVERIFY(errorSpy.isEmpty());
+    QVERIFY(surface.m_totalFrames > 0);
+    QVERIFY(surface.m_totalFrames < 25);
+
+    // Dropping never reorders frames
+    for (int i = 1; i < surface.m_frameList.size(); ++i)
+        QVERIFY(surface.m_frameList.at(i).startTime() > surface.m_frameList.at(i - 1).startTime());
+}
+
+// A surface error in asynchronous mode fails the next render
+void tst_QMediaPlayerBackend::asyncSurfaceErrorTest()
+{
+    if (localVideoFile.isNull())
+        QSKIP("Video format is not supported");
+
+    EnvironmentVariable async("QT_GSTREAMER_VIDEOSINK_ASYNC", "1");
+
+    TestVideoSurface surface;
+    QMediaPlayer player;
+    QSignalSpy errorSpy(&player, SIGNAL(error(QMediaPlayer::Error)));
+    player.setVideoOutput(&surface);
+    player.setMedia(localVideoFile);
+    player.play();
+    QTRY_VERIFY(surface.m_totalFrames > 0);
+
+    surface.m_failPresent = true;
+    QTRY_VERIFY(!errorSpy.isEmpty());
+    QVERIFY(player.error() != QMediaPlayer::NoError);
+}
+
 TestVideoSurface::TestVideoSurface(bool storeFrames):
     m_totalFrames(0),
+    m_presentDelay(0),
+    m_failPresent(false),
     m_storeFrames(storeFrames)
 {
     // set default formats
@@ -983,6 +1077,14 @@ void TestVideoSurface::stop()
 
 bool TestVideoSurface::present(const QVideoFrame &frame)
 {
+    if (m_failPresent) {
+        setError(ResourceError);
+        return false;
+    }
+
+    if (m_presentDelay > 0)
+        QThread::msleep(m_presentDelay);
+
     if (m_storeFrames)
         m_frameList.push_back(frame);
     m_totalFrames++;
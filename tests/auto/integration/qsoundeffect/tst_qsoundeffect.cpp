@@ -75,6 +75,7 @@ private slots:
     void testSetSourceWhilePlaying();
     void testSupportedMimeTypes();
     void testCorruptFile();
+    void testPreload();
 
 private:
     QSoundEffect* sound;
@@ -424,6 +425,21 @@ void tst_QSoundEffect::testCorruptFile()
     }
 }
 
+void tst_QSoundEffect::testPreload()
+{
+    QSoundEffect::preload(QList<QUrl>() << url << url2 << urlCorrupted);
+
+    // Preloaded sources still play like any other
+    sound->setSource(url2);
+    QTRY_COMPARE(sound->status(), QSoundEffect::Ready);
+    sound->play();
+    QVERIFY(sound->isPlaying());
+    QTRY_VERIFY(!sound->isPlaying());
+
+    sound->setSource(urlCorrupted);
+    QTRY_COMPARE(sound->status(), QSoundEffect::Error);
+}
+
 QTEST_MAIN(tst_QSoundEffect)
 
 #include "tst_qsoundeffect.moc"
@@ -28,9 +28,12 @@ SUBDIRS += \
     qradiotuner \
     qvideoencodersettingscontrol \
     qvideoframe \
+    qvideoframeconversionhelper \
+    qvideoframepool \
     qvideosurfaceformat \
     qwavedecoder \
     qaudiobuffer \
+    qaudiohelpers \
     qaudiodecoder \
     qaudioprobe \
     qvideoprobe \
@@ -117,6 +117,7 @@ void tst_QAbstractVideoBuffer::handleType_data()
     ADD_ENUM_TEST(GLTextureHandle);
     ADD_ENUM_TEST(XvShmImageHandle);
     ADD_ENUM_TEST(QPixmapHandle);
+    ADD_ENUM_TEST(SharedMemoryHandle);
     ADD_ENUM_TEST(CoreImageHandle);
 
     // User handles are different
@@ -62,6 +62,7 @@ private Q_SLOTS:
     void format();
     void source();
     void readAll();
+    void readBuffers();
     void nullControl();
     void nullService();
 
@@ -340,6 +341,42 @@ void tst_QAudioDecoder::readAll()
     }
 }
 
+void tst_QAudioDecoder::readBuffers()
+{
+    QAudioDecoder d;
+    d.setSourceFilename("Foo");
+
+    QSignalSpy finishedSpy(&d, SIGNAL(finished()));
+
+    QVERIFY(d.readBuffers().isEmpty());
+
+    d.start();
+    QVERIFY(d.readBuffers().isEmpty());
+
+    qint64 lastStartTime = -1;
+    int count = 0;
+    while (count < MOCK_DECODER_MAX_BUFFERS) {
+        QTRY_VERIFY(d.bufferAvailable());
+        QVERIFY(d.readBuffers(0).isEmpty());
+
+        const QList<QAudioBuffer> buffers = d.readBuffers();
+        QVERIFY(!buffers.isEmpty());
+        QVERIFY(!d.bufferAvailable());
+
+        foreach (const QAudioBuffer &buffer, buffers) {
+            QVERIFY(buffer.isValid());
+            QVERIFY(buffer.startTime() > lastStartTime);
+            lastStartTime = buffer.startTime();
+        }
+        QCOMPARE(d.position(), lastStartTime / 1000);
+        count += buffers.size();
+    }
+
+    QCOMPARE(count, MOCK_DECODER_MAX_BUFFERS);
+    QCOMPARE(finishedSpy.count(), 1);
+    QVERIFY(d.state() == QAudioDecoder::StoppedState);
+}
+
 void tst_QAudioDecoder::nullControl()
 {
     mockAudioDecoderService->setControlNull();
@@ -368,6 +405,7 @@ void tst_QAudioDecoder::nullControl()
     QVERIFY(!d.audioFormat().isValid());
 
     QVERIFY(!d.read().isValid());
+    QVERIFY(d.readBuffers().isEmpty());
     QVERIFY(!d.bufferAvailable());
 
     QVERIFY(d.position() == -1);
@@ -0,0 +1,6 @@
+CONFIG += testcase no_private_qt_headers_warning
+TARGET = tst_qaudiohelpers
+
+QT += core multimedia-private testlib
+
+SOURCES += tst_qaudiohelpers.cpp
@@ -0,0 +1,330 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+//TESTED_COMPONENT=src/multimedia
+
+#include <QtTest/QtTest>
+
+#include <qaudioformat.h>
+#include <private/qaudiohelpers_p.h>
+
+#include <math.h>
+
+QT_USE_NAMESPACE
+
+Q_DECLARE_METATYPE(QAudioFormat::SampleType)
+
+class tst_QAudioHelpers : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void multiplySamples_data();
+    void multiplySamples();
+    void multiplyBuffer_data();
+    void multiplyBuffer();
+    void multiplyFloatSamples();
+    void storeMixedSamples();
+};
+
+static QAudioFormat sampleFormat(int sampleSize, QAudioFormat::SampleType sampleType)
+{
+    QAudioFormat format;
+    format.setSampleRate(48000);
+    format.setChannelCount(1);
+    format.setCodec(QLatin1String("audio/pcm"));
+    format.setByteOrder(QAudioFormat::Endian(QSysInfo::ByteOrder));
+    format.setSampleSize(sampleSize);
+    format.setSampleType(sampleType);
+    return format;
+}
+
+// Integer samples are handled as signed values, unsigned samples are biased
+static qint64 sampleBias(const QAudioFormat &format)
+{
+    return format.sampleType() == QAudioFormat::UnSignedInt
+            ? Q_INT64_C(1) << (format.sampleSize() - 1) : 0;
+}
+
+static void writeSample(const QAudioFormat &format, char *data, int index, qint64 value)
+{
+    const quint32 raw = quint32(value + sampleBias(format));
+    char *p = data + index * format.sampleSize() / 8;
+
+    switch (format.sampleSize()) {
+    case 8:
+        *reinterpret_cast<quint8 *>(p) = quint8(raw);
+        break;
+    case 16:
+        *reinterpret_cast<quint16 *>(p) = quint16(raw);
+        break;
+    case 24:
+        if (QSysInfo::ByteOrder == QSysInfo::LittleEndian) {
+            p[0] = char(raw);
+            p[1] = char(raw >> 8);
+            p[2] = char(raw >> 16);
+        } else {
+            p[0] = char(raw >> 16);
+            p[1] = char(raw >> 8);
+            p[2] = char(raw);
+        }
+        break;
+    default:
+        *reinterpret_cast<quint32 *>(p) = raw;
+        break;
+    }
+}
+
+static qint64 readSample(const QAudioFormat &format, const char *data, int index)
+{
+    const uchar *p = reinterpret_cast<const uchar *>(data + index * format.sampleSize() / 8);
+    const int bits = format.sampleSize();
+
+    quint32 raw = 0;
+    switch (bits) {
+    case 8:
+        raw = *p;
+        break;
+    case 16:
+        raw = *reinterpret_cast<const quint16 *>(p);
+        break;
+    case 24:
+        raw = QSysInfo::ByteOrder == QSysInfo::LittleEndian
+                ? p[0] | (p[1] << 8) | (p[2] << 16)
+                : (p[0] << 16) | (p[1] << 8) | p[2];
+        break;
+    default:
+        raw = *reinterpret_cast<const quint32 *>(p);
+        break;
+    }
+
+    if (format.sampleType() == QAudioFormat::UnSignedInt)
+        return qint64(raw) - sampleBias(format);
+
+    // Sign extend
+    const qint64 sign = Q_INT64_C(1) << (bits - 1);
+    const qint64 value = qint64(raw) & ((sign << 1) - 1);
+    return (value ^ sign) - sign;
+}
+
+// Rounds to nearest, ties to even, and clamps to the sample range. 8 and 16
+// bit samples are scaled with a 16.16 fixed-point gain.
+static qint64 expectedSample(const QAudioFormat &format, qint64 value, qreal factor)
+{
+    const qint64 max = (Q_INT64_C(1) << (format.sampleSize() - 1)) - 1;
+
+    qint64 rounded;
+    if (format.sampleSize() <= 16) {
+        const qint64 scaled = value * qRound64(factor * 65536);
+        const qint64 fraction = scaled & 0xffff;
+        rounded = scaled >> 16;
+        if (fraction > 0x8000 || (fraction == 0x8000 && (rounded & 1)))
+            ++rounded;
+    } else {
+        const double scaled = value * factor;
+        rounded = qint64(floor(scaled));
+        const double fraction = scaled - rounded;
+        if (fraction > 0.5 || (fraction == 0.5 && (rounded & 1)))
+            ++rounded;
+    }
+
+    return qBound(-max - 1, rounded, max);
+}
+
+void tst_QAudioHelpers::multiplySamples_data()
+{
+    QTest::addColumn<int>("sampleSize");
+    QTest::addColumn<QAudioFormat::SampleType>("sampleType");
+    QTest::addColumn<qreal>("factor");
+    QTest::addColumn<qint64>("sample");
+    QTest::addColumn<qint64>("expected");
+
+    const QAudioFormat::SampleType types[] = { QAudioFormat::SignedInt, QAudioFormat::UnSignedInt };
+    const int sizes[] = { 8, 16, 24, 32 };
+
+    for (int t = 0; t < 2; ++t) {
+        for (int s = 0; s < 4; ++s) {
+            const int size = sizes[s];
+            const qint64 max = (Q_INT64_C(1) << (size - 1)) - 1;
+            const qint64 min = -max - 1;
+            const QByteArray name = QByteArray(types[t] == QAudioFormat::SignedInt ? "int" : "uint")
+                    + QByteArray::number(size);
+
+            // Ties go to the even neighbour
+            QTest::newRow(name + " 1.5 to 2") << size << types[t] << qreal(0.5) << qint64(3) << qint64(2);
+            QTest::newRow(name + " 2.5 to 2") << size << types[t] << qreal(0.5) << qint64(5) << qint64(2);
+            QTest::newRow(name + " -1.5 to -2") << size << types[t] << qreal(0.5) << qint64(-3) << qint64(-2);
+            QTest::newRow(name + " -2.5 to -2") << size << types[t] << qreal(0.5) << qint64(-5) << qint64(-2);
+            QTest::newRow(name + " 0.5 to 0") << size << types[t] << qreal(0.5) << qint64(1) << qint64(0);
+
+            // Amplification saturates instead of wrapping around
+            QTest::newRow(name + " max saturates") << size << types[t] << qreal(2.0) << max << max;
+            QTest::newRow(name + " min saturates") << size << types[t] << qreal(2.0) << min << min;
+            QTest::newRow(name + " half max") << size << types[t] << qreal(0.5) << max << (max + 1) / 2;
+            QTest::newRow(name + " half min") << size << types[t] << qreal(0.5) << min << min / 2;
+
+            // Silence is the bias for unsigned samples
+            QTest::newRow(name + " silence") << size << types[t] << qreal(0.0) << max << qint64(0);
+            QTest::newRow(name + " unity") << size << types[t] << qreal(1.0) << min << min;
+        }
+    }
+}
+
+// Scales a buffer long enough for the vectorized kernels, every sample set
+// to the same value, and checks the samples they produce as well as the
+// remainder handled by the generic code.
+void tst_QAudioHelpers::multiplySamples()
+{
+    QFETCH(int, sampleSize);
+    QFETCH(QAudioFormat::SampleType, sampleType);
+    QFETCH(qreal, factor);
+    QFETCH(qint64, sample);
+    QFETCH(qint64, expected);
+
+    const QAudioFormat format = sampleFormat(sampleSize, sampleType);
+    const int samples = 67;
+
+    QByteArray source(samples * sampleSize / 8, Qt::Uninitialized);
+    for (int i = 0; i < samples; ++i)
+        writeSample(format, source.data(), i, sample);
+
+    QByteArray destination(source.size(), Qt::Uninitialized);
+    QAudioHelperInternal::qMultiplySamples(factor, format, source.constData(), destination.data(), destination.size());
+
+    for (int i = 0; i < samples; ++i)
+        QCOMPARE(readSample(format, destination.constData(), i), expected);
+
+    // In place
+    QAudioHelperInternal::qMultiplySamples(factor, format, source.constData(), source.data(), source.size());
+    QCOMPARE(source, destination);
+}
+
+void tst_QAudioHelpers::multiplyBuffer_data()
+{
+    QTest::addColumn<int>("sampleSize");
+    QTest::addColumn<QAudioFormat::SampleType>("sampleType");
+    QTest::addColumn<qreal>("factor");
+
+    const qreal factors[] = { 0.1, 0.5, 0.75, 1.5, 3.0 };
+    const int sizes[] = { 8, 16, 24, 32 };
+
+    for (int s = 0; s < 4; ++s) {
+        for (int f = 0; f < 5; ++f) {
+            const QByteArray name = QByteArray::number(sizes[s]) + " bit, factor "
+                    + QByteArray::number(factors[f]);
+            QTest::newRow("int" + name) << sizes[s] << QAudioFormat::SignedInt << factors[f];
+            QTest::newRow("uint" + name) << sizes[s] << QAudioFormat::UnSignedInt << factors[f];
+        }
+    }
+}
+
+// Every code path follows the same rounding rule
+void tst_QAudioHelpers::multiplyBuffer()
+{
+    QFETCH(int, sampleSize);
+    QFETCH(QAudioFormat::SampleType, sampleType);
+    QFETCH(qreal, factor);
+
+    const QAudioFormat format = sampleFormat(sampleSize, sampleType);
+    const qint64 max = (Q_INT64_C(1) << (sampleSize - 1)) - 1;
+    const int samples = 1001;
+
+    QVector<qint64> values(samples);
+    for (int i = 0; i < samples; ++i)
+        values[i] = (qint64(qrand()) * 65536 + qrand()) % (2 * max + 2) - max - 1;
+    values[0] = max;
+    values[1] = -max - 1;
+
+    QByteArray source(samples * sampleSize / 8, Qt::Uninitialized);
+    for (int i = 0; i < samples; ++i)
+        writeSample(format, source.data(), i, values.at(i));
+
+    QByteArray destination(source.size(), Qt::Uninitialized);
+    QAudioHelperInternal::qMultiplySamples(factor, format, source.constData(), destination.data(), destination.size());
+
+    for (int i = 0; i < samples; ++i)
+        QCOMPARE(readSample(format, destination.constData(), i), expectedSample(format, values.at(i), factor));
+}
+
+void tst_QAudioHelpers::multiplyFloatSamples()
+{
+    const QAudioFormat format = sampleFormat(32, QAudioFormat::Float);
+
+    QVector<float> source(37);
+    for (int i = 0; i < source.size(); ++i)
+        source[i] = float(i - 18) / 16;
+
+    QVector<float> destination(source.size());
+    QAudioHelperInternal::qMultiplySamples(0.5, format, source.constData(), destination.data(),
+                                           source.size() * sizeof(float));
+
+    // Float samples are neither rounded nor clipped
+    for (int i = 0; i < source.size(); ++i)
+        QCOMPARE(destination.at(i), source.at(i) * 0.5f);
+}
+
+void tst_QAudioHelpers::storeMixedSamples()
+{
+    const QAudioFormat format = sampleFormat(16, QAudioFormat::SignedInt);
+    QVERIFY(QAudioHelperInternal::qIsMixableFormat(format));
+
+    const float values[] = { 0.5f, 1.5f, 2.5f, -0.5f, -1.5f, -2.5f, 40000.0f, -40000.0f, 3e9f, -3e9f };
+    const qint16 expected[] = { 0, 2, 2, 0, -2, -2, 32767, -32768, 32767, -32768 };
+    const int count = sizeof(values) / sizeof(values[0]);
+
+    // Long enough for the vectorized store and a remainder
+    QVector<float> accumulator;
+    QVector<qint16> expectedSamples;
+    for (int repeat = 0; repeat < 3; ++repeat) {
+        for (int i = 0; i < count; ++i) {
+            accumulator.append(values[i]);
+            expectedSamples.append(expected[i]);
+        }
+    }
+
+    QVector<qint16> destination(accumulator.size());
+    QAudioHelperInternal::qStoreMixedSamples(format, accumulator.constData(), destination.data(), accumulator.size());
+    QCOMPARE(destination, expectedSamples);
+}
+
+QTEST_MAIN(tst_QAudioHelpers)
+
+#include "tst_qaudiohelpers.moc"
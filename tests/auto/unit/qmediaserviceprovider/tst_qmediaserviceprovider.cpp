@@ -80,6 +80,7 @@ public slots:
     void initTestCase();
 
 private slots:
+    void testPluginIndexRebuild();
     void testDefaultProviderAvailable();
     void testObtainService();
     void testHasSupport();
@@ -90,6 +91,8 @@ private slots:
     void testCameraInfo();
 
 private:
+    QString pluginIndexPath(const QStringList &libraryPaths = QCoreApplication::libraryPaths()) const;
+
     QObjectList plugins;
 };
 
@@ -97,6 +100,65 @@ void tst_QMediaServiceProvider::initTestCase()
 {
 //    QMediaPluginLoader::setStaticPlugins(QLatin1String("mediaservice"), plugins);
     QCoreApplication::setLibraryPaths(QStringList() << QCoreApplication::applicationDirPath());
+
+    // Leave a plugin index behind that doesn't match the installed plugins,
+    // it has to be rebuilt by the first query.
+    QStandardPaths::setTestModeEnabled(true);
+    QVERIFY(QDir().mkpath(QFileInfo(pluginIndexPath()).absolutePath()));
+
+    QJsonObject staleIndex;
+    staleIndex.insert(QStringLiteral("fingerprint"), QStringLiteral("stale"));
+    staleIndex.insert(QStringLiteral("plugins"), QJsonArray());
+
+    QFile file(pluginIndexPath());
+    QVERIFY(file.open(QIODevice::WriteOnly));
+    file.write(QJsonDocument(staleIndex).toJson());
+
+    // The index of an application searching other plugin paths
+    QFile otherFile(pluginIndexPath(QStringList() << QStringLiteral("/other")));
+    QVERIFY(otherFile.open(QIODevice::WriteOnly));
+    otherFile.write(QJsonDocument(staleIndex).toJson());
+}
+
+// Each set of plugin paths has its own index
+QString tst_QMediaServiceProvider::pluginIndexPath(const QStringList &libraryPaths) const
+{
+    const QByteArray key = QCryptographicHash::hash(libraryPaths.join(QLatin1Char('\n')).toUtf8(),
+                                                    QCryptographicHash::Sha1).toHex().left(16);
+
+    return QStandardPaths::writableLocation(QStandardPaths::GenericCacheLocation)
+            + QStringLiteral("/qtmultimedia/mediaservice-plugins-")
+            + QString::fromLatin1(key) + QStringLiteral(".json");
+}
+
+// Must run before any other query loads the index
+void tst_QMediaServiceProvider::testPluginIndexRebuild()
+{
+    QMediaServiceProvider *provider = QMediaServiceProvider::defaultServiceProvider();
+    QVERIFY(provider != 0);
+
+    // The stale index lists no plugins
+    QMediaService *service = provider->requestService(Q_MEDIASERVICE_MEDIAPLAYER);
+    QVERIFY(service != 0);
+    provider->releaseService(service);
+
+    QFile file(pluginIndexPath());
+    QVERIFY(file.open(QIODevice::ReadOnly));
+    const QJsonObject index = QJsonDocument::fromJson(file.readAll()).object();
+    QVERIFY(index.value(QStringLiteral("fingerprint")).toString() != QLatin1String("stale"));
+
+    const QJsonArray plugins = index.value(QStringLiteral("plugins")).toArray();
+    QVERIFY(!plugins.isEmpty());
+
+    // What a plugin supports may change without the plugin file changing
+    foreach (const QJsonValue &plugin, plugins)
+        QVERIFY(!plugin.toObject().contains(QStringLiteral("mimeTypes")));
+
+    // Other applications' indexes are left alone
+    QFile otherFile(pluginIndexPath(QStringList() << QStringLiteral("/other")));
+    QVERIFY(otherFile.open(QIODevice::ReadOnly));
+    const QJsonObject otherIndex = QJsonDocument::fromJson(otherFile.readAll()).object();
+    QCOMPARE(otherIndex.value(QStringLiteral("fingerprint")).toString(), QStringLiteral("stale"));
 }
 
 void tst_QMediaServiceProvider::testDefaultProviderAvailable()
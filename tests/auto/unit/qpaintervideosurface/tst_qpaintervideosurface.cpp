@@ -200,6 +200,11 @@ static const uchar yuvPlanarImageData[] =
     0x00, 0x0f, 0x0f, 0x00,
 };
 
+static const uchar uyvyImageData[] =
+{
+    0x80, 0x10, 0x80, 0xeb, 0x10, 0x51, 0xf0, 0x29
+};
+
 void tst_QPainterVideoSurface::supportedFormat_data()
 {
     QTest::addColumn<QAbstractVideoBuffer::HandleType>("handleType");
@@ -251,14 +256,26 @@ void tst_QPainterVideoSurface::supportedFormat_data()
             << QAbstractVideoBuffer::NoHandle
             << QVideoFrame::Format_YUV420P
             << QSize(640, 480)
-            << false
-            << false;
+            << true
+            << true;
     QTest::newRow("YUV420P 640x-480")
             << QAbstractVideoBuffer::NoHandle
             << QVideoFrame::Format_YUV420P
             << QSize(640, -480)
-            << false
+            << true
             << false;
+    QTest::newRow("NV12 1920x1080")
+            << QAbstractVideoBuffer::NoHandle
+            << QVideoFrame::Format_NV12
+            << QSize(1920, 1080)
+            << true
+            << true;
+    QTest::newRow("UYVY 640x480")
+            << QAbstractVideoBuffer::NoHandle
+            << QVideoFrame::Format_UYVY
+            << QSize(640, 480)
+            << true
+            << true;
     QTest::newRow("Y8 640x480")
             << QAbstractVideoBuffer::NoHandle
             << QVideoFrame::Format_Y8
@@ -425,6 +442,30 @@ void tst_QPainterVideoSurface::present_data()
             << int(sizeof(rgb565ImageData))
             << 4;
 #endif
+
+    QTest::newRow("rgb32 -> yuv420p")
+            << QVideoFrame::Format_RGB32
+            << QSize(2, 2)
+            << static_cast<const uchar *>(rgb32ImageData)
+            << int(sizeof(rgb32ImageData))
+            << 8
+            << QVideoFrame::Format_YUV420P
+            << QSize(8, 8)
+            << static_cast<const uchar *>(yuvPlanarImageData)
+            << int(sizeof(yuvPlanarImageData))
+            << 8;
+
+    QTest::newRow("yv12 -> uyvy")
+            << QVideoFrame::Format_YV12
+            << QSize(8, 8)
+            << static_cast<const uchar *>(yuvPlanarImageData)
+            << int(sizeof(yuvPlanarImageData))
+            << 8
+            << QVideoFrame::Format_UYVY
+            << QSize(2, 2)
+            << static_cast<const uchar *>(uyvyImageData)
+            << int(sizeof(uyvyImageData))
+            << 4;
 }
 
 void tst_QPainterVideoSurface::present()
@@ -57,6 +57,9 @@ private slots:
     void testEnoughCapacity();
     void testNotEnoughCapacity();
     void testInvalidFile();
+    void testLeastRecentlyUsedEviction();
+    void testPrefetch();
+    void testPreferredFormat();
 
 private:
 
@@ -194,6 +197,108 @@ void tst_QSampleCache::testInvalidFile()
     QVERIFY(!cache.isCached(QUrl::fromLocalFile("invalid")));
 }
 
+void tst_QSampleCache::testLeastRecentlyUsedEviction()
+{
+    const QUrl first = QUrl::fromLocalFile(QFINDTESTDATA("testdata/test.wav"));
+    const QUrl second = QUrl::fromLocalFile(QFINDTESTDATA("testdata/test2.wav"));
+    const QUrl third = QUrl::fromLocalFile(QFINDTESTDATA("testdata/test3.wav"));
+
+    QSampleCache cache;
+
+    QSample* sample = cache.requestSample(first);
+    QTRY_COMPARE(sample->state(), QSample::Ready);
+    const qint64 sampleSize = sample->data().size();
+    QCOMPARE(cache.usage(), sampleSize);
+    sample->release();
+
+    // room for two samples
+    cache.setCapacity(sampleSize * 2 + sampleSize / 2);
+
+    sample = cache.requestSample(first);
+    QTRY_COMPARE(sample->state(), QSample::Ready);
+    sample->release();
+
+    sample = cache.requestSample(second);
+    QTRY_COMPARE(sample->state(), QSample::Ready);
+    sample->release();
+
+    // use the first sample again, the second one is now the least recently used
+    sample = cache.requestSample(first);
+    QCOMPARE(sample->state(), QSample::Ready);
+    sample->release();
+
+    sample = cache.requestSample(third);
+    QTRY_COMPARE(sample->state(), QSample::Ready);
+    sample->release();
+
+    QVERIFY(cache.isCached(first));
+    QVERIFY(!cache.isCached(second));
+    QVERIFY(cache.isCached(third));
+
+    QCOMPARE(cache.sampleCount(), 2);
+    QCOMPARE(cache.usage(), sampleSize * 2);
+    QCOMPARE(cache.evictionCount(), 1);
+    QCOMPARE(cache.hitCount(), 1);
+    QCOMPARE(cache.missCount(), 4);
+    QTRY_VERIFY(!cache.isLoading());
+}
+
+void tst_QSampleCache::testPrefetch()
+{
+    const QUrl url = QUrl::fromLocalFile(QFINDTESTDATA("testdata/test.wav"));
+
+    QSampleCache cache;
+
+    // nothing is kept without a capacity
+    cache.prefetch(url);
+    QVERIFY(!cache.isCached(url));
+
+    cache.setCapacity(1024 * 1024);
+    cache.prefetch(url);
+    QVERIFY(cache.isCached(url));
+    QTRY_VERIFY(!cache.isLoading());
+
+    QSample* sample = cache.requestSample(url);
+    QCOMPARE(sample->state(), QSample::Ready);
+    QCOMPARE(cache.hitCount(), 1);
+    sample->release();
+}
+
+void tst_QSampleCache::testPreferredFormat()
+{
+    const QUrl url = QUrl::fromLocalFile(QFINDTESTDATA("testdata/test.wav"));
+
+    QSampleCache cache;
+    QSample* sample = cache.requestSample(url);
+    QTRY_COMPARE(sample->state(), QSample::Ready);
+    const QAudioFormat decodedFormat = sample->format();
+    const QByteArray decoded = sample->data();
+    sample->release();
+
+    QAudioFormat format = decodedFormat;
+    format.setChannelCount(decodedFormat.channelCount() * 2);
+    format.setSampleSize(8);
+    format.setSampleType(QAudioFormat::UnSignedInt);
+    cache.setPreferredFormat(format);
+
+    sample = cache.requestSample(url);
+    QTRY_COMPARE(sample->state(), QSample::Ready);
+    QCOMPARE(sample->format(), format);
+    QCOMPARE(sample->data().size(), decoded.size());
+    sample->release();
+
+    // a different sample rate is kept as decoded
+    format.setSampleRate(decodedFormat.sampleRate() / 2);
+    cache.setPreferredFormat(format);
+
+    sample = cache.requestSample(url);
+    QTRY_COMPARE(sample->state(), QSample::Ready);
+    QCOMPARE(sample->format(), decodedFormat);
+    QCOMPARE(sample->data(), decoded);
+    sample->release();
+    QTRY_VERIFY(!cache.isLoading());
+}
+
 QTEST_MAIN(tst_QSampleCache)
 
 #include "tst_qsamplecache.moc"
@@ -47,6 +47,12 @@
 #include <QtGui/QImage>
 #include <QtCore/QPointer>
 
+#if defined(Q_OS_UNIX) && !defined(Q_OS_ANDROID)
+#include <private/qsharedmemoryvideobuffer_p.h>
+#include <unistd.h>
+#define TEST_SHARED_MEMORY_BUFFER
+#endif
+
 // Adds an enum, and the stringized version
 #define ADD_ENUM_TEST(x) \
     QTest::newRow(#x) \
@@ -85,11 +91,17 @@ private slots:
     void assign();
     void map_data();
     void map();
+    void mapPlanes_data();
+    void mapPlanes();
+    void mapPlanarBuffer();
+    void mapSharedMemoryBuffer();
     void mapImage_data();
     void mapImage();
     void imageDetach();
     void formatConversion_data();
     void formatConversion();
+    void image_data();
+    void image();
 
     void metadata();
 
@@ -124,6 +136,42 @@ public:
     void unmap() {}
 };
 
+class QtTestPlanarVideoBuffer : public QAbstractPlanarVideoBuffer
+{
+public:
+    QtTestPlanarVideoBuffer()
+        : QAbstractPlanarVideoBuffer(NoHandle)
+        , m_mode(NotMapped)
+    {
+        memset(m_planes, 0, sizeof(m_planes));
+    }
+
+    MapMode mapMode() const { return m_mode; }
+
+    using QAbstractPlanarVideoBuffer::map;
+    int map(MapMode mode, int *numBytes, int bytesPerLine[4], uchar *data[4])
+    {
+        if (m_mode != NotMapped)
+            return 0;
+
+        m_mode = mode;
+        if (numBytes)
+            *numBytes = sizeof(m_planes);
+        for (int i = 0; i < 3; ++i) {
+            bytesPerLine[i] = 64 >> (i == 0 ? 0 : 1);
+            data[i] = m_planes[i];
+        }
+        return 3;
+    }
+
+    void unmap() { m_mode = NotMapped; }
+
+    // Each plane is deliberately larger than its data, so the planes are not
+    // where a contiguous YUV420P buffer would have them
+    uchar m_planes[3][64 * 64 * 2];
+    MapMode m_mode;
+};
+
 tst_QVideoFrame::tst_QVideoFrame()
 {
 }
@@ -684,6 +732,134 @@ void tst_QVideoFrame::map()
     QCOMPARE(frame.mapMode(), QAbstractVideoBuffer::NotMapped);
 }
 
+void tst_QVideoFrame::mapPlanes_data()
+{
+    QTest::addColumn<QVideoFrame>("frame");
+    QTest::addColumn<QList<int> >("strides");
+    QTest::addColumn<QList<int> >("offsets");
+
+    QVideoFrame planarFrame(new QtTestPlanarVideoBuffer, QSize(64, 64), QVideoFrame::Format_YUV420P);
+    QTest::newRow("Planar")
+            << planarFrame
+            << (QList<int>() << 64 << 32 << 32)
+            << (QList<int>() << 64 * 64 * 2 << 64 * 64 * 2);
+    QTest::newRow("Format_YUV420P")
+            << QVideoFrame(8096, QSize(60, 64), 64, QVideoFrame::Format_YUV420P)
+            << (QList<int>() << 64 << 62 << 62)
+            << (QList<int>() << 4096 << 1984);
+    QTest::newRow("Format_YV12 odd height")
+            << QVideoFrame(1504, QSize(32, 31), 32, QVideoFrame::Format_YV12)
+            << (QList<int>() << 32 << 16 << 16)
+            << (QList<int>() << 992 << 256);
+    QTest::newRow("Format_NV12")
+            << QVideoFrame(1536, QSize(32, 32), 32, QVideoFrame::Format_NV12)
+            << (QList<int>() << 32 << 32)
+            << (QList<int>() << 1024);
+    QTest::newRow("Format_NV21")
+            << QVideoFrame(1536, QSize(32, 32), 32, QVideoFrame::Format_NV21)
+            << (QList<int>() << 32 << 32)
+            << (QList<int>() << 1024);
+    QTest::newRow("Format_ARGB32")
+            << QVideoFrame(1024, QSize(16, 16), 64, QVideoFrame::Format_ARGB32)
+            << (QList<int>() << 64)
+            << QList<int>();
+}
+
+void tst_QVideoFrame::mapPlanes()
+{
+    QFETCH(QVideoFrame, frame);
+    QFETCH(QList<int>, strides);
+    QFETCH(QList<int>, offsets);
+
+    QCOMPARE(frame.planeCount(), 0);
+    QVERIFY(!frame.bits(0));
+
+    QVERIFY(frame.map(QAbstractVideoBuffer::ReadOnly));
+    QCOMPARE(frame.planeCount(), strides.count());
+    QCOMPARE(frame.bits(0), frame.bits());
+    QCOMPARE(frame.bytesPerLine(0), frame.bytesPerLine());
+
+    for (int i = 0; i < strides.count(); ++i)
+        QCOMPARE(frame.bytesPerLine(i), strides.at(i));
+    for (int i = 0; i < offsets.count(); ++i)
+        QCOMPARE(int(frame.bits(i + 1) - frame.bits(i)), offsets.at(i));
+
+    // Planes past the plane count are not mapped
+    QVERIFY(!frame.bits(strides.count()));
+    QCOMPARE(frame.bytesPerLine(strides.count()), 0);
+    QVERIFY(!frame.bits(-1));
+
+    frame.unmap();
+
+    QCOMPARE(frame.planeCount(), 0);
+    for (int i = 0; i < 4; ++i) {
+        QVERIFY(!frame.bits(i));
+        QCOMPARE(frame.bytesPerLine(i), 0);
+    }
+}
+
+void tst_QVideoFrame::mapPlanarBuffer()
+{
+    QtTestPlanarVideoBuffer *buffer = new QtTestPlanarVideoBuffer;
+    QVideoFrame frame(buffer, QSize(64, 64), QVideoFrame::Format_YV12);
+
+    QVERIFY(frame.map(QAbstractVideoBuffer::WriteOnly));
+    QCOMPARE(buffer->mapMode(), QAbstractVideoBuffer::WriteOnly);
+    QCOMPARE(frame.planeCount(), 3);
+
+    // The planes are returned as the buffer mapped them, without being
+    // recalculated from the pixel format
+    for (int i = 0; i < 3; ++i)
+        QCOMPARE(frame.bits(i), buffer->m_planes[i]);
+
+    frame.unmap();
+    QCOMPARE(buffer->mapMode(), QAbstractVideoBuffer::NotMapped);
+
+    // Mapping through the single plane interface returns the first plane
+    int numBytes = 0;
+    int bytesPerLine = 0;
+    QCOMPARE(buffer->map(QAbstractVideoBuffer::ReadOnly, &numBytes, &bytesPerLine),
+             buffer->m_planes[0]);
+    QCOMPARE(numBytes, int(sizeof(buffer->m_planes)));
+    QCOMPARE(bytesPerLine, 64);
+    buffer->unmap();
+}
+
+void tst_QVideoFrame::mapSharedMemoryBuffer()
+{
+#ifdef TEST_SHARED_MEMORY_BUFFER
+    const int fd = QSharedMemoryVideoBuffer::createFileDescriptor(8192);
+    QVERIFY(fd >= 0);
+
+    // Two buffers importing the same memory, the second at an offset that
+    // isn't page aligned
+    QVideoFrame frame(new QSharedMemoryVideoBuffer(fd, 1024, 64, 0),
+                      QSize(16, 16), QVideoFrame::Format_ARGB32);
+    QVideoFrame imported(new QSharedMemoryVideoBuffer(fd, 1024, 64, 100),
+                         QSize(16, 16), QVideoFrame::Format_ARGB32);
+    ::close(fd);
+
+    QCOMPARE(frame.handleType(), QAbstractVideoBuffer::SharedMemoryHandle);
+    QVERIFY(frame.handle().toInt() >= 0);
+    QVERIFY(frame.handle().toInt() != imported.handle().toInt());
+
+    QVERIFY(frame.map(QAbstractVideoBuffer::WriteOnly));
+    QCOMPARE(frame.mappedBytes(), 1024);
+    QCOMPARE(frame.bytesPerLine(), 64);
+    memset(frame.bits(), 0, frame.mappedBytes());
+    frame.bits()[100] = 0x5a;
+    frame.unmap();
+
+    QVERIFY(imported.map(QAbstractVideoBuffer::ReadOnly));
+    QCOMPARE(int(imported.bits()[0]), 0x5a);
+    imported.unmap();
+
+    QCOMPARE(QSharedMemoryVideoBuffer::createFileDescriptor(0), -1);
+#else
+    QSKIP("Shared memory video buffers are not supported on this platform");
+#endif
+}
+
 void tst_QVideoFrame::mapImage_data()
 {
     QTest::addColumn<QSize>("size");
@@ -905,6 +1081,80 @@ void tst_QVideoFrame::formatConversion()
              pixelFormat != QVideoFrame::Format_Invalid);
 }
 
+void tst_QVideoFrame::image_data()
+{
+    QTest::addColumn<QVideoFrame::PixelFormat>("pixelFormat");
+    QTest::addColumn<QSize>("frameSize");
+    QTest::addColumn<int>("bytesPerLine");
+    QTest::addColumn<QByteArray>("data");
+    QTest::addColumn<QSize>("requestedSize");
+    QTest::addColumn<QSize>("expectedSize");
+    QTest::addColumn<uint>("expectedPixel");
+
+    QTest::newRow("RGB32")
+            << QVideoFrame::Format_RGB32 << QSize(2, 2) << 8
+            << QByteArray("\x30\x20\x10\xff", 4).repeated(4)
+            << QSize() << QSize(2, 2) << 0xff102030u;
+    QTest::newRow("BGR24 scaled")
+            << QVideoFrame::Format_BGR24 << QSize(4, 2) << 12
+            << QByteArray("\x30\x20\x10", 3).repeated(8)
+            << QSize(2, 1) << QSize(2, 1) << 0xff102030u;
+    QTest::newRow("ARGB32 premultiplied scaled")
+            << QVideoFrame::Format_ARGB32_Premultiplied << QSize(2, 1) << 8
+            << QByteArray("\x80\x80\x80\x80", 4).repeated(2)
+            << QSize(1, 1) << QSize(1, 1) << 0x80ffffffu;
+    QTest::newRow("YUV420P grey")
+            << QVideoFrame::Format_YUV420P << QSize(4, 4) << 4
+            << QByteArray(24, char(128))
+            << QSize() << QSize(4, 4) << 0xff828282u;
+    QTest::newRow("YUV420P black scaled")
+            << QVideoFrame::Format_YUV420P << QSize(4, 4) << 4
+            << QByteArray(16, char(16)) + QByteArray(8, char(128))
+            << QSize(2, 2) << QSize(2, 2) << 0xff000000u;
+    QTest::newRow("NV12 white")
+            << QVideoFrame::Format_NV12 << QSize(4, 4) << 4
+            << QByteArray(16, char(235)) + QByteArray(8, char(128))
+            << QSize() << QSize(4, 4) << 0xffffffffu;
+    QTest::newRow("UYVY grey")
+            << QVideoFrame::Format_UYVY << QSize(4, 2) << 8
+            << QByteArray(16, char(128))
+            << QSize() << QSize(4, 2) << 0xff828282u;
+}
+
+void tst_QVideoFrame::image()
+{
+    QFETCH(QVideoFrame::PixelFormat, pixelFormat);
+    QFETCH(QSize, frameSize);
+    QFETCH(int, bytesPerLine);
+    QFETCH(QByteArray, data);
+    QFETCH(QSize, requestedSize);
+    QFETCH(QSize, expectedSize);
+    QFETCH(uint, expectedPixel);
+
+    QVideoFrame frame(data.size(), frameSize, bytesPerLine, pixelFormat);
+    QVERIFY(frame.map(QAbstractVideoBuffer::WriteOnly));
+    QCOMPARE(frame.mappedBytes(), data.size());
+    memcpy(frame.bits(), data.constData(), data.size());
+    frame.unmap();
+
+    const QImage image = frame.image(requestedSize);
+    QVERIFY(!frame.isMapped());
+    QCOMPARE(image.size(), expectedSize);
+    for (int y = 0; y < image.height(); ++y) {
+        for (int x = 0; x < image.width(); ++x)
+            QCOMPARE(image.pixel(x, y), expectedPixel);
+    }
+
+    // A frame that is mapped write only can't be read back
+    QVERIFY(frame.map(QAbstractVideoBuffer::WriteOnly));
+    QVERIFY(frame.image(requestedSize).isNull());
+    frame.unmap();
+
+    // Compressed frames have no image
+    QVideoFrame jpeg(data.size(), frameSize, bytesPerLine, QVideoFrame::Format_Jpeg);
+    QVERIFY(jpeg.image().isNull());
+}
+
 void tst_QVideoFrame::metadata()
 {
     // Simple metadata test
@@ -0,0 +1,207 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+//TESTED_COMPONENT=src/multimedia
+
+#include <QtTest/QtTest>
+
+#include <qvideoframe.h>
+#include <private/qvideoframeconversionhelper_p.h>
+
+QT_USE_NAMESPACE
+
+namespace {
+
+struct Color
+{
+    uchar y;
+    uchar u;
+    uchar v;
+    QRgb rgb;
+};
+
+// Limited range BT.601 encodings of the colour bar colours
+const Color colors[] = {
+    {  16, 128, 128, qRgb(  0,   0,   0) },
+    { 235, 128, 128, qRgb(255, 255, 255) },
+    {  81,  90, 240, qRgb(255,   0,   0) },
+    { 145,  54,  34, qRgb(  0, 255,   0) },
+    {  41, 240, 110, qRgb(  0,   0, 255) },
+    { 210,  16, 146, qRgb(255, 255,   0) },
+    { 170, 166,  16, qRgb(  0, 255, 255) },
+    { 106, 202, 222, qRgb(255,   0, 255) },
+    { 126, 128, 128, qRgb(128, 128, 128) }
+};
+const int colorCount = sizeof(colors) / sizeof(colors[0]);
+
+// Every 2x2 block, which shares its chroma samples, gets the next colour.
+// Three blocks per row pair put all colours in a 6x6 frame.
+const Color &colorAt(int x, int row)
+{
+    return colors[(x / 2 + row / 2 * 3) % colorCount];
+}
+
+void fillFrame(QVideoFrame *frame)
+{
+    const int width = frame->width();
+    const int height = frame->height();
+
+    switch (frame->pixelFormat()) {
+    case QVideoFrame::Format_YUV420P:
+        for (int row = 0; row < height; ++row) {
+            for (int x = 0; x < width; ++x)
+                frame->bits(0)[row * frame->bytesPerLine(0) + x] = colorAt(x, row).y;
+        }
+        for (int row = 0; row < height / 2; ++row) {
+            for (int x = 0; x < width / 2; ++x) {
+                frame->bits(1)[row * frame->bytesPerLine(1) + x] = colorAt(2 * x, 2 * row).u;
+                frame->bits(2)[row * frame->bytesPerLine(2) + x] = colorAt(2 * x, 2 * row).v;
+            }
+        }
+        break;
+    case QVideoFrame::Format_NV12:
+        for (int row = 0; row < height; ++row) {
+            for (int x = 0; x < width; ++x)
+                frame->bits(0)[row * frame->bytesPerLine(0) + x] = colorAt(x, row).y;
+        }
+        for (int row = 0; row < height / 2; ++row) {
+            for (int x = 0; x < width; x += 2) {
+                frame->bits(1)[row * frame->bytesPerLine(1) + x] = colorAt(x, 2 * row).u;
+                frame->bits(1)[row * frame->bytesPerLine(1) + x + 1] = colorAt(x, 2 * row).v;
+            }
+        }
+        break;
+    case QVideoFrame::Format_UYVY:
+        for (int row = 0; row < height; ++row) {
+            uchar *pair = frame->bits() + row * frame->bytesPerLine();
+            for (int x = 0; x < width; x += 2, pair += 4) {
+                pair[0] = colorAt(x, row).u;
+                pair[1] = colorAt(x, row).y;
+                pair[2] = colorAt(x, row).v;
+                pair[3] = colorAt(x + 1, row).y;
+            }
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+}
+
+Q_DECLARE_METATYPE(QVideoFrame::PixelFormat)
+
+class tst_QVideoFrameConversionHelper : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void convertToRgb32_data();
+    void convertToRgb32();
+};
+
+void tst_QVideoFrameConversionHelper::convertToRgb32_data()
+{
+    QTest::addColumn<QVideoFrame::PixelFormat>("pixelFormat");
+    QTest::addColumn<int>("width");
+    QTest::addColumn<int>("outputWidth");
+
+    const QVideoFrame::PixelFormat formats[] = {
+        QVideoFrame::Format_YUV420P,
+        QVideoFrame::Format_NV12,
+        QVideoFrame::Format_UYVY
+    };
+    const char *names[] = { "YUV420P", "NV12", "UYVY" };
+
+    for (int f = 0; f < 3; ++f) {
+        const QByteArray name(names[f]);
+
+        // Rows narrower than 8 pixels are converted by the scalar code only,
+        // wider ones go through the SIMD kernel with a scalar tail.
+        QTest::newRow(name + " scalar") << formats[f] << 6 << 6;
+        QTest::newRow(name + " sse2") << formats[f] << (4 * colorCount + 2) << (4 * colorCount + 2);
+        QTest::newRow(name + " scaled") << formats[f] << (8 * colorCount + 4) << (4 * colorCount + 2);
+    }
+}
+
+void tst_QVideoFrameConversionHelper::convertToRgb32()
+{
+    QFETCH(QVideoFrame::PixelFormat, pixelFormat);
+    QFETCH(int, width);
+    QFETCH(int, outputWidth);
+
+    const int height = 6;
+    const int bytesPerLine = pixelFormat == QVideoFrame::Format_UYVY ? 2 * width : width;
+    const int bytes = pixelFormat == QVideoFrame::Format_UYVY
+            ? bytesPerLine * height
+            : bytesPerLine * height * 3 / 2;
+
+    QVideoFrame frame(bytes, QSize(width, height), bytesPerLine, pixelFormat);
+    QVERIFY(frame.map(QAbstractVideoBuffer::ReadWrite));
+    fillFrame(&frame);
+
+    QImage output(outputWidth, height, QImage::Format_RGB32);
+    QVERIFY(qt_convertVideoFrameToRgb32(frame, QRect(0, 0, width, height), &output));
+    frame.unmap();
+
+    // Each output pixel samples the source column under its centre
+    for (int row = 0; row < height; ++row) {
+        for (int x = 0; x < outputWidth; ++x) {
+            const int sourceX = (2 * x + 1) * width / (2 * outputWidth);
+            const QRgb expected = colorAt(sourceX, row).rgb;
+            const QRgb actual = output.pixel(x, row);
+
+            // The fixed-point coefficients may be off by one from the exact values
+            if (qAbs(qRed(actual) - qRed(expected)) > 1
+                    || qAbs(qGreen(actual) - qGreen(expected)) > 1
+                    || qAbs(qBlue(actual) - qBlue(expected)) > 1) {
+                QFAIL(qPrintable(QString::fromLatin1("Pixel (%1, %2) is #%3, expected #%4")
+                                 .arg(x).arg(row)
+                                 .arg(actual & 0xffffff, 6, 16, QLatin1Char('0'))
+                                 .arg(expected & 0xffffff, 6, 16, QLatin1Char('0'))));
+            }
+        }
+    }
+}
+
+QTEST_MAIN(tst_QVideoFrameConversionHelper)
+
+#include "tst_qvideoframeconversionhelper.moc"
@@ -0,0 +1,182 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the test suite of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+//TESTED_COMPONENT=src/multimedia
+
+#include <QtTest/QtTest>
+
+#include <qvideoframepool.h>
+
+class tst_QVideoFramePool : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void frame();
+    void recycle();
+    void capacity();
+    void outlivePool();
+    void clear();
+};
+
+void tst_QVideoFramePool::frame()
+{
+    QVideoFramePool pool(16384, QSize(64, 64), 256, QVideoFrame::Format_ARGB32);
+
+    QCOMPARE(pool.mappedBytes(), 16384);
+    QCOMPARE(pool.frameSize(), QSize(64, 64));
+    QCOMPARE(pool.bytesPerLine(), 256);
+    QCOMPARE(pool.pixelFormat(), QVideoFrame::Format_ARGB32);
+
+    QVideoFrame frame = pool.frame();
+    QVERIFY(frame.isValid());
+    QCOMPARE(frame.size(), QSize(64, 64));
+    QCOMPARE(frame.pixelFormat(), QVideoFrame::Format_ARGB32);
+    QCOMPARE(frame.handleType(), QAbstractVideoBuffer::NoHandle);
+
+    QVERIFY(frame.map(QAbstractVideoBuffer::ReadWrite));
+    QVERIFY(frame.bits());
+    QCOMPARE(quintptr(frame.bits()) % 32, quintptr(0));
+    QCOMPARE(frame.mappedBytes(), 16384);
+    QCOMPARE(frame.bytesPerLine(), 256);
+    frame.unmap();
+
+    QCOMPARE(pool.activeCount(), 1);
+    QCOMPARE(pool.missCount(), 1);
+    QCOMPARE(pool.hitCount(), 0);
+}
+
+void tst_QVideoFramePool::recycle()
+{
+    QVideoFramePool pool(1536, QSize(32, 32), 32, QVideoFrame::Format_YUV420P);
+
+    QVideoFrame frame = pool.frame();
+    QVERIFY(frame.map(QAbstractVideoBuffer::WriteOnly));
+    const uchar *bits = frame.bits();
+    frame.unmap();
+
+    // A copy keeps the memory in use
+    QVideoFrame copy = frame;
+    frame = QVideoFrame();
+    QCOMPARE(pool.activeCount(), 1);
+
+    // Destroying the last copy returns it, even when still mapped
+    QVERIFY(copy.map(QAbstractVideoBuffer::ReadOnly));
+    copy = QVideoFrame();
+    QCOMPARE(pool.activeCount(), 0);
+
+    frame = pool.frame();
+    QCOMPARE(pool.hitCount(), 1);
+    QCOMPARE(pool.missCount(), 1);
+    QCOMPARE(frame.mapMode(), QAbstractVideoBuffer::NotMapped);
+    QCOMPARE(frame.startTime(), qint64(-1));
+    QVERIFY(frame.map(QAbstractVideoBuffer::ReadOnly));
+    QCOMPARE(frame.bits(), bits);
+    QCOMPARE(frame.planeCount(), 3);
+    frame.unmap();
+
+    pool.resetStatistics();
+    QCOMPARE(pool.hitCount(), 0);
+    QCOMPARE(pool.missCount(), 0);
+}
+
+void tst_QVideoFramePool::capacity()
+{
+    QVideoFramePool pool(1024, QSize(16, 16), 64, QVideoFrame::Format_RGB32);
+    QCOMPARE(pool.capacity(), 4);
+
+    pool.setCapacity(2);
+    QCOMPARE(pool.capacity(), 2);
+
+    QList<QVideoFrame> frames;
+    for (int i = 0; i < 5; ++i)
+        frames.append(pool.frame());
+    QCOMPARE(pool.activeCount(), 5);
+    QCOMPARE(pool.missCount(), 5);
+
+    // Only two of the returned frames are kept for reuse
+    frames.clear();
+    QCOMPARE(pool.activeCount(), 0);
+
+    for (int i = 0; i < 5; ++i)
+        frames.append(pool.frame());
+    QCOMPARE(pool.hitCount(), 2);
+    QCOMPARE(pool.missCount(), 8);
+
+    frames.clear();
+    pool.setCapacity(0);
+    frames.append(pool.frame());
+    QCOMPARE(pool.hitCount(), 2);
+    QCOMPARE(pool.missCount(), 9);
+}
+
+void tst_QVideoFramePool::outlivePool()
+{
+    QVideoFramePool *pool = new QVideoFramePool(1024, QSize(16, 16), 64, QVideoFrame::Format_RGB32);
+
+    QVideoFrame frame = pool->frame();
+    QVideoFrame unused = pool->frame();
+    unused = QVideoFrame();
+
+    delete pool;
+
+    QVERIFY(frame.isValid());
+    QVERIFY(frame.map(QAbstractVideoBuffer::ReadWrite));
+    QCOMPARE(frame.mappedBytes(), 1024);
+    memset(frame.bits(), 0xff, frame.mappedBytes());
+    frame.unmap();
+}
+
+void tst_QVideoFramePool::clear()
+{
+    QVideoFramePool pool(1024, QSize(16, 16), 64, QVideoFrame::Format_RGB32);
+
+    pool.frame();
+    pool.clear();
+
+    QVideoFrame frame = pool.frame();
+    QCOMPARE(pool.hitCount(), 0);
+    QCOMPARE(pool.missCount(), 2);
+}
+
+QTEST_MAIN(tst_QVideoFramePool)
+
+#include "tst_qvideoframepool.moc"
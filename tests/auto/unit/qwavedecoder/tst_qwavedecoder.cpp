@@ -78,6 +78,12 @@ private slots:
 
     void readAllAtOnce();
     void readPerByte();
+
+    void seek();
+    void mapData();
+
+    void generated_data();
+    void generated();
 };
 
 Q_DECLARE_METATYPE(tst_QWaveDecoder::Corruption)
@@ -133,11 +139,11 @@ void tst_QWaveDecoder::file_data()
     // The next file has extra data in the wave header.
     QTest::newRow("File isawav_1_16_44100_le_2.wav") << testFilePath("isawav_1_16_44100_le_2.wav")  << tst_QWaveDecoder::None << 1 << 16 << 44100 << QAudioFormat::LittleEndian;
 
-    // 32 bit waves are not supported
-    QTest::newRow("File isawav_1_32_8000_le.wav") << testFilePath("isawav_1_32_8000_le.wav")  << tst_QWaveDecoder::FormatDescriptor << 1 << 32 << 8000 << QAudioFormat::LittleEndian;
-    QTest::newRow("File isawav_1_32_44100_le.wav") << testFilePath("isawav_1_32_44100_le.wav")  << tst_QWaveDecoder::FormatDescriptor << 1 << 32 << 44100 << QAudioFormat::LittleEndian;
-    QTest::newRow("File isawav_2_32_8000_be.wav") << testFilePath("isawav_2_32_8000_be.wav")  << tst_QWaveDecoder::FormatDescriptor << 2 << 32 << 8000 << QAudioFormat::BigEndian;
-    QTest::newRow("File isawav_2_32_44100_be.wav") << testFilePath("isawav_2_32_44100_be.wav")  << tst_QWaveDecoder::FormatDescriptor << 2 << 32 << 44100 << QAudioFormat::BigEndian;
+    // 32 bit waves use WAVE_FORMAT_EXTENSIBLE
+    QTest::newRow("File isawav_1_32_8000_le.wav") << testFilePath("isawav_1_32_8000_le.wav")  << tst_QWaveDecoder::None << 1 << 32 << 8000 << QAudioFormat::LittleEndian;
+    QTest::newRow("File isawav_1_32_44100_le.wav") << testFilePath("isawav_1_32_44100_le.wav")  << tst_QWaveDecoder::None << 1 << 32 << 44100 << QAudioFormat::LittleEndian;
+    QTest::newRow("File isawav_2_32_8000_be.wav") << testFilePath("isawav_2_32_8000_be.wav")  << tst_QWaveDecoder::None << 2 << 32 << 8000 << QAudioFormat::BigEndian;
+    QTest::newRow("File isawav_2_32_44100_be.wav") << testFilePath("isawav_2_32_44100_be.wav")  << tst_QWaveDecoder::None << 2 << 32 << 44100 << QAudioFormat::BigEndian;
 }
 
 void tst_QWaveDecoder::file()
@@ -312,6 +318,187 @@ void tst_QWaveDecoder::readPerByte()
     stream.close();
 }
 
+void tst_QWaveDecoder::seek()
+{
+    QFile stream;
+    stream.setFileName(testFilePath("isawav_2_16_44100_be.wav"));
+    stream.open(QIODevice::ReadOnly);
+
+    QVERIFY(stream.isOpen());
+
+    QWaveDecoder waveDecoder(&stream);
+    QSignalSpy validFormatSpy(&waveDecoder, SIGNAL(formatKnown()));
+
+    QTRY_COMPARE(validFormatSpy.count(), 1);
+
+    const int bytesPerFrame = waveDecoder.audioFormat().bytesPerFrame();
+    QCOMPARE(bytesPerFrame, 4);
+    QCOMPARE(waveDecoder.frameCount(), waveDecoder.size() / bytesPerFrame);
+
+    QByteArray samples = waveDecoder.readAll();
+    QCOMPARE(qint64(samples.size()), waveDecoder.size());
+    QCOMPARE(waveDecoder.pos(), waveDecoder.size());
+
+    QVERIFY(waveDecoder.seekToFrame(100));
+    QCOMPARE(waveDecoder.pos(), qint64(100 * bytesPerFrame));
+    QCOMPARE(waveDecoder.read(32), samples.mid(100 * bytesPerFrame, 32));
+
+    QVERIFY(waveDecoder.seek(0));
+    QCOMPARE(waveDecoder.readAll(), samples);
+
+    QVERIFY(!waveDecoder.seek(-1));
+    QVERIFY(!waveDecoder.seek(waveDecoder.size() + 1));
+    QVERIFY(!waveDecoder.seekToFrame(waveDecoder.frameCount() + 1));
+
+    stream.close();
+}
+
+void tst_QWaveDecoder::mapData()
+{
+    QFile stream;
+    stream.setFileName(testFilePath("isawav_2_8_44100.wav"));
+    stream.open(QIODevice::ReadOnly);
+
+    QVERIFY(stream.isOpen());
+
+    QWaveDecoder waveDecoder(&stream);
+    QSignalSpy validFormatSpy(&waveDecoder, SIGNAL(formatKnown()));
+
+    QTRY_COMPARE(validFormatSpy.count(), 1);
+
+    const uchar *mapped = waveDecoder.mapData();
+    QVERIFY(mapped != 0);
+    QCOMPARE(waveDecoder.mapData(), mapped);
+
+    QByteArray samples = waveDecoder.readAll();
+    QCOMPARE(QByteArray(reinterpret_cast<const char *>(mapped), samples.size()), samples);
+
+    stream.close();
+}
+
+static void appendUInt16(QByteArray &data, quint16 value)
+{
+    uchar buf[2];
+    qToLittleEndian<quint16>(value, buf);
+    data.append(reinterpret_cast<const char *>(buf), sizeof(buf));
+}
+
+static void appendUInt32(QByteArray &data, quint32 value)
+{
+    uchar buf[4];
+    qToLittleEndian<quint32>(value, buf);
+    data.append(reinterpret_cast<const char *>(buf), sizeof(buf));
+}
+
+static void appendChunk(QByteArray &data, const char *id, const QByteArray &payload)
+{
+    data.append(id, 4);
+    appendUInt32(data, payload.size());
+    data.append(payload);
+    if (payload.size() & 1)
+        data.append('\0');
+}
+
+// Builds a little endian RIFF or RF64 wave with an odd sized chunk in front
+// of the format and a trailing chunk after the samples
+static QByteArray generateWave(quint16 formatTag, bool extensible, bool rf64, const QByteArray &samples)
+{
+    const quint16 channels = 2;
+    const quint32 sampleRate = 8000;
+    const quint16 bitsPerSample = 32;
+
+    QByteArray fmt;
+    appendUInt16(fmt, extensible ? 0xFFFE : formatTag);
+    appendUInt16(fmt, channels);
+    appendUInt32(fmt, sampleRate);
+    appendUInt32(fmt, sampleRate * channels * bitsPerSample / 8);
+    appendUInt16(fmt, channels * bitsPerSample / 8);
+    appendUInt16(fmt, bitsPerSample);
+    if (extensible) {
+        appendUInt16(fmt, 22);
+        appendUInt16(fmt, bitsPerSample);
+        appendUInt32(fmt, 0x3);
+        appendUInt16(fmt, formatTag);
+        fmt.append("\x00\x00\x00\x00\x10\x00\x80\x00\x00\xAA\x00\x38\x9B\x71", 14);
+    }
+
+    QByteArray body("WAVE");
+    if (rf64) {
+        QByteArray ds64;
+        appendUInt32(ds64, 0);
+        appendUInt32(ds64, 0);
+        appendUInt32(ds64, samples.size());
+        appendUInt32(ds64, 0);
+        appendUInt32(ds64, samples.size() / (channels * bitsPerSample / 8));
+        appendUInt32(ds64, 0);
+        appendUInt32(ds64, 0);
+        appendChunk(body, "ds64", ds64);
+    }
+    appendChunk(body, "junk", QByteArray("odd"));
+    appendChunk(body, "fmt ", fmt);
+    body.append("data", 4);
+    appendUInt32(body, rf64 ? 0xFFFFFFFF : samples.size());
+    body.append(samples);
+    appendChunk(body, "LIST", QByteArray("trailing chunk"));
+
+    QByteArray wave(rf64 ? "RF64" : "RIFF");
+    appendUInt32(wave, rf64 ? 0xFFFFFFFF : body.size());
+    wave.append(body);
+    return wave;
+}
+
+void tst_QWaveDecoder::generated_data()
+{
+    QTest::addColumn<QByteArray>("wave");
+    QTest::addColumn<QAudioFormat::SampleType>("sampleType");
+
+    QByteArray samples;
+    for (int i = 0; i < 1600; ++i)
+        samples.append(char(i));
+
+    QTest::newRow("float") << generateWave(0x0003, false, false, samples) << QAudioFormat::Float;
+    QTest::newRow("extensible float") << generateWave(0x0003, true, false, samples) << QAudioFormat::Float;
+    QTest::newRow("extensible pcm") << generateWave(0x0001, true, false, samples) << QAudioFormat::SignedInt;
+    QTest::newRow("rf64 pcm") << generateWave(0x0001, false, true, samples) << QAudioFormat::SignedInt;
+    QTest::newRow("rf64 extensible float") << generateWave(0x0003, true, true, samples) << QAudioFormat::Float;
+}
+
+void tst_QWaveDecoder::generated()
+{
+    QFETCH(QByteArray, wave);
+    QFETCH(QAudioFormat::SampleType, sampleType);
+
+    QBuffer buffer(&wave);
+    buffer.open(QIODevice::ReadOnly);
+
+    QWaveDecoder waveDecoder(&buffer);
+    QSignalSpy validFormatSpy(&waveDecoder, SIGNAL(formatKnown()));
+    QSignalSpy parsingErrorSpy(&waveDecoder, SIGNAL(parsingError()));
+
+    QTRY_COMPARE(validFormatSpy.count(), 1);
+    QCOMPARE(parsingErrorSpy.count(), 0);
+
+    QAudioFormat format = waveDecoder.audioFormat();
+    QCOMPARE(format.sampleType(), sampleType);
+    QCOMPARE(format.sampleSize(), 32);
+    QCOMPARE(format.channelCount(), 2);
+    QCOMPARE(format.sampleRate(), 8000);
+    QCOMPARE(format.byteOrder(), QAudioFormat::LittleEndian);
+
+    QCOMPARE(waveDecoder.size(), qint64(1600));
+    QCOMPARE(waveDecoder.frameCount(), qint64(200));
+    QCOMPARE(waveDecoder.duration(), 25);
+
+    // Only files can be mapped
+    QVERIFY(waveDecoder.mapData() == 0);
+
+    // The trailing chunk is not part of the samples
+    QByteArray samples = waveDecoder.readAll();
+    QCOMPARE(samples.size(), 1600);
+    QCOMPARE(samples.at(1599), char(1599));
+    QVERIFY(waveDecoder.atEnd());
+}
+
 QTEST_MAIN(tst_QWaveDecoder)
 
 #include "tst_qwavedecoder.moc"
@@ -0,0 +1,6 @@
+TARGET = tst_bench_qaudiohelpers
+
+QT += core multimedia-private testlib
+CONFIG += no_private_qt_headers_warning release
+
+SOURCES += tst_bench_qaudiohelpers.cpp
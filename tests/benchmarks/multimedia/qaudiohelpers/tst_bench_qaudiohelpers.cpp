@@ -0,0 +1,183 @@
+/****************************************************************************
+**
+** Copyright (C) 2013 Digia Plc and/or its subsidiary(-ies).
+** Contact: http://www.qt-project.org/legal
+**
+** This file is part of the Qt Toolkit.
+**
+** $QT_BEGIN_LICENSE:LGPL$
+** Commercial License Usage
+** Licensees holding valid commercial Qt licenses may use this file in
+** accordance with the commercial license agreement provided with the
+** Software or, alternatively, in accordance with the terms contained in
+** a written agreement between you and Digia.  For licensing terms and
+** conditions see http://qt.digia.com/licensing.  For further information
+** use the contact form at http://qt.digia.com/contact-us.
+**
+** GNU Lesser General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU Lesser
+** General Public License version 2.1 as published by the Free Software
+** Foundation and appearing in the file LICENSE.LGPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU Lesser General Public License version 2.1 requirements
+** will be met: http://www.gnu.org/licenses/old-licenses/lgpl-2.1.html.
+**
+** In addition, as a special exception, Digia gives you certain additional
+** rights.  These rights are described in the Digia Qt LGPL Exception
+** version 1.1, included in the file LGPL_EXCEPTION.txt in this package.
+**
+** GNU General Public License Usage
+** Alternatively, this file may be used under the terms of the GNU
+** General Public License version 3.0 as published by the Free Software
+** Foundation and appearing in the file LICENSE.GPL included in the
+** packaging of this file.  Please review the following information to
+** ensure the GNU General Public License version 3.0 requirements will be
+** met: http://www.gnu.org/copyleft/gpl.html.
+**
+**
+** $QT_END_LICENSE$
+**
+****************************************************************************/
+
+#include <QtTest/QtTest>
+#include <QtCore/qelapsedtimer.h>
+
+#include <qaudioformat.h>
+#include <private/qaudiohelpers_p.h>
+
+Q_DECLARE_METATYPE(QAudioFormat::SampleType)
+
+// Number of samples scaled per call, roughly one period of a
+// 48 kHz stereo stream.
+static const int bufferSamples = 4096;
+
+class tst_QAudioHelpers : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void multiplySamples_data();
+    void multiplySamples();
+    void mixSamples_data();
+    void mixSamples();
+};
+
+void tst_QAudioHelpers::multiplySamples_data()
+{
+    QTest::addColumn<int>("sampleSize");
+    QTest::addColumn<QAudioFormat::SampleType>("sampleType");
+    QTest::addColumn<qreal>("factor");
+
+    QTest::newRow("int8") << 8 << QAudioFormat::SignedInt << qreal(0.5);
+    QTest::newRow("uint8") << 8 << QAudioFormat::UnSignedInt << qreal(0.5);
+    QTest::newRow("int16") << 16 << QAudioFormat::SignedInt << qreal(0.5);
+    QTest::newRow("uint16") << 16 << QAudioFormat::UnSignedInt << qreal(0.5);
+    QTest::newRow("int16 amplify") << 16 << QAudioFormat::SignedInt << qreal(1.5);
+    QTest::newRow("int24") << 24 << QAudioFormat::SignedInt << qreal(0.5);
+    QTest::newRow("int32") << 32 << QAudioFormat::SignedInt << qreal(0.5);
+    QTest::newRow("uint32") << 32 << QAudioFormat::UnSignedInt << qreal(0.5);
+    QTest::newRow("float") << 32 << QAudioFormat::Float << qreal(0.5);
+}
+
+void tst_QAudioHelpers::multiplySamples()
+{
+    QFETCH(int, sampleSize);
+    QFETCH(QAudioFormat::SampleType, sampleType);
+    QFETCH(qreal, factor);
+
+    QAudioFormat format;
+    format.setSampleRate(48000);
+    format.setChannelCount(2);
+    format.setCodec(QLatin1String("audio/pcm"));
+    format.setByteOrder(QAudioFormat::LittleEndian);
+    format.setSampleSize(sampleSize);
+    format.setSampleType(sampleType);
+
+    const int bytes = bufferSamples * sampleSize / 8;
+    QByteArray source(bytes, Qt::Uninitialized);
+    for (int i = 0; i < bytes; ++i)
+        source[i] = char(qrand());
+    if (sampleType == QAudioFormat::Float) {
+        float *samples = reinterpret_cast<float *>(source.data());
+        for (int i = 0; i < bufferSamples; ++i)
+            samples[i] = float(qrand()) / RAND_MAX * 2 - 1;
+    }
+    QByteArray destination(bytes, Qt::Uninitialized);
+
+    // Report throughput in samples per second rather than time per call
+    qint64 iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        QAudioHelperInternal::qMultiplySamples(factor, format,
+                                               source.constData(), destination.data(), bytes);
+        ++iterations;
+    }
+    const qint64 elapsed = qMax<qint64>(1, timer.nsecsElapsed());
+
+    const qreal samplesPerSecond = qreal(iterations) * bufferSamples * 1000000000 / elapsed;
+    QTest::setBenchmarkResult(samplesPerSecond, QTest::Events);
+}
+
+void tst_QAudioHelpers::mixSamples_data()
+{
+    QTest::addColumn<int>("sampleSize");
+    QTest::addColumn<QAudioFormat::SampleType>("sampleType");
+    QTest::addColumn<int>("voices");
+
+    QTest::newRow("int16, 1 voice") << 16 << QAudioFormat::SignedInt << 1;
+    QTest::newRow("int16, 8 voices") << 16 << QAudioFormat::SignedInt << 8;
+    QTest::newRow("float, 1 voice") << 32 << QAudioFormat::Float << 1;
+    QTest::newRow("float, 8 voices") << 32 << QAudioFormat::Float << 8;
+}
+
+void tst_QAudioHelpers::mixSamples()
+{
+    QFETCH(int, sampleSize);
+    QFETCH(QAudioFormat::SampleType, sampleType);
+    QFETCH(int, voices);
+
+    QAudioFormat format;
+    format.setSampleRate(48000);
+    format.setChannelCount(2);
+    format.setCodec(QLatin1String("audio/pcm"));
+    format.setByteOrder(QAudioFormat::Endian(QSysInfo::ByteOrder));
+    format.setSampleSize(sampleSize);
+    format.setSampleType(sampleType);
+    QVERIFY(QAudioHelperInternal::qIsMixableFormat(format));
+
+    const int bytes = bufferSamples * sampleSize / 8;
+    QByteArray source(bytes, Qt::Uninitialized);
+    for (int i = 0; i < bytes; ++i)
+        source[i] = char(qrand());
+    if (sampleType == QAudioFormat::Float) {
+        float *samples = reinterpret_cast<float *>(source.data());
+        for (int i = 0; i < bufferSamples; ++i)
+            samples[i] = float(qrand()) / RAND_MAX * 2 - 1;
+    }
+    QVector<float> accumulator(bufferSamples);
+    QByteArray destination(bytes, Qt::Uninitialized);
+
+    // One iteration mixes all voices into a block and stores it
+    qint64 iterations = 0;
+    QElapsedTimer timer;
+    timer.start();
+    QBENCHMARK {
+        accumulator.fill(0);
+        for (int voice = 0; voice < voices; ++voice) {
+            QAudioHelperInternal::qMixSamples(qreal(0.5), format, source.constData(),
+                                              accumulator.data(), bufferSamples);
+        }
+        QAudioHelperInternal::qStoreMixedSamples(format, accumulator.constData(),
+                                                 destination.data(), bufferSamples);
+        ++iterations;
+    }
+    const qint64 elapsed = qMax<qint64>(1, timer.nsecsElapsed());
+
+    const qreal samplesPerSecond = qreal(iterations) * voices * bufferSamples * 1000000000 / elapsed;
+    QTest::setBenchmarkResult(samplesPerSecond, QTest::Events);
+}
+
+QTEST_MAIN(tst_QAudioHelpers)
+
+#include "tst_bench_qaudiohelpers.moc"